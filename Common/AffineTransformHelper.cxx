@@ -33,29 +33,38 @@
 #include "AffineTransformHelper.h"
 #include "itkMatrixOffsetTransformBase.h"
 #include "itkIdentityTransform.h"
+#include "itkCompositeTransform.h"
+#include "itkDisplacementFieldTransform.h"
 #include "itkTransformFileWriter.h"
 #include "itkTransformFileReader.h"
 #include "itkTransformFactory.h"
+#include "itkImageFileReader.h"
+#include "itkMetaDataObject.h"
+#include "itksys/SystemTools.hxx"
 #include "IRISException.h"
 #include "Registry.h"
 
+// Key under which the file name of a displacement field is stored in the
+// field's metadata dictionary
+static const char *WarpFileKey = "ITK-SNAP.WarpFile";
+
+typedef itk::DisplacementFieldTransform<double, 3> WarpTransform;
+typedef itk::CompositeTransform<double, 3> CompositeTransform;
+
 void AffineTransformHelper::GetMatrixAndOffset(
     const ITKTransformBase *t, ITKMatrix &mat, ITKVector &off)
 {
-  typedef itk::MatrixOffsetTransformBase<double, 3, 3> TransformBase;
-  const TransformBase *tb = dynamic_cast<const TransformBase *>(t);
-
-  mat.SetIdentity();
-  off.Fill(0.0);
-  if(tb)
-    {
-    mat = tb->GetMatrix();
-    off = tb->GetOffset();
-    }
+  SmartPtr<const ITKTransformMOTB> tb = CastToMOTB(t);
+  mat = tb->GetMatrix();
+  off = tb->GetOffset();
 }
 
 bool AffineTransformHelper::IsIdentity(const ITKTransformBase *t, double tol)
 {
+  // A displacement field is never treated as the identity
+  if(!IsLinear(t))
+    return false;
+
   // Get matrix and offset
   ITKMatrix matrix;
   ITKVector offset;
@@ -78,8 +87,96 @@ bool AffineTransformHelper::IsIdentity(const ITKTransformBase *t, double tol)
   return is_identity;
 }
 
+bool AffineTransformHelper::IsLinear(const ITKTransformBase *t)
+{
+  return !t || t->GetTransformCategory() == ITKTransformBase::Linear;
+}
+
+SmartPtr<AffineTransformHelper::ITKTransformBase>
+AffineTransformHelper::CreateDeformableTransform(
+    DisplacementField *field, const ITKTransformBase *affine)
+{
+  SmartPtr<WarpTransform> warp = WarpTransform::New();
+  warp->SetDisplacementField(field);
+
+  SmartPtr<ITKTransformBase> result;
+  if(!affine || IsIdentity(affine))
+    {
+    result = warp.GetPointer();
+    }
+  else
+    {
+    // The composite transform applies the last added transform first
+    SmartPtr<CompositeTransform> comp = CompositeTransform::New();
+    comp->AddTransform(const_cast<ITKTransformBase *>(affine));
+    comp->AddTransform(warp);
+    result = comp.GetPointer();
+    }
+
+  return result;
+}
+
+SmartPtr<AffineTransformHelper::ITKTransformBase>
+AffineTransformHelper::ReadDeformableTransform(
+    const char *file, const ITKTransformBase *affine)
+{
+  typedef itk::ImageFileReader<DisplacementField> ReaderType;
+  SmartPtr<ReaderType> reader = ReaderType::New();
+  reader->SetFileName(file);
+  try
+    {
+    reader->Update();
+    }
+  catch(itk::ExceptionObject &exc)
+    {
+    throw IRISException("Failed to read displacement field from file %s: %s",
+                        file, exc.GetDescription());
+    }
+
+  // Remember where the field came from
+  SmartPtr<DisplacementField> field = reader->GetOutput();
+  field->DisconnectPipeline();
+  itk::EncapsulateMetaData<std::string>(
+        field->GetMetaDataDictionary(), WarpFileKey,
+        itksys::SystemTools::CollapseFullPath(file));
+
+  SmartPtr<const ITKTransformMOTB> motb = CastToMOTB(affine);
+  return CreateDeformableTransform(field, motb);
+}
+
+AffineTransformHelper::DisplacementField *
+AffineTransformHelper::GetDisplacementField(const ITKTransformBase *t)
+{
+  const WarpTransform *warp = dynamic_cast<const WarpTransform *>(t);
+
+  // CreateDeformableTransform puts the warp last in the composite
+  const CompositeTransform *comp = dynamic_cast<const CompositeTransform *>(t);
+  for(unsigned int i = 0; comp && !warp && i < comp->GetNumberOfTransforms(); i++)
+    {
+    const ITKTransformBase *ti = comp->GetNthTransformConstPointer(i);
+    warp = dynamic_cast<const WarpTransform *>(ti);
+    }
 
+  return warp ? const_cast<DisplacementField *>(warp->GetDisplacementField()) : NULL;
+}
 
+SmartPtr<const AffineTransformHelper::ITKTransformMOTB>
+AffineTransformHelper::GetAffinePart(const ITKTransformBase *t)
+{
+  return CastToMOTB(t);
+}
+
+SmartPtr<AffineTransformHelper::ITKTransformBase>
+AffineTransformHelper::ReplaceAffinePart(
+    const ITKTransformBase *t, const ITKTransformBase *affine)
+{
+  DisplacementField *field = GetDisplacementField(t);
+  if(field)
+    return CreateDeformableTransform(field, affine);
+
+  SmartPtr<ITKTransformBase> result = const_cast<ITKTransformBase *>(affine);
+  return result;
+}
 
 void AffineTransformHelper::WriteAsITKTransform(const ITKTransformBase *t, const char *file)
 {
@@ -192,15 +289,20 @@ AffineTransformHelper::ReadFromRegistry(Registry *reg)
       matrix(i, j) = folder[folder.Key("Matrix.Element[%d][%d]",i,j)][matrix(i,j)];
     }
 
-  // Check the matrix and offset for being identity
-  if(matrix.GetVnlMatrix().is_identity() && offset.GetVnlVector().is_zero())
-    return transform;
+  // Use the matrix/offset transform unless it is the identity
+  if(!matrix.GetVnlMatrix().is_identity() || !offset.GetVnlVector().is_zero())
+    {
+    SmartPtr<ITKTransformMOTB> motb = ITKTransformMOTB::New();
+    motb->SetMatrix(matrix);
+    motb->SetOffset(offset);
+    transform = motb.GetPointer();
+    }
+
+  // Apply the displacement field, if any, before the affine transform
+  std::string warp_file = folder["WarpFile"][""];
+  if(warp_file.length())
+    transform = ReadDeformableTransform(warp_file.c_str(), transform);
 
-  // Use the matrix/offset transform
-  SmartPtr<ITKTransformMOTB> motb = ITKTransformMOTB::New();
-  motb->SetMatrix(matrix);
-  motb->SetOffset(offset);
-  transform = motb.GetPointer();
   return transform;
 }
 
@@ -210,21 +312,36 @@ void AffineTransformHelper
   // Get the target folder
   Registry &folder = reg->Folder("ImageTransform");
 
-  // Cast the transform to the matrix/offset type
+  // Cast the transform to the matrix/offset type. For a deformable transform
+  // this is its affine part
   SmartPtr<const ITKTransformMOTB> motb = CastToMOTB(t);
 
+  // The displacement field can only be saved by referring to its file
+  std::string warp_file;
+  DisplacementField *field = GetDisplacementField(t);
+  if(field)
+    itk::ExposeMetaData<std::string>(
+          field->GetMetaDataDictionary(), WarpFileKey, warp_file);
+
   // Check for identity
-  if(!motb || (motb->GetMatrix().GetVnlMatrix().is_identity() &&
-               motb->GetOffset().GetVnlVector().is_zero()))
+  if(warp_file.empty() &&
+     motb->GetMatrix().GetVnlMatrix().is_identity() &&
+     motb->GetOffset().GetVnlVector().is_zero())
     {
     folder["IsIdentity"] << true;
     folder.RemoveKeys("Matrix");
     folder.RemoveKeys("Offset");
+    folder.RemoveKeys("WarpFile");
     }
   else
     {
     folder["IsIdentity"] << false;
 
+    if(warp_file.length())
+      folder["WarpFile"] << warp_file;
+    else
+      folder.RemoveKeys("WarpFile");
+
     for(int i = 0; i < 3; i++)
       {
       folder[folder.Key("Offset.Element[%d]",i)] << motb->GetOffset()[i];
@@ -262,6 +379,15 @@ SmartPtr<const AffineTransformHelper::ITKTransformMOTB>
 AffineTransformHelper::CastToMOTB(const ITKTransformBase *t)
 {
   ITKTransformMOTB::ConstPointer p = dynamic_cast<const ITKTransformMOTB *>(t);
+
+  // The affine part of a deformable transform from CreateDeformableTransform
+  const CompositeTransform *comp = dynamic_cast<const CompositeTransform *>(t);
+  for(unsigned int i = 0; comp && p.IsNull() && i < comp->GetNumberOfTransforms(); i++)
+    {
+    const ITKTransformBase *ti = comp->GetNthTransformConstPointer(i);
+    p = dynamic_cast<const ITKTransformMOTB *>(ti);
+    }
+
   if(p.IsNull())
     {
     ITKMatrix matrix; matrix.SetIdentity();
@@ -41,6 +41,7 @@ namespace itk {
   template <class TScalar, unsigned int V1, unsigned int V2> class MatrixOffsetTransformBase;
   template <class TScalar, unsigned int V1, unsigned int V2> class Matrix;
   template <class TScalar, unsigned int V1> class Vector;
+  template <class TPixel, unsigned int V1> class Image;
 }
 
 class Registry;
@@ -61,6 +62,7 @@ public:
   typedef itk::Matrix<double, 3, 3>                                  ITKMatrix;
   typedef itk::Vector<double, 3>                                     ITKVector;
   typedef vnl_matrix_fixed<double, 4, 4>                                 Mat44;
+  typedef itk::Image<itk::Vector<double, 3>, 3>                 DisplacementField;
 
   // Get the matrix and offset from a transform
   static void GetMatrixAndOffset(const ITKTransformBase *t, ITKMatrix &mat, ITKVector &off);
@@ -68,6 +70,30 @@ public:
   // Check if the transform is identity
   static bool IsIdentity(const ITKTransformBase *t, double tol = 1e-5);
 
+  // Check if the transform is linear, i.e., does not involve a displacement field
+  static bool IsLinear(const ITKTransformBase *t);
+
+  // Create a transform that displaces the point by the field (given in the
+  // reference space) and then maps it through the affine transform, if any
+  static SmartPtr<ITKTransformBase> CreateDeformableTransform(
+      DisplacementField *field, const ITKTransformBase *affine = NULL);
+
+  // Read a displacement field from an image file and compose it with the
+  // affine part of the given transform, as CreateDeformableTransform does.
+  // The file name is kept with the field so the transform can be saved.
+  static SmartPtr<ITKTransformBase> ReadDeformableTransform(
+      const char *file, const ITKTransformBase *affine = NULL);
+
+  // Get the displacement field of a deformable transform, or NULL
+  static DisplacementField *GetDisplacementField(const ITKTransformBase *t);
+
+  // Get the affine part of a transform (identity if there is none)
+  static SmartPtr<const ITKTransformMOTB> GetAffinePart(const ITKTransformBase *t);
+
+  // Replace the affine part of a transform, keeping its displacement field
+  static SmartPtr<ITKTransformBase> ReplaceAffinePart(
+      const ITKTransformBase *t, const ITKTransformBase *affine);
+
   // Save as an ITK transform file
   static void WriteAsITKTransform(const ITKTransformBase *t, const char *file);
 
@@ -83,7 +109,9 @@ public:
   // Read transform from registry
   static SmartPtr<ITKTransformBase> ReadFromRegistry(Registry *reg);
 
-  // Write transform to registry
+  // Write transform to registry. The displacement field of a deformable
+  // transform is saved as a reference to the file it was read from; a field
+  // that was not read from a file is not saved, only the affine part is.
   static void WriteToRegistry(Registry *reg, const ITKTransformBase *t);
 
   // Get the RAS matrix
@@ -88,6 +88,27 @@ void GetImagePhysicalExtents(itk::ImageBase<VDim> *image,
     }
 }
 
+/**
+ * The smallest stride, same along all axes, for which a regular subsample of
+ * the region (taking every stride-th voxel along each axis) has at most
+ * maxSamples voxels. Used to estimate image statistics from a subsample.
+ */
+template <unsigned int VDim>
+unsigned int GetRegularSamplingStride(const itk::ImageRegion<VDim> &region,
+                                      unsigned long maxSamples)
+{
+  unsigned int stride;
+  for(stride = 1; ; stride++)
+    {
+    double n = 1.0;
+    for(unsigned int d = 0; d < VDim; d++)
+      n *= (region.GetSize(d) + stride - 1) / stride;
+    if(n <= maxSamples)
+      break;
+    }
+  return stride;
+}
+
 
 
 #endif // IMAGEFUNCTIONS_H
@@ -0,0 +1,403 @@
+#include "SharedImageSegment.h"
+#include "itksys/MD5.h"
+#include "itksys/SystemTools.hxx"
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+
+#ifndef WIN32
+  #include <sys/types.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <signal.h>
+#endif
+
+// Segment states. A newly created segment is zero-filled, i.e., being written
+enum { STATE_WRITING = 0, STATE_READY, STATE_DEAD };
+
+// Largest number of processes using one segment
+enum { MAX_USERS = 64 };
+
+// Identifies the layout of the header, must change when the header changes
+static const char SEGMENT_MAGIC[8] = { 'S', 'N', 'A', 'P', 'S', 'H', 'M', '2' };
+
+struct SharedImageSegment::Header
+{
+  char Magic[8];
+  std::atomic<int> State;
+  long PublisherPID;
+  unsigned long long DataSize;
+  ImageInfo Info;
+  char FileHash[64];
+  char ContentDigest[64];
+  std::atomic<long> Users[MAX_USERS];
+};
+
+#ifndef WIN32
+
+static bool IsProcessRunning(long pid)
+{
+  // Signal 0 checks that the process exists without sending anything
+  return kill((pid_t) pid, 0) == 0 || errno == EPERM;
+}
+
+// Size of the header rounded up to a page, so that the data can be mapped
+static size_t GetHeaderSize()
+{
+  size_t page = (size_t) sysconf(_SC_PAGESIZE);
+  return ((sizeof(SharedImageSegment::Header) + page - 1) / page) * page;
+}
+
+static int CountLiveUsersInHeader(SharedImageSegment::Header *hdr)
+{
+  int n = 0;
+  for(int i = 0; i < MAX_USERS; i++)
+    {
+    long pid = hdr->Users[i].load();
+    if(pid == 0)
+      continue;
+
+    // Processes that died without releasing the segment are removed
+    if(IsProcessRunning(pid))
+      n++;
+    else
+      hdr->Users[i].compare_exchange_strong(pid, 0);
+    }
+  return n;
+}
+
+#endif
+
+SharedImageSegment::SharedImageSegment()
+{
+  m_Header = NULL;
+  m_Data = NULL;
+  m_DataSize = 0;
+  m_HeaderSize = 0;
+  m_Handle = -1;
+
+#ifdef WIN32
+  m_ProcessID = 0;
+#else
+  m_ProcessID = getpid();
+#endif
+}
+
+SharedImageSegment::~SharedImageSegment()
+{
+  this->Release();
+}
+
+bool SharedImageSegment::IsSupported()
+{
+#ifdef WIN32
+  return false;
+#else
+  return true;
+#endif
+}
+
+std::string
+SharedImageSegment::MakeFileHash(const char *filename, const std::string &extra)
+{
+  if(!itksys::SystemTools::FileExists(filename))
+    return std::string();
+
+  std::ostringstream oss;
+  oss << itksys::SystemTools::GetRealPath(filename) << "|"
+      << itksys::SystemTools::FileLength(filename) << "|"
+      << itksys::SystemTools::ModifiedTime(filename) << "|"
+      << extra << "|"
+      << std::string(SEGMENT_MAGIC, 8);
+  std::string id = oss.str();
+
+  char hex_code[33];
+  hex_code[32] = 0;
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+  itksysMD5_Append(md5, (unsigned char *) id.c_str(), id.size());
+  itksysMD5_FinalizeHex(md5, hex_code);
+  itksysMD5_Delete(md5);
+
+  return std::string(hex_code);
+}
+
+std::string
+SharedImageSegment::MakeKey(const char *filename, const std::string &extra)
+{
+  std::string hash = MakeFileHash(filename, extra);
+  if(hash.empty())
+    return hash;
+
+  // Keep the name short, since some systems limit it to 31 characters
+  return std::string("/itksnap-") + hash.substr(0, 20);
+}
+
+#ifndef WIN32
+
+bool SharedImageSegment::RemoveIfStale(const std::string &name)
+{
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if(fd < 0)
+    return false;
+
+  // A segment without a header may be in the middle of being created
+  struct stat st;
+  size_t hsize = GetHeaderSize();
+  if(fstat(fd, &st) != 0 || (size_t) st.st_size < hsize)
+    {
+    close(fd);
+    return false;
+    }
+
+  void *p = mmap(NULL, hsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if(p == MAP_FAILED)
+    return false;
+
+  Header *hdr = static_cast<Header *>(p);
+  int state = hdr->State.load();
+  bool stale = false;
+  if(state == STATE_DEAD)
+    stale = true;
+  else if(state == STATE_WRITING)
+    stale = hdr->PublisherPID != 0 && !IsProcessRunning(hdr->PublisherPID);
+  else if(CountLiveUsersInHeader(hdr) == 0)
+    stale = hdr->State.compare_exchange_strong(state, STATE_DEAD);
+
+  munmap(p, hsize);
+
+  if(stale)
+    shm_unlink(name.c_str());
+  return stale;
+}
+
+bool SharedImageSegment::AddUser()
+{
+  CountLiveUsersInHeader(m_Header);
+  for(int i = 0; i < MAX_USERS; i++)
+    {
+    long empty = 0;
+    if(m_Header->Users[i].compare_exchange_strong(empty, m_ProcessID))
+      return true;
+    }
+  return false;
+}
+
+void SharedImageSegment::RemoveUser()
+{
+  for(int i = 0; i < MAX_USERS; i++)
+    {
+    long pid = m_ProcessID;
+    if(m_Header->Users[i].compare_exchange_strong(pid, 0))
+      return;
+    }
+}
+
+int SharedImageSegment::CountLiveUsers() const
+{
+  return CountLiveUsersInHeader(m_Header);
+}
+
+bool SharedImageSegment::MapData()
+{
+  void *p = mmap(NULL, m_DataSize, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                 m_Handle, (off_t) m_HeaderSize);
+  m_Data = (p == MAP_FAILED) ? NULL : p;
+  return m_Data != NULL;
+}
+
+bool SharedImageSegment::Publish(
+    const std::string &key, const ImageInfo &info,
+    const void *data, size_t size,
+    const std::string &fileHash, const std::string &contentDigest)
+{
+  this->Release();
+  if(key.empty() || size == 0)
+    return false;
+
+  // Create the segment. If it exists, it may have been left behind
+  int fd = shm_open(key.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd < 0 && errno == EEXIST && RemoveIfStale(key))
+    fd = shm_open(key.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if(fd < 0)
+    return false;
+
+  m_Name = key;
+  m_Handle = fd;
+  m_HeaderSize = GetHeaderSize();
+  m_DataSize = size;
+
+  // Reserve the memory up front. Otherwise, running out of shared memory
+  // would crash the process when the data are copied
+  off_t total = (off_t) (m_HeaderSize + m_DataSize);
+  bool ok = ftruncate(fd, total) == 0;
+#ifdef __linux__
+  ok = ok && posix_fallocate(fd, 0, total) == 0;
+#endif
+
+  void *p = ok ? mmap(NULL, m_HeaderSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  if(p == MAP_FAILED)
+    {
+    close(fd);
+    shm_unlink(key.c_str());
+    m_Handle = -1;
+    m_Name.clear();
+    return false;
+    }
+
+  // Fill out the header
+  m_Header = static_cast<Header *>(p);
+  m_Header->PublisherPID = m_ProcessID;
+  memcpy(m_Header->Magic, SEGMENT_MAGIC, 8);
+  m_Header->DataSize = size;
+  m_Header->Info = info;
+  strncpy(m_Header->FileHash, fileHash.c_str(), sizeof(m_Header->FileHash) - 1);
+  strncpy(m_Header->ContentDigest, contentDigest.c_str(), sizeof(m_Header->ContentDigest) - 1);
+
+  // Copy the data through a shared mapping
+  void *q = mmap(NULL, m_DataSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, (off_t) m_HeaderSize);
+  ok = (q != MAP_FAILED);
+  if(ok)
+    {
+    memcpy(q, data, size);
+    munmap(q, m_DataSize);
+    }
+
+  // Map the data the same way as the other users do
+  ok = ok && this->AddUser() && this->MapData();
+  if(!ok)
+    {
+    m_Header->State.store(STATE_DEAD);
+    shm_unlink(key.c_str());
+    this->Release();
+    return false;
+    }
+
+  // Other processes can now attach
+  m_Header->State.store(STATE_READY);
+  return true;
+}
+
+bool SharedImageSegment::Attach(const std::string &key)
+{
+  this->Release();
+  if(key.empty())
+    return false;
+
+  int fd = shm_open(key.c_str(), O_RDWR, 0);
+  if(fd < 0)
+    return false;
+
+  struct stat st;
+  size_t hsize = GetHeaderSize();
+  void *p = MAP_FAILED;
+  if(fstat(fd, &st) == 0 && (size_t) st.st_size >= hsize)
+    p = mmap(NULL, hsize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  if(p == MAP_FAILED)
+    {
+    close(fd);
+    return false;
+    }
+
+  m_Name = key;
+  m_Handle = fd;
+  m_Header = static_cast<Header *>(p);
+  m_HeaderSize = hsize;
+  m_DataSize = (size_t) m_Header->DataSize;
+
+  // The segment must be complete. After registering as a user, check that the
+  // segment was not removed by the last user in the meantime
+  bool ok = memcmp(m_Header->Magic, SEGMENT_MAGIC, 8) == 0
+            && m_Header->State.load() == STATE_READY
+            && m_DataSize > 0
+            && (size_t) st.st_size >= m_HeaderSize + m_DataSize;
+
+  if(ok && this->AddUser())
+    {
+    if(m_Header->State.load() == STATE_READY && this->MapData())
+      return true;
+    this->RemoveUser();
+    }
+
+  // Just unmap, without removing anything
+  munmap(m_Header, m_HeaderSize);
+  close(m_Handle);
+  m_Header = NULL;
+  m_Handle = -1;
+  m_DataSize = 0;
+  m_Name.clear();
+  return false;
+}
+
+void SharedImageSegment::Release()
+{
+  if(!m_Header)
+    return;
+
+  if(m_Data)
+    munmap(m_Data, m_DataSize);
+
+  // The last user removes the segment
+  this->RemoveUser();
+  int state = STATE_READY;
+  if(this->CountLiveUsers() == 0
+     && m_Header->State.compare_exchange_strong(state, STATE_DEAD))
+    {
+    shm_unlink(m_Name.c_str());
+    }
+
+  munmap(m_Header, m_HeaderSize);
+  close(m_Handle);
+
+  m_Header = NULL;
+  m_Data = NULL;
+  m_DataSize = 0;
+  m_Handle = -1;
+  m_Name.clear();
+}
+
+#else
+
+bool SharedImageSegment::RemoveIfStale(const std::string &) { return false; }
+bool SharedImageSegment::AddUser() { return false; }
+void SharedImageSegment::RemoveUser() {}
+int SharedImageSegment::CountLiveUsers() const { return 0; }
+bool SharedImageSegment::MapData() { return false; }
+
+bool SharedImageSegment::Publish(const std::string &, const ImageInfo &,
+                                 const void *, size_t,
+                                 const std::string &, const std::string &)
+{
+  return false;
+}
+
+bool SharedImageSegment::Attach(const std::string &) { return false; }
+
+void SharedImageSegment::Release() {}
+
+#endif
+
+const SharedImageSegment::ImageInfo &SharedImageSegment::GetImageInfo() const
+{
+  return m_Header->Info;
+}
+
+std::string SharedImageSegment::GetFileHash() const
+{
+  return std::string(m_Header->FileHash);
+}
+
+std::string SharedImageSegment::GetContentDigest() const
+{
+  return std::string(m_Header->ContentDigest);
+}
+
+int SharedImageSegment::GetNumberOfUsers() const
+{
+  return m_Header ? this->CountLiveUsers() : 0;
+}
@@ -0,0 +1,128 @@
+#ifndef SHAREDIMAGESEGMENT_H
+#define SHAREDIMAGESEGMENT_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A block of image data placed in named shared memory, so that several SNAP
+ * sessions running on the same machine can use one copy of an image that
+ * they all load from the same file, e.g., when linked sessions are used to
+ * compare segmentations of the same scan.
+ *
+ * The segment is named after the identity of the file (see MakeKey). The first
+ * session to load the file publishes the data, and the sessions that load the
+ * same file afterwards attach to the segment instead of reading the file. The
+ * segment header carries the image geometry, a hash of the identity of the
+ * file (see MakeFileHash) and a digest of the image data computed by the
+ * publisher. The attaching session checks the identity without reading the
+ * file, and can check the mapped data against the digest.
+ *
+ * The data are mapped copy-on-write: every session sees the published data,
+ * and pages that a session modifies become private to that session. So a
+ * session never changes what the other sessions see.
+ *
+ * The segment keeps a table of the processes that use it. The process that
+ * releases the segment last, or that finds that all the other users have
+ * died, removes it. This uses POSIX shared memory, so on Windows the class
+ * does nothing and Publish and Attach always fail.
+ */
+class SharedImageSegment
+{
+public:
+
+  /** Description of the image stored in the segment */
+  struct ImageInfo
+  {
+    int ComponentType;
+    unsigned int NumberOfComponents;
+    unsigned long Size[3];
+    double Spacing[3], Origin[3], Direction[9];
+  };
+
+  SharedImageSegment();
+  ~SharedImageSegment();
+
+  /** Whether shared memory is supported on this system */
+  static bool IsSupported();
+
+  /**
+   * Create a key identifying an image file by its real path, size and time of
+   * modification, so that a file that is changed gets a different key. The
+   * extra string should describe any other option that affects the contents
+   * of the loaded image (e.g., the DICOM series). Returns an empty string if
+   * the file does not exist.
+   */
+  static std::string MakeKey(const char *filename, const std::string &extra);
+
+  /**
+   * The full MD5 hash of the same file identity that MakeKey uses. The key is
+   * a shortened form of this hash. It is cheap to compute, since only the
+   * file's metadata is read. Returns an empty string if the file does not
+   * exist.
+   */
+  static std::string MakeFileHash(const char *filename, const std::string &extra);
+
+  /**
+   * Copy the image data into a new segment with the given key, along with the
+   * file identity hash and a digest of the data. Fails if the segment already
+   * exists and is in use. On success, GetData() returns the copy-on-write
+   * mapping of the segment, so the caller can drop its own copy
+   */
+  bool Publish(const std::string &key, const ImageInfo &info,
+               const void *data, size_t size,
+               const std::string &fileHash, const std::string &contentDigest);
+
+  /** Attach to an existing, fully written segment */
+  bool Attach(const std::string &key);
+
+  /** Detach from the segment, removing it if no other process uses it */
+  void Release();
+
+  /** Whether the object is attached to a segment */
+  bool IsAttached() const { return m_Header != NULL; }
+
+  /** Information about the stored image */
+  const ImageInfo &GetImageInfo() const;
+
+  /** Hash of the file identity, as given by the publisher */
+  std::string GetFileHash() const;
+
+  /** Digest of the image data, as given by the publisher */
+  std::string GetContentDigest() const;
+
+  /** The (copy-on-write) image data and its size in bytes */
+  void *GetData() const { return m_Data; }
+  size_t GetDataSize() const { return m_DataSize; }
+
+  /** Number of live processes that use the segment */
+  int GetNumberOfUsers() const;
+
+  /** Layout of the segment header, defined in the implementation */
+  struct Header;
+
+protected:
+
+  // Map the data part of the segment in copy-on-write mode
+  bool MapData();
+
+  // Add or remove this process in the table of users
+  bool AddUser();
+  void RemoveUser();
+
+  // Remove entries of dead processes and count the remaining ones
+  int CountLiveUsers() const;
+
+  // Unlink a segment that was left behind by processes that died
+  static bool RemoveIfStale(const std::string &name);
+
+  // Name of the segment and mapped pointers
+  std::string m_Name;
+  Header *m_Header;
+  void *m_Data;
+  size_t m_DataSize, m_HeaderSize;
+  int m_Handle;
+  long m_ProcessID;
+};
+
+#endif // SHAREDIMAGESEGMENT_H
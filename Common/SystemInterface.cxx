@@ -63,6 +63,8 @@
 #include <cerrno>
 #include <cstring>
 #include <iomanip>
+#include <fstream>
+#include <chrono>
 
 #include <itkRGBAPixel.h>
 #include <itkImage.h>
@@ -178,11 +180,26 @@ SystemInterface
 
   // Set the preferences file
   m_UserPreferenceFile = appdir + "/UserPreferences.xml";
+
+  // The thumbnail writer is started with the first thumbnail
+  m_ThumbnailWriting = false;
+  m_StopThumbnailWriter = false;
 }
 
 SystemInterface
 ::~SystemInterface()
 {
+  // The writer drains the queue before exiting
+  if(m_ThumbnailWriter.joinable())
+    {
+      {
+      std::lock_guard<std::mutex> lock(m_ThumbnailMutex);
+      m_StopThumbnailWriter = true;
+      }
+    m_ThumbnailQueueCondition.notify_one();
+    m_ThumbnailWriter.join();
+    }
+
   delete m_RegistryIO;
   delete m_HistoryManager;
 }
@@ -621,6 +638,24 @@ SystemInterface
   return AssociateRegistryWithFile(file,registry);
 }
 
+std::string
+SystemInterface
+::GetThumbnailDirectory()
+{
+  // Only check for the directory once, since the history panel asks for the
+  // thumbnail of every entry
+  if(m_ThumbnailDirectory.empty())
+    {
+    string thumbdir = this->GetApplicationDataDirectory() + "/Thumbnails";
+    if(!SystemTools::MakeDirectory(thumbdir.c_str()))
+      throw IRISException("Unable to create thumbnail directory %s",
+                          thumbdir.c_str());
+    m_ThumbnailDirectory = thumbdir;
+    }
+
+  return m_ThumbnailDirectory;
+}
+
 std::string
 SystemInterface
 ::GetThumbnailAssociatedWithFile(const char *file)
@@ -628,23 +663,124 @@ SystemInterface
   // Get a string giving the thumbnail name
   string code = this->FindUniqueCodeForFile(file, true);
 
-  // Create an association file in the settings directory
-  string appdir = this->GetApplicationDataDirectory();
-  string thumbdir = appdir + "/Thumbnails";
-  if(!SystemTools::MakeDirectory(thumbdir.c_str()))
-    throw IRISException("Unable to create thumbnail directory %s",
-                        thumbdir.c_str());
-
   // Create the association filename
-  return thumbdir + "/" + code + ".png";
+  return this->GetThumbnailDirectory() + "/" + code + ".png";
 }
 
 void SystemInterface
 ::WriteThumbnail(
     const char *associated_file, ThumbnailImageType *thumbnail)
 {
-  std::string thumb_fn = this->GetThumbnailAssociatedWithFile(associated_file);
-  this->m_SystemInfoDelegate->WriteRGBAImage2D(thumb_fn, thumbnail);
+  // The file name is found here, since the registry is not thread-safe
+  ThumbnailJob job;
+  job.FileName = this->GetThumbnailAssociatedWithFile(associated_file);
+  job.Image = thumbnail;
+
+    {
+    std::lock_guard<std::mutex> lock(m_ThumbnailMutex);
+    m_ThumbnailQueue.push_back(job);
+    if(!m_ThumbnailWriter.joinable())
+      m_ThumbnailWriter = std::thread(&SystemInterface::ThumbnailWriterLoop, this);
+    }
+  m_ThumbnailQueueCondition.notify_one();
+}
+
+void SystemInterface::FlushThumbnails()
+{
+  std::unique_lock<std::mutex> lock(m_ThumbnailMutex);
+  while(m_ThumbnailWriting || !m_ThumbnailQueue.empty())
+    m_ThumbnailIdleCondition.wait(lock);
+}
+
+void SystemInterface::ThumbnailWriterLoop()
+{
+  std::unique_lock<std::mutex> lock(m_ThumbnailMutex);
+  while(true)
+    {
+    while(!m_StopThumbnailWriter && m_ThumbnailQueue.empty())
+      m_ThumbnailQueueCondition.wait(lock);
+
+    if(m_ThumbnailQueue.empty())
+      break;
+
+    // Take all the pending thumbnails and write them without holding the lock
+    std::deque<ThumbnailJob> batch;
+    batch.swap(m_ThumbnailQueue);
+    string thumbdir = m_ThumbnailDirectory;
+    m_ThumbnailWriting = true;
+    lock.unlock();
+
+    ThumbnailIndex written;
+    for(size_t i = 0; i < batch.size(); i++)
+      {
+      // Write to a temporary file first, so that readers never see a
+      // partially written thumbnail. Failures are not reported, since the
+      // thumbnail is only a convenience
+      try
+        {
+        string fn = batch[i].FileName;
+        string fn_part = fn.substr(0, fn.size() - 4) + ".part.png";
+        m_SystemInfoDelegate->WriteRGBAImage2D(fn_part, batch[i].Image);
+        if(SystemTools::RenameFile(fn_part.c_str(), fn.c_str()))
+          written[SystemTools::GetFilenameName(fn)] =
+              std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+      catch(...) {}
+      }
+
+    // Release the images on this thread, outside of the lock
+    batch.clear();
+    if(written.size())
+      UpdateThumbnailIndex(thumbdir, written);
+
+    lock.lock();
+    m_ThumbnailWriting = false;
+    m_ThumbnailIdleCondition.notify_all();
+    }
+}
+
+// Name of the index file in the thumbnail directory. Each line holds the
+// time stamp of a thumbnail in milliseconds and the name of its file
+static const char *THUMBNAIL_INDEX_FILE = "/ThumbnailIndex.txt";
+
+bool
+SystemInterface
+::ReadThumbnailIndex(const std::string &thumbdir, ThumbnailIndex &index)
+{
+  index.clear();
+  std::ifstream ifs((thumbdir + THUMBNAIL_INDEX_FILE).c_str());
+  if(!ifs.good())
+    return false;
+
+  long long stamp;
+  string name;
+  while(ifs >> stamp >> name)
+    index[name] = stamp;
+
+  return true;
+}
+
+void
+SystemInterface
+::UpdateThumbnailIndex(const std::string &thumbdir, const ThumbnailIndex &written)
+{
+  // Merge with the index on disk, which other sessions may have written to
+  ThumbnailIndex index;
+  ReadThumbnailIndex(thumbdir, index);
+  for(ThumbnailIndex::const_iterator it = written.begin(); it != written.end(); ++it)
+    index[it->first] = it->second;
+
+  // Replace the index file in one step
+  string fn = thumbdir + THUMBNAIL_INDEX_FILE, fn_part = fn + ".part";
+    {
+    std::ofstream ofs(fn_part.c_str());
+    for(ThumbnailIndex::const_iterator it = index.begin(); it != index.end(); ++it)
+      ofs << it->second << " " << it->first << "\n";
+    if(!ofs.good())
+      return;
+    }
+  SystemTools::RenameFile(fn_part.c_str(), fn.c_str());
 }
 
 bool 
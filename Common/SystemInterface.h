@@ -38,6 +38,11 @@
 
 #include "Registry.h"
 #include "GlobalState.h"
+#include <deque>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class IRISApplication;
 class SNAPRegistryIO;
@@ -120,9 +125,35 @@ public:
   /** Get the thumbnail filename associated with an image file */
   std::string GetThumbnailAssociatedWithFile(const char *file);
 
-  /** Write a thumbnail */
+  /** Get the directory where the thumbnails are stored, creating it if needed */
+  std::string GetThumbnailDirectory();
+
+  /**
+   * Write a thumbnail. The file is written by a background thread, so the
+   * thumbnail must not be modified afterwards. The thumbnail index is updated
+   * once the file has been written.
+   */
   void WriteThumbnail(const char *associated_file, ThumbnailImageType *thumbnail);
 
+  /**
+   * Wait until all the thumbnails passed to WriteThumbnail have been written.
+   * This can be called from any thread, e.g., by a thumbnail reader
+   */
+  void FlushThumbnails();
+
+  /** Time stamps of the thumbnails, keyed by the thumbnail file name */
+  typedef std::map<std::string, long long> ThumbnailIndex;
+
+  /**
+   * Read the thumbnail index, a small file in the thumbnail directory that
+   * records when each thumbnail was last written. Readers can use it to
+   * tell whether their copy of a thumbnail is current without accessing
+   * the thumbnail files. Thumbnails written by older versions are not in
+   * the index. This method does not use the registry and can be called from
+   * any thread. Returns false if there is no index.
+   */
+  static bool ReadThumbnailIndex(const std::string &thumbdir, ThumbnailIndex &index);
+
   /** A higher level method: associates current settings with the current image
    * so that the next time the image is loaded, it can be saved */
   bool AssociateCurrentSettingsWithCurrentImageFile(
@@ -199,6 +230,25 @@ private:
 
   // Get the directory where application data (pref files, etc) should go
   std::string GetApplicationDataDirectory();
+
+  // Thumbnail directory, once it has been created
+  std::string m_ThumbnailDirectory;
+
+  // Thumbnails waiting to be written by the writer thread
+  struct ThumbnailJob
+  {
+    std::string FileName;
+    SmartPtr<ThumbnailImageType> Image;
+  };
+
+  void ThumbnailWriterLoop();
+  static void UpdateThumbnailIndex(const std::string &thumbdir, const ThumbnailIndex &written);
+
+  std::deque<ThumbnailJob> m_ThumbnailQueue;
+  bool m_ThumbnailWriting, m_StopThumbnailWriter;
+  std::thread m_ThumbnailWriter;
+  std::mutex m_ThumbnailMutex;
+  std::condition_variable m_ThumbnailQueueCondition, m_ThumbnailIdleCondition;
 };
 
 
@@ -0,0 +1,285 @@
+#include "BackgroundTask.h"
+#include "itkCommand.h"
+#include "itkProcessObject.h"
+#include "itkMacro.h"
+#include <algorithm>
+
+/**
+ * Command that forwards the progress of an ITK filter to a task
+ */
+class BackgroundTask::ProgressCommand : public itk::Command
+{
+public:
+  typedef ProgressCommand Self;
+  typedef itk::SmartPointer<Self> Pointer;
+  itkTypeMacro(ProgressCommand, itk::Command)
+  itkNewMacro(Self)
+
+  void SetTask(BackgroundTask *task, double p0, double p1)
+    { m_Task = task; m_P0 = p0; m_P1 = p1; }
+
+  virtual void Execute(itk::Object *caller, const itk::EventObject &event) ITK_OVERRIDE
+  {
+    itk::ProcessObject *po = dynamic_cast<itk::ProcessObject *>(caller);
+    if(po)
+      {
+      // Let the filter stop itself, so that it can clean up
+      if(m_Task->IsCancelRequested())
+        po->AbortGenerateDataOn();
+      else
+        m_Task->SetProgress(m_P0 + (m_P1 - m_P0) * po->GetProgress());
+      }
+    else
+      {
+      m_Task->ThrowIfCancelRequested();
+      }
+  }
+
+  virtual void Execute(const itk::Object *caller, const itk::EventObject &event) ITK_OVERRIDE
+  {
+    const itk::ProcessObject *po = dynamic_cast<const itk::ProcessObject *>(caller);
+    if(po)
+      m_Task->SetProgress(m_P0 + (m_P1 - m_P0) * po->GetProgress());
+    m_Task->ThrowIfCancelRequested();
+  }
+
+protected:
+  ProgressCommand() : m_Task(NULL), m_P0(0.0), m_P1(1.0) {}
+
+  // The task owns the filters that hold this command, so no smart pointer
+  BackgroundTask *m_Task;
+  double m_P0, m_P1;
+};
+
+BackgroundTask::BackgroundTask()
+{
+  m_State = TASK_PENDING;
+  m_Progress = 0.0;
+  m_CancelRequested = false;
+  m_LastReportedProgress = 0.0;
+}
+
+BackgroundTask::TaskState BackgroundTask::GetState() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_State;
+}
+
+bool BackgroundTask::IsFinished() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_State != TASK_PENDING && m_State != TASK_RUNNING;
+}
+
+double BackgroundTask::GetProgress() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Progress;
+}
+
+std::string BackgroundTask::GetErrorMessage() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_ErrorMessage;
+}
+
+void BackgroundTask::RequestCancel()
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_CancelRequested = true;
+}
+
+bool BackgroundTask::IsCancelRequested() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_CancelRequested;
+}
+
+void BackgroundTask::WaitUntilFinished() const
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while(m_State == TASK_PENDING || m_State == TASK_RUNNING)
+    m_FinishedCondition.wait(lock);
+}
+
+void BackgroundTask::SetProgress(double progress)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Progress = std::max(0.0, std::min(1.0, progress));
+}
+
+void BackgroundTask::ThrowIfCancelRequested() const
+{
+  if(this->IsCancelRequested())
+    {
+    itk::ProcessAborted exc(__FILE__, __LINE__);
+    exc.SetDescription("Task canceled by the user");
+    throw exc;
+    }
+}
+
+SmartPtr<itk::Command> BackgroundTask::CreateProgressCommand(double p0, double p1)
+{
+  SmartPtr<ProgressCommand> cmd = ProgressCommand::New();
+  cmd->SetTask(this, p0, p1);
+
+  SmartPtr<itk::Command> return_cmd = cmd.GetPointer();
+  return return_cmd;
+}
+
+
+BackgroundTaskManager::BackgroundTaskManager()
+{
+  m_ProgressInterval = 100.0;
+  m_NumberOfThreads = 2;
+  m_StopWorkers = false;
+}
+
+BackgroundTaskManager::~BackgroundTaskManager()
+{
+  // Cancel whatever is still running and wait for the workers to exit
+  this->CancelAllTasks();
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_StopWorkers = true;
+    }
+  m_QueueCondition.notify_all();
+
+  for(unsigned int i = 0; i < m_Workers.size(); i++)
+    m_Workers[i].join();
+
+  // Tasks left in the queue will never run
+  for(unsigned int i = 0; i < m_Queue.size(); i++)
+    {
+      {
+      std::lock_guard<std::mutex> tlock(m_Queue[i]->m_Mutex);
+      m_Queue[i]->m_State = BackgroundTask::TASK_CANCELED;
+      }
+    m_Queue[i]->m_FinishedCondition.notify_all();
+    }
+}
+
+void BackgroundTaskManager::Submit(BackgroundTask *task)
+{
+  task->m_LastReportedProgress = task->GetProgress();
+  task->m_LastReportTime = std::chrono::steady_clock::now();
+  m_ActiveTasks.push_back(task);
+
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    // Start the workers on first use
+    if(m_Workers.empty())
+      {
+      for(unsigned int i = 0; i < std::max(1u, m_NumberOfThreads); i++)
+        m_Workers.push_back(std::thread(&BackgroundTaskManager::WorkerLoop, this));
+      }
+
+    m_Queue.push_back(task);
+    }
+  m_QueueCondition.notify_one();
+
+  this->InvokeEvent(TaskSubmittedEvent());
+}
+
+void BackgroundTaskManager::WorkerLoop()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while(true)
+    {
+    while(!m_StopWorkers && m_Queue.empty())
+      m_QueueCondition.wait(lock);
+
+    if(m_StopWorkers)
+      break;
+
+    SmartPtr<BackgroundTask> task = m_Queue.front();
+    m_Queue.pop_front();
+    lock.unlock();
+
+    // Tasks canceled while in the queue are not run
+    BackgroundTask::TaskState state = BackgroundTask::TASK_CANCELED;
+    std::string error;
+    if(!task->IsCancelRequested())
+      {
+        {
+        std::lock_guard<std::mutex> tlock(task->m_Mutex);
+        task->m_State = BackgroundTask::TASK_RUNNING;
+        }
+
+      try
+        {
+        task->Run();
+        state = BackgroundTask::TASK_COMPLETED;
+        }
+      catch(itk::ProcessAborted &)
+        {
+        state = BackgroundTask::TASK_CANCELED;
+        }
+      catch(std::exception &exc)
+        {
+        state = task->IsCancelRequested()
+                ? BackgroundTask::TASK_CANCELED : BackgroundTask::TASK_FAILED;
+        error = exc.what();
+        }
+      catch(...)
+        {
+        state = BackgroundTask::TASK_FAILED;
+        error = "Unknown error";
+        }
+      }
+
+      {
+      std::lock_guard<std::mutex> tlock(task->m_Mutex);
+      task->m_State = state;
+      task->m_ErrorMessage = error;
+      if(state == BackgroundTask::TASK_COMPLETED)
+        task->m_Progress = 1.0;
+      }
+    task->m_FinishedCondition.notify_all();
+
+    // Release the task before taking the lock, since the last reference to
+    // it may be held by this thread
+    task = NULL;
+    lock.lock();
+    }
+}
+
+bool BackgroundTaskManager::ProcessTaskEvents()
+{
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  // Copy the list, since the listeners may submit new tasks
+  std::list<SmartPtr<BackgroundTask> > tasks = m_ActiveTasks;
+  for(std::list<SmartPtr<BackgroundTask> >::iterator it = tasks.begin(); it != tasks.end(); ++it)
+    {
+    BackgroundTask *task = *it;
+    bool finished = task->IsFinished();
+    double progress = task->GetProgress();
+
+    // Rate-limited progress, always reported before the task finishes
+    double elapsed = std::chrono::duration<double, std::milli>(
+                       now - task->m_LastReportTime).count();
+    if(progress != task->m_LastReportedProgress && (finished || elapsed >= m_ProgressInterval))
+      {
+      task->m_LastReportedProgress = progress;
+      task->m_LastReportTime = now;
+      task->InvokeEvent(BackgroundTask::TaskProgressEvent());
+      }
+
+    if(finished)
+      {
+      m_ActiveTasks.remove(*it);
+      task->InvokeEvent(BackgroundTask::TaskFinishedEvent());
+      }
+    }
+
+  return !m_ActiveTasks.empty();
+}
+
+void BackgroundTaskManager::CancelAllTasks()
+{
+  for(std::list<SmartPtr<BackgroundTask> >::iterator it = m_ActiveTasks.begin();
+      it != m_ActiveTasks.end(); ++it)
+    (*it)->RequestCancel();
+}
@@ -0,0 +1,189 @@
+#ifndef BACKGROUNDTASK_H
+#define BACKGROUNDTASK_H
+
+#include "SNAPCommon.h"
+#include "SNAPEvents.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include <string>
+#include <list>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace itk
+{
+class Command;
+}
+
+/**
+ * \class BackgroundTask
+ * \brief A long operation that runs on a worker thread of BackgroundTaskManager
+ *
+ * Subclasses implement Run(), which is called on a worker thread. Run() reports
+ * progress with SetProgress() and should check for cancellation regularly with
+ * ThrowIfCancelRequested(). When Run() wraps ITK filters, the command returned
+ * by CreateProgressCommand() can be added as a ProgressEvent observer: it
+ * forwards the filter progress to the task and aborts the filter when the task
+ * is canceled.
+ *
+ * The task does not fire events from the worker thread. Instead, the manager
+ * fires TaskProgressEvent and TaskFinishedEvent on the GUI thread from
+ * BackgroundTaskManager::ProcessTaskEvents(), so that listeners can safely
+ * update the GUI and the models.
+ */
+class BackgroundTask : public itk::Object
+{
+public:
+  irisITKAbstractObjectMacro(BackgroundTask, itk::Object)
+
+  /** Progress has changed (fired on the GUI thread, rate-limited) */
+  itkEventMacro(TaskProgressEvent, IRISEvent)
+
+  /** The task has completed, failed or was canceled (fired on the GUI thread) */
+  itkEventMacro(TaskFinishedEvent, IRISEvent)
+
+  FIRES(TaskProgressEvent)
+  FIRES(TaskFinishedEvent)
+
+  enum TaskState {
+    TASK_PENDING = 0, TASK_RUNNING, TASK_COMPLETED, TASK_CANCELED, TASK_FAILED
+  };
+
+  /** Get the state of the task */
+  TaskState GetState() const;
+
+  /** Whether the task is completed, canceled or failed */
+  bool IsFinished() const;
+
+  /** Get the progress, between 0 and 1 */
+  double GetProgress() const;
+
+  /** Get the error message if the task failed */
+  std::string GetErrorMessage() const;
+
+  /** A short description of the task, e.g., for a progress dialog */
+  irisGetSetMacro(Title, std::string)
+
+  /**
+   * Ask the task to stop. This can be called from any thread. The task stops
+   * the next time it checks for cancellation. A task that has not started
+   * yet will not be run.
+   */
+  void RequestCancel();
+
+  /** Whether cancellation has been requested */
+  bool IsCancelRequested() const;
+
+  /** Block until the task has finished */
+  void WaitUntilFinished() const;
+
+  /**
+   * Create a command that can observe ITK ProgressEvent on filters executed
+   * within Run(). The command updates the progress of the task, mapping the
+   * progress of the filter into the range [p0, p1], and aborts the filter if
+   * cancellation has been requested.
+   */
+  SmartPtr<itk::Command> CreateProgressCommand(double p0 = 0.0, double p1 = 1.0);
+
+protected:
+
+  BackgroundTask();
+  virtual ~BackgroundTask() {}
+
+  /** The work to perform, called on a worker thread */
+  virtual void Run() = 0;
+
+  /** Set the progress from within Run() */
+  void SetProgress(double progress);
+
+  /** Throw itk::ProcessAborted if cancellation has been requested */
+  void ThrowIfCancelRequested() const;
+
+  std::string m_Title;
+
+  // Internal state, protected by the mutex
+  TaskState m_State;
+  double m_Progress;
+  bool m_CancelRequested;
+  std::string m_ErrorMessage;
+  mutable std::mutex m_Mutex;
+  mutable std::condition_variable m_FinishedCondition;
+
+  // State maintained by the manager on the GUI thread
+  double m_LastReportedProgress;
+  std::chrono::steady_clock::time_point m_LastReportTime;
+
+  class ProgressCommand;
+  friend class BackgroundTaskManager;
+};
+
+/**
+ * \class BackgroundTaskManager
+ * \brief Runs BackgroundTask objects on worker threads
+ *
+ * Tasks are submitted from the GUI thread and are executed in the order of
+ * submission by a small pool of worker threads. The GUI must call
+ * ProcessTaskEvents() periodically (e.g., from a timer) while tasks are
+ * active. This call fires the progress events on the tasks, at most once per
+ * ProgressInterval, and the finished events. In contrast to calling
+ * QCoreApplication::processEvents() from ITK observers, filters never
+ * re-enter the GUI event loop and progress reporting costs next to nothing
+ * on the worker threads.
+ */
+class BackgroundTaskManager : public itk::Object
+{
+public:
+  irisITKObjectMacro(BackgroundTaskManager, itk::Object)
+
+  /** Fired when a task is submitted, so that the GUI can start polling */
+  itkEventMacro(TaskSubmittedEvent, IRISEvent)
+
+  FIRES(TaskSubmittedEvent)
+
+  /** Minimum interval between progress events for a task, in ms (default 100) */
+  irisGetSetMacro(ProgressInterval, double)
+
+  /** Number of worker threads (default 2), takes effect before the first submit */
+  irisGetSetMacro(NumberOfThreads, unsigned int)
+
+  /** Schedule a task for execution */
+  void Submit(BackgroundTask *task);
+
+  /**
+   * Fire pending progress and finished events for the tasks. Must be called
+   * on the GUI thread. Returns true if there are still active tasks.
+   */
+  bool ProcessTaskEvents();
+
+  /** Whether there are tasks that have not been reported as finished */
+  bool HasActiveTasks() const { return !m_ActiveTasks.empty(); }
+
+  /** Request cancellation of all the active tasks */
+  void CancelAllTasks();
+
+protected:
+
+  BackgroundTaskManager();
+  virtual ~BackgroundTaskManager();
+
+  void WorkerLoop();
+
+  double m_ProgressInterval;
+  unsigned int m_NumberOfThreads;
+
+  // Tasks that have been submitted but not reported as finished (GUI thread)
+  std::list<SmartPtr<BackgroundTask> > m_ActiveTasks;
+
+  // Queue of tasks waiting for a worker, protected by the mutex
+  std::deque<SmartPtr<BackgroundTask> > m_Queue;
+  bool m_StopWorkers;
+  std::mutex m_Mutex;
+  std::condition_variable m_QueueCondition;
+  std::vector<std::thread> m_Workers;
+};
+
+#endif // BACKGROUNDTASK_H
@@ -37,6 +37,9 @@ Generic3DModel::Generic3DModel()
   // Continuous update model
   m_ContinuousUpdateModel = NewSimpleConcreteProperty(false);
 
+  // Spray brush radius model
+  m_SprayBrushRadiusModel = NewRangedConcreteProperty(0, 0, 10, 1);
+
   // Scalpel
   m_ScalpelStatus = SCALPEL_LINE_NULL;
 
@@ -191,8 +194,7 @@ void Generic3DModel::OnUpdate()
     // m_Mesh->DiscardVTKMeshes();
 
     // Clear the spray points
-    m_SprayPoints->GetPoints()->Reset();
-    m_SprayPoints->Modified();
+    this->ClearSprayPoints();
 
     // The geometry has changed
     this->OnImageGeometryUpdate();
@@ -217,7 +219,7 @@ void Generic3DModel::OnImageGeometryUpdate()
 
 #include "itkMutexLockHolder.h"
 
-void Generic3DModel::UpdateSegmentationMesh(itk::Command *callback)
+void Generic3DModel::UpdateSegmentationMesh(itk::Command *callback, bool preview)
 {
   // Prevent concurrent access to this method
   itk::MutexLockHolder<itk::SimpleFastMutexLock> mholder(m_MutexLock);
@@ -226,7 +228,7 @@ void Generic3DModel::UpdateSegmentationMesh(itk::Command *callback)
   {
     // Generate all the mesh objects
     m_MeshUpdating = true;
-    m_Driver->GetMeshManager()->UpdateVTKMeshes(callback);
+    m_Driver->GetMeshManager()->UpdateVTKMeshes(callback, preview);
     m_MeshUpdating = false;
 
     InvokeEvent(ModelUpdateEvent());
@@ -246,62 +248,77 @@ bool Generic3DModel::IsMeshUpdating()
   return m_MeshUpdating;
 }
 
-bool Generic3DModel::AcceptAction()
+void Generic3DModel::ClearSprayPoints()
 {
-  ToolbarMode3DType mode = m_ParentUI->GetGlobalState()->GetToolbarMode3D();
-  IRISApplication *app = m_ParentUI->GetDriver();
+  m_SprayVoxels.clear();
+  m_SprayPoints->GetPoints()->Reset();
+  m_SprayPoints->Modified();
+}
 
-  // Get the segmentation image
+unsigned long Generic3DModel::ApplySprayPaint()
+{
+  IRISApplication *app = m_ParentUI->GetDriver();
   LabelImageWrapper *seg = app->GetSelectedSegmentationLayer();
   LabelImageWrapper::ImageType *imSeg = seg->GetImage();
+  itk::ImageRegion<3> imgRegion = imSeg->GetBufferedRegion();
+
+  // Offsets of the voxels in the brush
+  int r = this->GetSprayBrushRadius();
+  std::vector<itk::Offset<3> > brush;
+  for(int dz = -r; dz <= r; dz++)
+    for(int dy = -r; dy <= r; dy++)
+      for(int dx = -r; dx <= r; dx++)
+        {
+        if(dx * dx + dy * dy + dz * dz <= r * r)
+          {
+          itk::Offset<3> off = {{ dx, dy, dz }};
+          brush.push_back(off);
+          }
+        }
 
-  // Accept the current action
-  if(mode == SPRAYPAINT_MODE)
+  // Expand the sprayed voxels by the brush. The set removes the overlaps
+  // between brushes and keeps the voxels sorted by image line
+  SprayVoxelSet voxels;
+  for(SprayVoxelSet::const_iterator it = m_SprayVoxels.begin(); it != m_SprayVoxels.end(); ++it)
     {
-    // Anything to update?
-    bool update = false;
-
-    // Merge all the spray points into the segmentation
-    for(int i = 0; i < m_SprayPoints->GetNumberOfPoints(); i++)
+    for(unsigned int k = 0; k < brush.size(); k++)
       {
-      // Find the point in image coordinates
-      double *x = m_SprayPoints->GetPoint(i);
+      IndexType idx = *it + brush[k];
+      if(imgRegion.IsInside(idx))
+        voxels.insert(idx);
+      }
+    }
 
-      // Create a region around this one voxel (in the future could use other shapes)
-      SegmentationUpdateIterator::RegionType region;
-      region.SetIndex(0, static_cast<unsigned int>(x[0])); region.SetSize(0, 1);
-      region.SetIndex(1, static_cast<unsigned int>(x[1])); region.SetSize(1, 1);
-      region.SetIndex(2, static_cast<unsigned int>(x[2])); region.SetSize(2, 1);
+  // Paint the voxels line by line into a single delta
+  unsigned long n_changed = 0;
+  SegmentationVoxelSetUpdate::UndoDelta *delta = SegmentationVoxelSetUpdate::Paint(
+        imSeg, voxels,
+        app->GetGlobalState()->GetDrawingColorLabel(),
+        app->GetGlobalState()->GetDrawOverFilter(), n_changed);
 
-      // Treat each point as a region update
-      SegmentationUpdateIterator it(imSeg, region,
-                                    app->GetGlobalState()->GetDrawingColorLabel(),
-                                    app->GetGlobalState()->GetDrawOverFilter());
+  if(delta)
+    seg->StoreUndoPoint("3D spray paint", delta);
 
-      for(; !it.IsAtEnd(); ++it)
-        {
-        it.PaintAsForeground();
-        }
+  return n_changed;
+}
 
-      // Store the delta for this update
-      it.Finalize();
+bool Generic3DModel::AcceptAction()
+{
+  ToolbarMode3DType mode = m_ParentUI->GetGlobalState()->GetToolbarMode3D();
+  IRISApplication *app = m_ParentUI->GetDriver();
 
-      if(it.GetNumberOfChangedVoxels() > 0)
-        {
-        update = true;
-        seg->StoreIntermediateUndoDelta(it.RelinquishDelta());
-        }
-      }
+  // Accept the current action
+  if(mode == SPRAYPAINT_MODE)
+    {
+    // Merge all the spray points into the segmentation
+    bool update = this->ApplySprayPaint() > 0;
 
-    // Store the undo point
     if(update)
       {
-      seg->StoreUndoPoint("3D spray paint");
       app->RecordCurrentLabelUse();
 
       // Clear the spray points
-      m_SprayPoints->GetPoints()->Reset();
-      m_SprayPoints->Modified();
+      this->ClearSprayPoints();
       InvokeEvent(SprayPaintEvent());
       }
 
@@ -342,8 +359,7 @@ void Generic3DModel::CancelAction()
   if(mode == SPRAYPAINT_MODE)
     {
     // Clear the spray points
-    m_SprayPoints->GetPoints()->Reset();
-    m_SprayPoints->Modified();
+    this->ClearSprayPoints();
     InvokeEvent(SprayPaintEvent());
     }
   else if(mode == SCALPEL_MODE && m_ScalpelStatus == SCALPEL_LINE_COMPLETED)
@@ -460,9 +476,13 @@ bool Generic3DModel::SpraySegmentationVoxelUnderMouse(int px, int py)
     itk::ImageRegion<3> region = m_Driver->GetCurrentImageData()->GetImageRegion();
     if(region.IsInside(to_itkIndex(hit)))
       {
-      m_SprayPoints->GetPoints()->InsertNextPoint(hit[0], hit[1], hit[2]);
-      m_SprayPoints->Modified();
-      this->InvokeEvent(SprayPaintEvent());
+      // Voxels that have already been sprayed are not added again
+      if(m_SprayVoxels.insert(to_itkIndex(hit)).second)
+        {
+        m_SprayPoints->GetPoints()->InsertNextPoint(hit[0], hit[1], hit[2]);
+        m_SprayPoints->Modified();
+        this->InvokeEvent(SprayPaintEvent());
+        }
       return true;
       }
     }
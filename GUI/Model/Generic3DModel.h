@@ -6,6 +6,8 @@
 #include "vtkSmartPointer.h"
 #include "SNAPEvents.h"
 #include "itkMutexLock.h"
+#include "itkIndex.h"
+#include "SegmentationUpdateIterator.h"
 
 class GlobalUIModel;
 class IRISApplication;
@@ -62,8 +64,13 @@ public:
   // TODO: replace this with an update in a background thread
   irisSimplePropertyAccessMacro(ContinuousUpdate, bool)
 
-  // Tell the model to update the segmentation mesh
-  void UpdateSegmentationMesh(itk::Command *callback);
+  // Radius of the spray paint brush in voxels. With zero radius, only the
+  // sprayed voxels are painted, otherwise a ball is painted around each one
+  irisRangedPropertyAccessMacro(SprayBrushRadius, int)
+
+  // Tell the model to update the segmentation mesh. A preview mesh of an
+  // evolving level set is extracted near its active layer only
+  void UpdateSegmentationMesh(itk::Command *callback, bool preview = false);
 
   // Reentrant function to check if mesh is being constructed in another thread
   bool IsMeshUpdating();
@@ -134,6 +141,17 @@ protected:
   // Find the labeled voxel under the cursor
   bool IntersectSegmentation(int vx, int vy, Vector3i &hit);
 
+  // Voxels ordered by image line (z, then y, then x), without duplicates
+  typedef itk::Index<3> IndexType;
+  typedef SegmentationVoxelSetUpdate::VoxelSet SprayVoxelSet;
+
+  // Paint the spray voxels, expanded by the brush, as a single undo delta.
+  // Returns the number of voxels changed
+  unsigned long ApplySprayPaint();
+
+  // Clear the spray points
+  void ClearSprayPoints();
+
   // Parent (where the global UI state is stored)
   GlobalUIModel *m_ParentUI;
 
@@ -147,9 +165,12 @@ protected:
   // updated on the event main image changes
   Mat4d m_WorldMatrix, m_WorldMatrixInverse;
 
-  // Set of spraypainted points in image coordinates
+  // Set of spraypainted points in image coordinates, used for rendering
   vtkSmartPointer<vtkPolyData> m_SprayPoints;
 
+  // The same voxels, sorted and thinned (each voxel is only sprayed once)
+  SprayVoxelSet m_SprayVoxels;
+
   // On-screen endpoints of the scalpel line
   Vector2i m_ScalpelStart, m_ScalpelEnd;
 
@@ -159,6 +180,9 @@ protected:
   // Continuous update model
   SmartPtr<ConcreteSimpleBooleanProperty> m_ContinuousUpdateModel;
 
+  // Spray brush radius model
+  SmartPtr<ConcreteRangedIntProperty> m_SprayBrushRadiusModel;
+
   // Is the mesh updating
   bool m_MeshUpdating;
 
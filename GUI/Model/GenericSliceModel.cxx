@@ -328,6 +328,32 @@ Vector3d GenericSliceModel::MapImageToSlice(const Vector3d &xImage)
   return  m_ImageToDisplayTransform->TransformPoint(xImage);
 }
 
+itk::ImageRegion<2> GenericSliceModel::GetVisibleSliceRegion(ImageWrapperBase *layer)
+{
+  assert(IsSliceInitialized());
+
+  Vector2ui size = this->GetCanvasSize();
+  itk::ImageRegion<2> region;
+  if(!layer->IsSlicingOrthogonal())
+    {
+    region.SetSize(0, size[0]);
+    region.SetSize(1, size[1]);
+    return region;
+    }
+
+  // The voxels that overlap the corners of the viewport, and all in between
+  Vector3d x0 = this->MapWindowToSlice(Vector2d(0.0, 0.0));
+  Vector3d x1 = this->MapWindowToSlice(Vector2d(size[0], size[1]));
+  for(unsigned int d = 0; d < 2; d++)
+    {
+    long i0 = (long) floor(std::min(x0[d], x1[d]));
+    long i1 = (long) ceil(std::max(x0[d], x1[d]));
+    region.SetIndex(d, i0);
+    region.SetSize(d, std::max(i1 - i0, 0l));
+    }
+  return region;
+}
+
 Vector2d GenericSliceModel::MapSliceToWindow(const Vector3d &xSlice)
 {
   assert(IsSliceInitialized());
@@ -200,6 +200,13 @@ public:
    */
   Vector3d MapImageToSlice(const Vector3d &xImage);
 
+  /**
+   * Get the region of the display slice of a layer that is visible in the
+   * main viewport, in slice voxels. Layers that are not sliced orthogonally
+   * are resampled to the viewport, so all of their slice is visible.
+   */
+  itk::ImageRegion<2> GetVisibleSliceRegion(ImageWrapperBase *layer);
+
   /**
    * Get the cursor position in slice coordinates, shifted to the center
    * of the voxel
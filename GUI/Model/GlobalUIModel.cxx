@@ -54,6 +54,7 @@
 #include <PaintbrushModel.h>
 #include <PaintbrushSettingsModel.h>
 #include "PolygonSettingsModel.h"
+#include "BackgroundTask.h"
 #include <SynchronizationModel.h>
 #include <SnakeParameterModel.h>
 #include <SnakeROIResampleModel.h>
@@ -109,6 +110,9 @@ GlobalUIModel::GlobalUIModel()
   m_DistributedSegmentationModel = DistributedSegmentationModel::New();
   m_DistributedSegmentationModel->SetParentModel(this);
 
+  // Background tasks
+  m_TaskManager = BackgroundTaskManager::New();
+
   // Create the slice models
   for (unsigned int i = 0; i < 3; i++)
     {
@@ -76,6 +76,7 @@ class ColorLabelQuickListModel;
 class InterpolateLabelModel;
 class RegistrationModel;
 class DistributedSegmentationModel;
+class BackgroundTaskManager;
 
 namespace itk
 {
@@ -250,6 +251,9 @@ public:
   /** Model for distributed image segmentation */
   irisGetMacro(DistributedSegmentationModel, DistributedSegmentationModel *)
 
+  /** Runner for long operations that should not block the GUI */
+  irisGetMacro(TaskManager, BackgroundTaskManager *)
+
   /**
     Check the state of the system. This class will issue StateChangeEvent()
     when one of the flags has changed. This method can be used together with
@@ -432,6 +436,9 @@ protected:
   // Model for DSS
   SmartPtr<DistributedSegmentationModel> m_DistributedSegmentationModel;
 
+  // Background task runner
+  SmartPtr<BackgroundTaskManager> m_TaskManager;
+
   // Current coordinates of the cursor
   SmartPtr<AbstractRangedUIntVec3Property> m_CursorPositionModel;
   bool GetCursorPositionValueAndRange(
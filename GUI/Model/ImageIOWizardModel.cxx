@@ -5,6 +5,7 @@
 #include "SystemInterface.h"
 #include "ImageCoordinateGeometry.h"
 #include <itksys/SystemTools.hxx>
+#include "itkCommand.h"
 
 #include "ColorMap.h"
 #include "ImageIODelegates.h"
@@ -315,6 +316,7 @@ void ImageIOWizardModel::LoadImage(std::string filename)
     m_LoadDelegate->UnloadCurrentImage();
 
     // Load the data from the image
+    m_LoadDelegate->ConfigureImageIO(m_GuidedIO);
     m_GuidedIO->ReadNativeImageData();
 
     // Validate the image data
@@ -388,6 +390,11 @@ void ImageIOWizardModel::ProcessDicomDirectory(const std::string &filename,
   {
     throw ei;
   }
+  catch (itk::ProcessAborted &)
+  {
+    // The scan was canceled from the progress command
+    throw;
+  }
   catch (std::exception &e)
   {
     throw IRISException("Error: exception occured when parsing DICOM directory. "
@@ -395,6 +402,15 @@ void ImageIOWizardModel::ProcessDicomDirectory(const std::string &filename,
   }
 }
 
+SmartPtr<DicomDirectoryScanTask>
+ImageIOWizardModel
+::CreateDicomDirectoryScanTask(const std::string &filename)
+{
+  SmartPtr<DicomDirectoryScanTask> task = DicomDirectoryScanTask::New();
+  task->Initialize(this, filename);
+  return task;
+}
+
 std::list<std::string>
 ImageIOWizardModel
 ::GetFoundDicomSeriesIds()
@@ -539,3 +555,70 @@ void ImageIOWizardModel::SetStickyOverlayColorMapValue(std::string value)
       return;
       }
 }
+
+
+DicomDirectoryScanTask::DicomDirectoryScanTask()
+{
+  m_NumberOfFilesRead = 0;
+}
+
+void DicomDirectoryScanTask::Initialize(ImageIOWizardModel *model, const std::string &filename)
+{
+  m_Model = model;
+  m_Filename = filename;
+  this->SetTitle("Scanning DICOM directory...");
+}
+
+void DicomDirectoryScanTask::Run()
+{
+  SmartPtr<itk::MemberCommand<Self> > cmd = itk::MemberCommand<Self>::New();
+  cmd->SetCallbackFunction(this, &Self::FileReadCallback);
+
+  m_LastSnapshotTime = std::chrono::steady_clock::now();
+  m_Model->ProcessDicomDirectory(m_Filename, cmd);
+  this->UpdateSnapshot();
+}
+
+void DicomDirectoryScanTask::FileReadCallback(itk::Object *, const itk::EventObject &)
+{
+  // This is where the scan can be canceled
+  this->ThrowIfCancelRequested();
+
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_NumberOfFilesRead++;
+    }
+
+  // Copying the metadata is not free, so don't do it for every file
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if(std::chrono::duration<double, std::milli>(now - m_LastSnapshotTime).count() > 250.0)
+    {
+    this->UpdateSnapshot();
+    m_LastSnapshotTime = now;
+    }
+}
+
+void DicomDirectoryScanTask::UpdateSnapshot()
+{
+  // Called on the worker thread, where it is safe to access the model
+  std::vector<Registry> snapshot;
+  std::list<std::string> series_ids = m_Model->GetFoundDicomSeriesIds();
+  for(std::list<std::string>::const_iterator it = series_ids.begin();
+      it != series_ids.end(); ++it)
+    snapshot.push_back(m_Model->GetFoundDicomSeriesMetaData(*it));
+
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  m_Snapshot.swap(snapshot);
+}
+
+std::vector<Registry> DicomDirectoryScanTask::GetSeriesMetaData() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_Snapshot;
+}
+
+unsigned int DicomDirectoryScanTask::GetNumberOfFilesRead() const
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  return m_NumberOfFilesRead;
+}
@@ -7,8 +7,48 @@
 #include "GuidedNativeImageIO.h"
 #include "Registry.h"
 #include "ImageIODelegates.h"
+#include "BackgroundTask.h"
 
 class GlobalUIModel;
+class ImageIOWizardModel;
+
+/**
+ * Background task that scans a DICOM directory for series. While the scan is
+ * running, GetSeriesMetaData() returns the series found so far, so that the
+ * GUI can update the listing on the fly. The snapshot is refreshed on the
+ * worker thread at most every 250 ms.
+ */
+class DicomDirectoryScanTask : public BackgroundTask
+{
+public:
+  irisITKObjectMacro(DicomDirectoryScanTask, BackgroundTask)
+
+  /** Set the model and the directory (or a file within it) to scan */
+  void Initialize(ImageIOWizardModel *model, const std::string &filename);
+
+  /** Get the metadata of the series found so far */
+  std::vector<Registry> GetSeriesMetaData() const;
+
+  /** Get the number of DICOM files read so far */
+  unsigned int GetNumberOfFilesRead() const;
+
+protected:
+
+  DicomDirectoryScanTask();
+  virtual ~DicomDirectoryScanTask() {}
+
+  virtual void Run() ITK_OVERRIDE;
+
+  void FileReadCallback(itk::Object *source, const itk::EventObject &event);
+  void UpdateSnapshot();
+
+  SmartPtr<ImageIOWizardModel> m_Model;
+  std::string m_Filename;
+
+  std::vector<Registry> m_Snapshot;
+  unsigned int m_NumberOfFilesRead;
+  std::chrono::steady_clock::time_point m_LastSnapshotTime;
+};
 
 namespace itk {
   class GDCMSeriesFileNames;
@@ -166,6 +206,12 @@ public:
     */
   void ProcessDicomDirectory(const std::string &filename, itk::Command *progressCommand);
 
+  /**
+    Create a task that calls ProcessDicomDirectory() in the background. The
+    model should not be used for IO until the task has finished.
+    */
+  SmartPtr<DicomDirectoryScanTask> CreateDicomDirectoryScanTask(const std::string &filename);
+
   /**
    * Get a list of loaded Dicom SeriesIDs. This can be called from the
    * callback of progressCommand, allowing on the fly updates
@@ -4,6 +4,9 @@
 #include "itkImageBase.h"
 #include "ScalarImageHistogram.h"
 #include "GlobalUIModel.h"
+#include "GenericSliceModel.h"
+#include "DisplayLayoutModel.h"
+#include "GlobalState.h"
 #include "IntensityCurveInterface.h"
 #include "DisplayMappingPolicy.h"
 #include "LayerAssociation.txx"
@@ -637,6 +640,68 @@ void IntensityCurveModel::OnAutoFitWindow()
   dmp->AutoFitContrast();
 }
 
+void IntensityCurveModel::OnAutoFitWindowToVisibleRegion()
+{
+  AbstractContinuousImageDisplayMappingPolicy *dmp = this->GetDisplayPolicy();
+  assert(dmp);
+
+  // The part of the layer's slice that is on the screen in each view. Views
+  // hidden by the current layout (e.g., when one view is maximized) are left
+  // empty, so that they do not contribute to the fit
+  DisplayLayoutModel *dlm = m_ParentModel->GetDisplayLayoutModel();
+  itk::ImageRegion<2> regions[3];
+  for(unsigned int i = 0; i < 3; i++)
+    {
+    GenericSliceModel *sm = m_ParentModel->GetSliceModel(i);
+    if(sm->IsSliceInitialized() && dlm->GetViewPanelVisibilityModel(i)->GetValue())
+      regions[i] = sm->GetVisibleSliceRegion(m_Layer);
+    }
+
+  dmp->AutoFitContrastInSlices(regions);
+}
+
+void IntensityCurveModel::OnAutoFitWindowToSegmentationROI()
+{
+  AbstractContinuousImageDisplayMappingPolicy *dmp = this->GetDisplayPolicy();
+  assert(dmp);
+
+  // The ROI is given in the voxels of the main image. Find the voxels of the
+  // layer that it covers by mapping the corners of the ROI
+  GlobalState *gs = m_ParentModel->GetGlobalState();
+  if(!gs->isSegmentationROIValid())
+    return;
+
+  ImageWrapperBase *main = m_ParentModel->GetDriver()->GetCurrentImageData()->GetMain();
+  itk::ImageRegion<3> roi = gs->GetSegmentationROISettings().GetROI();
+
+  Vector3d xmin(1e100), xmax(-1e100);
+  for(unsigned int c = 0; c < 8; c++)
+    {
+    Vector3d corner;
+    for(unsigned int d = 0; d < 3; d++)
+      corner[d] = roi.GetIndex(d) - 0.5 + ((c >> d) & 1) * roi.GetSize(d);
+
+    Vector3d x = m_Layer->TransformPositionToVoxelCIndex(
+          main->TransformVoxelCIndexToPosition(corner));
+    for(unsigned int d = 0; d < 3; d++)
+      {
+      xmin[d] = std::min(xmin[d], x[d]);
+      xmax[d] = std::max(xmax[d], x[d]);
+      }
+    }
+
+  // The voxels whose centers are inside of the mapped ROI
+  itk::ImageRegion<3> region;
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    long i0 = (long) ceil(xmin[d]), i1 = (long) floor(xmax[d]);
+    region.SetIndex(d, i0);
+    region.SetSize(d, std::max(i1 - i0 + 1, 0l));
+    }
+
+  dmp->AutoFitContrastInRegion(region);
+}
+
 bool
 IntensityCurveModel
 ::GetHistogramBinSizeValueAndRange(
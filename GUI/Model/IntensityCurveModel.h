@@ -171,7 +171,19 @@ public:
   AbstractRangedDoubleProperty *GetIntensityRangeModel(
       IntensityRangePropertyType index) const;
 
+  /** Fit the window to the histogram of the whole image */
   void OnAutoFitWindow();
+
+  /**
+    Fit the window to a subsample of the intensities that are visible in the
+    slice views. Unlike OnAutoFitWindow, this does not need the histogram of
+    the whole image, and ignores the background outside of the view.
+    */
+  void OnAutoFitWindowToVisibleRegion();
+
+  /** Fit the window to a subsample of the intensities in the segmentation ROI */
+  void OnAutoFitWindowToSegmentationROI();
+
 protected:
 
   IntensityCurveModel();
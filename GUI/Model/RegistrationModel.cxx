@@ -15,6 +15,7 @@
 #include "vnl/algo/vnl_svd.h"
 
 #include "OptimizationProgressRenderer.h"
+#include "RegistrationMetricEstimator.h"
 
 
 const unsigned long RegistrationModel::NOID = (unsigned long)(-1);
@@ -97,6 +98,24 @@ RegistrationModel::RegistrationModel()
   m_RegistrationProgressRenderer = OptimizationProgressRenderer::New();
   m_RegistrationProgressRenderer->SetModel(this);
 
+  // Live metric readout
+  m_MetricEstimator = RegistrationMetricEstimator::New();
+  m_LiveMetricFixedId = m_LiveMetricMovingId = NOID;
+  m_LiveMetricFixedMTime = m_LiveMetricMovingMTime = 0;
+  m_LiveMetricTransformMTime = 0;
+  m_LiveMetricFirstRequest = 0;
+  m_LiveMetricValid = false;
+  m_LiveNCC = m_LiveNMI = m_LiveSSD = 0.0;
+
+  m_LiveNCCModel = wrapGetterSetterPairAsProperty(
+        this, &Self::GetLiveNCCValue);
+
+  m_LiveNMIModel = wrapGetterSetterPairAsProperty(
+        this, &Self::GetLiveNMIValue);
+
+  m_LiveSSDModel = wrapGetterSetterPairAsProperty(
+        this, &Self::GetLiveSSDValue);
+
   m_Driver = NULL;
   m_Parent = NULL;
   m_GreedyAPI = NULL;
@@ -518,8 +537,10 @@ void RegistrationModel::UpdateWrapperFromManualParameters()
   affine->SetMatrix(m_ManualParam.AffineMatrix);
   affine->SetOffset(m_ManualParam.AffineOffset);
 
-  // Update the layer's transform
-  layer->SetITKTransform(layer->GetReferenceSpace(), affine);
+  // Update the layer's transform, keeping its displacement field, if any
+  layer->SetITKTransform(
+        layer->GetReferenceSpace(),
+        AffineTransformHelper::ReplaceAffinePart(layer->GetITKTransform(), affine));
 
   // Update the state of the cache
   m_ManualParam.LayerID = m_MovingLayerId;
@@ -594,9 +615,11 @@ void RegistrationModel::SetMovingTransform(const RegistrationModel::ITKMatrixTyp
   affine->SetMatrix(matrix);
   affine->SetOffset(offset);
 
-  // Create a new euler transform
+  // Create a new euler transform, keeping the displacement field, if any
   ImageWrapperBase *layer = this->GetMovingLayerWrapper();
-  layer->SetITKTransform(layer->GetReferenceSpace(), affine);
+  layer->SetITKTransform(
+        layer->GetReferenceSpace(),
+        AffineTransformHelper::ReplaceAffinePart(layer->GetITKTransform(), affine));
 
   // Update our parameters
   this->UpdateManualParametersFromWrapper(false, false);
@@ -611,15 +634,7 @@ void RegistrationModel::GetMovingTransform(ITKMatrixType &matrix, ITKVectorType
   // TODO: in the future it might make more sense to stick to a single kind of
   // transform in the ImageWrapper instead of allowing different transform
   // classes. Using multiple classes seems pointless.
-  typedef itk::MatrixOffsetTransformBase<double, 3, 3> TransformBase;
-  const TransformBase *tb = dynamic_cast<const TransformBase *>(transform);
-  matrix.SetIdentity();
-  offset.Fill(0.0);
-  if(tb)
-    {
-    matrix = tb->GetMatrix();
-    offset = tb->GetOffset();
-    }
+  AffineTransformHelper::GetMatrixAndOffset(transform, matrix, offset);
 }
 
 ImageWrapperBase *RegistrationModel::GetMovingLayerWrapper() const
@@ -841,19 +856,30 @@ void RegistrationModel::MatchByMoments(int order)
 
 void RegistrationModel::LoadTransform(const char *filename, TransformFormat format)
 {
-  // Read the transform
-  SmartPtr<AffineTransformHelper::ITKTransformMOTB> tran;
-  if(format == FORMAT_C3D)
-    tran = AffineTransformHelper::ReadAsRASMatrix(filename);
+  ImageWrapperBase *layer = this->GetMovingLayerWrapper();
+
+  // Read the transform. A warp replaces the displacement field of the layer
+  // and a linear transform replaces its affine part
+  SmartPtr<AffineTransformHelper::ITKTransformBase> tran;
+  if(format == FORMAT_WARP)
+    {
+    tran = AffineTransformHelper::ReadDeformableTransform(
+             filename, layer->GetITKTransform());
+    }
   else
-    tran = AffineTransformHelper::ReadAsITKTransform(filename);
+    {
+    SmartPtr<AffineTransformHelper::ITKTransformMOTB> affine =
+        (format == FORMAT_C3D)
+        ? AffineTransformHelper::ReadAsRASMatrix(filename)
+        : AffineTransformHelper::ReadAsITKTransform(filename);
+    tran = AffineTransformHelper::ReplaceAffinePart(layer->GetITKTransform(), affine);
+    }
 
   // Update the history
   this->GetParent()->GetSystemInterface()
       ->GetHistoryManager()->UpdateHistory("AffineTransform", filename, true);
 
   // Now, the transform tran should hold our matrix and offset
-  ImageWrapperBase *layer = this->GetMovingLayerWrapper();
   layer->SetITKTransform(layer->GetReferenceSpace(), tran);
 
   // Update our parameters
@@ -892,6 +918,132 @@ void RegistrationModel::OnDialogClosed()
   // Don't leave the interactive mode on
   if(m_InteractiveToolModel->GetValue())
     m_InteractiveToolModel->SetValue(false);
+
+  // The metric cache is not needed until the dialog is opened again
+  this->ResetLiveMetric();
+}
+
+void RegistrationModel::ResetLiveMetric()
+{
+  m_MetricEstimator->ReleaseImages();
+  m_LiveMetricFixedId = m_LiveMetricMovingId = NOID;
+  if(m_LiveMetricValid)
+    {
+    m_LiveMetricValid = false;
+    this->InvokeEvent(ModelUpdateEvent());
+    }
+}
+
+// Sample the native intensities of a layer on a regular grid with at most
+// max_samples voxels, and store them in an image with the geometry of the grid
+static SmartPtr<RegistrationMetricEstimator::FloatImageType>
+SampleLayerOnRegularGrid(ImageWrapperBase *layer, unsigned long max_samples)
+{
+  typedef RegistrationMetricEstimator::FloatImageType FloatImageType;
+  ScalarImageWrapperBase *scalar = layer->GetDefaultScalarRepresentation();
+  itk::ImageRegion<3> region = layer->GetBufferedRegion();
+  unsigned int stride = GetRegularSamplingStride(region, max_samples);
+
+  std::vector<double> samples;
+  samples.reserve(max_samples);
+  scalar->SampleNativeIntensities(region, max_samples, samples);
+
+  // The grid starts at the first voxel, so only the spacing changes
+  const itk::ImageBase<3> *base = layer->GetImageBase();
+  FloatImageType::RegionType grid;
+  FloatImageType::SpacingType spacing;
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    grid.SetSize(d, (region.GetSize(d) + stride - 1) / stride);
+    spacing[d] = base->GetSpacing()[d] * stride;
+    }
+
+  SmartPtr<FloatImageType> image = FloatImageType::New();
+  image->SetRegions(grid);
+  image->SetSpacing(spacing);
+  image->SetOrigin(base->GetOrigin());
+  image->SetDirection(base->GetDirection());
+  image->Allocate();
+  assert(samples.size() == grid.GetNumberOfPixels());
+  std::copy(samples.begin(), samples.end(), image->GetBufferPointer());
+  return image;
+}
+
+void RegistrationModel::UpdateLiveMetric()
+{
+  ImageWrapperBase *moving = this->GetMovingLayerWrapper();
+  ImageWrapperBase *fixed = m_Driver->IsMainImageLoaded()
+      ? m_Driver->GetCurrentImageData()->GetMain() : NULL;
+
+  if(!moving || !fixed)
+    {
+    if(m_LiveMetricMovingId != NOID)
+      this->ResetLiveMetric();
+    return;
+    }
+
+  // Rebuild the downsampled images if the layers or their contents have changed.
+  // The layers are sampled on a grid with about as many voxels as the cache,
+  // so that this does not take a pass over the full resolution images
+  bool rebuilt = false;
+  if(fixed->GetUniqueId() != m_LiveMetricFixedId
+     || moving->GetUniqueId() != m_LiveMetricMovingId
+     || fixed->GetImageBase()->GetMTime() != m_LiveMetricFixedMTime
+     || moving->GetImageBase()->GetMTime() != m_LiveMetricMovingMTime)
+    {
+    unsigned long dim = m_MetricEstimator->GetMaximumCacheDimension();
+    unsigned long max_samples = dim * dim * dim;
+    m_MetricEstimator->SetImages(SampleLayerOnRegularGrid(fixed, max_samples),
+                                 SampleLayerOnRegularGrid(moving, max_samples));
+
+    m_LiveMetricFixedId = fixed->GetUniqueId();
+    m_LiveMetricMovingId = moving->GetUniqueId();
+    m_LiveMetricFixedMTime = fixed->GetImageBase()->GetMTime();
+    m_LiveMetricMovingMTime = moving->GetImageBase()->GetMTime();
+    rebuilt = true;
+    }
+
+  // Submit the transform if it has changed since the last request
+  unsigned long tran_mtime = moving->GetITKTransform()->GetMTime();
+  if(rebuilt || tran_mtime != m_LiveMetricTransformMTime)
+    {
+    ITKMatrixType matrix; ITKVectorType offset;
+    this->GetMovingTransform(matrix, offset);
+    unsigned long id = m_MetricEstimator->RequestEvaluation(matrix, offset);
+    if(rebuilt)
+      m_LiveMetricFirstRequest = id;
+    m_LiveMetricTransformMTime = tran_mtime;
+    }
+
+  // Pick up the most recent result
+  RegistrationMetricEstimator::Result result;
+  if(m_MetricEstimator->GetLatestResult(result)
+     && result.RequestId >= m_LiveMetricFirstRequest)
+    {
+    m_LiveMetricValid = result.NumberOfSamples > 0;
+    m_LiveNCC = result.NCC;
+    m_LiveNMI = result.NMI;
+    m_LiveSSD = result.SSD;
+    this->InvokeEvent(ModelUpdateEvent());
+    }
+}
+
+bool RegistrationModel::GetLiveNCCValue(double &value)
+{
+  value = m_LiveNCC;
+  return m_LiveMetricValid;
+}
+
+bool RegistrationModel::GetLiveNMIValue(double &value)
+{
+  value = m_LiveNMI;
+  return m_LiveMetricValid;
+}
+
+bool RegistrationModel::GetLiveSSDValue(double &value)
+{
+  value = m_LiveSSD;
+  return m_LiveMetricValid;
 }
 
 void RegistrationModel
@@ -11,6 +11,7 @@ class GlobalUIModel;
 class IRISApplication;
 class ImageWrapperBase;
 class OptimizationProgressRenderer;
+class RegistrationMetricEstimator;
 
 template <unsigned int VDim, class TReal> class GreedyApproach;
 
@@ -44,8 +45,9 @@ public:
   /** Image similarity metrics */
   enum SimilarityMetric { NMI = 0, NCC, SSD, INVALID_METRIC };
 
-  /** Types of transform file */
-  enum TransformFormat { FORMAT_ITK = 0, FORMAT_C3D };
+  /** Types of transform file. A warp is a displacement field image that is
+    applied before the current affine transform of the moving layer */
+  enum TransformFormat { FORMAT_ITK = 0, FORMAT_C3D, FORMAT_WARP };
 
   /**
     Check the state flags above
@@ -133,6 +135,22 @@ public:
 
   irisSimplePropertyAccessMacro(LastMetricValue, double)
 
+  /**
+    Approximate similarity between the main image and the moving image under
+    the current transform. These are computed in the background on
+    downsampled images, and have no value until the first computation ends
+    */
+  irisGetMacro(LiveNCCModel, AbstractSimpleDoubleProperty *)
+  irisGetMacro(LiveNMIModel, AbstractSimpleDoubleProperty *)
+  irisGetMacro(LiveSSDModel, AbstractSimpleDoubleProperty *)
+
+  /**
+    Check for changes to the images and the transform, request a new metric
+    computation if needed, and pick up completed results. Should be called
+    periodically (e.g., from a timer) while the registration dialog is shown
+    */
+  void UpdateLiveMetric();
+
   /** Get the progress renderer object */
   irisGetMacro(RegistrationProgressRenderer, OptimizationProgressRenderer *)
 
@@ -295,6 +313,35 @@ protected:
   // Renderer used to plot the metric
   SmartPtr<OptimizationProgressRenderer> m_RegistrationProgressRenderer;
 
+  // Live metric computation
+  SmartPtr<RegistrationMetricEstimator> m_MetricEstimator;
+
+  // Layers and times for which the metric cache was built
+  unsigned long m_LiveMetricFixedId, m_LiveMetricMovingId;
+  unsigned long m_LiveMetricFixedMTime, m_LiveMetricMovingMTime;
+
+  // Modified time of the last transform submitted for evaluation
+  unsigned long m_LiveMetricTransformMTime;
+
+  // Results of requests submitted before the cache was rebuilt are ignored
+  unsigned long m_LiveMetricFirstRequest;
+
+  // Latest metric values
+  bool m_LiveMetricValid;
+  double m_LiveNCC, m_LiveNMI, m_LiveSSD;
+
+  SmartPtr<AbstractSimpleDoubleProperty> m_LiveNCCModel;
+  bool GetLiveNCCValue(double &value);
+
+  SmartPtr<AbstractSimpleDoubleProperty> m_LiveNMIModel;
+  bool GetLiveNMIValue(double &value);
+
+  SmartPtr<AbstractSimpleDoubleProperty> m_LiveSSDModel;
+  bool GetLiveSSDValue(double &value);
+
+  // Reset the live metric and release its cache
+  void ResetLiveMetric();
+
   // Euler angles to a rotation matrix
   Mat3 MapEulerAnglesToRotationMatrix(const Vec3 &euler_angles) const;
   Vec3 MapRotationMatrixToEulerAngles(const Mat3 &rotation) const;
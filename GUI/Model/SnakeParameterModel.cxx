@@ -31,6 +31,9 @@ SnakeParameterModel::SnakeParameterModel()
   m_CasellesOrAdvancedModeModel = wrapGetterSetterPairAsProperty(
         this, &Self::GetCasellesOrAdvancedModeValue);
 
+  m_PreserveTopologyModel = wrapGetterSetterPairAsProperty(
+        this, &Self::GetPreserveTopologyValue, &Self::SetPreserveTopologyValue);
+
   m_AnimateDemoModel = NewSimpleConcreteProperty(false);
 
   // Treat changes to the state as model updates
@@ -372,6 +375,23 @@ SnakeParameterModel
   m_ParametersModel->SetValue(param);
 }
 
+bool
+SnakeParameterModel
+::GetPreserveTopologyValue(bool &value)
+{
+  value = m_ParametersModel->GetValue().GetPreserveTopology();
+  return true;
+}
+
+void
+SnakeParameterModel
+::SetPreserveTopologyValue(bool value)
+{
+  SnakeParameters param = m_ParametersModel->GetValue();
+  param.SetPreserveTopology(value);
+  m_ParametersModel->SetValue(param);
+}
+
 bool SnakeParameterModel::GetCasellesOrAdvancedModeValue()
 {
   return this->GetAdvancedEquationModeModel()->GetValue() || (!this->IsRegionSnake());
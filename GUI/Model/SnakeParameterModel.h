@@ -59,6 +59,9 @@ public:
   irisSimplePropertyAccessMacro(AdvancedEquationMode, bool)
   irisSimplePropertyAccessMacro(CasellesOrAdvancedMode, bool)
 
+  // Whether the evolution preserves the topology of the segmentation
+  irisSimplePropertyAccessMacro(PreserveTopology, bool)
+
   // Whether the demo is being animated
   irisSimplePropertyAccessMacro(AnimateDemo, bool)
 
@@ -105,6 +108,10 @@ protected:
   SmartPtr<AbstractSimpleBooleanProperty> m_CasellesOrAdvancedModeModel;
   bool GetCasellesOrAdvancedModeValue();
 
+  SmartPtr<AbstractSimpleBooleanProperty> m_PreserveTopologyModel;
+  bool GetPreserveTopologyValue(bool &value);
+  void SetPreserveTopologyValue(bool value);
+
   SmartPtr<ConcreteSimpleBooleanProperty> m_AnimateDemoModel;
 
   void SetupPreviewPipeline();
@@ -277,6 +277,16 @@ void SnakeROIModel::ResetROI()
   m_Parent->GetDriver()->GetGlobalState()->SetSegmentationROI(roi);
 }
 
+void SnakeROIModel::FitROIToSegmentation()
+{
+  // Pad the label by a quarter of its extent, but at least by a few voxels
+  GlobalState::RegionType roi =
+      m_Parent->GetDriver()->ComputeAutomaticSegmentationROI(10, 0.25);
+
+  // Update
+  m_Parent->GetDriver()->GetGlobalState()->SetSegmentationROI(roi);
+}
+
 void SnakeROIModel::ProcessLeaveEvent()
 {
   // Turn off the highlight
@@ -90,6 +90,13 @@ public:
 
   void ResetROI();
 
+  /**
+   * Fit the ROI around the current drawing label in the segmentation and the
+   * cursor position, with a margin. This can make the active contour much
+   * faster than using the whole image.
+   */
+  void FitROIToSegmentation();
+
   friend class SnakeROIRenderer;
 
 
@@ -139,6 +139,10 @@ SnakeWizardModel::SnakeWizardModel()
         nullsetter,
         EvolutionIterationEvent());
 
+  m_GrowROIModel = NewSimpleConcreteProperty(false);
+
+  m_EvolutionRunning = false;
+
   m_NumberOfClustersModel = wrapGetterSetterPairAsProperty(
         this,
         &Self::GetNumberOfClustersValueAndRange,
@@ -1422,6 +1426,11 @@ bool SnakeWizardModel::PerformEvolutionStep()
   // Do the segmentation step!
   m_Driver->GetSNAPImageData()->RunSegmentation(m_StepSizeModel->GetValue());
 
+  // Once the contour reaches the edge of the region of interest, continue
+  // the evolution in a larger region
+  if(m_GrowROIModel->GetValue())
+    m_Driver->GrowSegmentationROI(2, 10, 0.25, m_Parent->GetProgressCommand());
+
   // Fire an event
   InvokeEvent(EvolutionIterationEvent());
 
@@ -142,6 +142,9 @@ public:
   irisGetMacro(StepSizeModel, AbstractRangedIntProperty *)
   irisGetMacro(EvolutionIterationModel, AbstractSimpleIntProperty *)
 
+  // Model for whether the region of interest grows with the contour
+  irisSimplePropertyAccessMacro(GrowROI, bool)
+
   /** Check the state flags above */
   bool CheckState(UIState state);
 
@@ -208,6 +211,13 @@ public:
    */
   bool PerformEvolutionStep();
 
+  /**
+   * Whether the evolution is being run continuously, rather than paused or
+   * stepped. Set by the GUI that drives the evolution
+   */
+  irisIsMacro(EvolutionRunning)
+  irisSetMacro(EvolutionRunning, bool)
+
   /** Rewind the evolution */
   void RewindEvolution();
 
@@ -372,6 +382,11 @@ protected:
   SmartPtr<AbstractSimpleIntProperty> m_EvolutionIterationModel;
   int GetEvolutionIterationValue();
 
+  SmartPtr<ConcreteSimpleBooleanProperty> m_GrowROIModel;
+
+  // Whether the evolution is running continuously
+  bool m_EvolutionRunning;
+
   // Get the threshold settings for the active layer
   ThresholdSettings *GetThresholdSettings();
 
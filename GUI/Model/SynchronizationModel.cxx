@@ -11,6 +11,7 @@
 #include "vtkCamera.h"
 #include "vtkCommand.h"
 #include "IPCHandler.h"
+#include "GlobalState.h"
 
 /** Structure passed on to IPC */
 struct IPCMessage
@@ -90,6 +91,11 @@ void SynchronizationModel::SetParentModel(GlobalUIModel *parent)
 }
 
 
+AbstractSimpleBooleanProperty *SynchronizationModel::GetSyncShareImagesModel() const
+{
+  return m_Parent->GetGlobalState()->GetShareImagesBetweenSessionsModel();
+}
+
 void SynchronizationModel::OnUpdate()
 {
   // If there is no synchronization or no image, get out
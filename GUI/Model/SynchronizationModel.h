@@ -26,6 +26,9 @@ public:
   irisSimplePropertyAccessMacro(SyncPan, bool)
   irisSimplePropertyAccessMacro(SyncCamera, bool)
 
+  /** Model for sharing loaded images with the other sessions (see GlobalState) */
+  AbstractSimpleBooleanProperty *GetSyncShareImagesModel() const;
+
   /**
    * Whether the model should be broadcasting. The GUI should toggle this
    * flag depending on whether the window is active or not */
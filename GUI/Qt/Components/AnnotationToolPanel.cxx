@@ -42,7 +42,7 @@ void AnnotationToolPanel::on_btnOpen_clicked()
   // Load annotations
   QString file = ShowSimpleOpenDialogWithHistory(
                    this, m_Model, "Annotations", "Open Annotation File",
-                   "Annotation File", "ITK-SNAP Annotation Files (*.annot)");
+                   "Annotation File", "ITK-SNAP Annotation Files (*.annot);;Annotation Tables (*.csv *.tsv)");
 
   if(!file.isNull())
     {
@@ -64,7 +64,7 @@ void AnnotationToolPanel::on_btnSave_clicked()
   // Save annotations
   QString file = ShowSimpleSaveDialogWithHistory(
                    this, m_Model, "Annotations", "Open Annotation File",
-                   "Annotation File", "ITK-SNAP Annotation Files (*.annot)", false);
+                   "Annotation File", "ITK-SNAP Annotation Files (*.annot);;Annotation Tables (*.csv *.tsv)", false);
 
   if(!file.isNull())
     {
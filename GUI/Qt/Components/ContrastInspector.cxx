@@ -11,6 +11,7 @@
 #include "IntensityCurveVTKRenderer.h"
 
 #include <QPalette>
+#include <QMenu>
 
 ContrastInspector::ContrastInspector(QWidget *parent) :
     SNAPComponent(parent),
@@ -27,6 +28,14 @@ ContrastInspector::ContrastInspector(QWidget *parent) :
   m_CurveRenderer = IntensityCurveVTKRenderer::New();
   ui->plotWidget->SetRenderer(m_CurveRenderer);
   m_CurveRenderer->SetBackgroundColor(Vector3d(1.0, 1.0, 1.0));
+
+  // The auto button fits the window to the whole image, and its menu to
+  // smaller regions
+  QMenu *menuAuto = new QMenu(this);
+  menuAuto->addAction(ui->actionAutoFitVisibleRegion);
+  menuAuto->addAction(ui->actionAutoFitSegmentationROI);
+  ui->btnAuto->setMenu(menuAuto);
+  ui->btnAuto->setPopupMode(QToolButton::MenuButtonPopup);
 }
 
 ContrastInspector::~ContrastInspector()
@@ -101,3 +110,13 @@ void ContrastInspector::on_btnAuto_clicked()
 {
   m_Model->OnAutoFitWindow();
 }
+
+void ContrastInspector::on_actionAutoFitVisibleRegion_triggered()
+{
+  m_Model->OnAutoFitWindowToVisibleRegion();
+}
+
+void ContrastInspector::on_actionAutoFitSegmentationROI_triggered()
+{
+  m_Model->OnAutoFitWindowToSegmentationROI();
+}
@@ -36,6 +36,10 @@ private slots:
 
   void on_btnAuto_clicked();
 
+  void on_actionAutoFitVisibleRegion_triggered();
+
+  void on_actionAutoFitSegmentationROI_triggered();
+
 private:
 
   IntensityCurveModel *m_Model;
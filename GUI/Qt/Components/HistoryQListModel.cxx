@@ -7,16 +7,12 @@
 #include <QIcon>
 #include "SNAPQtCommon.h"
 #include "LatentITKEventNotifier.h"
-#include "itkImageFileReader.h"
 
-#include <QWaitCondition>
-#include <QThread>
 #include <QString>
-#include <SNAPQtCommon.h>
-#include <QPixmapCache>
 #include <QFileInfo>
 #include <QIcon>
-#include <QTimer>
+#include <QPixmap>
+#include <QMutexLocker>
 
 HistoryQListModel::HistoryQListModel(QObject *parent) :
   QStandardItemModel(parent)
@@ -26,6 +22,11 @@ HistoryQListModel::HistoryQListModel(QObject *parent) :
   QPixmap pixmap(128,128);
   pixmap.fill(QColor(Qt::lightGray));
   m_DummyIcon = QIcon(pixmap);
+
+  // Thumbnails are loaded in the background
+  m_Loader = new HistoryThumbnailLoader(this);
+  connect(m_Loader, SIGNAL(thumbnailLoaded(QString, QImage)),
+          this, SLOT(onThumbnailLoaded(QString, QImage)));
 }
 
 void HistoryQListItem::setItem(
@@ -39,70 +40,128 @@ void HistoryQListItem::setItem(
   // Set the filename
   this->setToolTip(history_entry);
   this->setData(history_entry, Qt::UserRole);
-  QPixmap dummy(128, 128);
-  dummy.fill(Qt::black);
-  this->setIcon(QIcon(dummy));
 
   // At the moment, these are hard-coded
   this->setSizeHint(QSize(188,144));
 
-  // Deal with the icon later
+  // The icon is loaded later
   std::string hist_str = to_utf8(history_entry);
   std::string thumbnail =
       model->GetDriver()->GetSystemInterface()->GetThumbnailAssociatedWithFile(hist_str.c_str());
 
   m_IconFilename = from_utf8(thumbnail);
+}
 
-  // TODO: for debugging change 0 to a random number
-  QTimer::singleShot(0, this, SLOT(onTimer()));
+HistoryThumbnailLoader::HistoryThumbnailLoader(QObject *parent)
+  : QThread(parent), m_SystemInterface(NULL), m_NewRequest(false), m_Stop(false)
+{
 }
 
-void HistoryQListItem::onTimer()
+HistoryThumbnailLoader::~HistoryThumbnailLoader()
 {
-  // Construct a string from the filenane and the timestamp
-  QString key = QString("%1::%2")
-                .arg(m_IconFilename)
-                .arg(QFileInfo(m_IconFilename).lastModified().toString());
-  QPixmap *pixmap = QPixmapCache::find(key);
-  if(pixmap)
-    this->setIcon(QIcon(*pixmap));
+  m_Mutex.lock();
+  m_Stop = true;
+  m_Condition.wakeOne();
+  m_Mutex.unlock();
+  this->wait();
+}
+
+void HistoryThumbnailLoader::load(
+    SystemInterface *si, const QString &thumbdir, const QStringList &files)
+{
+  QMutexLocker locker(&m_Mutex);
+  m_SystemInterface = si;
+  m_Directory = thumbdir;
+  m_Pending = files;
+  m_NewRequest = true;
+
+  if(this->isRunning())
+    m_Condition.wakeOne();
   else
+    this->start(QThread::LowPriority);
+}
+
+void HistoryThumbnailLoader::run()
+{
+  m_Mutex.lock();
+  while(!m_Stop)
     {
-    try
+    if(!m_NewRequest)
       {
-    /*
-      // Load the icon using ITK to avoid this really annoying warning
-      // from the PNG library. The only problem is that QIcon caches
-      typedef itk::RGBAPixel<unsigned char> PNGPixelType;
-      typedef itk::Image<PNGPixelType, 2> PNGSliceType;
-      typedef itk::ImageFileReader<PNGSliceType> PNGReaderType;
-      SmartPtr<PNGReaderType> reader = PNGReaderType::New();
-      reader->SetFileName(to_utf8(m_IconFilename).c_str());
-      reader->Update();
-
-      // Need to load the icon
-      SmartPtr<PNGSliceType> slice = reader->GetOutput();
-      int w = slice->GetBufferedRegion().GetSize()[0];
-      int h = slice->GetBufferedRegion().GetSize()[1];
-      QImage image(w, h, QImage::Format_ARGB32);
-      PNGPixelType *input = slice->GetBufferPointer();
-      QRgb *output = reinterpret_cast<QRgb*>(image.bits());
-      for(int i = 0; i < slice->GetPixelContainer()->Size(); i++)
-        {
-        *output++ = qRgba(input[i].GetRed(), input[i].GetGreen(), input[i].GetBlue(), input[i].GetAlpha());
-        } */
-
-      QPixmap load_pixmap(m_IconFilename);
-      this->setIcon(QIcon(load_pixmap));
-      QPixmapCache::insert(key, load_pixmap);
+      m_Condition.wait(&m_Mutex);
+      continue;
       }
-    catch(itk::ExceptionObject &)
+
+    // Take the request
+    SystemInterface *si = m_SystemInterface;
+    QString thumbdir = m_Directory;
+    QStringList files = m_Pending;
+    m_NewRequest = false;
+    m_Mutex.unlock();
+
+    // An image is added to the history before its thumbnail is made, so wait
+    // for the thumbnails that are still being written
+    if(si)
+      si->FlushThumbnails();
+
+    // One read of the index gives the time stamps of all the thumbnails
+    SystemInterface::ThumbnailIndex index;
+    bool have_index = SystemInterface::ReadThumbnailIndex(to_utf8(thumbdir), index);
+
+    for(int i = 0; i < files.size(); i++)
       {
-      QPixmap dummy(128, 128);
-      dummy.fill(Qt::black);
-      this->setIcon(QIcon(dummy));
-      QPixmapCache::insert(key, dummy);
+      // Stop early if there is a new request or the loader is stopping
+      m_Mutex.lock();
+      bool interrupted = m_Stop || m_NewRequest;
+      m_Mutex.unlock();
+      if(interrupted)
+        break;
+
+      // Thumbnails that are not in the index were written by an older version
+      // or have not been written yet, and have to be checked on disk
+      QString file = files[i];
+      QFileInfo fi(file);
+      SystemInterface::ThumbnailIndex::const_iterator it =
+          have_index ? index.find(to_utf8(fi.fileName())) : index.end();
+      qint64 stamp = -1;
+      if(it != index.end())
+        stamp = it->second;
+      else if(fi.exists())
+        stamp = fi.lastModified().toMSecsSinceEpoch();
+      else
+        continue;
+
+      // Read the thumbnail unless the cached copy is current
+      QHash<QString, QPair<qint64, QImage> >::const_iterator cit = m_Cache.find(file);
+      QImage image;
+      if(cit != m_Cache.end() && cit.value().first == stamp)
+        {
+        image = cit.value().second;
+        }
+      else
+        {
+        image = QImage(file);
+        if(image.isNull())
+          continue;
+        m_Cache.insert(file, qMakePair(stamp, image));
+        }
+
+      emit thumbnailLoaded(file, image);
       }
+
+    m_Mutex.lock();
+    }
+  m_Mutex.unlock();
+}
+
+void HistoryQListModel::onThumbnailLoaded(const QString &file, const QImage &image)
+{
+  QIcon icon(QPixmap::fromImage(image));
+  for(int i = 0; i < this->rowCount(); i++)
+    {
+    HistoryQListItem *si = static_cast<HistoryQListItem *>(this->item(i, 0));
+    if(si && si->iconFilename() == file)
+      si->setIcon(icon);
     }
 }
 
@@ -116,13 +175,20 @@ void HistoryQListModel::rebuildModel()
   this->setRowCount(history.size());
 
   // We need to parse the history in reverse order (but why?)
+  QStringList thumbnails;
   for(int i = 0; i < history.size(); i++)
     {
     // Create a standard item to hold this
     HistoryQListItem *si = new HistoryQListItem();
     si->setItem(m_Model, from_utf8(history[history.size() - 1 - i]));
+    si->setIcon(m_DummyIcon);
     this->setItem(i, 0, si);
+    thumbnails.push_back(si->iconFilename());
     }
+
+  // Load the thumbnails in the background
+  SystemInterface *si = m_Model->GetDriver()->GetSystemInterface();
+  m_Loader->load(si, from_utf8(si->GetThumbnailDirectory()), thumbnails);
 }
 
 void HistoryQListModel::Initialize(
@@ -9,20 +9,25 @@
 #include <QImage>
 #include <QStandardItemModel>
 #include <QStandardItem>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QPair>
+#include <QStringList>
 
 class EventBucket;
 class GlobalUIModel;
+class SystemInterface;
 
-class HistoryQListItem : public QObject, public QStandardItem
+class HistoryQListItem : public QStandardItem
 {
-  Q_OBJECT
 public:
 
   virtual void setItem(GlobalUIModel *model, const QString &history_entry);
 
-protected slots:
-
-  void onTimer();
+  /** Full path of the thumbnail file for this item */
+  const QString &iconFilename() const { return m_IconFilename; }
 
 protected:
 
@@ -31,6 +36,48 @@ protected:
 };
 
 
+/**
+  Thread that loads the thumbnails shown in the history panels, so that
+  reading them from a slow disk does not stall the GUI. The time stamps in
+  the thumbnail index tell whether a thumbnail that was already loaded is
+  current, so the thumbnail files are only read when they change. Loaded
+  thumbnails are sent to the GUI thread as QImages, since QPixmaps can only
+  be created there. Before loading, the thread waits for the thumbnails that
+  the system interface is still writing.
+  */
+class HistoryThumbnailLoader : public QThread
+{
+  Q_OBJECT
+
+public:
+  explicit HistoryThumbnailLoader(QObject *parent = 0);
+  ~HistoryThumbnailLoader();
+
+  /** Load the given thumbnails, dropping the ones that are still pending */
+  void load(SystemInterface *si, const QString &thumbdir, const QStringList &files);
+
+signals:
+
+  void thumbnailLoaded(const QString &file, const QImage &image);
+
+protected:
+
+  virtual void run();
+
+  QMutex m_Mutex;
+  QWaitCondition m_Condition;
+
+  // Pending request, and whether it has been replaced by a new one
+  SystemInterface *m_SystemInterface;
+  QString m_Directory;
+  QStringList m_Pending;
+  bool m_NewRequest, m_Stop;
+
+  // Loaded thumbnails and their time stamps. Only used by the thread
+  QHash<QString, QPair<qint64, QImage> > m_Cache;
+};
+
+
 /**
   QT model used to display an item from the image history as an entry in
   the table of recently loaded images
@@ -48,12 +95,14 @@ public slots:
 
   void onModelUpdate(const EventBucket &bucket);
 
+protected slots:
+
+  void onThumbnailLoaded(const QString &file, const QImage &image);
+
 protected:
 
   void rebuildModel();
 
-  static void updateIcon(QStandardItem *item);
-
   // Need a pointer to the model
   GlobalUIModel *m_Model;
 
@@ -63,8 +112,8 @@ protected:
   // Dummy icon
   QIcon m_DummyIcon;
 
-  // List of standard items for concurrent code
-  QList<QStandardItem *> m_ItemList;
+  // Thread loading the thumbnails
+  HistoryThumbnailLoader *m_Loader;
 };
 
 
@@ -15,6 +15,7 @@
 #include <QFile>
 #include <QMenu>
 #include <QContextMenuEvent>
+#include <QMap>
 #include <QWidgetAction>
 #include "QtWidgetActivator.h"
 #include "QtCursorOverride.h"
@@ -62,6 +63,22 @@ QWidget *OpacitySliderAction::createWidget(QWidget *parent)
 
 QString LayerInspectorRowDelegate::m_SliderStyleSheetTemplate;
 
+// Icons for the color map presets, shared by the menus of all the rows. The
+// cache is cleared when the presets change.
+static QMap<QString, QIcon> s_ColorMapPresetIcons;
+
+static QIcon GetColorMapPresetIcon(ColorMapPresetManager *pm, const std::string &preset)
+{
+  QString key = from_utf8(preset);
+  QMap<QString, QIcon>::const_iterator it = s_ColorMapPresetIcons.find(key);
+  if(it != s_ColorMapPresetIcons.end())
+    return it.value();
+
+  QIcon icon = CreateColorMapIcon(16, 16, pm->GetPreset(preset));
+  s_ColorMapPresetIcons.insert(key, icon);
+  return icon;
+}
+
 LayerInspectorRowDelegate::LayerInspectorRowDelegate(QWidget *parent) :
   SNAPComponent(parent),
   ui(new Ui::LayerInspectorRowDelegate)
@@ -108,6 +125,10 @@ LayerInspectorRowDelegate::LayerInspectorRowDelegate(QWidget *parent) :
   QMenu *processMenu = m_PopupMenu->addMenu("Image Processing");
   processMenu->addAction(ui->actionTextureFeatures);
 
+  // Submenus are filled in when the popup menu is first shown
+  m_ColorMapMenuDirty = m_ComponentMenuDirty = m_OverlaysMenuDirty = true;
+  connect(m_PopupMenu, SIGNAL(aboutToShow()), this, SLOT(onPopupMenuAboutToShow()));
+
   // set up an event filter
   ui->inLayerOpacity->installEventFilter(this);
 
@@ -189,14 +210,8 @@ void LayerInspectorRowDelegate::SetModel(LayerTableRowModel *model)
   connectITK(m_Model->GetParentModel()->GetGlobalState()->GetSelectedSegmentationLayerIdModel(),
               ValueChangedEvent());
 
-  // Update the color map menu
-  UpdateColorMapMenu();
-
-  // Update the component menu
-  UpdateComponentMenu();
-
-  // Update the overlays
-  this->UpdateOverlaysMenu();
+  // The submenus are built when the popup menu is shown
+  m_ColorMapMenuDirty = m_ComponentMenuDirty = m_OverlaysMenuDirty = true;
 
   // Update the appearance
   this->UpdateTextFont();
@@ -371,7 +386,7 @@ void LayerInspectorRowDelegate::UpdateColorMapMenu()
   // Create the actions for the system presets
   for(unsigned int i = 0; i < pSystem.size(); i++)
     {
-    QIcon icon = CreateColorMapIcon(16, 16, pm->GetPreset(pSystem[i]));
+    QIcon icon = GetColorMapPresetIcon(pm, pSystem[i]);
     QAction *action = m_SystemPresetActionGroup->addAction(icon, from_utf8(pSystem[i]));
     action->setCheckable(true);
     actionMap[pSystem[i]] = action;
@@ -383,7 +398,7 @@ void LayerInspectorRowDelegate::UpdateColorMapMenu()
   // Add the user presets to the action group
   for(unsigned int i = 0; i < pUser.size(); i++)
     {
-    QIcon icon = CreateColorMapIcon(16, 16, pm->GetPreset(pUser[i]));
+    QIcon icon = GetColorMapPresetIcon(pm, pUser[i]);
     QAction *action = m_SystemPresetActionGroup->addAction(icon, from_utf8(pUser[i]));
     action->setCheckable(true);
     actionMap[pUser[i]] = action;
@@ -481,6 +496,35 @@ void LayerInspectorRowDelegate::UpdateOverlaysMenu()
   m_OverlaysMenu->menuAction()->setVisible(k > 0);
 }
 
+void LayerInspectorRowDelegate::UpdateDirtyMenus()
+{
+  if(!m_Model || !m_Model->GetLayer())
+    return;
+
+  if(m_ColorMapMenuDirty)
+    {
+    this->UpdateColorMapMenu();
+    m_ColorMapMenuDirty = false;
+    }
+
+  if(m_ComponentMenuDirty)
+    {
+    this->UpdateComponentMenu();
+    m_ComponentMenuDirty = false;
+    }
+
+  if(m_OverlaysMenuDirty)
+    {
+    this->UpdateOverlaysMenu();
+    m_OverlaysMenuDirty = false;
+    }
+}
+
+void LayerInspectorRowDelegate::onPopupMenuAboutToShow()
+{
+  this->UpdateDirtyMenus();
+}
+
 
 void LayerInspectorRowDelegate::OnNicknameUpdate()
 {
@@ -499,7 +543,7 @@ void LayerInspectorRowDelegate::onModelUpdate(const EventBucket &bucket)
 {
   IRISApplication *app = m_Model->GetParentModel()->GetDriver();
   GlobalState *gs = app->GetGlobalState();
-  if(bucket.HasEvent(WrapperDisplayMappingChangeEvent()))
+  if(bucket.HasEvent(WrapperDisplayMappingChangeEvent(), m_Model->GetLayer()))
     {
     this->ApplyColorMap();
     }
@@ -509,11 +553,12 @@ void LayerInspectorRowDelegate::onModelUpdate(const EventBucket &bucket)
     }
   if(bucket.HasEvent(ColorMapModel::PresetUpdateEvent()))
     {
-    this->UpdateColorMapMenu();
+    s_ColorMapPresetIcons.clear();
+    m_ColorMapMenuDirty = true;
     }
   if(bucket.HasEvent(LayerChangeEvent()) || bucket.HasEvent(WrapperChangeEvent()))
     {
-    this->UpdateOverlaysMenu();
+    m_OverlaysMenuDirty = true;
     this->UpdateTextFont();
     }
   if(bucket.HasEvent(ValueChangedEvent(), gs->GetSelectedLayerIdModel()))
@@ -104,6 +104,8 @@ signals:
 private slots:
   void on_btnMenu_pressed();
 
+  void onPopupMenuAboutToShow();
+
   /*
   void on_btnMoveUp_clicked();
 
@@ -153,11 +155,16 @@ private:
   // An action group for the system presets
   QActionGroup* m_SystemPresetActionGroup, *m_DisplayModeActionGroup;
 
+  // The submenus are only rebuilt when the popup menu is about to be shown,
+  // so that events do not cause every row to rebuild its menus
+  bool m_ColorMapMenuDirty, m_ComponentMenuDirty, m_OverlaysMenuDirty;
+
   void ApplyColorMap();
   void UpdateBackgroundPalette();
   void UpdateColorMapMenu();
   void UpdateComponentMenu();
   void UpdateOverlaysMenu();
+  void UpdateDirtyMenus();
   void UpdateTextFont();
   void OnNicknameUpdate();
 };
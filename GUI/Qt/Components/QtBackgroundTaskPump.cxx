@@ -0,0 +1,35 @@
+#include "QtBackgroundTaskPump.h"
+#include "BackgroundTask.h"
+#include <QTimer>
+
+QtBackgroundTaskPump::QtBackgroundTaskPump(QWidget *parent) :
+  SNAPComponent(parent)
+{
+  m_Model = NULL;
+
+  // The timer only runs while there are active tasks. Progress events are
+  // rate-limited by the task manager, so the interval can be short.
+  m_Timer = new QTimer(this);
+  m_Timer->setInterval(30);
+  connect(m_Timer, SIGNAL(timeout()), this, SLOT(onTimer()));
+}
+
+void QtBackgroundTaskPump::SetModel(BackgroundTaskManager *model)
+{
+  m_Model = model;
+
+  // Listen to task submissions
+  connectITK(m_Model, BackgroundTaskManager::TaskSubmittedEvent());
+}
+
+void QtBackgroundTaskPump::onModelUpdate(const EventBucket &bucket)
+{
+  if(!m_Timer->isActive())
+    m_Timer->start();
+}
+
+void QtBackgroundTaskPump::onTimer()
+{
+  if(!m_Model || !m_Model->ProcessTaskEvents())
+    m_Timer->stop();
+}
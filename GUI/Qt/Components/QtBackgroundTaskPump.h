@@ -0,0 +1,36 @@
+#ifndef QTBACKGROUNDTASKPUMP_H
+#define QTBACKGROUNDTASKPUMP_H
+
+#include <QObject>
+#include <SNAPComponent.h>
+
+class BackgroundTaskManager;
+class QTimer;
+
+/**
+ * @brief Delivers the events of background tasks to the GUI. While there are
+ * active tasks, a timer calls BackgroundTaskManager::ProcessTaskEvents(), so
+ * that progress and completion events are fired on the GUI thread. The timer
+ * is stopped when all tasks have finished.
+ */
+class QtBackgroundTaskPump : public SNAPComponent
+{
+  Q_OBJECT
+public:
+  explicit QtBackgroundTaskPump(QWidget *parent = 0);
+
+  void SetModel(BackgroundTaskManager *model);
+
+public slots:
+
+  virtual void onModelUpdate(const EventBucket &bucket);
+
+  void onTimer();
+
+private:
+
+  BackgroundTaskManager *m_Model;
+  QTimer *m_Timer;
+};
+
+#endif // QTBACKGROUNDTASKPUMP_H
@@ -160,7 +160,13 @@ void QtProgressReporterDelegate::SetProgressDialog(QProgressDialog *dialog)
 #include <QAction>
 void QtProgressReporterDelegate::SetProgressValue(double value)
 {
-  m_Dialog->setValue((int) (1000 * value));
+  // Filters report progress very often. Setting the value of a modal dialog
+  // processes events, so only do it when the displayed value changes
+  int ivalue = (int) (1000 * value);
+  if(ivalue == m_Dialog->value())
+    return;
+
+  m_Dialog->setValue(ivalue);
   // qDebug() << "Progress: " << value;
   // QCoreApplication::processEvents();
 }
@@ -53,6 +53,12 @@ void SnakeToolROIPanel::on_btnResetROI_clicked()
   m_Model->GetSnakeROIModel(0)->ResetROI();
 }
 
+void SnakeToolROIPanel::on_btnFitROI_clicked()
+{
+  // Fit the ROI to the current label
+  m_Model->GetSnakeROIModel(0)->FitROIToSegmentation();
+}
+
 void SnakeToolROIPanel::on_btnAuto_clicked()
 {
   // TODO: Check that the label configuration is valid
@@ -23,6 +23,8 @@ public:
 private slots:
   void on_btnResetROI_clicked();
 
+  void on_btnFitROI_clicked();
+
   void on_btnAuto_clicked();
 
 private:
@@ -14,6 +14,7 @@
 #include "QtDoubleSpinBoxCoupling.h"
 #include "QtSliderCoupling.h"
 #include "QtRadioButtonCoupling.h"
+#include "QtCheckBoxCoupling.h"
 #include "ColorLabelQuickListWidget.h"
 #include "IRISException.h"
 #include <QMessageBox>
@@ -252,6 +253,7 @@ void SnakeWizardPanel::SetModel(GlobalUIModel *model)
 
   makeCoupling(ui->inStepSize, m_Model->GetStepSizeModel());
   makeCoupling(ui->outIteration, m_Model->GetEvolutionIterationModel());
+  makeCoupling(ui->chkGrowROI, m_Model->GetGrowROIModel());
 
   // Activation flags
   /*
@@ -341,6 +343,7 @@ void SnakeWizardPanel::on_stack_currentChanged(int page)
 void SnakeWizardPanel::on_btnPlay_toggled(bool checked)
 {
   // This is where we toggle the snake evolution!
+  m_Model->SetEvolutionRunning(checked);
   if(checked)
     m_EvolutionTimer->start(10);
   else
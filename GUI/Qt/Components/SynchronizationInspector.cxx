@@ -29,6 +29,7 @@ void SynchronizationInspector::SetModel(SynchronizationModel *model)
   makeCoupling(ui->chkZoom, model->GetSyncZoomModel());
   makeCoupling(ui->chkPan, model->GetSyncPanModel());
   makeCoupling(ui->chkCamera, model->GetSyncCameraModel());
+  makeCoupling(ui->chkShareImages, model->GetSyncShareImagesModel());
 
   // The checkboxes should be deactivated when the sync model is off
   makeBooleanNamedPropertyCoupling(ui->panelProperties, "enabled",
@@ -8,7 +8,9 @@
 #include "MainImageWindow.h"
 #include "SNAPQtCommon.h"
 #include "QtWidgetActivator.h"
+#include "QtSpinBoxCoupling.h"
 #include "DisplayLayoutModel.h"
+#include "SnakeWizardModel.h"
 #include <QtCore>
 #include <qtconcurrentrun.h>
 #include "itkProcessObject.h"
@@ -107,6 +109,9 @@ void ViewPanel3D::Initialize(GlobalUIModel *globalUI)
   activateOnFlag(ui->btnUpdateMesh, m_Model, Generic3DModel::UIF_MESH_DIRTY);
   activateOnFlag(ui->actionRestore_Viewpoint, m_Model, Generic3DModel::UIF_CAMERA_STATE_SAVED);
 
+  // Couple the spray brush size
+  makeCoupling(ui->inSprayRadius, m_Model->GetSprayBrushRadiusModel());
+
   // Listen to layout events
   connectITK(m_Model->GetParentUI()->GetDisplayLayoutModel(),
              DisplayLayoutModel::ViewPanelLayoutChangeEvent());
@@ -143,12 +148,12 @@ void ViewPanel3D::UpdateExpandViewButton()
 }
 
 // This method is run in a concurrent thread
-void ViewPanel3D::UpdateMeshesInBackground()
+void ViewPanel3D::UpdateMeshesInBackground(bool preview)
 {
   // Make sure the model actually requires updating
   if(m_Model && m_Model->CheckState(Generic3DModel::UIF_MESH_DIRTY))
     {
-    m_Model->UpdateSegmentationMesh(m_RenderProgressCommand);
+    m_Model->UpdateSegmentationMesh(m_RenderProgressCommand, preview);
     }
 }
 
@@ -202,10 +207,14 @@ void ViewPanel3D::onTimer()
     if(m_Model && ui->actionContinuous_Update->isChecked()
        && m_Model->CheckState(Generic3DModel::UIF_MESH_DIRTY))
       {
+      // Continuous updates of a running snake only need a preview mesh. Once
+      // the evolution is paused, the mesh stays dirty until fully rebuilt
+      bool preview = m_GlobalUI->GetSnakeWizardModel()->IsEvolutionRunning();
+
       // Launch the worker thread
       m_RenderProgressValue = 0;
       m_RenderElapsedTicks = 0;
-      m_RenderFuture = QtConcurrent::run(this, &ViewPanel3D::UpdateMeshesInBackground);
+      m_RenderFuture = QtConcurrent::run(this, &ViewPanel3D::UpdateMeshesInBackground, preview);
       }
     else
       {
@@ -267,16 +276,19 @@ void ViewPanel3D::UpdateActionButtons()
       ui->btnAccept->setVisible(false);
       ui->btnCancel->setVisible(false);
       ui->btnFlip->setVisible(false);
+      ui->inSprayRadius->setVisible(false);
       break;
     case SPRAYPAINT_MODE:
       ui->btnAccept->setVisible(true);
       ui->btnCancel->setVisible(true);
       ui->btnFlip->setVisible(false);
+      ui->inSprayRadius->setVisible(true);
       break;
     case SCALPEL_MODE:
       ui->btnAccept->setVisible(true);
       ui->btnCancel->setVisible(true);
       ui->btnFlip->setVisible(true);
+      ui->inSprayRadius->setVisible(false);
       break;
     }
 }
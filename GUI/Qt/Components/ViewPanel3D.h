@@ -99,7 +99,7 @@ private:
 
   void UpdateExpandViewButton();
 
-  void UpdateMeshesInBackground();
+  void UpdateMeshesInBackground(bool preview);
 
   void UpdateActionButtons();
 
@@ -38,6 +38,9 @@
 #include "ImageIOWizard/OverlayRolePage.h"
 
 #include "DICOMListingTable.h"
+#include "LatentITKEventNotifier.h"
+#include "GlobalUIModel.h"
+#include "BackgroundTask.h"
 
 
 namespace imageiowiz {
@@ -424,6 +427,18 @@ DICOMPage::DICOMPage(QWidget *parent)
   connect(m_Table->selectionModel(),
           SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
           SIGNAL(completeChanged()));
+
+  // Timer that updates the table while the directory is being scanned
+  m_ScanTimer = new QTimer(this);
+  m_ScanTimer->setInterval(100);
+  connect(m_ScanTimer, SIGNAL(timeout()), this, SLOT(updateTable()));
+}
+
+DICOMPage::~DICOMPage()
+{
+  // Don't keep scanning if the wizard is closed
+  if(m_ScanTask)
+    m_ScanTask->RequestCancel();
 }
 
 void DICOMPage::initializePage()
@@ -437,50 +452,64 @@ void DICOMPage::initializePage()
 
 void DICOMPage::cleanupPage()
 {
+  // Stop the scan if the user goes back. The scan stops after the current file
+  if(m_ScanTask)
+    {
+    m_ScanTask->RequestCancel();
+    m_ScanTask->WaitUntilFinished();
+    m_ScanTask = NULL;
+    m_ScanTimer->stop();
+    this->setEnabled(true);
+    }
+
   AbstractPage::cleanupPage();
 }
 
-#include "ProcessEventsITKCommand.h"
-
 void DICOMPage::processDicomDirectory()
 {
-  // Change cursor until this object moves out of scope
-  QtCursorOverride curse(Qt::WaitCursor); (void) curse;
-
   // Disable the buttons until we finish loading
   this->setEnabled(false);
+  m_OutMessage->clear();
 
-  try
-    {
-    // Callback that will handle progress of DICOM loading
-    SmartPtr<ProcessEventsITKCommand> cmd = ProcessEventsITKCommand::New();
-
-    // Timer that will call a slot at regular intervals to update the table
-    QTimer timer;
-    connect(&timer, SIGNAL(timeout()), this, SLOT(updateTable()));
-    timer.start(100);
+  // Scan the directory in the background. The table is updated from the
+  // timer with the series found so far.
+  GlobalUIModel *gui = m_Model->GetParent();
+  m_ScanTask = m_Model->CreateDicomDirectoryScanTask(to_utf8(field("Filename").toString()));
+  LatentITKEventNotifier::connect(m_ScanTask, BackgroundTask::TaskFinishedEvent(),
+                                  this, SLOT(onDicomScanFinished(const EventBucket &)));
+  gui->GetTaskManager()->Submit(m_ScanTask);
+  m_ScanTimer->start();
+}
 
-    // Get the DICOM directory contents. The command and the timer make sure
-    // that the table of DICOM entries is updated every 100 ms
-    m_Model->ProcessDicomDirectory(to_utf8(field("Filename").toString()), cmd);
+void DICOMPage::onDicomScanFinished(const EventBucket &)
+{
+  // Ignore scans that have been abandoned in cleanupPage()
+  if(!m_ScanTask || !m_ScanTask->IsFinished())
+    return;
 
-    // Stop the timer
-    timer.stop();
+  SmartPtr<DicomDirectoryScanTask> task = m_ScanTask;
+  m_ScanTask = NULL;
+  m_ScanTimer->stop();
 
-    // Update the data
+  // Update the data
+  if(task->GetState() == BackgroundTask::TASK_COMPLETED)
     this->updateTable();
-    }
-  catch(IRISException &exc)
-    {
-    ErrorMessage(exc);
-    }
+  else if(task->GetState() == BackgroundTask::TASK_FAILED)
+    ErrorMessage(IRISException("%s", task->GetErrorMessage().c_str()));
 
-  // Enable the buttons until we finish loading
+  // Enable the buttons now that we finished loading
   this->setEnabled(true);
 }
 
 void DICOMPage::updateTable()
 {
+  // While scanning, use the listing collected by the task
+  if(m_ScanTask)
+    {
+    m_Table->setData(m_ScanTask->GetSeriesMetaData());
+    return;
+    }
+
   // Get the list of existing series
   // TODO: this is a cluge!
   std::list<std::string> series_ids = m_Model->GetFoundDicomSeriesIds();
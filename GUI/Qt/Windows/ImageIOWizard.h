@@ -20,10 +20,12 @@ class QTreeWidgetItem;
 class QTableWidget;
 class QSpinBox;
 class QDoubleSpinBox;
+class QTimer;
 class FileChooserPanelWithHistory;
 class OptimizationProgressRenderer;
 class QtVTKRenderWindowBox;
 class DICOMListingTable;
+class EventBucket;
 
 // Helper classes in their own namespace, so I can use simple class names
 namespace imageiowiz
@@ -125,6 +127,7 @@ class DICOMPage : public AbstractPage
 public:
 
   explicit DICOMPage(QWidget *parent = 0);
+  virtual ~DICOMPage();
   void initializePage();
   bool validatePage();
 
@@ -135,10 +138,15 @@ public slots:
 
   void processDicomDirectory();
   void updateTable();
+  void onDicomScanFinished(const EventBucket &bucket);
 
 private:
 
   DICOMListingTable *m_Table;
+
+  // The scan runs in the background, and the table is refreshed on a timer
+  SmartPtr<DicomDirectoryScanTask> m_ScanTask;
+  QTimer *m_ScanTimer;
 };
 
 class RawPage : public AbstractPage
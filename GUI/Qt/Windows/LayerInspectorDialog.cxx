@@ -133,22 +133,27 @@ void LayerInspectorDialog::SetPageToImageInfo()
   ui->tabWidget->setCurrentWidget(ui->cmpInfo);
 }
 
-QMenu *LayerInspectorDialog::GetLayerContextMenu(ImageWrapperBase *layer)
+LayerInspectorRowDelegate *LayerInspectorDialog::GetLayerDelegate(ImageWrapperBase *layer)
 {
-  foreach(LayerInspectorRowDelegate *del, m_Delegates)
-    if(del->GetLayer() == layer)
-      return del->contextMenu();
+  if(!layer)
+    return NULL;
 
-  return NULL;
+  // The row must still refer to this layer, since the layer may have been
+  // deleted and its id is only checked here
+  LayerInspectorRowDelegate *del = m_DelegateMap.value(layer->GetUniqueId(), NULL);
+  return (del && del->GetLayer() == layer) ? del : NULL;
 }
 
-QAction *LayerInspectorDialog::GetLayerSaveAction(ImageWrapperBase *layer)
+QMenu *LayerInspectorDialog::GetLayerContextMenu(ImageWrapperBase *layer)
 {
-  foreach(LayerInspectorRowDelegate *del, m_Delegates)
-    if(del->GetLayer() == layer)
-      return del->saveAction();
+  LayerInspectorRowDelegate *del = this->GetLayerDelegate(layer);
+  return del ? del->contextMenu() : NULL;
+}
 
-  return NULL;
+QAction *LayerInspectorDialog::GetLayerSaveAction(ImageWrapperBase *layer)
+{
+  LayerInspectorRowDelegate *del = this->GetLayerDelegate(layer);
+  return del ? del->saveAction() : NULL;
 }
 
 bool LayerInspectorDialog::eventFilter(QObject *source, QEvent *event)
@@ -203,79 +208,110 @@ void LayerInspectorDialog::BuildLayerWidgetHierarchy()
     mapRoleNames[LABEL_ROLE] = "Segmentation Layers";
     }
 
+  // List the layers and their roles in display order
+  QList<ImageWrapperBase *> layers;
+  QList<QPair<int, unsigned long> > signature;
+  LayerIterator it = m_Model->GetDriver()->GetCurrentImageData()->GetLayers(
+        MAIN_ROLE | OVERLAY_ROLE | SNAP_ROLE | LABEL_ROLE);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    layers.push_back(it.GetLayer());
+    signature.push_back(qMakePair((int) it.GetRole(), it.GetLayer()->GetUniqueId()));
+    }
+
+  // LayerChangeEvent is fired for many reasons other than adding, removing
+  // and reordering layers. If the list is the same, the rows are left alone.
+  if(signature == m_LayerSignature)
+    return;
+  m_LayerSignature = signature;
+
   // Get the top-level layout in the pane
   QBoxLayout *lo = (QBoxLayout *) ui->saLayersContents->layout();
 
-  // Before deleting all of the existing widgets in the pane,
-  // find the one that is currently selected, and remember its
-  // layer, so we can re-select it if needed
-  bool found_selected_layer = false;
-
   // Get the ID of the currently selected layer
   unsigned long selected_layer = m_Model->GetGlobalState()->GetSelectedLayerId();
+  bool found_selected_layer = false;
 
-  // Get rid of all existing widgets in the pane
+  // Take the rows out of their group boxes. Rows whose layers are gone are
+  // deleted, the rest are reused, so only new layers get new rows.
+  QMap<unsigned long, LayerInspectorRowDelegate *> oldDelegates = m_DelegateMap;
   m_Delegates.clear();
-  QLayoutItem * item;
-  while ( (item = lo->takeAt( 0 ) ) != NULL )
+  m_DelegateMap.clear();
+  for(QMap<unsigned long, LayerInspectorRowDelegate *>::iterator itd = oldDelegates.begin();
+      itd != oldDelegates.end(); ++itd)
     {
-    if(item->widget())
-      {
-      delete item->widget();
-      }
-    delete item;
+    itd.value()->setParent(NULL);
     }
 
-  // Iterate over the layers for each class of displayed layers
-  LayerIterator it = m_Model->GetDriver()->GetCurrentImageData()->GetLayers(
-        MAIN_ROLE | OVERLAY_ROLE | SNAP_ROLE | LABEL_ROLE);
+  // Take the group boxes out of the layout, keeping them for reuse
+  QLayoutItem * item;
+  while ( (item = lo->takeAt( 0 ) ) != NULL )
+    delete item;
 
   // The current role and associated group box
   LayerRole currentRole = NO_ROLE;
   CollapsableGroupBox *currentGroupBox = NULL;
+  QMap<int, CollapsableGroupBox *> usedGroupBoxes;
 
   // The row widget for the main image layer (default selection)
   LayerInspectorRowDelegate *w_main = NULL;
 
   // Loop over all the layers
-  for(; !it.IsAtEnd(); ++it)
+  for(int i = 0; i < layers.size(); i++)
     {
-    LayerRole role = it.GetRole();
+    ImageWrapperBase *layer = layers[i];
+    LayerRole role = (LayerRole) signature[i].first;
+    unsigned long id = signature[i].second;
+
     if(role != currentRole)
       {
-      // Create the new groupbox
-      currentGroupBox = new CollapsableGroupBox();
+      // Reuse the group box for this role, which preserves its collapsed state
+      currentGroupBox = m_GroupBoxes.value(role, NULL);
+      if(!currentGroupBox)
+        {
+        currentGroupBox = new CollapsableGroupBox();
+        currentGroupBox->setTitle(mapRoleNames[role]);
+        }
+      usedGroupBoxes[role] = currentGroupBox;
       currentRole = role;
       lo->addWidget(currentGroupBox);
-      currentGroupBox->setTitle(mapRoleNames[currentRole]);
       }
 
-    // Create the custom widget for this layer
-    LayerInspectorRowDelegate *w = new LayerInspectorRowDelegate(this);
+    // Reuse the row for this layer or create a new one
+    LayerInspectorRowDelegate *w = oldDelegates.value(id, NULL);
+    if(w)
+      {
+      oldDelegates.remove(id);
+      }
+    else
+      {
+      // Create the custom widget for this layer
+      w = new LayerInspectorRowDelegate(this);
+
+      // Find the model for this layer
+      SmartPtr<LayerTableRowModel> model =
+          dynamic_cast<LayerTableRowModel *>(
+            layer->GetUserData("LayerTableRowModel"));
+
+      // Set the model
+      w->SetModel(model);
+
+      // Listen to select signals from widget
+      connect(w, SIGNAL(selectionChanged(bool)), this, SLOT(layerSelected(bool)));
+      connect(w, SIGNAL(contrastInspectorRequested()), this, SLOT(onContrastInspectorRequested()));
+      connect(w, SIGNAL(colorMapInspectorRequested()), this, SLOT(onColorMapInspectorRequested()));
+      }
 
     // Is this the main layer? Then remember the widget
     if(role == MAIN_ROLE)
       w_main = w;
 
-    // Find the model for this layer
-    SmartPtr<LayerTableRowModel> model =
-        dynamic_cast<LayerTableRowModel *>(
-          it.GetLayer()->GetUserData("LayerTableRowModel"));
-
-    // Set the model
-    w->SetModel(model);
-
     // Set a name for this widget for debugging purposes
     w->setObjectName(QString().sprintf("wgtRowDelegate_%04d", m_Delegates.size()));
 
-    // Listen to select signals from widget
-    connect(w, SIGNAL(selectionChanged(bool)), this, SLOT(layerSelected(bool)));
-    connect(w, SIGNAL(contrastInspectorRequested()), this, SLOT(onContrastInspectorRequested()));
-    connect(w, SIGNAL(colorMapInspectorRequested()), this, SLOT(onColorMapInspectorRequested()));
-
     // Select the layer if it was previously selected or nothing was previously
     // selected and the layer is the main layer
-    if(it.GetLayer()->GetUniqueId() == selected_layer)
+    if(id == selected_layer)
       {
       w->setSelected(true);
       found_selected_layer = true;
@@ -286,8 +322,20 @@ void LayerInspectorDialog::BuildLayerWidgetHierarchy()
       }
 
     currentGroupBox->addWidget(w);
+    w->show();
     m_Delegates.push_back(w);
+    m_DelegateMap[id] = w;
+    }
+
+  // Delete the rows of the layers that are gone, and unused group boxes
+  qDeleteAll(oldDelegates);
+  for(QMap<int, CollapsableGroupBox *>::iterator itg = m_GroupBoxes.begin();
+      itg != m_GroupBoxes.end(); ++itg)
+    {
+    if(!usedGroupBoxes.contains(itg.key()))
+      delete itg.value();
     }
+  m_GroupBoxes = usedGroupBoxes;
 
   // If we haven't selected anything, select the main layer's widget - this should not happen
   if(!found_selected_layer && w_main)
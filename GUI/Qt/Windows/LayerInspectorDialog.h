@@ -3,6 +3,8 @@
 
 #include <QDialog>
 #include <QAbstractListModel>
+#include <QMap>
+#include <QPair>
 
 class IntensityCurveBox;
 class ContrastInspector;
@@ -14,6 +16,7 @@ class QToolButton;
 class QMenu;
 class QAction;
 class QEvent;
+class CollapsableGroupBox;
 
 namespace Ui {
     class LayerInspectorDialog;
@@ -87,12 +90,20 @@ private:
   void BuildLayerWidgetHierarchy();
   void SetActiveLayer(ImageWrapperBase *layer);
   void UpdateLayerLayoutAction();
+  LayerInspectorRowDelegate *GetLayerDelegate(ImageWrapperBase *layer);
 
   // Tool bar buttons that use actions from the selected layer widgets
   QToolButton *m_SaveSelectedButton;
 
   // List of layer delegate widgets
   QList<LayerInspectorRowDelegate *> m_Delegates;
+
+  // Delegates and role group boxes, looked up by layer id and role
+  QMap<unsigned long, LayerInspectorRowDelegate *> m_DelegateMap;
+  QMap<int, CollapsableGroupBox *> m_GroupBoxes;
+
+  // Roles and ids of the layers for which the rows were last built
+  QList<QPair<int, unsigned long> > m_LayerSignature;
 };
 
 #endif // LAYERINSPECTORDIALOG_H
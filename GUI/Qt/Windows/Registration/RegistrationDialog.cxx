@@ -2,12 +2,14 @@
 #include "ui_RegistrationDialog.h"
 
 #include <QMenu>
+#include <QTimer>
 #include <QVBoxLayout>
 #include "QtComboBoxCoupling.h"
 #include "QtCheckBoxCoupling.h"
 #include "QtLineEditCoupling.h"
 #include "QtDoubleSpinBoxCoupling.h"
 #include "QtSliderCoupling.h"
+#include "QtLabelCoupling.h"
 #include "QtAbstractButtonCoupling.h"
 #include "QtWidgetArrayCoupling.h"
 #include "RegistrationModel.h"
@@ -34,6 +36,11 @@ RegistrationDialog::RegistrationDialog(QWidget *parent) :
   menuMatch->addAction(ui->actionCenters_of_Mass);
   menuMatch->addAction(ui->actionMoments_of_Inertia);
   ui->btnMatchCenters->setMenu(menuMatch);
+
+  // The live metric is computed in the background and picked up by the timer
+  m_LiveMetricTimer = new QTimer(this);
+  m_LiveMetricTimer->setInterval(100);
+  connect(m_LiveMetricTimer, SIGNAL(timeout()), SLOT(onLiveMetricTimer()));
 }
 
 RegistrationDialog::~RegistrationDialog()
@@ -78,6 +85,10 @@ void RegistrationDialog::SetModel(RegistrationModel *model)
   makeCoupling(ui->inSimilarityMetric, m_Model->GetSimilarityMetricModel());
   makeCoupling(ui->inUseMask, m_Model->GetUseSegmentationAsMaskModel());
 
+  makeCoupling(ui->outLiveNCC, m_Model->GetLiveNCCModel());
+  makeCoupling(ui->outLiveNMI, m_Model->GetLiveNMIModel());
+  makeCoupling(ui->outLiveSSD, m_Model->GetLiveSSDModel());
+
   makeCoupling(ui->inCoarseLevel, m_Model->GetCoarsestResolutionLevelModel());
   makeCoupling(ui->inFineLevel, m_Model->GetFinestResolutionLevelModel());
 
@@ -91,6 +102,8 @@ void RegistrationDialog::SetModel(RegistrationModel *model)
   ProcessEventsITKCommand::Pointer cmdProcEvents = ProcessEventsITKCommand::New();
   m_Model->SetIterationCommand(cmdProcEvents);
 
+  m_LiveMetricTimer->start();
+
 }
 
 void RegistrationDialog::on_pushButton_clicked()
@@ -157,6 +170,8 @@ int RegistrationDialog::GetTransformFormat(QString &format)
     return RegistrationModel::FORMAT_ITK;
   else if(format == "Convert3D Transform Files")
     return RegistrationModel::FORMAT_C3D;
+  else if(format == "Displacement Field Images")
+    return RegistrationModel::FORMAT_WARP;
   else
     return RegistrationModel::FORMAT_ITK;
 }
@@ -169,7 +184,8 @@ void RegistrationDialog::on_btnLoad_clicked()
         this, m_Model->GetParent(),
         "Open Transform - ITK-SNAP", "Transform File",
         "AffineTransform",
-        "ITK Transform Files (*.txt);; Convert3D Transform Files (*.mat)");
+        "ITK Transform Files (*.txt);; Convert3D Transform Files (*.mat);; "
+        "Displacement Field Images (*.nii.gz *.nii *.mha *.nrrd)");
 
   RegistrationModel::TransformFormat format =
       (RegistrationModel::TransformFormat) this->GetTransformFormat(result.activeFormat);
@@ -310,3 +326,10 @@ void RegistrationDialog::on_actionMoments_of_Inertia_triggered()
   QtCursorOverride cursor(Qt::WaitCursor);
   m_Model->MatchByMoments(2);
 }
+
+void RegistrationDialog::onLiveMetricTimer()
+{
+  // Only compute the metric while the manual page is in view
+  if(m_Model && this->isVisible() && ui->tabWidget->currentWidget() == ui->pgManual)
+    m_Model->UpdateLiveMetric();
+}
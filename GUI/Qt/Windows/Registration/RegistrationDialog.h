@@ -7,6 +7,7 @@
 class RegistrationModel;
 class QAbstractButton;
 class OptimizationProgressRenderer;
+class QTimer;
 
 namespace Ui {
 class RegistrationDialog;
@@ -49,11 +50,16 @@ private slots:
 
   void on_actionMoments_of_Inertia_triggered();
 
+  void onLiveMetricTimer();
+
 private:
   Ui::RegistrationDialog *ui;
 
   RegistrationModel *m_Model;
 
+  // Timer used to poll for the live similarity metric
+  QTimer *m_LiveMetricTimer;
+
   int GetTransformFormat(QString &format);
 
   // This is a bit unfortunate but we need to keep a list of renderers for the
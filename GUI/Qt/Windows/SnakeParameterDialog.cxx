@@ -70,6 +70,7 @@ void SnakeParameterDialog::SetModel(SnakeParameterModel *model)
 
   makeCoupling(ui->inSpeedup, m_Model->GetSpeedupFactorModel());
   makeCoupling(ui->inSpeedupSlider, m_Model->GetSpeedupFactorModel());
+  makeCoupling(ui->chkPreserveTopology, m_Model->GetPreserveTopologyModel());
 
   // Couple the advanced checkbox
   makeCoupling(ui->chkAdvanced, m_Model->GetAdvancedEquationModeModel());
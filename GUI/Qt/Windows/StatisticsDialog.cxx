@@ -3,6 +3,7 @@
 
 #include "GlobalUIModel.h"
 #include "IRISApplication.h"
+#include "GenericImageData.h"
 #include "SegmentationStatistics.h"
 #include "HistoryManager.h"
 #include <QStandardItemModel>
@@ -47,8 +48,9 @@ void StatisticsDialog::Activate()
 
 void StatisticsDialog::FillTable()
 {
-  // Compute the segmentation statistics
-  m_Stats->Compute(m_Model->GetDriver());
+  // Update the segmentation statistics, visiting only the voxels edited
+  // since the last time the table was filled
+  m_Stats->Update(m_Model->GetDriver());
 
   // Fill out the item model
   m_ItemModel->clear();
@@ -99,6 +101,10 @@ void StatisticsDialog::FillTable()
       }
     }
 
+  // Comparison needs at least two segmentation layers
+  ui->btnCompare->setEnabled(
+        m_Model->GetDriver()->GetCurrentImageData()->GetNumberOfLayers(LABEL_ROLE) > 1);
+
   // Perform a smart resize of the column widts
   ui->tvVolumes->resizeColumnsToContents();
   for(int col = 0; col < ui->tvVolumes->horizontalHeader()->count(); col++)
@@ -161,3 +167,30 @@ void StatisticsDialog::on_btnExport_clicked()
       }
     }
 }
+
+void StatisticsDialog::on_btnCompare_clicked()
+{
+  // Ask for a filename
+  QString selection = ShowSimpleSaveDialogWithHistory(
+        this, m_Model, "Statistics",
+        "Export Segmentation Comparison - ITK-SNAP",
+        "Segmentation Comparison File",
+        "Text Files (*.txt);; Comma Separated Value Files (*.csv)",
+        true);
+
+  if(selection.length())
+    {
+    try
+      {
+      QtCursorOverride cursy(Qt::WaitCursor);
+      m_Model->GetDriver()->ExportSegmentationComparison(selection.toUtf8());
+      m_Model->GetSystemInterface()->GetHistoryManager()->
+          UpdateHistory("Statistics", to_utf8(selection), true);
+      }
+    catch(std::exception &exc)
+      {
+      ReportNonLethalException(this, exc, "Segmentation Comparison IO Error",
+                               QString("Failed to export the segmentation comparison"));
+      }
+    }
+}
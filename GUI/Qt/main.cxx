@@ -23,6 +23,8 @@
 #include "SnakeWizardPanel.h"
 #include "QtRendererPlatformSupport.h"
 #include "QtIPCManager.h"
+#include "QtBackgroundTaskPump.h"
+#include "BackgroundTask.h"
 #include "QtCursorOverride.h"
 #include "SNAPQtCommon.h"
 #include "SNAPTestQt.h"
@@ -886,6 +888,11 @@ int main(int argc, char *argv[])
     ipcman->hide();
     ipcman->SetModel(gui->GetSynchronizationModel());
 
+    // Deliver the events from background tasks (as a hidden widget)
+    QtBackgroundTaskPump *taskpump = new QtBackgroundTaskPump(mainwin);
+    taskpump->hide();
+    taskpump->SetModel(gui->GetTaskManager());
+
     // Start in cross-hairs mode
     gui->GetGlobalState()->SetToolbarMode(CROSSHAIRS_MODE);
 
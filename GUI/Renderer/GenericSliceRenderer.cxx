@@ -31,6 +31,7 @@
 #include "SNAPAppearanceSettings.h"
 #include "GenericImageData.h"
 #include "ImageWrapper.h"
+#include "LabelImageWrapper.h"
 #include "IRISApplication.h"
 #include "IntensityCurveModel.h"
 #include "DisplayLayoutModel.h"
@@ -469,10 +470,83 @@ GenericSliceRenderer
   // in image space or in display space
   tex->SetMipMapping(layer->IsSlicingOrthogonal());
 
+  // Segmentations are edited a few voxels at a time
+  LabelImageWrapper *seg = dynamic_cast<LabelImageWrapper *>(layer);
+  if(seg)
+    this->UpdateModifiedRegionFromChangeLog(seg, tex);
+
   return tex;
 }
 
-#include <itkImageLinearConstIteratorWithIndex.h>
+// The latest modification time of the filters and of the source data upstream
+// of a data object, leaving out the data object 'excluded'
+static itk::ModifiedTimeType
+GetUpstreamMTimeExcluding(itk::DataObject *data, const itk::DataObject *excluded)
+{
+  if(data == excluded)
+    return 0;
+
+  itk::ProcessObject *source = data->GetSource();
+  if(!source)
+    return data->GetMTime();
+
+  itk::ModifiedTimeType mtime = source->GetMTime();
+  itk::ProcessObject::DataObjectPointerArray inputs = source->GetInputs();
+  for(unsigned int i = 0; i < inputs.size(); i++)
+    if(inputs[i])
+      mtime = std::max(mtime, GetUpstreamMTimeExcluding(inputs[i], excluded));
+
+  return mtime;
+}
+
+void
+GenericSliceRenderer
+::UpdateModifiedRegionFromChangeLog(LabelImageWrapper *seg, Texture *tex)
+{
+  // The edits made since the texture was last updated
+  unsigned long &pos = m_ChangeLogPosition[seg->GetUniqueId()];
+  std::vector<const LabelImageWrapper::LabelChange *> changes;
+  bool logged = seg->GetChangesSince(pos, changes);
+  pos = seg->GetChangeLogEnd();
+
+  // The edits only tell the whole story if nothing else in the display
+  // pipeline (slice position, color table, etc.) has changed since the update
+  Texture::ImageType *slice = const_cast<Texture::ImageType *>(tex->GetImage());
+  if(!logged || tex->GetUpdateTime() == 0
+     || GetUpstreamMTimeExcluding(slice, seg->GetImage()) > tex->GetUpdateTime())
+    {
+    tex->ClearModifiedRegion();
+    return;
+    }
+
+  // Map the region of each edit into the slice
+  for(unsigned int i = 0; i < changes.size(); i++)
+    tex->AddModifiedRegion(
+          seg->GetDisplaySliceRegionForImageRegion(m_Model->GetId(), changes[i]->Region));
+}
+
+GenericSliceRenderer::GridBuilderType *
+GenericSliceRenderer
+::GetDeformationGridForLayer(ImageWrapperBase *layer)
+{
+  const char *user_data_ids[] = {
+    "DeformationGrid[0]",
+    "DeformationGrid[1]",
+    "DeformationGrid[2]"
+  };
+  const char *user_data_id = user_data_ids[m_Model->GetId()];
+
+  // The grid is kept with the layer, like the texture
+  SmartPtr<GridBuilderType> grid =
+      static_cast<GridBuilderType *>(layer->GetUserData(user_data_id));
+  if(!grid)
+    {
+    grid = GridBuilderType::New();
+    layer->SetUserData(user_data_id, grid.GetPointer());
+    }
+
+  return grid;
+}
 
 Vector3d GenericSliceRenderer::ComputeGridPosition(
     const Vector3d &disp_pix,
@@ -625,21 +699,21 @@ void GenericSliceRenderer::DrawTextureForLayer(
 
       // The mapping between (index, phi[index]) and on-screen coordinate for a grid
       // point is linear (combines a bunch of transforms). To save time, we can
-      // compute this mapping once at the beginning of the loop. We also know that the
-      // index will only be going up by one at each iteration
+      // compute this mapping once and let the grid builder apply it
       itk::Index<2> ind;
-      Vector3d phi, G0, d_grid_d_phi[3], d_grid_d_ind[2];
+      Vector3d phi;
+      GridBuilderType::Mapping mapping;
 
       // Compute the initial displacement G0
       ind.Fill(0); phi.fill(0.0f);
-      G0 = ComputeGridPosition(phi, ind, vecimg);
+      mapping.Origin = ComputeGridPosition(phi, ind, vecimg);
 
       // Compute derivative of grid displacement wrt warp components
       for(int a = 0; a < 3; a++)
         {
         ind.Fill(0); phi.fill(0.0f);
         phi[a] = 1.0f;
-        d_grid_d_phi[a] = ComputeGridPosition(phi, ind, vecimg) - G0;
+        mapping.DPhi[a] = ComputeGridPosition(phi, ind, vecimg) - mapping.Origin;
         }
 
       // Compute derivative of grid displacement wrt index components
@@ -647,73 +721,51 @@ void GenericSliceRenderer::DrawTextureForLayer(
         {
         ind.Fill(0); phi.fill(0.0f);
         ind[b] = 1;
-        d_grid_d_ind[b] = ComputeGridPosition(phi, ind, vecimg) - G0;
+        mapping.DIndex[b] = ComputeGridPosition(phi, ind, vecimg) - mapping.Origin;
         }
 
-      // Iterate line direction
+      // Figure out how frequently to sample lines and the vertices along them.
+      // Lines should be about 8 screen pixels apart, and vertices no closer
+      // than 2 screen pixels.
+      Vector2i lineSpacing, vertexSpacing;
       for(int d = 0; d < 2; d++)
         {
-
-        // The current matrix is such that we should be drawing in pixel coordinates.
-        typedef itk::ImageLinearConstIteratorWithIndex<AnatomicImageWrapper::SliceType> IterType;
-        IterType it1(slice, slice->GetBufferedRegion());
-        it1.SetDirection(d);
-        it1.GoToBegin();
-
-        int vox_increment;
         if(vecimg->IsSlicingOrthogonal())
           {
-          // Figure out how frequently to sample lines. The spacing on the screen should be at
-          // most every 4 pixels. Zoom is in units of px/mm. Spacing is in units of mm/vox, so
-          // zoom * spacing is (display pixels) / (image voxels).
-          double disp_pix_per_vox = m_Model->GetSliceSpacing()[d] * m_Model->GetViewZoom();
-          vox_increment = (int) ceil(8.0 / disp_pix_per_vox);
+          // Zoom is in units of px/mm. Spacing is in units of mm/vox, so
+          // zoom * spacing is (display pixels) / (image voxels). The lines along
+          // d are spaced along the other axis.
+          double pix_between_lines = m_Model->GetSliceSpacing()[1-d] * m_Model->GetViewZoom();
+          double pix_along_line = m_Model->GetSliceSpacing()[d] * m_Model->GetViewZoom();
+          lineSpacing[d] = (int) ceil(8.0 / pix_between_lines);
+          vertexSpacing[d] = std::max(1, (int) floor(2.0 / pix_along_line));
           }
         else
           {
-          // The slice is in screen pixel units already - so just 8!
-          vox_increment = 8;
-          }
-
-        while( !it1.IsAtEnd() )
-          {
-          // Do we draw this line?
-          if(it1.GetIndex()[1-d] % vox_increment == 0)
-            {
-            elt->ApplyColor();
-            glBegin(GL_LINE_STRIP);
-
-            // Set up the current position and increment
-            Vector3d G1 = G0 +
-                (d_grid_d_ind[0] * (double) (it1.GetIndex()[0])) +
-                (d_grid_d_ind[1] * (double) (it1.GetIndex()[1]));
-
-            while( !it1.IsAtEndOfLine() )
-              {
-              // Read the pixel
-              AnatomicImageWrapper::SliceType::PixelType pix = it1.Get();
-
-              // Alternative version
-              Vector3d xDispSlice = G1 +
-                  (d_grid_d_phi[0] * (double) (pix[0])) +
-                  (d_grid_d_phi[1] * (double) (pix[1])) +
-                  (d_grid_d_phi[2] * (double) (pix[2]));
-
-              glVertex2d(xDispSlice[0], xDispSlice[1]);
-
-              // Add the displacement
-              ++it1;
-
-              // Update the current position
-              G1 += d_grid_d_ind[d];
-              }
-
-            glEnd();
-            }
-
-          it1.NextLine();
+          // The slice is in screen pixel units already
+          lineSpacing[d] = 8;
+          vertexSpacing[d] = 2;
           }
+        }
 
+      // Get the grid geometry, which is only built again if the slice, the
+      // mapping or the sampling have changed
+      GridBuilderType *grid = this->GetDeformationGridForLayer(vecimg);
+      grid->SetSlice(slice);
+      grid->SetMapping(mapping);
+      grid->SetSampling(lineSpacing, vertexSpacing);
+      grid->Update();
+
+      const std::vector<float> &vertices = grid->GetVertices();
+      const std::vector<unsigned int> &starts = grid->GetLineStarts();
+      if(grid->GetNumberOfLines() > 0 && vertices.size() > 0)
+        {
+        elt->ApplyColor();
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(2, GL_FLOAT, 0, &vertices[0]);
+        for(unsigned int i = 0; i < grid->GetNumberOfLines(); i++)
+          glDrawArrays(GL_LINE_STRIP, starts[i], starts[i+1] - starts[i]);
+        glDisableClientState(GL_VERTEX_ARRAY);
         }
 
       glPopAttrib();
@@ -30,12 +30,16 @@
 #include <AbstractRenderer.h>
 #include <GenericSliceModel.h>
 #include <ImageWrapper.h>
+#include <ImageWrapperTraits.h>
+#include <DeformationGridBuilder.h>
 #include <OpenGLSliceTexture.h>
 #include <SNAPOpenGL.h>
 #include <list>
+#include <map>
 #include <LayerAssociation.h>
 
 class GenericSliceRenderer;
+class LabelImageWrapper;
 
 class SliceRendererDelegate : public AbstractRenderer
 {
@@ -55,6 +59,9 @@ public:
   // texture type
   typedef OpenGLSliceTexture<ImageWrapperBase::DisplayPixelType> Texture;
 
+  // geometry of the deformation grid drawn over warp fields
+  typedef DeformationGridBuilder<AnatomicImageWrapper::SliceType> GridBuilderType;
+
 
   irisITKObjectMacro(GenericSliceRenderer, AbstractModel)
 
@@ -106,6 +113,9 @@ public:
   // Get (creating if necessary) and configure the texture for a given layer
   Texture *GetTextureForLayer(ImageWrapperBase *iw);
 
+  // Get (creating if necessary) the deformation grid for a given layer
+  GridBuilderType *GetDeformationGridForLayer(ImageWrapperBase *iw);
+
   // Set list of child renderers
   void SetChildRenderers(std::list<AbstractRenderer *> renderers);
 
@@ -135,8 +145,17 @@ protected:
 
   bool IsTiledMode() const;
 
+  // Tell the texture of a segmentation layer which part of the slice has been
+  // edited since the texture was last updated, using the segmentation's log of
+  // changes, so that only the tiles that show the edits are uploaded again
+  void UpdateModifiedRegionFromChangeLog(LabelImageWrapper *seg, Texture *tex);
+
   GenericSliceModel *m_Model;
 
+  // Position in the change log of each segmentation layer (by unique id) up
+  // to which the edits have been passed on to the texture
+  std::map<unsigned long, unsigned long> m_ChangeLogPosition;
+
   // Whether rendering to thumbnail or not
   bool m_DrawingZoomThumbnail, m_DrawingLayerThumbnail;
 
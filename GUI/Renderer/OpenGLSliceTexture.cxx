@@ -34,18 +34,25 @@
 =========================================================================*/
 #include "OpenGLSliceTexture.h"
 #include "ImageWrapper.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 
 template<class TPixel>
 OpenGLSliceTexture<TPixel>
 ::OpenGLSliceTexture()
 {
-  // Set to -1 to force a call to 'generate'
-  m_IsTextureInitalized = false;
-
   // Set the update time to -1
   m_UpdateTime = 0;
 
+  // Tiles are created on first update
+  m_TileSize = 512;
+  m_TileGridImageSize.Fill(0);
+  m_NumberOfTileUploads = 0;
+  m_IsModifiedRegionKnown = false;
+  m_MipMapping = false;
+
   // Init the GL settings to uchar, luminance defautls, which are harmless
   m_GlComponents = 1;
   m_GlFormat = GL_LUMINANCE;
@@ -67,8 +74,7 @@ template<class TPixel>
 OpenGLSliceTexture<TPixel>
 ::~OpenGLSliceTexture()
 {
-  if(m_IsTextureInitalized)
-    glDeleteTextures(1,&m_TextureIndex);
+  this->ReleaseTiles();
 }
 
 template<class TPixel>
@@ -76,20 +82,97 @@ void
 OpenGLSliceTexture<TPixel>
 ::SetInterpolation(GLenum interp)
 {
+  // The mode is applied to each tile as it is bound, no need to reload
   assert(interp == GL_LINEAR || interp == GL_NEAREST);
-  if(interp != m_InterpolationMode)
+  m_InterpolationMode = interp;
+}
+
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::SetTileSize(unsigned int size)
+{
+  assert(size >= 4 && (size & (size - 1)) == 0);
+  if(size != m_TileSize)
     {
-    m_InterpolationMode = interp;
-    m_UpdateTime = 0; // make it out-of-date
+    m_TileSize = size;
+    this->ReleaseTiles();
     }
 }
 
-#include "itkImageFileWriter.h"
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::ReleaseTiles()
+{
+  for(unsigned int i = 0; i < m_Tiles.size(); i++)
+    if(m_Tiles[i].IsTextureInitialized)
+      glDeleteTextures(1, &m_Tiles[i].TextureIndex);
+  m_Tiles.clear();
+}
 
 template<class TPixel>
 void
 OpenGLSliceTexture<TPixel>
-::Update()
+::BuildTiles()
+{
+  this->ReleaseTiles();
+
+  itk::Size<2> szImage = m_Image->GetBufferedRegion().GetSize();
+
+  // Split each dimension into ranges. An image that fits into a single tile
+  // is stored whole, otherwise the core of each tile is two pixels smaller
+  // than the tile so that the shared border fits into the texture
+  std::vector<int> core_start[2], core_size[2];
+  for(unsigned int d = 0; d < 2; d++)
+    {
+    int n = (int) szImage[d];
+    int stride = (n <= (int) m_TileSize) ? std::max(n, 1) : (int) m_TileSize - 2;
+    for(int x = 0; x == 0 || x < n; x += stride)
+      {
+      core_start[d].push_back(x);
+      core_size[d].push_back(std::min(stride, n - x));
+      }
+    }
+
+  for(unsigned int iy = 0; iy < core_start[1].size(); iy++)
+    {
+    for(unsigned int ix = 0; ix < core_start[0].size(); ix++)
+      {
+      Tile tile;
+      tile.TextureIndex = 0;
+      tile.IsTextureInitialized = false;
+      tile.IsStale = true;
+      tile.InterpolationMode = m_InterpolationMode;
+      tile.CoreIndex[0] = core_start[0][ix];
+      tile.CoreIndex[1] = core_start[1][iy];
+      tile.CoreSize[0] = core_size[0][ix];
+      tile.CoreSize[1] = core_size[1][iy];
+
+      for(unsigned int d = 0; d < 2; d++)
+        {
+        int x0 = std::max(0, tile.CoreIndex[d] - 1);
+        int x1 = std::min((int) szImage[d], tile.CoreIndex[d] + tile.CoreSize[d] + 1);
+        tile.DataIndex[d] = x0;
+        tile.DataSize[d] = x1 - x0;
+
+        // Promote the tile dimensions to powers of 2
+        tile.TextureSize[d] = 1;
+        while(tile.TextureSize[d] < (unsigned int) tile.DataSize[d])
+          tile.TextureSize[d] <<= 1;
+        }
+
+      m_Tiles.push_back(tile);
+      }
+    }
+
+  m_TileGridImageSize = szImage;
+}
+
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::UpdatePipeline()
 {
   // Better have an image
   assert(m_Image);
@@ -98,98 +181,268 @@ OpenGLSliceTexture<TPixel>
   if(m_Image->GetSource())
     m_Image->GetSource()->UpdateLargestPossibleRegion();
 
-  // Check if everything is up-to-date and no computation is needed
-  if (m_IsTextureInitalized && m_UpdateTime == m_Image->GetPipelineMTime())
+  // Rebuild the tiles if the size of the slice has changed
+  if(m_Tiles.empty() || m_TileGridImageSize != m_Image->GetBufferedRegion().GetSize())
+    this->BuildTiles();
+
+  // If the image has been modified, the tiles that show the modified pixels
+  // have to be uploaded before they are drawn again
+  if(m_UpdateTime != m_Image->GetPipelineMTime())
     {
-    return;
+    // The tiles are indexed relative to the start of the buffer
+    const RegionType &buffered = m_Image->GetBufferedRegion();
+
+    for(unsigned int i = 0; i < m_Tiles.size(); i++)
+      {
+      Tile &tile = m_Tiles[i];
+      bool overlaps = true;
+      for(unsigned int d = 0; d < 2; d++)
+        {
+        long x0 = m_ModifiedRegion.GetIndex(d) - buffered.GetIndex(d);
+        long x1 = x0 + (long) m_ModifiedRegion.GetSize(d);
+        overlaps = overlaps
+            && x0 < tile.DataIndex[d] + tile.DataSize[d] && x1 > tile.DataIndex[d];
+        }
+      if(overlaps || !m_IsModifiedRegionKnown)
+        tile.IsStale = true;
+      }
+
+    // Remember the image's timestamp
+    m_UpdateTime = m_Image->GetPipelineMTime();
+    this->ClearModifiedRegion();
     }
+}
 
-  // Promote the image dimensions to powers of 2
-  itk::Size<2> szImage = m_Image->GetLargestPossibleRegion().GetSize();
-  m_TextureSize = Vector2ui(1);
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::AddModifiedRegion(const RegionType &region)
+{
+  if(!m_IsModifiedRegionKnown || m_ModifiedRegion.GetNumberOfPixels() == 0)
+    {
+    m_ModifiedRegion = region;
+    }
+  else if(region.GetNumberOfPixels() > 0)
+    {
+    // Extend the region to the bounding box of both regions
+    for(unsigned int d = 0; d < 2; d++)
+      {
+      long x0 = std::min(m_ModifiedRegion.GetIndex(d), region.GetIndex(d));
+      long x1 = std::max(m_ModifiedRegion.GetUpperIndex()[d], region.GetUpperIndex()[d]);
+      m_ModifiedRegion.SetIndex(d, x0);
+      m_ModifiedRegion.SetSize(d, x1 + 1 - x0);
+      }
+    }
+  m_IsModifiedRegionKnown = true;
+}
 
-  // Use shift to quickly double the coordinates
-  for (unsigned int i=0;i<2;i++)
-    while (m_TextureSize(i) < szImage[i])
-      m_TextureSize(i) <<= 1;
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::ClearModifiedRegion()
+{
+  m_ModifiedRegion = RegionType();
+  m_IsModifiedRegionKnown = false;
+}
 
-  // Create the texture index if necessary
-  if(!m_IsTextureInitalized)
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::UpdateTile(Tile &tile)
+{
+  bool fresh = !tile.IsTextureInitialized;
+  if(fresh)
+    {
+    // Generate the texture and allocate it at the power of 2 size
+    glGenTextures(1, &tile.TextureIndex);
+    glBindTexture(GL_TEXTURE_2D, tile.TextureIndex);
+    glTexImage2D(GL_TEXTURE_2D, 0, m_GlComponents,
+      tile.TextureSize[0], tile.TextureSize[1],
+      0, m_GlFormat, m_GlType, NULL);
+
+    // Force the filter parameters to be set below
+    tile.IsTextureInitialized = true;
+    tile.InterpolationMode = GL_NONE;
+    }
+  else
     {
-    // Generate one texture
-    glGenTextures(1,&m_TextureIndex);
-    m_IsTextureInitalized = true;
+    glBindTexture(GL_TEXTURE_2D, tile.TextureIndex);
     }
 
-  // Select the texture for pixel pumping
-  glBindTexture(GL_TEXTURE_2D,m_TextureIndex);
+  // Upload the data if the texture does not hold it yet
+  if(fresh || tile.IsStale)
+    {
+    int w = m_Image->GetBufferedRegion().GetSize()[0];
+    const TPixel *data =
+        m_Image->GetBufferPointer() + tile.DataIndex[1] * w + tile.DataIndex[0];
+
+    // Turn off modulo-4 rounding in GL, and read the tile directly out of
+    // the slice buffer
+    glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, w);
+
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tile.DataSize[0], tile.DataSize[1],
+                    m_GlFormat, m_GlType, data);
+
+    glPopClientAttrib();
+
+    m_NumberOfTileUploads++;
+    tile.IsStale = false;
+    }
 
   // Properties for the texture
-  glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
-  glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_InterpolationMode );
-  glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_InterpolationMode );
+  if(tile.InterpolationMode != m_InterpolationMode)
+    {
+    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, m_InterpolationMode );
+    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, m_InterpolationMode );
+    tile.InterpolationMode = m_InterpolationMode;
+    }
 
   // TODO: figure out how this can be applied in a fully compatible way
   // glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_MIRRORED_REPEAT);
   // glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_MIRRORED_REPEAT);
+}
 
-  // Turn off modulo-4 rounding in GL
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::Update()
+{
+  this->UpdatePipeline();
+  for(unsigned int i = 0; i < m_Tiles.size(); i++)
+    this->UpdateTile(m_Tiles[i]);
+}
 
-  // Allocate texture of slightly bigger size
-  glTexImage2D(GL_TEXTURE_2D, 0, m_GlComponents,
-    m_TextureSize(0), m_TextureSize(1),
-    0, m_GlFormat, m_GlType, NULL);
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::ComputeVisibleRegion(double visible[4]) const
+{
+  // By default, everything is visible
+  double big = std::numeric_limits<double>::max();
+  visible[0] = visible[1] = -big;
+  visible[2] = visible[3] = big;
+
+  // Combine the projection and modelview matrices (column-major)
+  GLdouble mv[16], pr[16], m[16];
+  glGetDoublev(GL_MODELVIEW_MATRIX, mv);
+  glGetDoublev(GL_PROJECTION_MATRIX, pr);
+  for(int r = 0; r < 4; r++)
+    for(int c = 0; c < 4; c++)
+      {
+      m[c * 4 + r] = 0.0;
+      for(int k = 0; k < 4; k++)
+        m[c * 4 + r] += pr[k * 4 + r] * mv[c * 4 + k];
+      }
 
-  // Copy a subtexture of correct size into the image
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, szImage[0], szImage[1],
-                  m_GlFormat, m_GlType, m_Image->GetBufferPointer());
+  // The slice lies in the z=0 plane. We can only invert an affine mapping
+  // from slice to normalized device coordinates
+  if(m[3] != 0.0 || m[7] != 0.0 || m[15] == 0.0)
+    return;
 
-  // Remember the image's timestamp
-  m_UpdateTime = m_Image->GetPipelineMTime();
+  double a = m[0] / m[15], b = m[4] / m[15], c = m[12] / m[15];
+  double d = m[1] / m[15], e = m[5] / m[15], f = m[13] / m[15];
+  double det = a * e - b * d;
+  if(fabs(det) < 1e-12)
+    return;
+
+  // Map the corners of the viewport back into the slice
+  visible[0] = visible[1] = big;
+  visible[2] = visible[3] = -big;
+  for(int i = 0; i < 4; i++)
+    {
+    double nx = (i & 1) ? 1.0 : -1.0, ny = (i & 2) ? 1.0 : -1.0;
+    double x = (e * (nx - c) - b * (ny - f)) / det;
+    double y = (a * (ny - f) - d * (nx - c)) / det;
+    visible[0] = std::min(visible[0], x);
+    visible[1] = std::min(visible[1], y);
+    visible[2] = std::max(visible[2], x);
+    visible[3] = std::max(visible[3], y);
+    }
 }
 
+template<class TPixel>
+bool
+OpenGLSliceTexture<TPixel>
+::IsTileVisible(const Tile &tile, const double visible[4]) const
+{
+  // Allow a pixel of slack for rounding
+  return tile.CoreIndex[0] <= visible[2] + 1
+      && tile.CoreIndex[1] <= visible[3] + 1
+      && tile.CoreIndex[0] + tile.CoreSize[0] >= visible[0] - 1
+      && tile.CoreIndex[1] + tile.CoreSize[1] >= visible[1] - 1;
+}
 
 template<class TPixel>
 void
 OpenGLSliceTexture<TPixel>
-::Draw(const Vector3d &clrBackground)
+::AddTileQuad(const Tile &tile, double x0, double y0, double x1, double y1)
+{
+  // Texture coordinates are relative to the data stored in the tile
+  double tx0 = (x0 - tile.DataIndex[0]) / tile.TextureSize[0];
+  double tx1 = (x1 - tile.DataIndex[0]) / tile.TextureSize[0];
+  double ty0 = (y0 - tile.DataIndex[1]) / tile.TextureSize[1];
+  double ty1 = (y1 - tile.DataIndex[1]) / tile.TextureSize[1];
+
+  glTexCoord2d(tx0,ty0);
+  glVertex2d(x0,y0);
+  glTexCoord2d(tx0,ty1);
+  glVertex2d(x0,y1);
+  glTexCoord2d(tx1,ty1);
+  glVertex2d(x1,y1);
+  glTexCoord2d(tx1,ty0);
+  glVertex2d(x1,y0);
+}
+
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::DrawVisibleTiles()
 {
   // Update the texture
-  Update();
+  this->UpdatePipeline();
 
-  // Should have a texture number
-  assert(m_IsTextureInitalized);
+  double visible[4];
+  this->ComputeVisibleRegion(visible);
 
+  glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+
+  for(unsigned int i = 0; i < m_Tiles.size(); i++)
+    {
+    Tile &tile = m_Tiles[i];
+    if(this->IsTileVisible(tile, visible))
+      {
+      // Select the texture of the tile
+      this->UpdateTile(tile);
+
+      // Draw quad
+      glBegin(GL_QUADS);
+      this->AddTileQuad(tile, tile.CoreIndex[0], tile.CoreIndex[1],
+                        tile.CoreIndex[0] + tile.CoreSize[0],
+                        tile.CoreIndex[1] + tile.CoreSize[1]);
+      glEnd();
+      }
+    }
+}
+
+
+template<class TPixel>
+void
+OpenGLSliceTexture<TPixel>
+::Draw(const Vector3d &clrBackground)
+{
   // GL settings
   glPushAttrib(GL_TEXTURE_BIT);
   glEnable(GL_TEXTURE_2D);
 
-  // Select our texture
-  glBindTexture(GL_TEXTURE_2D,m_TextureIndex);
-
   // Set the color to the background color
   glColor3dv(clrBackground.data_block());
 
-  int w = m_Image->GetBufferedRegion().GetSize()[0];
-  int h = m_Image->GetBufferedRegion().GetSize()[1];
-  double tx = w * 1.0 / m_TextureSize(0);
-  double ty = h * 1.0 / m_TextureSize(1);
-
   glPushMatrix();
 
-  // Draw quad
-  glBegin(GL_QUADS);
-  glTexCoord2d(0,0);
-  glVertex2d(0,0);
-  glTexCoord2d(0,ty);
-  glVertex2d(0,h);
-  glTexCoord2d(tx,ty);
-  glVertex2d(w,h);
-  glTexCoord2d(tx,0);
-  glVertex2d(w,0);
-  glEnd();
+  // Draw the tiles
+  this->DrawVisibleTiles();
 
   glPopMatrix();
 
@@ -204,52 +457,57 @@ OpenGLSliceTexture<TPixel>
 ::DrawCheckerboard(int rows, int cols)
 {
   // Update the texture
-  Update();
-
-  // Should have a texture number
-  assert(m_IsTextureInitalized);
+  this->UpdatePipeline();
 
   // GL settings
   glPushAttrib(GL_TEXTURE_BIT);
   glEnable(GL_TEXTURE_2D);
-
-  // Select our texture
-  glBindTexture(GL_TEXTURE_2D,m_TextureIndex);
+  glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
 
   int w = m_Image->GetBufferedRegion().GetSize()[0];
   int h = m_Image->GetBufferedRegion().GetSize()[1];
-  double tx = w * 1.0 / m_TextureSize(0);
-  double ty = h * 1.0 / m_TextureSize(1);
+
+  double visible[4];
+  this->ComputeVisibleRegion(visible);
 
   glPushMatrix();
-  glBegin(GL_QUADS);
 
-  // Repeat for each checkerboard
-  for(int iy = 0; iy < rows; iy++)
+  for(unsigned int i = 0; i < m_Tiles.size(); i++)
     {
-    for(int ix = 0; ix < cols; ix++)
+    Tile &tile = m_Tiles[i];
+    if(!this->IsTileVisible(tile, visible))
+      continue;
+
+    // Select the texture of the tile
+    this->UpdateTile(tile);
+
+    double cx0 = tile.CoreIndex[0], cx1 = cx0 + tile.CoreSize[0];
+    double cy0 = tile.CoreIndex[1], cy1 = cy0 + tile.CoreSize[1];
+
+    glBegin(GL_QUADS);
+
+    // Repeat for each checkerboard, clipped to the tile
+    for(int iy = 0; iy < rows; iy++)
       {
-      if((ix + iy) % 2 == 0)
+      for(int ix = 0; ix < cols; ix++)
         {
-        double x0 = ix * 1.0 / cols;
-        double x1 = (ix + 1) * 1.0 / cols;
-        double y0 = iy * 1.0 / rows;
-        double y1 = (iy + 1) * 1.0 / rows;
-
-        // Draw quad
-        glTexCoord2d(x0 * tx, y0 * ty);
-        glVertex2d(x0 * w, y0 * h);
-        glTexCoord2d(x0 * tx, y1 * ty);
-        glVertex2d(x0 * w, y1 * h);
-        glTexCoord2d(x1 * tx, y1 * ty);
-        glVertex2d(x1 * w, y1 * h);
-        glTexCoord2d(x1 * tx, y0 * ty);
-        glVertex2d(x1 * w, y0 * h);
+        if((ix + iy) % 2 == 0)
+          {
+          double x0 = std::max(cx0, ix * 1.0 * w / cols);
+          double x1 = std::min(cx1, (ix + 1) * 1.0 * w / cols);
+          double y0 = std::max(cy0, iy * 1.0 * h / rows);
+          double y1 = std::min(cy1, (iy + 1) * 1.0 * h / rows);
+
+          // Draw quad
+          if(x0 < x1 && y0 < y1)
+            this->AddTileQuad(tile, x0, y0, x1, y1);
+          }
         }
       }
+
+    glEnd();
     }
 
-  glEnd();
   glPopMatrix();
 
   // Even though we use glPushAttrib, on some graphics cards, the texture bit remains set
@@ -263,12 +521,6 @@ void
 OpenGLSliceTexture<TPixel>
 ::DrawTransparent(double alpha)
 {
-  // Update the texture
-  Update();
-
-  // Should have a texture number
-  assert(m_IsTextureInitalized);
-
   // GL settings
   glPushAttrib(GL_TEXTURE_BIT | GL_COLOR_BUFFER_BIT);
   glEnable(GL_TEXTURE_2D);
@@ -277,28 +529,11 @@ OpenGLSliceTexture<TPixel>
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 
-  // Select our texture
-  glBindTexture(GL_TEXTURE_2D,m_TextureIndex);
-
   // Set the color to white
   glColor4ub(255,255,255,(unsigned char)(alpha * 255));
-    
-  int w = m_Image->GetBufferedRegion().GetSize()[0];
-  int h = m_Image->GetBufferedRegion().GetSize()[1];
-  double tx = w * 1.0 / m_TextureSize(0);
-  double ty = h * 1.0 / m_TextureSize(1);
-
-  // Draw quad 
-  glBegin(GL_QUADS);
-  glTexCoord2d(0,0);
-  glVertex2d(0,0);
-  glTexCoord2d(0,ty);
-  glVertex2d(0,h);
-  glTexCoord2d(tx,ty);
-  glVertex2d(w,h);
-  glTexCoord2d(tx,0);
-  glVertex2d(w,0);
-  glEnd();
+
+  // Draw the tiles
+  this->DrawVisibleTiles();
 
   // Even though we use glPushAttrib, on some graphics cards, the texture bit remains set
   glDisable(GL_BLEND);
@@ -314,6 +549,7 @@ void OpenGLSliceTexture<TPixel>::SetImage(ImageType *inImage)
   m_Image = inImage;
   m_Image->GetSource()->UpdateLargestPossibleRegion();
   m_UpdateTime = 0;
+  this->ClearModifiedRegion();
 }
 
 template<class TPixel>
@@ -324,6 +560,7 @@ void OpenGLSliceTexture<TPixel>::SetMipMapping(bool state)
     {
     m_MipMapping = state;
     m_UpdateTime = 0;
+    this->ClearModifiedRegion();
     }
 }
 
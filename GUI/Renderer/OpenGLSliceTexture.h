@@ -45,6 +45,7 @@
 #endif
 
 #include "itkImage.h"
+#include <vector>
 
 /**
  * \class OpenGLSliceTexture
@@ -52,6 +53,17 @@
  * into a GL texture.  
  *
  * The calls to Update will make sure that the texture is up to date.  
+ *
+ * Large slices are split into a grid of tiles, each of which is stored in its
+ * own GL texture of at most TileSize x TileSize pixels. This keeps textures
+ * within the size limits of all drivers, and avoids sending the whole slice
+ * to the GPU for small changes: when the caller knows which part of the image
+ * was modified (see AddModifiedRegion), only the tiles that overlap it are
+ * uploaded again, otherwise all tiles are. The Draw methods only
+ * update the tiles that intersect the current GL viewport, so that when the
+ * view is zoomed in on a large slice, the tiles that are out of view are not
+ * uploaded until they are scrolled into view. Neighboring tiles share a one
+ * pixel border, so that linear interpolation is seamless across tiles.
  */
 template <class TPixel>
 class OpenGLSliceTexture : public itk::Object
@@ -63,6 +75,7 @@ public:
   // Image typedefs
   typedef itk::Image<TPixel, 2> ImageType;
   typedef SmartPtr<ImageType> ImagePointer;
+  typedef typename ImageType::RegionType RegionType;
 
   /** Initialize the texture object */
   void SetDepth(GLuint, GLenum);
@@ -77,11 +90,36 @@ public:
   irisGetMacro(MipMapping, bool)
   void SetMipMapping(bool state);
 
-  /** Get the dimensions of the texture image, which are powers of 2 */
-  irisGetMacro(TextureSize,Vector2ui)
+  /** 
+   * The maximum size of the texture for each tile, must be a power of 2 
+   * (default 512). Changing the tile size causes all tiles to be reloaded.
+   */
+  irisGetMacro(TileSize, unsigned int)
+  void SetTileSize(unsigned int size);
+
+  /** Get the number of tiles in the current tile grid */
+  unsigned int GetNumberOfTiles() const { return m_Tiles.size(); }
 
-  /** Get the GL texture number automatically allocated by this object */
-  irisGetMacro(TextureIndex,int)
+  /** Get the number of tile uploads performed so far (for profiling) */
+  irisGetMacro(NumberOfTileUploads, unsigned long)
+
+  /** Get the pipeline time of the image when the texture was last updated */
+  irisGetMacro(UpdateTime, unsigned long)
+
+  /**
+   * Tell the texture that, since it was last updated, the image has only
+   * changed inside of the given region (in image index coordinates). When the
+   * image is updated next, only the tiles that overlap the region are uploaded
+   * again. The caller must be certain that no other pixels have changed.
+   * Calling this more than once before the update extends the region.
+   */
+  void AddModifiedRegion(const RegionType &region);
+
+  /**
+   * Forget the regions passed to AddModifiedRegion, so that all the tiles are
+   * uploaded again the next time the image changes
+   */
+  void ClearModifiedRegion();
 
   /** Set the number of components used in call to glTextureImage */
   irisSetMacro(GlComponents,GLuint)
@@ -93,14 +131,15 @@ public:
   irisSetMacro(GlType,GLenum)
 
   /**
-   * Make sure that the texture is up to date (reflects the image)
+   * Make sure that the texture is up to date (reflects the image). This
+   * updates all the tiles, including the ones that are not visible.
    */
   void Update();
 
   /**
-   * Set the interpolation mode for the texture. If the interpolation mode
-   * is changed, Update() will be called on the next Draw() command. The value
-   * must be GL_NEAREST or GL_LINEAR
+   * Set the interpolation mode for the texture. The new mode is applied to
+   * each tile the next time it is drawn. The value must be GL_NEAREST or
+   * GL_LINEAR
    */
   void SetInterpolation(GLenum newmode);
 
@@ -125,19 +164,83 @@ protected:
   OpenGLSliceTexture();
   ~OpenGLSliceTexture();
 
+  // A rectangular piece of the slice stored in its own texture
+  struct Tile
+  {
+    // The GL texture, if it has been allocated
+    GLuint TextureIndex;
+    bool IsTextureInitialized;
+
+    // The region drawn by this tile, in image pixels
+    int CoreIndex[2], CoreSize[2];
+
+    // The region uploaded into the texture: the core plus a one pixel border
+    // shared with the neighboring tiles
+    int DataIndex[2], DataSize[2];
+
+    // The dimensions of the texture, which are powers of 2
+    Vector2ui TextureSize;
+
+    // Set when the pixel data in the texture is out of date
+    bool IsStale;
+
+    // Interpolation mode last applied to the texture
+    GLenum InterpolationMode;
+  };
+
+  /**
+   * Update the image pipeline and the tile grid. If the image has changed,
+   * mark the tiles that overlap the modified region (or all tiles) as stale
+   */
+  void UpdatePipeline();
+
+  /** Rebuild the tile grid for the current image size */
+  void BuildTiles();
+
+  /** Delete the GL textures of all the tiles */
+  void ReleaseTiles();
+
+  /**
+   * Bind the texture of a tile, uploading the tile data if it is stale and
+   * applying the current interpolation mode
+   */
+  void UpdateTile(Tile &tile);
+
+  /** Emit a textured quad for a rectangle (in image pixels) within a tile */
+  void AddTileQuad(const Tile &tile, double x0, double y0, double x1, double y1);
+
+  /** Whether the core of the tile intersects the visible region of the slice */
+  bool IsTileVisible(const Tile &tile, const double visible[4]) const;
+
+  /**
+   * Compute the range of image pixel coordinates (x0, y0, x1, y1) visible in
+   * the current GL viewport, based on the modelview and projection matrices
+   */
+  void ComputeVisibleRegion(double visible[4]) const;
+
+  /** Draw the quads for all visible tiles, updating them as needed */
+  void DrawVisibleTiles();
+
 private:
   
-  // The dimensions of the texture as stored in memory
-  Vector2ui m_TextureSize;
-
   // The pointer to the image from which the texture is computed
   ImagePointer m_Image;
 
-  // The texture number (index)
-  GLuint m_TextureIndex;
+  // The tiles, stored row by row
+  std::vector<Tile> m_Tiles;
+
+  // The image size for which the tiles were built
+  itk::Size<2> m_TileGridImageSize;
+
+  // Maximum texture size for each tile
+  unsigned int m_TileSize;
+
+  // Number of times tile data was sent to the GPU
+  unsigned long m_NumberOfTileUploads;
 
-  // Has the texture been initialized?
-  bool m_IsTextureInitalized;
+  // The part of the image modified since the last update, if known
+  RegionType m_ModifiedRegion;
+  bool m_IsModifiedRegionKnown;
 
   // Are mip-maps required
   bool m_MipMapping;
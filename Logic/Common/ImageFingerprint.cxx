@@ -0,0 +1,137 @@
+#include "ImageFingerprint.h"
+#include "itkMultiThreader.h"
+#include <algorithm>
+#include <cstdio>
+
+ImageFingerprint::ImageFingerprint()
+{
+  m_NumberOfSlices = 0;
+  m_SlicesPerSlab = 1;
+  m_NumberOfThreads = 0;
+  m_BytesPerSlab = 4 << 20;
+}
+
+struct ImageFingerprintThreadData
+{
+  const ImageFingerprint::SliceSource *source;
+  const std::vector<unsigned int> *slabs;
+  unsigned int slicesPerSlab, nSlices;
+
+  // Output, one digest per listed slab
+  std::vector<std::string> digests;
+};
+
+static ITK_THREAD_RETURN_TYPE HashSlabsThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct *info =
+      static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+  ImageFingerprintThreadData *data =
+      static_cast<ImageFingerprintThreadData *>(info->UserData);
+
+  // The slabs are interleaved between the threads
+  size_t nt = info->NumberOfThreads, t = info->ThreadID;
+  itksysMD5 *md5 = itksysMD5_New();
+  char hex[33];
+  for(size_t i = t; i < data->slabs->size(); i += nt)
+    {
+    unsigned int z0 = (*data->slabs)[i] * data->slicesPerSlab;
+    unsigned int z1 = std::min(z0 + data->slicesPerSlab, data->nSlices);
+
+    itksysMD5_Initialize(md5);
+    data->source->HashSlices(md5, z0, z1);
+    itksysMD5_FinalizeHex(md5, hex);
+    hex[32] = 0;
+    data->digests[i] = hex;
+    }
+  itksysMD5_Delete(md5);
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+void ImageFingerprint::HashSlabs(const SliceSource &source, const std::vector<unsigned int> &slabs)
+{
+  if(slabs.empty())
+    return;
+
+  ImageFingerprintThreadData data;
+  data.source = &source;
+  data.slabs = &slabs;
+  data.slicesPerSlab = m_SlicesPerSlab;
+  data.nSlices = m_NumberOfSlices;
+  data.digests.resize(slabs.size());
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  if(m_NumberOfThreads > 0)
+    threader->SetNumberOfThreads(m_NumberOfThreads);
+  if(threader->GetNumberOfThreads() > slabs.size())
+    threader->SetNumberOfThreads(slabs.size());
+
+  threader->SetSingleMethod(HashSlabsThreaderCallback, &data);
+  threader->SingleMethodExecute();
+
+  for(size_t i = 0; i < slabs.size(); i++)
+    m_SlabDigests[slabs[i]] = data.digests[i];
+}
+
+void ImageFingerprint::ComputeDigest()
+{
+  itksysMD5 *md5 = itksysMD5_New();
+  itksysMD5_Initialize(md5);
+
+  // The layout and the slab size go first, so that images with the same
+  // bytes but a different shape or slab split have different fingerprints
+  char header[64];
+  sprintf(header, ":%u:", m_SlicesPerSlab);
+  std::string prefix = m_Layout + header;
+  itksysMD5_Append(md5, (const unsigned char *) prefix.c_str(), (int) prefix.size());
+  for(size_t i = 0; i < m_SlabDigests.size(); i++)
+    itksysMD5_Append(md5, (const unsigned char *) m_SlabDigests[i].c_str(), 32);
+
+  char hex[33];
+  itksysMD5_FinalizeHex(md5, hex);
+  hex[32] = 0;
+  itksysMD5_Delete(md5);
+  m_Digest = hex;
+}
+
+void ImageFingerprint::Compute(const SliceSource &source)
+{
+  m_Layout = source.GetLayout();
+  m_NumberOfSlices = source.GetNumberOfSlices();
+
+  size_t bytesPerSlice = std::max((size_t) 1, source.GetBytesPerSlice());
+  m_SlicesPerSlab = (unsigned int) std::max((size_t) 1, m_BytesPerSlab / bytesPerSlice);
+
+  unsigned int nSlabs = (m_NumberOfSlices + m_SlicesPerSlab - 1) / m_SlicesPerSlab;
+  m_SlabDigests.assign(nSlabs, std::string());
+
+  std::vector<unsigned int> slabs(nSlabs);
+  for(unsigned int i = 0; i < nSlabs; i++)
+    slabs[i] = i;
+
+  HashSlabs(source, slabs);
+  ComputeDigest();
+}
+
+unsigned int ImageFingerprint::UpdateSlices(
+    const SliceSource &source, unsigned int z0, unsigned int z1)
+{
+  // Start over if the image is not the one hashed last
+  if(!IsValid() || source.GetLayout() != m_Layout)
+    {
+    Compute(source);
+    return m_SlabDigests.size();
+    }
+
+  if(z0 > z1 || z0 >= m_NumberOfSlices)
+    return 0;
+  z1 = std::min(z1, m_NumberOfSlices - 1);
+
+  std::vector<unsigned int> slabs;
+  for(unsigned int i = z0 / m_SlicesPerSlab; i <= z1 / m_SlicesPerSlab; i++)
+    slabs.push_back(i);
+
+  HashSlabs(source, slabs);
+  ComputeDigest();
+  return slabs.size();
+}
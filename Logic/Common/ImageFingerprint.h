@@ -0,0 +1,165 @@
+#ifndef IMAGEFINGERPRINT_H
+#define IMAGEFINGERPRINT_H
+
+#include "SNAPCommon.h"
+#include "itksys/MD5.h"
+#include <string>
+#include <vector>
+
+/**
+ * A fingerprint of the contents of an image, for caching and change
+ * detection. The image is split into slabs of consecutive slices along the
+ * z axis, and each slab is hashed with MD5 separately, with the slabs split
+ * between threads. The fingerprint is the MD5 of the image layout followed
+ * by the slab digests, i.e., a two-level tree hash. When some slices are
+ * modified, only the slabs that contain them are hashed again.
+ *
+ * The number of slices per slab is derived from the size of a slice, so that
+ * the fingerprint of an image does not depend on the number of threads or on
+ * the order of the updates. It is not the MD5 of the image buffer, so it can
+ * not replace GuidedNativeImageIO::GetNativeImageMD5Hash where file names
+ * depend on the MD5. It is used to check images shared between sessions
+ * (see SharedImageSegment) against the data that the publisher read.
+ */
+class ImageFingerprint
+{
+public:
+
+  /** Access to the bytes of an image, one slab of slices at a time */
+  class SliceSource
+  {
+  public:
+    virtual ~SliceSource() {}
+
+    /** Number of slices along z */
+    virtual unsigned int GetNumberOfSlices() const = 0;
+
+    /** Nominal size of a slice in bytes, used to size the slabs */
+    virtual size_t GetBytesPerSlice() const = 0;
+
+    /** Size and pixel type of the image, which are part of the fingerprint */
+    virtual std::string GetLayout() const = 0;
+
+    /** Append slices [z0, z1) to the MD5. Called concurrently for different slabs */
+    virtual void HashSlices(itksysMD5 *md5, unsigned int z0, unsigned int z1) const = 0;
+  };
+
+  /** Source for images that store their pixels in a single buffer */
+  template <class TImage> class BufferSliceSource;
+
+  /** Source for run-length encoded images. Runs are hashed, not pixels */
+  template <class TImage> class RLESliceSource;
+
+  ImageFingerprint();
+
+  /** Number of threads used to hash the slabs (0 for the default) */
+  void SetNumberOfThreads(unsigned int n)
+    { m_NumberOfThreads = n; }
+
+  /** Nominal size of a slab in bytes. Changing it changes the fingerprint */
+  void SetBytesPerSlab(size_t n)
+    { m_BytesPerSlab = n; m_Layout.clear(); }
+
+  /** Hash the whole image */
+  void Compute(const SliceSource &source);
+
+  /**
+   * Hash the slabs that contain slices [z0, z1] again, after they have been
+   * modified. The whole image is hashed if the layout has changed since the
+   * last call. Returns the number of slabs hashed.
+   */
+  unsigned int UpdateSlices(const SliceSource &source, unsigned int z0, unsigned int z1);
+
+  /** Whether the fingerprint has been computed */
+  bool IsValid() const
+    { return !m_Layout.empty(); }
+
+  /** Forget the fingerprint */
+  void Reset()
+    { m_Layout.clear(); m_SlabDigests.clear(); m_Digest.clear(); }
+
+  /** The fingerprint as a hex string of 32 characters */
+  const std::string &GetDigest() const
+    { return m_Digest; }
+
+  /** Number of slabs */
+  unsigned int GetNumberOfSlabs() const
+    { return m_SlabDigests.size(); }
+
+  /** Number of slices in a slab */
+  unsigned int GetSlicesPerSlab() const
+    { return m_SlicesPerSlab; }
+
+private:
+
+  // Hash the listed slabs on several threads
+  void HashSlabs(const SliceSource &source, const std::vector<unsigned int> &slabs);
+
+  // Combine the layout and the slab digests into the fingerprint
+  void ComputeDigest();
+
+  std::string m_Layout;
+  unsigned int m_NumberOfSlices, m_SlicesPerSlab;
+  std::vector<std::string> m_SlabDigests;
+  std::string m_Digest;
+
+  unsigned int m_NumberOfThreads;
+  size_t m_BytesPerSlab;
+};
+
+
+template <class TImage>
+class ImageFingerprint::BufferSliceSource : public ImageFingerprint::SliceSource
+{
+public:
+  typedef typename TImage::InternalPixelType ComponentType;
+
+  BufferSliceSource(const TImage *image) : m_Image(image) {}
+
+  virtual unsigned int GetNumberOfSlices() const ITK_OVERRIDE
+    { return m_Image->GetBufferedRegion().GetSize(2); }
+
+  virtual size_t GetBytesPerSlice() const ITK_OVERRIDE
+    {
+    return m_Image->GetBufferedRegion().GetSize(0) * m_Image->GetBufferedRegion().GetSize(1)
+        * m_Image->GetNumberOfComponentsPerPixel() * sizeof(ComponentType);
+    }
+
+  virtual std::string GetLayout() const ITK_OVERRIDE;
+
+  virtual void HashSlices(itksysMD5 *md5, unsigned int z0, unsigned int z1) const ITK_OVERRIDE;
+
+private:
+  const TImage *m_Image;
+};
+
+
+template <class TImage>
+class ImageFingerprint::RLESliceSource : public ImageFingerprint::SliceSource
+{
+public:
+  typedef TImage ImageType;
+  typedef typename TImage::PixelType PixelType;
+
+  RLESliceSource(const ImageType *image) : m_Image(image) {}
+
+  virtual unsigned int GetNumberOfSlices() const ITK_OVERRIDE
+    { return m_Image->GetBufferedRegion().GetSize(2); }
+
+  virtual size_t GetBytesPerSlice() const ITK_OVERRIDE
+    {
+    return m_Image->GetBufferedRegion().GetSize(0) * m_Image->GetBufferedRegion().GetSize(1)
+        * sizeof(PixelType);
+    }
+
+  virtual std::string GetLayout() const ITK_OVERRIDE;
+
+  virtual void HashSlices(itksysMD5 *md5, unsigned int z0, unsigned int z1) const ITK_OVERRIDE;
+
+private:
+  const ImageType *m_Image;
+};
+
+#include "ImageFingerprint.txx"
+
+#endif // IMAGEFINGERPRINT_H
@@ -0,0 +1,90 @@
+#include <sstream>
+#include <limits>
+
+// Describes the layout of an image as text, e.g. "64x64x32:3xu16"
+template <class TComponent>
+std::string ImageFingerprintLayout(const itk::Size<3> &size, unsigned int ncomp)
+{
+  std::ostringstream oss;
+  oss << size[0] << "x" << size[1] << "x" << size[2] << ":" << ncomp << "x"
+      << (std::numeric_limits<TComponent>::is_integer
+          ? (std::numeric_limits<TComponent>::is_signed ? "s" : "u") : "f")
+      << 8 * sizeof(TComponent);
+  return oss.str();
+}
+
+template <class TImage>
+std::string
+ImageFingerprint::BufferSliceSource<TImage>
+::GetLayout() const
+{
+  return ImageFingerprintLayout<ComponentType>(
+        m_Image->GetBufferedRegion().GetSize(), m_Image->GetNumberOfComponentsPerPixel());
+}
+
+template <class TImage>
+void
+ImageFingerprint::BufferSliceSource<TImage>
+::HashSlices(itksysMD5 *md5, unsigned int z0, unsigned int z1) const
+{
+  size_t bytes = this->GetBytesPerSlice();
+  const unsigned char *buffer =
+      reinterpret_cast<const unsigned char *>(m_Image->GetBufferPointer());
+
+  // Append one slice at a time, since the length is an int
+  for(unsigned int z = z0; z < z1; z++)
+    itksysMD5_Append(md5, buffer + z * bytes, (int) bytes);
+}
+
+template <class TImage>
+std::string
+ImageFingerprint::RLESliceSource<TImage>
+::GetLayout() const
+{
+  return ImageFingerprintLayout<PixelType>(m_Image->GetBufferedRegion().GetSize(), 1) + ":rle";
+}
+
+template <class TImage>
+void
+ImageFingerprint::RLESliceSource<TImage>
+::HashSlices(itksysMD5 *md5, unsigned int z0, unsigned int z1) const
+{
+  typedef typename ImageType::RLLine RLLine;
+  typedef typename ImageType::BufferType BufferType;
+
+  const BufferType *lines = m_Image->GetBuffer().GetPointer();
+  unsigned int ny = m_Image->GetBufferedRegion().GetSize(1);
+
+  // Each run is hashed as its length followed by its value. Adjacent runs
+  // with the same value are merged first, so that the digest only depends
+  // on the labels, and not on how the runs were split by earlier edits.
+  std::vector<unsigned char> bytes;
+  for(unsigned int z = z0; z < z1; z++)
+    {
+    bytes.clear();
+    itk::Index<2> lix;
+    lix[1] = z;
+    for(unsigned int y = 0; y < ny; y++)
+      {
+      lix[0] = y;
+      const RLLine &line = lines->GetPixel(lix);
+
+      // Runs do not merge across lines
+      for(size_t r = 0; r < line.size(); )
+        {
+        PixelType value = line[r].second;
+        unsigned int count = 0;
+        for(; r < line.size() && line[r].second == value; r++)
+          count += line[r].first;
+
+        const unsigned char *pc = reinterpret_cast<const unsigned char *>(&count);
+        const unsigned char *pv = reinterpret_cast<const unsigned char *>(&value);
+        bytes.insert(bytes.end(), pc, pc + sizeof(count));
+        bytes.insert(bytes.end(), pv, pv + sizeof(value));
+        }
+      }
+
+    if(bytes.size())
+      itksysMD5_Append(md5, &bytes[0], (int) bytes.size());
+    }
+}
@@ -119,6 +119,9 @@ SNAPRegistryIO
     registry["SolverAlgorithm"].GetEnum(
       m_EnumMapSolver,defaultSet.GetSolver()));
 
+  out.SetPreserveTopology(
+    registry["PreserveTopology"][defaultSet.GetPreserveTopology()]);
+
   return out;
 }
 
@@ -141,6 +144,7 @@ SNAPRegistryIO
   registry["AdvectionSpeedExponent"] << in.GetAdvectionSpeedExponent();
   registry["SnakeType"].PutEnum(m_EnumMapSnakeType,in.GetSnakeType());
   registry["SolverAlgorithm"].PutEnum(m_EnumMapSolver,in.GetSolver());
+  registry["PreserveTopology"] << in.GetPreserveTopology();
 }
 
 /** Read mesh options from a registry */
@@ -0,0 +1,379 @@
+#include "SegmentationComparison.h"
+#include "LabelImageWrapper.h"
+#include "ColorLabelTable.h"
+#include "IRISException.h"
+#include "itkMultiThreader.h"
+#include "itkSignedMaurerDistanceMapImageFilter.h"
+#include "itksys/SystemTools.hxx"
+#include <climits>
+#include <cmath>
+#include <algorithm>
+
+using namespace std;
+
+SegmentationComparison::BoundingBox::BoundingBox()
+{
+  for(int d = 0; d < 3; d++)
+    {
+    lower[d] = LONG_MAX;
+    upper[d] = LONG_MIN;
+    }
+}
+
+void SegmentationComparison::BoundingBox::Add(long x0, long x1, long y, long z)
+{
+  lower[0] = std::min(lower[0], x0); upper[0] = std::max(upper[0], x1);
+  lower[1] = std::min(lower[1], y);  upper[1] = std::max(upper[1], y);
+  lower[2] = std::min(lower[2], z);  upper[2] = std::max(upper[2], z);
+}
+
+void SegmentationComparison::BoundingBox::Add(const BoundingBox &other)
+{
+  for(int d = 0; d < 3; d++)
+    {
+    lower[d] = std::min(lower[d], other.lower[d]);
+    upper[d] = std::max(upper[d], other.upper[d]);
+    }
+}
+
+SegmentationComparison::SegmentationComparison()
+{
+  m_ComputeSurfaceDistances = true;
+  m_NumberOfThreads = 0;
+}
+
+// Data shared by the threads that count the voxels
+struct SegmentationComparisonThreadData
+{
+  typedef SegmentationComparison::LabelImageType LabelImageType;
+  typedef LabelImageType::RLLine RLLine;
+
+  const RLLine *linesA, *linesB;
+  size_t nLines;
+  long x0, y0, z0, ny;
+
+  std::vector<SegmentationComparison::ConfusionMap> confusion;
+  std::vector<SegmentationComparison::BoxMap> boxes;
+};
+
+// Add the runs of a line to the bounding boxes of their labels
+static void AddLineToBoxes(const SegmentationComparisonThreadData::RLLine &line,
+                           long x, long y, long z, SegmentationComparison::BoxMap &boxes)
+{
+  LabelType lastLabel = 0;
+  SegmentationComparison::BoundingBox *lastBox = NULL;
+  for(size_t k = 0; k < line.size(); x += line[k].first, k++)
+    {
+    LabelType label = line[k].second;
+    if(label == 0)
+      continue;
+
+    if(!lastBox || label != lastLabel)
+      {
+      lastBox = &boxes[label];
+      lastLabel = label;
+      }
+    lastBox->Add(x, x + line[k].first - 1, y, z);
+    }
+}
+
+static ITK_THREAD_RETURN_TYPE CountVoxelsThreaderCallback(void *arg)
+{
+  itk::MultiThreader::ThreadInfoStruct *info =
+      static_cast<itk::MultiThreader::ThreadInfoStruct *>(arg);
+  SegmentationComparisonThreadData *data =
+      static_cast<SegmentationComparisonThreadData *>(info->UserData);
+
+  typedef SegmentationComparisonThreadData::RLLine RLLine;
+
+  // The range of lines handled by this thread
+  size_t nt = info->NumberOfThreads, t = info->ThreadID;
+  size_t l0 = data->nLines * t / nt, l1 = data->nLines * (t + 1) / nt;
+
+  SegmentationComparison::ConfusionMap &confusion = data->confusion[t];
+  SegmentationComparison::BoxMap &boxes = data->boxes[t];
+
+  // The count for the last pair of labels, to avoid most map lookups
+  SegmentationComparison::LabelPair lastPair;
+  unsigned long *lastCount = NULL;
+
+  for(size_t i = l0; i < l1; i++)
+    {
+    const RLLine &la = data->linesA[i], &lb = data->linesB[i];
+    long y = data->y0 + i % data->ny, z = data->z0 + i / data->ny;
+
+    AddLineToBoxes(la, data->x0, y, z, boxes);
+    AddLineToBoxes(lb, data->x0, y, z, boxes);
+
+    // Merge the runs of the two lines, stepping to the nearest run end
+    size_t ia = 0, ib = 0;
+    long ra = la.size() ? la[0].first : 0, rb = lb.size() ? lb[0].first : 0;
+    while(ia < la.size() && ib < lb.size())
+      {
+      long step = std::min(ra, rb);
+      SegmentationComparison::LabelPair pair(la[ia].second, lb[ib].second);
+      if(!lastCount || pair != lastPair)
+        {
+        lastCount = &confusion[pair];
+        lastPair = pair;
+        }
+      *lastCount += step;
+
+      ra -= step;
+      rb -= step;
+      if(ra == 0 && ++ia < la.size())
+        ra = la[ia].first;
+      if(rb == 0 && ++ib < lb.size())
+        rb = lb[ib].first;
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+void
+SegmentationComparison
+::CountVoxels(LabelImageType *a, LabelImageType *b)
+{
+  typedef LabelImageType::BufferType BufferType;
+  BufferType *bufA = a->GetBuffer(), *bufB = b->GetBuffer();
+  LabelImageType::RegionType region = a->GetBufferedRegion();
+
+  SegmentationComparisonThreadData data;
+  data.linesA = bufA->GetBufferPointer();
+  data.linesB = bufB->GetBufferPointer();
+  data.nLines = bufA->GetBufferedRegion().GetNumberOfPixels();
+  data.x0 = region.GetIndex(0);
+  data.y0 = region.GetIndex(1);
+  data.z0 = region.GetIndex(2);
+  data.ny = region.GetSize(1);
+
+  itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+  if(m_NumberOfThreads > 0)
+    threader->SetNumberOfThreads(m_NumberOfThreads);
+  if(threader->GetNumberOfThreads() > data.nLines)
+    threader->SetNumberOfThreads(std::max((size_t) 1, data.nLines));
+
+  data.confusion.resize(threader->GetNumberOfThreads());
+  data.boxes.resize(threader->GetNumberOfThreads());
+
+  threader->SetSingleMethod(CountVoxelsThreaderCallback, &data);
+  threader->SingleMethodExecute();
+
+  // Combine the results of the threads
+  for(size_t t = 0; t < data.confusion.size(); t++)
+    {
+    for(ConfusionMap::const_iterator it = data.confusion[t].begin();
+        it != data.confusion[t].end(); ++it)
+      m_Confusion[it->first] += it->second;
+
+    for(BoxMap::const_iterator it = data.boxes[t].begin();
+        it != data.boxes[t].end(); ++it)
+      m_Boxes[it->first].Add(it->second);
+    }
+}
+
+void
+SegmentationComparison
+::ComputeSurfaceDistances(LabelImageType *a, LabelImageType *b,
+                          LabelType label, Entry &entry)
+{
+  typedef itk::Image<unsigned char, 3> MaskType;
+  typedef itk::Image<float, 3> DistanceImageType;
+  typedef LabelImageType::RLLine RLLine;
+
+  // The bounding box of the label, with a margin of one voxel so that the
+  // label does not touch the edge of the box
+  const BoundingBox &box = m_Boxes[label];
+  MaskType::RegionType region;
+  for(int d = 0; d < 3; d++)
+    {
+    region.SetIndex(d, box.lower[d] - 1);
+    region.SetSize(d, box.upper[d] - box.lower[d] + 3);
+    }
+
+  // Rasterize the label in each image into a mask covering the box
+  LabelImageType *image[] = { a, b };
+  MaskType::Pointer mask[2];
+  long x0 = a->GetBufferedRegion().GetIndex(0);
+  for(int m = 0; m < 2; m++)
+    {
+    mask[m] = MaskType::New();
+    mask[m]->SetRegions(region);
+    mask[m]->SetSpacing(a->GetSpacing());
+    mask[m]->Allocate();
+    mask[m]->FillBuffer(0);
+
+    for(long z = box.lower[2]; z <= box.upper[2]; z++)
+      {
+      for(long y = box.lower[1]; y <= box.upper[1]; y++)
+        {
+        LabelImageType::BufferType::IndexType idxLine = {{ y, z }};
+        const RLLine &line = image[m]->GetBuffer()->GetPixel(idxLine);
+
+        MaskType::IndexType idx = {{ box.lower[0], y, z }};
+        unsigned char *row = mask[m]->GetBufferPointer()
+            + mask[m]->ComputeOffset(idx) - box.lower[0];
+
+        long x = x0;
+        for(size_t k = 0; k < line.size() && x <= box.upper[0]; x += line[k].first, k++)
+          {
+          if(line[k].second != label)
+            continue;
+          long r0 = std::max(x, box.lower[0]);
+          long r1 = std::min(x + (long) line[k].first - 1, box.upper[0]);
+          for(long q = r0; q <= r1; q++)
+            row[q] = 1;
+          }
+        }
+      }
+    }
+
+  // Strides in the mask buffer
+  long sy = region.GetSize(0), sz = region.GetSize(0) * region.GetSize(1);
+
+  double dmax = 0.0, dsum = 0.0;
+  unsigned long n = 0;
+  for(int m = 0; m < 2; m++)
+    {
+    // Distance to the boundary of the other mask
+    typedef itk::SignedMaurerDistanceMapImageFilter<MaskType, DistanceImageType> DistanceFilter;
+    DistanceFilter::Pointer fltDistance = DistanceFilter::New();
+    fltDistance->SetInput(mask[1-m]);
+    fltDistance->SetUseImageSpacing(true);
+    fltDistance->SetSquaredDistance(false);
+    fltDistance->SetInsideIsPositive(false);
+    fltDistance->Update();
+    const float *dist = fltDistance->GetOutput()->GetBufferPointer();
+
+    // Visit the boundary voxels of this mask, i.e., voxels in the label with
+    // a face neighbor outside of it. The margin keeps the neighbors in the box
+    const unsigned char *p = mask[m]->GetBufferPointer();
+    for(long z = 1; z < (long) region.GetSize(2) - 1; z++)
+      {
+      for(long y = 1; y < (long) region.GetSize(1) - 1; y++)
+        {
+        long off = z * sz + y * sy;
+        for(long x = 1; x < sy - 1; x++)
+          {
+          long v = off + x;
+          if(p[v] && (!p[v-1] || !p[v+1] || !p[v-sy] || !p[v+sy] || !p[v-sz] || !p[v+sz]))
+            {
+            double d = fabs(dist[v]);
+            dmax = std::max(dmax, d);
+            dsum += d;
+            n++;
+            }
+          }
+        }
+      }
+    }
+
+  entry.hausdorff_mm = dmax;
+  entry.mean_distance_mm = n > 0 ? dsum / n : 0.0;
+}
+
+void
+SegmentationComparison
+::Compute(LabelImageType *a, LabelImageType *b)
+{
+  if(a->GetBufferedRegion() != b->GetBufferedRegion())
+    throw IRISException("The segmentations being compared must have the same dimensions");
+
+  m_Stats.clear();
+  m_Confusion.clear();
+  m_Boxes.clear();
+
+  // Count the voxels of each pair of labels
+  this->CountVoxels(a, b);
+
+  // Size of a voxel, in mm^3
+  const double *spacing = a->GetSpacing().GetDataPointer();
+  double volVoxel = spacing[0] * spacing[1] * spacing[2];
+
+  // Count the voxels of each label
+  for(ConfusionMap::const_iterator it = m_Confusion.begin(); it != m_Confusion.end(); ++it)
+    {
+    LabelType la = it->first.first, lb = it->first.second;
+    if(la != 0)
+      m_Stats[la].countA += it->second;
+    if(lb != 0)
+      m_Stats[lb].countB += it->second;
+    if(la == lb && la != 0)
+      m_Stats[la].overlap = it->second;
+    }
+
+  // Derive the overlap and distance metrics
+  for(EntryMap::iterator it = m_Stats.begin(); it != m_Stats.end(); ++it)
+    {
+    Entry &entry = it->second;
+    entry.volumeA_mm3 = entry.countA * volVoxel;
+    entry.volumeB_mm3 = entry.countB * volVoxel;
+    entry.dice = 2.0 * entry.overlap / (entry.countA + entry.countB);
+    entry.jaccard = entry.overlap / (double) (entry.countA + entry.countB - entry.overlap);
+
+    // Distances are not defined unless the label is in both images
+    if(m_ComputeSurfaceDistances && entry.countA > 0 && entry.countB > 0)
+      {
+      this->ComputeSurfaceDistances(a, b, it->first, entry);
+      }
+    else
+      {
+      entry.hausdorff_mm = nan("");
+      entry.mean_distance_mm = nan("");
+      }
+    }
+}
+
+void
+SegmentationComparison
+::Compute(LabelImageWrapper *a, LabelImageWrapper *b)
+{
+  this->Compute(a->GetImage(), b->GetImage());
+  m_NameA = a->GetNickname();
+  m_NameB = b->GetNickname();
+}
+
+void
+SegmentationComparison
+::Export(ostream &oss, const string &colsep, const ColorLabelTable &clt, bool header) const
+{
+  if(header)
+    {
+    oss << "Segmentation A" << colsep;
+    oss << "Segmentation B" << colsep;
+    oss << "Label Id" << colsep;
+    oss << "Label Name" << colsep;
+    oss << "Voxels In A" << colsep;
+    oss << "Voxels In B" << colsep;
+    oss << "Overlapping Voxels" << colsep;
+    oss << "Volume A (mm^3)" << colsep;
+    oss << "Volume B (mm^3)" << colsep;
+    oss << "Volume Difference B-A (mm^3)" << colsep;
+    oss << "Dice" << colsep;
+    oss << "Jaccard" << colsep;
+    oss << "Hausdorff Distance (mm)" << colsep;
+    oss << "Mean Surface Distance (mm)" << std::endl;
+    }
+
+  std::string nameA = m_NameA, nameB = m_NameB;
+  itksys::SystemTools::ReplaceString(nameA, colsep.c_str(), " ");
+  itksys::SystemTools::ReplaceString(nameB, colsep.c_str(), " ");
+
+  for(EntryMap::const_iterator it = m_Stats.begin(); it != m_Stats.end(); ++it)
+    {
+    LabelType i = it->first;
+    const Entry &entry = it->second;
+
+    std::string label(clt.GetColorLabel(i).GetLabel());
+    itksys::SystemTools::ReplaceString(label, colsep.c_str(), " ");
+
+    oss << nameA << colsep << nameB << colsep;
+    oss << i << colsep << label << colsep;
+    oss << entry.countA << colsep << entry.countB << colsep << entry.overlap << colsep;
+    oss << entry.volumeA_mm3 << colsep << entry.volumeB_mm3 << colsep;
+    oss << entry.volumeB_mm3 - entry.volumeA_mm3 << colsep;
+    oss << entry.dice << colsep << entry.jaccard << colsep;
+    oss << entry.hausdorff_mm << colsep << entry.mean_distance_mm << std::endl;
+    }
+}
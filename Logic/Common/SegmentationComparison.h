@@ -0,0 +1,113 @@
+#ifndef SEGMENTATIONCOMPARISON_H
+#define SEGMENTATIONCOMPARISON_H
+
+#include "SNAPCommon.h"
+#include "RLEImage.h"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <map>
+
+class ColorLabelTable;
+class LabelImageWrapper;
+
+/**
+ * Overlap and distance metrics between two segmentations of the same image,
+ * e.g., two segmentation layers loaded at the same time.
+ *
+ * The voxel counts are computed by merging the runs of the two run-length
+ * encoded images line by line, with the lines split between threads. This
+ * gives the confusion counts of every pair of labels, from which the Dice and
+ * Jaccard overlaps and the volumes are derived.
+ *
+ * The surface distances are computed for each label present in both images.
+ * Within the bounding box of the label, the boundary voxels of each
+ * segmentation (voxels with a face neighbor outside of the label) are found,
+ * and the distance from each boundary voxel to the nearest boundary voxel of
+ * the other segmentation is looked up in a distance transform. The distances
+ * are between voxel centers, and so are approximations of the distances
+ * between the surfaces.
+ */
+class SegmentationComparison
+{
+public:
+
+  typedef RLEImage<LabelType> LabelImageType;
+
+  /* Metrics of a single label */
+  struct Entry {
+    unsigned long countA, countB, overlap;
+    double volumeA_mm3, volumeB_mm3;
+    double dice, jaccard;
+    double hausdorff_mm, mean_distance_mm;
+    Entry() : countA(0), countB(0), overlap(0), volumeA_mm3(0), volumeB_mm3(0),
+      dice(0), jaccard(0), hausdorff_mm(0), mean_distance_mm(0) {}
+  };
+
+  typedef std::map<LabelType, Entry> EntryMap;
+
+  /* Number of voxels with label a in the first and b in the second image */
+  typedef std::pair<LabelType, LabelType> LabelPair;
+  typedef std::map<LabelPair, unsigned long> ConfusionMap;
+
+  SegmentationComparison();
+
+  /* Whether to compute the surface distances, which takes longer */
+  void SetComputeSurfaceDistances(bool value)
+    { m_ComputeSurfaceDistances = value; }
+
+  /* Number of threads used to count the voxels (0 for the default) */
+  void SetNumberOfThreads(unsigned int n)
+    { m_NumberOfThreads = n; }
+
+  /* Compare two label images, which must have the same size */
+  void Compute(LabelImageType *a, LabelImageType *b);
+
+  /* Compare two segmentation layers */
+  void Compute(LabelImageWrapper *a, LabelImageWrapper *b);
+
+  /* Export to a CSV or text file, one row per label, with an optional header */
+  void Export(std::ostream &oss, const std::string &colsep,
+              const ColorLabelTable &clt, bool header = true) const;
+
+  /* Metrics of the labels, other than the clear label, in either image */
+  const EntryMap &GetStats() const
+    { return m_Stats; }
+
+  const ConfusionMap &GetConfusion() const
+    { return m_Confusion; }
+
+  /* Names of the compared layers, if layers were compared */
+  const std::string &GetNameA() const { return m_NameA; }
+  const std::string &GetNameB() const { return m_NameB; }
+
+  /* Bounding box of a label in either image, as a pair of corners */
+  struct BoundingBox {
+    long lower[3], upper[3];
+    BoundingBox();
+    void Add(long x0, long x1, long y, long z);
+    void Add(const BoundingBox &other);
+  };
+
+  typedef std::map<LabelType, BoundingBox> BoxMap;
+
+private:
+
+  EntryMap m_Stats;
+  ConfusionMap m_Confusion;
+  BoxMap m_Boxes;
+  std::string m_NameA, m_NameB;
+
+  bool m_ComputeSurfaceDistances;
+  unsigned int m_NumberOfThreads;
+
+  // Merge the runs of both images and record the confusion counts and the
+  // bounding boxes of the labels
+  void CountVoxels(LabelImageType *a, LabelImageType *b);
+
+  // Compute the surface distances for one label
+  void ComputeSurfaceDistances(LabelImageType *a, LabelImageType *b,
+                               LabelType label, Entry &entry);
+};
+
+#endif // SEGMENTATIONCOMPARISON_H
@@ -44,30 +44,39 @@
 using namespace std;
 
 
-// TODO: improve efficiency by using filters to integrate label intensities
-void
 SegmentationStatistics
-::Compute(IRISApplication *app)
+::SegmentationStatistics()
 {
-  // Get the current image data
-  GenericImageData *id = app->GetCurrentImageData();
-
-  // Get the selected segmentation layer
-  LabelImageWrapper *seg = app->GetSelectedSegmentationLayer();
-
-  // A list of image sources
-  vector<ScalarImageWrapperBase *> layers;
+  m_SegmentationLayerId = 0;
+  m_ChangeLogPosition = 0;
+}
 
-  // Clear the list of column names
-  m_ImageStatisticsColumnNames.clear();
+void
+SegmentationStatistics
+::FindLayers(GenericImageData *id,
+             vector<ScalarImageWrapperBase *> &layers,
+             vector<string> &columns,
+             vector<LayerSignature> &signature)
+{
+  layers.clear();
+  columns.clear();
+  signature.clear();
 
   // Find all the images available for statistics computation
   for(LayerIterator it(id, MAIN_ROLE | OVERLAY_ROLE); !it.IsAtEnd(); ++it)
     {
+    // The statistics depend on the voxels of the layer, and can only be
+    // computed for layers sliced orthogonally
+    LayerSignature sig;
+    sig.id = it.GetLayer()->GetUniqueId();
+    sig.mtime = it.GetLayer()->GetImageBase()->GetMTime();
+    sig.orthogonal = it.GetLayer()->IsSlicingOrthogonal();
+    signature.push_back(sig);
+
     ScalarImageWrapperBase *lscalar = it.GetLayerAsScalar();
     if(lscalar)
       {
-      m_ImageStatisticsColumnNames.push_back(lscalar->GetNickname());
+      columns.push_back(lscalar->GetNickname());
       layers.push_back(lscalar);
       }
     else
@@ -79,12 +88,28 @@ SegmentationStatistics
         oss << lvector->GetNickname();
         if(lvector->GetNumberOfComponents() > 1)
           oss << " [" << j << "]";
-        m_ImageStatisticsColumnNames.push_back(oss.str());
+        columns.push_back(oss.str());
         layers.push_back(lvector->GetScalarRepresentation(
               SCALAR_REP_COMPONENT, j));
         }
       }
     }
+}
+
+// TODO: improve efficiency by using filters to integrate label intensities
+void
+SegmentationStatistics
+::Compute(IRISApplication *app)
+{
+  // Get the current image data
+  GenericImageData *id = app->GetCurrentImageData();
+
+  // Get the selected segmentation layer
+  LabelImageWrapper *seg = app->GetSelectedSegmentationLayer();
+
+  // A list of image sources
+  vector<ScalarImageWrapperBase *> layers;
+  this->FindLayers(id, layers, m_ImageStatisticsColumnNames, m_LayerSignature);
 
   // Get the number of gray image layers
   size_t ngray = layers.size();
@@ -92,6 +117,10 @@ SegmentationStatistics
   // Clear and initialize the statistics table
   m_Stats.clear();
 
+  // Later edits are applied from this point in the change log
+  m_SegmentationLayerId = seg->GetUniqueId();
+  m_ChangeLogPosition = seg->GetChangeLogEnd();
+
   // Start the label image iteration
   LabelImageWrapper::ConstIterator itLabel = seg->GetImageConstIterator();
   itk::ImageRegion<3> region = itLabel.GetRegion();
@@ -127,6 +156,101 @@ SegmentationStatistics
   // Record the statistics from the last run
   this->RecordRunLength(ngray, layers, region, runStart, runLength, cachedEntry);
 
+  // Compute the mean and standard deviation
+  this->ComputeMeanAndStdev(id, layers);
+}
+
+void
+SegmentationStatistics
+::Update(IRISApplication *app)
+{
+  GenericImageData *id = app->GetCurrentImageData();
+  LabelImageWrapper *seg = app->GetSelectedSegmentationLayer();
+
+  vector<ScalarImageWrapperBase *> layers;
+  vector<string> columns;
+  vector<LayerSignature> signature;
+  this->FindLayers(id, layers, columns, signature);
+
+  // Get the edits since the last update, unless the statistics have to be
+  // computed from scratch
+  vector<const LabelImageWrapper::LabelChange *> changes;
+  unsigned long pos = m_ChangeLogPosition;
+  if(seg->GetUniqueId() != m_SegmentationLayerId
+     || signature != m_LayerSignature
+     || !seg->GetChangesSince(pos, changes))
+    {
+    this->Compute(app);
+    return;
+    }
+
+  // Layers may have been renamed
+  m_ImageStatisticsColumnNames = columns;
+  m_ChangeLogPosition = pos;
+
+  size_t ngray = layers.size();
+  vnl_vector<double> sum(ngray), sumsq(ngray);
+
+  // Move the contribution of each changed run from the old label to the new
+  for(size_t k = 0; k < changes.size(); k++)
+    {
+    itk::ImageRegion<3> region = changes[k]->Region;
+    for(size_t r = 0; r < changes[k]->Runs.size(); r++)
+      {
+      const LabelImageWrapper::LabelChangeRun &run = changes[k]->Runs[r];
+
+      // Find the start of the run in the region
+      itk::Index<3> runStart;
+      size_t offset = run.Offset;
+      for(int d = 0; d < 3; d++)
+        {
+        runStart[d] = region.GetIndex(d) + offset % region.GetSize(d);
+        offset /= region.GetSize(d);
+        }
+
+      sum.fill(0.0);
+      sumsq.fill(0.0);
+      for(size_t j = 0; j < ngray; j++)
+        layers[j]->GetRunLengthIntensityStatistics(
+              region, runStart, run.Length, &sum[j], &sumsq[j]);
+
+      Entry &eOld = m_Stats[run.OldLabel];
+      if(eOld.count == 0)
+        eOld.resize(ngray);
+      eOld.count -= run.Length;
+      eOld.sum -= sum;
+      eOld.sumsq -= sumsq;
+
+      Entry &eNew = m_Stats[run.NewLabel];
+      if(eNew.count == 0)
+        eNew.resize(ngray);
+      eNew.count += run.Length;
+      eNew.sum += sum;
+      eNew.sumsq += sumsq;
+      }
+    }
+
+  // Remove the labels that are no longer present, except for the clear label,
+  // which is always listed, as it is by Compute
+  for(EntryMap::iterator it = m_Stats.begin(); it != m_Stats.end(); )
+    {
+    if(it->second.count == 0 && it->first != 0)
+      m_Stats.erase(it++);
+    else
+      ++it;
+    }
+
+  // Round-off is not left behind in empty entries
+  if(m_Stats[0].count == 0)
+    m_Stats[0].resize(ngray);
+
+  this->ComputeMeanAndStdev(id, layers);
+}
+
+void
+SegmentationStatistics
+::ComputeMeanAndStdev(GenericImageData *id, vector<ScalarImageWrapperBase *> &layers)
+{
   // Compute the size of a voxel, in mm^3
   const double *spacing = 
     id->GetMain()->GetImageBase()->GetSpacing().GetDataPointer();
@@ -136,7 +260,7 @@ SegmentationStatistics
   for(EntryMap::iterator it = m_Stats.begin(); it != m_Stats.end(); ++it)
     {
     Entry &entry = it->second;
-    for(size_t j = 0; j < ngray; j++)
+    for(size_t j = 0; j < layers.size(); j++)
       {
       // Map to native format
       double mean = entry.sum[j] / entry.count;
@@ -45,6 +45,7 @@ class GenericImageData;
 class ColorLabelTable;
 class ScalarImageWrapperBase;
 class IRISApplication;
+class LabelImageWrapper;
 
 namespace itk {
   template <unsigned int VDim> class ImageRegion;
@@ -78,8 +79,16 @@ public:
 
   typedef std::map<LabelType, Entry> EntryMap;
 
+  SegmentationStatistics();
+
   /* Compute statistics from a segmentation image */
   void Compute(IRISApplication *app);
+
+  /* Bring the statistics up to date with the segmentation. Only the voxels
+     changed by edits, undo and redo since the last update are visited, unless
+     the image layers or the segmentation layer have changed, or the changes
+     are not known, in which case the statistics are computed from scratch */
+  void Update(IRISApplication *app);
   
   /* Export to a text file using legacy format */
   void ExportLegacy(std::ostream &oss, const ColorLabelTable &clt);
@@ -100,7 +109,34 @@ private:
 
   // Column information
   std::vector<std::string> m_ImageStatisticsColumnNames;
-  
+
+  // Identifies the image layers and their contents, in order to tell when
+  // the statistics have to be computed from scratch
+  struct LayerSignature {
+    unsigned long id;
+    unsigned long mtime;
+    bool orthogonal;
+    bool operator == (const LayerSignature &o) const
+      { return id == o.id && mtime == o.mtime && orthogonal == o.orthogonal; }
+  };
+
+  std::vector<LayerSignature> m_LayerSignature;
+
+  // The segmentation layer and the position in its change log that the
+  // statistics are up to date with
+  unsigned long m_SegmentationLayerId;
+  unsigned long m_ChangeLogPosition;
+
+  void FindLayers(
+      GenericImageData *id,
+      std::vector<ScalarImageWrapperBase *> &layers,
+      std::vector<std::string> &columns,
+      std::vector<LayerSignature> &signature);
+
+  void ComputeMeanAndStdev(
+      GenericImageData *id,
+      std::vector<ScalarImageWrapperBase *> &layers);
+
   void RecordRunLength(
       size_t ngray,
       std::vector<ScalarImageWrapperBase *> &layers,
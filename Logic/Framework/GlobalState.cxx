@@ -136,6 +136,9 @@ GlobalState
   m_AnnotationColorModel = NewSimpleConcreteProperty(Vector3d(1, 0, 0));
   m_AnnotationAlphaModel = NewRangedConcreteProperty(1.0, 0.0, 1.0, 0.01);
   m_AnnotationVisibilityModel = NewNumericPropertyToggleAdaptor(m_AnnotationAlphaModel.GetPointer(), 0.0, 1.0);
+
+  // Image sharing between sessions is off by default
+  m_ShareImagesBetweenSessionsModel = NewSimpleConcreteProperty(false);
 }
 
 void GlobalState::SetDriver(IRISApplication *parent)
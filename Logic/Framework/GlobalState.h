@@ -407,6 +407,12 @@ public:
   irisRangedPropertyAccessMacro(AnnotationAlpha, double)
   irisSimplePropertyAccessMacro(AnnotationVisibility, bool)
 
+  /**
+   * Whether anatomical images loaded from disk are shared, through shared
+   * memory, with other SNAP sessions on this machine that load the same files
+   */
+  irisSimplePropertyAccessMacro(ShareImagesBetweenSessions, bool)
+
 protected:
 
   GlobalState();
@@ -540,6 +546,9 @@ private:
   SmartPtr<ConcreteSimpleDoubleVec3Property> m_AnnotationColorModel;
   SmartPtr<ConcreteRangedDoubleProperty> m_AnnotationAlphaModel;
   SmartPtr<AbstractSimpleBooleanProperty> m_AnnotationVisibilityModel;
+
+  // ------------------- Multi-Session -------------------------------------
+  SmartPtr<ConcreteSimpleBooleanProperty> m_ShareImagesBetweenSessionsModel;
 };
 
 #endif // __GlobalState_h_
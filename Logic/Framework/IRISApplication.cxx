@@ -48,7 +48,9 @@
 #include "MeshManager.h"
 #include "MeshExportSettings.h"
 #include "SegmentationStatistics.h"
+#include "SegmentationComparison.h"
 #include "RLEImageRegionIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
 #include "RLERegionOfInterestImageFilter.h"
 #include "itkPasteImageFilter.h"
 #include "itkIdentityTransform.h"
@@ -86,6 +88,7 @@
 #include "ImageAnnotationData.h"
 #include "SegmentationUpdateIterator.h"
 #include "AffineTransformHelper.h"
+#include "NativeImagePrefetcher.h"
 
 #include <stdio.h>
 #include <sstream>
@@ -98,6 +101,9 @@ IRISApplication
   m_SystemInterface = new SystemInterface();
   m_HistoryManager = m_SystemInterface->GetHistoryManager();
 
+  // Label statistics for export
+  m_SegmentationStatistics = new SegmentationStatistics();
+
   // Create a color map preset manager
   m_ColorMapPresetManager = ColorMapPresetManager::New();
   m_ColorMapPresetManager->Initialize(m_SystemInterface);
@@ -189,6 +195,7 @@ IRISApplication
 ::~IRISApplication() 
 {
   delete m_SystemInterface;
+  delete m_SegmentationStatistics;
 }
 
 void 
@@ -201,14 +208,32 @@ IRISApplication
   // Create the SNAP image data object
   m_SNAPImageData->InitializeToROI(m_IRISImageData, roi, progressCommand);
   
-  // Override the interpolator in ROI for label interpolation, or we will get
-  // nonsense
-  SNAPSegmentationROISettings roiLabel = roi;
-  roiLabel.SetInterpolationMethod(NEAREST_NEIGHBOR);
+  // Get chunk of the label image. Only the selected segmentation layer gets
+  // sent to SNAP. The labels are interpolated separately, so the interpolation
+  // method of the ROI gives smooth boundaries without mixing labels
+  unsigned int nCopied = this->ExtractSNAPSegmentation(
+        this->GetSelectedSegmentationLayer(), roi, progressCommand);
 
-  // Get chunk of the label image. Only the selected segmentation layer gets sent to SNAP
-  LabelImageWrapper *seg = this->GetSelectedSegmentationLayer();
-  LabelImageType::Pointer imgNewLabel = seg->DeepCopyRegion(roiLabel,progressCommand);
+  // Record whether the segmentation has any values that are not zero
+  m_GlobalState->SetSnakeInitializedWithManualSegmentation(nCopied > 0);
+
+  // Initialize the speed image of the SNAP image data
+  m_SNAPImageData->InitializeSpeed();
+
+  // Remember the ROI object
+  m_GlobalState->SetSegmentationROISettings(roi);
+
+  // Indicate that the speed image is invalid
+  m_GlobalState->SetSpeedValid(false);
+}
+
+unsigned int
+IRISApplication
+::ExtractSNAPSegmentation(LabelImageWrapper *seg,
+                          const SNAPSegmentationROISettings &roi,
+                          CommandType *progressCommand)
+{
+  LabelImageType::Pointer imgNewLabel = seg->DeepCopyRegion(roi,progressCommand);
 
   // Filter the segmentation image to only allow voxels of 0 intensity and 
   // of the current drawing color
@@ -226,9 +251,6 @@ IRISApplication
     ++itLabel;
     }
 
-  // Record whether the segmentation has any values that are not zero
-  m_GlobalState->SetSnakeInitializedWithManualSegmentation(nCopied > 0);
-
   // Pass the cleaned up segmentation image to SNAP
   m_SNAPImageData->SetSingleSegmentationImage(imgNewLabel);
 
@@ -236,14 +258,66 @@ IRISApplication
   m_SNAPImageData->SetColorLabel(
     m_ColorLabelTable->GetColorLabel(passThroughLabel));
 
-  // Initialize the speed image of the SNAP image data
-  m_SNAPImageData->InitializeSpeed();
+  return nCopied;
+}
 
-  // Remember the ROI object
-  m_GlobalState->SetSegmentationROISettings(roi);
+IRISApplication::RegionType
+IRISApplication
+::ComputeAutomaticSegmentationROI(unsigned int minMargin, double relMargin)
+{
+  assert(m_IRISImageData->IsMainLoaded());
 
-  // Indicate that the speed image is invalid
-  m_GlobalState->SetSpeedValid(false);
+  // Start with the cursor position, which is where the user is looking
+  Vector3ui cursor = this->GetCursorPosition();
+  long lower[3], upper[3];
+  for(unsigned int d = 0; d < 3; d++)
+    lower[d] = upper[d] = cursor[d];
+
+  // Scan the runs of the selected segmentation for the drawing label. The
+  // clear label is skipped, since it would cover the whole image
+  LabelImageWrapper *seg = this->GetSelectedSegmentationLayer();
+  LabelType label = m_GlobalState->GetDrawingColorLabel();
+  if(seg && label != 0)
+    {
+    LabelImageType *img = seg->GetImage();
+    long xStart = img->GetBufferedRegion().GetIndex(0);
+
+    // The buffer of the RLE image is indexed by the y and z coordinates
+    typedef itk::ImageRegionConstIteratorWithIndex<LabelImageType::BufferType> RLLineIter;
+    RLLineIter rlit(img->GetBuffer(), img->GetBuffer()->GetBufferedRegion());
+    for(; !rlit.IsAtEnd(); ++rlit)
+      {
+      const LabelImageType::RLLine &line = rlit.Value();
+      long x = xStart;
+      for(unsigned int i = 0; i < line.size(); i++)
+        {
+        if(line[i].second == label)
+          {
+          lower[0] = std::min(lower[0], x);
+          upper[0] = std::max(upper[0], x + (long) line[i].first - 1);
+          for(unsigned int d = 1; d < 3; d++)
+            {
+            lower[d] = std::min(lower[d], (long) rlit.GetIndex()[d-1]);
+            upper[d] = std::max(upper[d], (long) rlit.GetIndex()[d-1]);
+            }
+          }
+        x += line[i].first;
+        }
+      }
+    }
+
+  // Pad the bounding box and crop it to the image
+  RegionType roi;
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    long extent = upper[d] - lower[d] + 1;
+    long margin = std::max((long) minMargin, (long) ceil(relMargin * extent));
+    roi.SetIndex(d, lower[d] - margin);
+    roi.SetSize(d, extent + 2 * margin);
+    }
+
+  roi.Crop(m_IRISImageData->GetImageRegion());
+  return roi;
 }
 
 void 
@@ -514,6 +588,9 @@ IRISApplication
   // Update filenames
   seg_wrapper->SetFileName(io->GetFileNameOfNativeImage());
 
+  // Replay edits that were not saved before a crash, and start journaling
+  seg_wrapper->AttachJournal(io->GetFileNameOfNativeImage());
+
   // Load the metadata for this layer
   LoadMetaDataAssociatedWithLayer(seg_wrapper, LABEL_ROLE, metadata);
 
@@ -1030,8 +1107,8 @@ void
 IRISApplication
 ::ExportSegmentationStatistics(const char *file)
 {
-  SegmentationStatistics stats;
-  stats.Compute(this);
+  // Only the voxels edited since the last export are visited
+  m_SegmentationStatistics->Update(this);
 
   // Open the selected file for writing
   std::ofstream fout(file);
@@ -1042,7 +1119,7 @@ IRISApplication
                                "File can not be opened for writing");
   try 
     {
-    stats.ExportLegacy(fout, *m_ColorLabelTable);
+    m_SegmentationStatistics->ExportLegacy(fout, *m_ColorLabelTable);
     }
   catch(...)
     {
@@ -1055,6 +1132,37 @@ IRISApplication
 
 
 
+void
+IRISApplication
+::ExportSegmentationComparison(const char *file)
+{
+  LabelImageWrapper *seg = this->GetSelectedSegmentationLayer();
+  std::string colsep =
+      itksys::SystemTools::GetFilenameLastExtension(file) == ".csv" ? "," : "\t";
+
+  // Open the selected file for writing
+  std::ofstream fout(file);
+  if(!fout.good())
+    throw IRISException("File %s can not be opened for writing", file);
+
+  // Compare with each of the other segmentation layers
+  bool header = true;
+  for(LayerIterator it = m_CurrentImageData->GetLayers(LABEL_ROLE); !it.IsAtEnd(); ++it)
+    {
+    LabelImageWrapper *other = dynamic_cast<LabelImageWrapper *>(it.GetLayer());
+    if(!other || other == seg)
+      continue;
+
+    SegmentationComparison comparison;
+    comparison.Compute(seg, other);
+    comparison.Export(fout, colsep, *m_ColorLabelTable, header);
+    header = false;
+    }
+
+  if(header)
+    throw IRISException("There are no other segmentation layers to compare with");
+}
+
 void
 IRISApplication
 ::ExportSegmentationMesh(const MeshExportSettings &sets, itk::Command *progress) 
@@ -1170,26 +1278,25 @@ IRISApplication
 ::ReplaceLabel(LabelType drawing, LabelType drawover)
 {
   // Get the label image
-  LabelImageWrapper::ImageType *imgLabel = this->GetSelectedSegmentationLayer()->GetImage();
+  LabelImageWrapper *seg = this->GetSelectedSegmentationLayer();
+  LabelImageWrapper::ImageType *imgLabel = seg->GetImage();
 
-  // Get the number of voxels
-  size_t nvoxels = 0;
+  // Update the segmentation through the undo system, so that the change is
+  // logged and mirrored into the crash recovery journal
+  SegmentationUpdateIterator it(
+        imgLabel, imgLabel->GetBufferedRegion(),
+        drawing, DrawOverFilter(PAINT_OVER_ONE, drawover));
+  for(; !it.IsAtEnd(); ++it)
+    it.ReplaceLabel(drawover, drawing);
 
-  // Update the segmentation
-  typedef itk::ImageRegionIterator<
-    LabelImageWrapper::ImageType> IteratorType;
-  for(IteratorType it(imgLabel, imgLabel->GetBufferedRegion());  
-    !it.IsAtEnd(); ++it)
-    {
-    if(it.Get() == drawover)
-      {
-      it.Set(drawing);
-      ++nvoxels;
-      }
-    }
+  // Finalize
+  it.Finalize();
 
-  // Register that the image has been updated
-  imgLabel->Modified();
+  // Store the undo point if needed. The caller may still clear the undo
+  // points, since label metadata changes can not be undone
+  size_t nvoxels = it.GetNumberOfChangedVoxels();
+  if(nvoxels > 0)
+    seg->StoreUndoPoint("Replace label", it.RelinquishDelta());
 
   return nvoxels;
 }
@@ -1832,6 +1939,7 @@ IRISApplication
   del->UnloadCurrentImage();
 
   // Read the image body
+  del->ConfigureImageIO(io);
   io->ReadNativeImageData();
 
   // Validate the image data
@@ -1847,6 +1955,29 @@ IRISApplication
   return layer;
 }
 
+ImageWrapperBase *
+IRISApplication
+::LoadImageViaDelegate(GuidedNativeImageIO *io,
+                       AbstractLoadImageDelegate *del,
+                       IRISWarningList &wl)
+{
+  assert(io->IsNativeImageLoaded());
+
+  // Same sequence as above, except that the header and the data have
+  // already been read, possibly on another thread
+  del->ValidateHeader(io, wl);
+  del->UnloadCurrentImage();
+  del->ValidateImage(io, wl);
+
+  // Put the image in the right place
+  ImageWrapperBase *layer = del->UpdateApplicationWithImage(io);
+
+  // Store the IO hints inside of the image
+  layer->SetIOHints(io->GetHints());
+
+  return layer;
+}
+
 IRISApplication::DicomSeriesTree
 IRISApplication::ListAvailableSiblingDicomSeries()
 {
@@ -1962,9 +2093,9 @@ void IRISApplication
     }
 }
 
-void IRISApplication
-::LoadImage(const char *fname, LayerRole role, IRISWarningList &wl,
-            Registry *meta_data_reg, Registry *io_hints_reg, bool additive)
+SmartPtr<AbstractLoadImageDelegate>
+IRISApplication
+::CreateLoadDelegateForRole(LayerRole role, Registry *meta_data_reg, bool additive)
 {
   // Pointer to the delegate
   SmartPtr<AbstractLoadImageDelegate> delegate;
@@ -1992,6 +2123,17 @@ void IRISApplication
   if(meta_data_reg)
     delegate->SetMetaDataRegistry(meta_data_reg);
 
+  return delegate;
+}
+
+void IRISApplication
+::LoadImage(const char *fname, LayerRole role, IRISWarningList &wl,
+            Registry *meta_data_reg, Registry *io_hints_reg, bool additive)
+{
+  // Create the delegate for this role
+  SmartPtr<AbstractLoadImageDelegate> delegate =
+      CreateLoadDelegateForRole(role, meta_data_reg, additive);
+
   // Load via delegate, providing the IO hints
   this->LoadImageViaDelegate(fname, delegate, wl, io_hints_reg);
 }
@@ -2168,10 +2310,22 @@ void IRISApplication::OpenProject(
   // If the locations are different, we will attempt to find relative paths first
   bool moved = (project_save_dir != project_dir);
 
-  // Read all the layers
+  // Information about each layer gathered in the first pass
+  struct ProjectLayerInfo
+  {
+    SmartPtr<AbstractLoadImageDelegate> delegate;
+    unsigned int prefetch_index;
+    LayerRole role;
+  };
+  std::vector<ProjectLayerInfo> layers;
+
+  // Layers are read from disk in the background, in parallel, and installed
+  // into the application in project order below
+  SmartPtr<NativeImagePrefetcher> prefetcher = NativeImagePrefetcher::New();
+
+  // First pass: validate the layers and resolve their filenames
   std::string key;
-  bool main_loaded = false;
-  int n_segs_loaded = 0;
+  int n_segs_found = 0;
   for(int i = 0;
       preg.HasFolder(key = Registry::Key("Layers.Layer[%03d]", i));
       i++)
@@ -2226,30 +2380,76 @@ void IRISApplication::OpenProject(
         layer_file_full = moved_file_full;
       }
 
+    // Fail before the current workspace is unloaded if a layer is missing
+    if(!itksys::SystemTools::FileExists(layer_file_full.c_str()))
+      throw IRISException("Layer %d in the project can not be found at %s",
+                          i, layer_file_full.c_str());
+
     // Load the IO hints for the image from the project - but only if this
     // folder is actually present (otherwise some projects from before 2016
-    // will not load hints)
-    Registry *io_hints = NULL;
+    // will not load hints). Otherwise use the association system, as is
+    // done by LoadImageViaDelegate
+    Registry io_hints;
     if(folder.HasFolder("IOHints"))
-      io_hints = &folder.Folder("IOHints");
-
-    // TODO: this is spaggetti code
-    bool load_additive = false;
-    if(role == LABEL_ROLE && n_segs_loaded > 0)
-      load_additive = true;
-
-    // Load the image and its metadata
-    LoadImage(layer_file_full.c_str(), role, warn, &folder, io_hints, load_additive);
-
-    // Check if the main has been loaded
-    if(role == MAIN_ROLE)
       {
-      main_loaded = true;      
+      io_hints = folder.Folder("IOHints");
       }
-    else if(role == LABEL_ROLE)
+    else
       {
-      n_segs_loaded++;
+      Registry regAssoc;
+      m_SystemInterface->FindRegistryAssociatedWithFile(layer_file_full.c_str(), regAssoc);
+      io_hints = regAssoc.Folder("Files.Grey");
       }
+
+    // Create the delegate for this layer. It configures the IO object in the
+    // same way as when the image is loaded by itself (e.g., for sharing the
+    // image with other sessions), since the prefetcher reads the image data
+    // before the delegate gets to see it
+    ProjectLayerInfo info;
+    info.role = role;
+    info.delegate = CreateLoadDelegateForRole(
+          role, &folder, role == LABEL_ROLE && n_segs_found > 0);
+
+    SmartPtr<GuidedNativeImageIO> io = GuidedNativeImageIO::New();
+    info.delegate->ConfigureImageIO(io);
+    info.prefetch_index = prefetcher->AddImage(layer_file_full, io_hints, io);
+    layers.push_back(info);
+
+    if(role == LABEL_ROLE)
+      n_segs_found++;
+    }
+
+  // Layer 0 has been checked to be the main image, so an empty list is the
+  // only way for the main image to be missing
+  if(layers.empty())
+    throw IRISException("Empty or invalid project (main image not found in the project file).");
+
+  // Start reading the images
+  prefetcher->Start();
+
+  // Wait for the main image to be read before unloading the current
+  // workspace, so that if the main image can not be read, the session is
+  // left intact. This is also when the old workspace was unloaded with
+  // serial loading, although the read-ahead may now hold more layers
+  SmartPtr<GuidedNativeImageIO> main_io =
+      prefetcher->TakeImage(layers[0].prefetch_index);
+  this->UnloadMainImage();
+
+  // Second pass: install the layers in project order on this thread. If an
+  // exception is thrown here, the prefetcher stops its workers on destruction
+  bool main_loaded = false;
+  for(unsigned int i = 0; i < layers.size(); i++)
+    {
+    // Wait for the image to be read
+    SmartPtr<GuidedNativeImageIO> io = (i == 0)
+        ? main_io : prefetcher->TakeImage(layers[i].prefetch_index);
+
+    // Load the image and its metadata via the layer's delegate
+    this->LoadImageViaDelegate(io, layers[i].delegate, warn);
+
+    // Check if the main has been loaded
+    if(layers[i].role == MAIN_ROLE)
+      main_loaded = true;
     }
 
   // If main has not been loaded, throw an exception
@@ -2309,18 +2509,45 @@ bool IRISApplication::IsProjectFile(const char *filename)
 
 void IRISApplication::SaveAnnotations(const char *filename)
 {
-  Registry reg;
-  m_CurrentImageData->GetAnnotations()->SaveAnnotations(reg);
-  reg.WriteToXMLFile(filename);
+  ImageAnnotationData *annot = m_CurrentImageData->GetAnnotations();
+  if(ImageAnnotationData::IsTableFileName(filename))
+    {
+    // Large annotation sets are better stored as a table
+    std::ofstream fout(filename);
+    if(!fout.good())
+      throw IRISException("Can not open file %s for writing", filename);
+
+    std::string ext = itksys::SystemTools::GetFilenameLastExtension(filename);
+    annot->SaveAnnotationsAsTable(fout, itksys::SystemTools::LowerCase(ext) == ".tsv" ? '\t' : ',');
+    if(!fout.good())
+      throw IRISException("Failed to write annotations to file %s", filename);
+    }
+  else
+    {
+    Registry reg;
+    annot->SaveAnnotations(reg);
+    reg.WriteToXMLFile(filename);
+    }
 
   m_SystemInterface->GetHistoryManager()->UpdateHistory("Annotations", filename, true);
 }
 
 void IRISApplication::LoadAnnotations(const char *filename)
 {
-  Registry reg;
-  reg.ReadFromXMLFile(filename);
-  m_CurrentImageData->GetAnnotations()->LoadAnnotations(reg);
+  ImageAnnotationData *annot = m_CurrentImageData->GetAnnotations();
+  if(ImageAnnotationData::IsTableFileName(filename))
+    {
+    std::ifstream fin(filename);
+    if(!fin.good())
+      throw IRISException("Can not open file %s for reading", filename);
+    annot->LoadAnnotationsFromTable(fin);
+    }
+  else
+    {
+    Registry reg;
+    reg.ReadFromXMLFile(filename);
+    annot->LoadAnnotations(reg);
+    }
 
   m_SystemInterface->GetHistoryManager()->UpdateHistory("Annotations", filename, true);
 }
@@ -2756,6 +2983,116 @@ IRISApplication
     }
 }
 
+bool
+IRISApplication
+::GrowSegmentationROI(unsigned int distance, unsigned int minGrowth,
+                      double relGrowth, CommandType *progressCommand)
+{
+  assert(IsSnakeModeActive() && m_SNAPImageData->IsSegmentationActive());
+
+  // The speed image is recomputed in the new region with the last used
+  // preprocessing mode. An external advection field can not be recomputed
+  PreprocessingMode mode = m_GlobalState->GetLastUsedPreprocessingMode();
+  if(!this->GetPreprocessingFilterPreviewer(mode)
+     || m_SNAPImageData->HasExternalAdvectionField())
+    return false;
+
+  // Find the faces of the region that the contour has reached
+  unsigned int faces = m_SNAPImageData->GetLevelSetBoundaryFacesReached(distance);
+  if(!faces)
+    return false;
+
+  // Push these faces outwards, as far as the image goes
+  SNAPSegmentationROISettings roiOld = m_GlobalState->GetSegmentationROISettings();
+  RegionType region = roiOld.GetROI();
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    long growth = std::max((long) minGrowth, (long) ceil(relGrowth * region.GetSize(d)));
+    if(faces & (1u << (2 * d)))
+      {
+      region.SetIndex(d, region.GetIndex(d) - growth);
+      region.SetSize(d, region.GetSize(d) + growth);
+      }
+    if(faces & (1u << (2 * d + 1)))
+      region.SetSize(d, region.GetSize(d) + growth);
+    }
+
+  region.Crop(m_IRISImageData->GetImageRegion());
+  if(region == roiOld.GetROI())
+    return false;
+
+  // The new ROI keeps the voxel size of the old one
+  SNAPSegmentationROISettings roi = roiOld;
+  roi.SetROI(region);
+  if(roiOld.IsResampling())
+    {
+    Vector3ui dims = roiOld.GetResampleDimensions();
+    for(unsigned int d = 0; d < 3; d++)
+      dims[d] = std::max(1u, (unsigned int) floor(
+                           0.5 + dims[d] * region.GetSize(d)
+                           / (double) roiOld.GetROI().GetSize(d)));
+    roi.SetResampleDimensions(dims);
+    }
+
+  // Remember where the cursor and the bubbles are, since their voxel
+  // coordinates change with the region
+  ImageWrapperBase *main = m_SNAPImageData->GetMain();
+  Vector3d xyzCursor =
+      main->TransformVoxelCIndexToNIFTICoordinates(to_double(this->GetCursorPosition()));
+
+  std::vector<Vector3d> xyzBubbles;
+  for(unsigned int i = 0; i < m_BubbleArray.size(); i++)
+    xyzBubbles.push_back(
+          main->TransformVoxelCIndexToNIFTICoordinates(to_double(m_BubbleArray[i].center)));
+
+  // Extract the images and the segmentation in the new region. The
+  // segmentation comes from the IRIS layer that SNAP mode was entered with
+  this->EnterPreprocessingMode(PREPROCESS_NONE);
+  m_SNAPImageData->UnloadOverlays();
+  m_SNAPImageData->InitializeToROI(m_IRISImageData, roi, progressCommand);
+
+  LabelImageWrapper *iris_seg = dynamic_cast<LabelImageWrapper *>(
+                                  m_IRISImageData->FindLayer(
+                                    m_SavedIRISSelectedSegmentationLayerId, false));
+  this->ExtractSNAPSegmentation(iris_seg, roi, progressCommand);
+
+  m_SNAPImageData->InitializeSpeed();
+  m_GlobalState->SetSegmentationROISettings(roi);
+
+  // Recompute the speed image
+  this->EnterPreprocessingMode(mode);
+  this->ApplyCurrentPreprocessingModeToSpeedVolume(progressCommand);
+  this->EnterPreprocessingMode(PREPROCESS_NONE);
+
+  // Carry the contour over into the new region
+  m_SNAPImageData->ResampleSegmentationToSpeed();
+
+  // Map the bubbles and the cursor into the new region
+  main = m_SNAPImageData->GetMain();
+  for(unsigned int i = 0; i < m_BubbleArray.size(); i++)
+    m_BubbleArray[i].center = to_int(
+          main->TransformNIFTICoordinatesToVoxelCIndex(xyzBubbles[i]) + Vector3d(0.5));
+
+  itk::Index<3> idxCursor = to_itkIndex(
+        main->TransformNIFTICoordinatesToVoxelCIndex(xyzCursor) + Vector3d(0.5));
+  Vector3ui newCursor =
+      main->GetBufferedRegion().IsInside(idxCursor)
+      ? Vector3ui(idxCursor)
+      : main->GetSize() / 2u;
+
+  m_GlobalState->SetCrosshairsPosition(newCursor);
+  m_SNAPImageData->SetCrosshairs(newCursor);
+  InvokeEvent(CursorUpdateEvent());
+
+  // The main image and the segmentation layer have been replaced
+  m_GlobalState->SetSelectedLayerId(main->GetUniqueId());
+  m_GlobalState->SetSelectedSegmentationLayerId(
+        m_SNAPImageData->GetFirstSegmentationLayer()->GetUniqueId());
+  InvokeEvent(MainImageDimensionsChangeEvent());
+
+  return true;
+}
+
 IRISApplication::BubbleArray&
 IRISApplication::GetBubbleArray()
 {
@@ -71,6 +71,7 @@ struct IRISDisplayGeometry;
 class LabelUseHistory;
 class ImageAnnotationData;
 class LabelImageWrapper;
+class SegmentationStatistics;
 
 template <class TPixel, class TLabel, int VDim> class RandomForestClassifier;
 template <class TPixel, class TLabel, int VDim> class RFClassificationEngine;
@@ -216,6 +217,16 @@ public:
                                          IRISWarningList &wl,
                                          Registry *ioHints = NULL);
 
+  /**
+   * Update the application with an image that has already been read from disk,
+   * using a delegate object. This performs the validation and installation
+   * steps of the method above, but does not touch the file system. The IO
+   * hints stored in the layer are the ones that were used to read the image.
+   */
+  ImageWrapperBase* LoadImageViaDelegate(GuidedNativeImageIO *io,
+                                         AbstractLoadImageDelegate *del,
+                                         IRISWarningList &wl);
+
   /**
    * List available additional DICOM series that can be loaded given the currently
    * loaded DICOM images. This creates a listing of 'sibling' DICOM series Ids,
@@ -369,6 +380,17 @@ public:
   void InitializeSNAPImageData(const SNAPSegmentationROISettings &roi,
                                CommandType *progressCommand = NULL);
 
+  /**
+   * Compute a region of interest for the active contour that encloses all the
+   * voxels of the current drawing label in the selected segmentation, as well
+   * as the cursor position. The region is padded on each side by the larger
+   * of minMargin voxels and relMargin times its extent, and cropped to the
+   * image. The label is found by scanning the run-length encoded lines of the
+   * segmentation, so this is fast even for large images.
+   */
+  RegionType ComputeAutomaticSegmentationROI(
+      unsigned int minMargin, double relMargin);
+
   /**
     Enter given preprocessing mode. This activates the pipeline that can be
     used to provide automatic on-the-fly preview of the preprocessing result
@@ -408,6 +430,19 @@ public:
     */
   bool InitializeActiveContourPipeline();
 
+  /**
+   * Enlarge the region of interest of the active contour once the contour
+   * comes within distance voxels of its edge. Each face that the contour has
+   * reached is moved out by the larger of minGrowth voxels and relGrowth times
+   * the size of the region, as far as the image goes. The images are extracted
+   * from the new region, the speed image is recomputed with the last used
+   * preprocessing mode, and the evolution continues from the current contour.
+   * Returns false if the region did not change, or if the speed image or the
+   * external advection field can not be recomputed in a new region.
+   */
+  bool GrowSegmentationROI(unsigned int distance, unsigned int minGrowth,
+                           double relGrowth, CommandType *progressCommand = NULL);
+
   /**
    * Update IRIS image data with the segmentation contained in the SNAP image
    * data.
@@ -485,6 +520,14 @@ public:
   /** Export voxel statistis to a file */
   void ExportSegmentationStatistics(const char *file);
 
+  /**
+   * Export overlap and surface distance metrics between the selected
+   * segmentation layer and each of the other segmentation layers to a file.
+   * The file is comma separated if it has the .csv extension, and tab
+   * separated otherwise.
+   */
+  void ExportSegmentationComparison(const char *file);
+
   /**
    * Export the 3D mesh to a file, using settings passed in the
    * MeshExportSettings structure.
@@ -658,6 +701,12 @@ protected:
   // Map cursor from one image data to another
   void TransferCursor(GenericImageData *source, GenericImageData *target);
 
+  // Copy the drawing label from a region of a segmentation layer into SNAP,
+  // returning the number of voxels with that label
+  unsigned int ExtractSNAPSegmentation(LabelImageWrapper *seg,
+                                       const SNAPSegmentationROISettings &roi,
+                                       CommandType *progressCommand);
+
   // Image data objects
   GenericImageData *m_CurrentImageData;
   SmartPtr<IRISImageData> m_IRISImageData;
@@ -679,6 +728,9 @@ protected:
   // History manager
   HistoryManager *m_HistoryManager;
 
+  // Label statistics, kept between exports and updated with the edits
+  SegmentationStatistics *m_SegmentationStatistics;
+
   // Coordinate mapping between display space and anatomical space
   IRISDisplayGeometry m_DisplayGeometry;
 
@@ -774,6 +826,11 @@ protected:
   // Internal method used by the project IO code
   void SaveProjectToRegistry(Registry &preg, const std::string proj_file_full);
 
+  // Create the default load delegate for a layer role (used by LoadImage and
+  // by the project IO code)
+  SmartPtr<AbstractLoadImageDelegate> CreateLoadDelegateForRole(
+      LayerRole role, Registry *meta_data_reg, bool additive);
+
   // Auto-adjust contrast of a layer on load
   void AutoContrastLayerOnLoad(ImageWrapperBase *layer);
 
@@ -1,6 +1,14 @@
 #include "ImageAnnotationData.h"
 #include "Registry.h"
 #include "IRISException.h"
+#include "CSVParser.h"
+#include <itksys/SystemTools.hxx>
+#include <map>
+#include <vector>
+#include <sstream>
+#include <iomanip>
+#include <locale>
+#include <cstdlib>
 
 namespace annot
 {
@@ -162,6 +170,11 @@ void ImageAnnotationData::AddAnnotation(ImageAnnotationData::AbstractAnnotation
   m_Annotations.push_back(myannot);
 }
 
+void ImageAnnotationData::AddAnnotations(AnnotationList &annots)
+{
+  m_Annotations.splice(m_Annotations.end(), annots);
+}
+
 void ImageAnnotationData::Reset()
 {
   m_Annotations.clear();
@@ -228,6 +241,234 @@ void ImageAnnotationData::LoadAnnotations(Registry &reg)
     }
 }
 
+// Columns of the annotation table, in the order in which they are written
+enum AnnotationTableColumn {
+  COL_TYPE = 0, COL_PLANE, COL_X, COL_Y, COL_Z, COL_X2, COL_Y2, COL_Z2,
+  COL_OFFSET_X, COL_OFFSET_Y, COL_TEXT, COL_R, COL_G, COL_B,
+  COL_VIS_SLICES, COL_VIS_PLANES, COL_SELECTED, COL_TAGS, COL_COUNT };
+
+static const char *AnnotationTableColumnNames[COL_COUNT] = {
+  "Type", "Plane", "X", "Y", "Z", "X2", "Y2", "Z2", "OffsetX", "OffsetY", "Text",
+  "R", "G", "B", "VisibleInAllSlices", "VisibleInAllPlanes", "Selected", "Tags" };
+
+// Helpers for reading the fields of a row, where col maps columns to fields
+static bool TableHasField(const std::vector<std::string> &f, const int *col, int c)
+{
+  return col[c] >= 0 && col[c] < (int) f.size() && !f[col[c]].empty();
+}
+
+// Numbers are always read and written in the "C" locale, so that tables can
+// be exchanged between systems that use different decimal separators
+static double TableGetNumber(const std::vector<std::string> &f, const int *col, int c, double def)
+{
+  if(!TableHasField(f, col, c))
+    return def;
+
+  std::istringstream iss(f[col[c]]);
+  iss.imbue(std::locale::classic());
+  double value = def;
+  iss >> value;
+  return iss.fail() ? def : value;
+}
+
+void ImageAnnotationData::SaveAnnotationsAsTable(std::ostream &os, char delimiter) const
+{
+  os << "# ITK-SNAP Annotation Table" << std::endl;
+  for(int j = 0; j < COL_COUNT; j++)
+    os << (j > 0 ? std::string(1, delimiter) : std::string()) << AnnotationTableColumnNames[j];
+  os << std::endl;
+
+  // Full precision, so that the coordinates survive the round trip exactly
+  std::ostringstream row;
+  row.imbue(std::locale::classic());
+  row << std::setprecision(17);
+  const std::string d(1, delimiter);
+
+  for(AnnotationConstIterator it = m_Annotations.begin(); it != m_Annotations.end(); ++it)
+    {
+    AbstractAnnotation *ann = *it;
+    row.str(std::string());
+
+    Vector3d p1(0.0), p2(0.0);
+    Vector2d offset(0.0);
+    std::string text, type;
+    if(annot::LineSegmentAnnotation *lsa = dynamic_cast<annot::LineSegmentAnnotation *>(ann))
+      {
+      type = "LineSegment";
+      p1 = lsa->GetSegment().first;
+      p2 = lsa->GetSegment().second;
+      }
+    else if(annot::LandmarkAnnotation *lma = dynamic_cast<annot::LandmarkAnnotation *>(ann))
+      {
+      type = "Landmark";
+      p1 = lma->GetLandmark().Pos;
+      offset = lma->GetLandmark().Offset;
+      text = lma->GetLandmark().Text;
+      }
+    else continue;
+
+    // Tags are stored in a single field, separated by semicolons
+    std::string tags;
+    const TagList &tl = ann->GetTags();
+    for(TagList::const_iterator tit = tl.begin(); tit != tl.end(); ++tit)
+      tags += (tit == tl.begin() ? "" : ";") + CSVParser::QuoteField(*tit, ';');
+
+    const Vector3d &color = ann->GetColor();
+    row << type << d << ann->GetPlane() << d
+        << p1[0] << d << p1[1] << d << p1[2] << d;
+    if(type == "LineSegment")
+      row << p2[0] << d << p2[1] << d << p2[2] << d << d << d;
+    else
+      row << d << d << d << offset[0] << d << offset[1] << d;
+
+    row << CSVParser::QuoteField(text, delimiter) << d
+        << color[0] << d << color[1] << d << color[2] << d
+        << (ann->GetVisibleInAllSlices() ? 1 : 0) << d
+        << (ann->GetVisibleInAllPlanes() ? 1 : 0) << d
+        << (ann->GetSelected() ? 1 : 0) << d
+        << CSVParser::QuoteField(tags, delimiter);
+
+    os << row.str() << '\n';
+    }
+
+  os.flush();
+}
+
+void ImageAnnotationData::LoadAnnotationsFromTable(std::istream &is, bool append)
+{
+  std::string line;
+  std::vector<std::string> fields;
+
+  // Find the header row, skipping comments
+  bool have_header = false;
+  while(!have_header && std::getline(is, line))
+    have_header = !line.empty() && line[0] != '#' && line != "\r";
+
+  if(!have_header)
+    throw IRISException("Annotation table is empty.");
+
+  // Detect the delimiter from the header
+  char delimiter = (line.find('\t') != std::string::npos) ? '\t' : ',';
+  CSVParser::ParseLine(line, fields, delimiter);
+
+  // Map column names to positions
+  std::map<std::string, int> cmap;
+  for(unsigned int j = 0; j < fields.size(); j++)
+    cmap[itksys::SystemTools::TrimWhitespace(fields[j])] = j;
+
+  int col[COL_COUNT];
+  for(int j = 0; j < COL_COUNT; j++)
+    {
+    std::map<std::string, int>::const_iterator it = cmap.find(AnnotationTableColumnNames[j]);
+    col[j] = (it == cmap.end()) ? -1 : it->second;
+    }
+
+  if(col[COL_X] < 0 || col[COL_Y] < 0 || col[COL_Z] < 0)
+    throw IRISException("Annotation table must have X, Y and Z columns.");
+
+  // Read the annotations into a separate list, so that a failure leaves the
+  // current annotations intact
+  AnnotationList loaded;
+  unsigned int line_no = 1;
+  while(std::getline(is, line))
+    {
+    line_no++;
+    if(line.empty() || line[0] == '#' || line == "\r")
+      continue;
+
+    // Quoted fields may span multiple lines
+    while(!CSVParser::ParseLine(line, fields, delimiter))
+      {
+      std::string next;
+      if(!std::getline(is, next))
+        throw IRISException("Unterminated quoted field in annotation table at line %d.", line_no);
+      line += "\n" + next;
+      line_no++;
+      }
+
+    const std::vector<std::string> &f = fields;
+    std::string type = TableHasField(f, col, COL_TYPE) ? f[col[COL_TYPE]] : std::string("Landmark");
+    AnnotationPtr ann;
+    if(type == "LineSegment" || type == "LineSegmentAnnotation")
+      {
+      SmartPtr<annot::LineSegmentAnnotation> lsa = annot::LineSegmentAnnotation::New();
+      if(!TableHasField(f, col, COL_X2) || !TableHasField(f, col, COL_Y2)
+         || !TableHasField(f, col, COL_Z2))
+        throw IRISException("Line segment without second point in annotation table at line %d.", line_no);
+
+      annot::LineSegment seg;
+      seg.first = Vector3d(TableGetNumber(f, col, COL_X, 0),
+                           TableGetNumber(f, col, COL_Y, 0),
+                           TableGetNumber(f, col, COL_Z, 0));
+      seg.second = Vector3d(TableGetNumber(f, col, COL_X2, 0),
+                            TableGetNumber(f, col, COL_Y2, 0),
+                            TableGetNumber(f, col, COL_Z2, 0));
+      lsa->SetSegment(seg);
+      ann = lsa.GetPointer();
+      }
+    else if(type == "Landmark" || type == "LandmarkAnnotation")
+      {
+      SmartPtr<annot::LandmarkAnnotation> lma = annot::LandmarkAnnotation::New();
+      annot::Landmark lm;
+      lm.Pos = Vector3d(TableGetNumber(f, col, COL_X, 0),
+                        TableGetNumber(f, col, COL_Y, 0),
+                        TableGetNumber(f, col, COL_Z, 0));
+      lm.Offset = Vector2d(TableGetNumber(f, col, COL_OFFSET_X, 0),
+                           TableGetNumber(f, col, COL_OFFSET_Y, 0));
+      lm.Text = (col[COL_TEXT] >= 0 && col[COL_TEXT] < (int) f.size())
+                ? f[col[COL_TEXT]] : std::string("??? Landmark");
+      lma->SetLandmark(lm);
+      ann = lma.GetPointer();
+      }
+    else
+      {
+      throw IRISException("Unknown annotation type '%s' in annotation table at line %d.",
+                          type.c_str(), line_no);
+      }
+
+    // Same defaults as in AbstractAnnotation::Load
+    ann->SetPlane((int) TableGetNumber(f, col, COL_PLANE, 0));
+    ann->SetColor(Vector3d(TableGetNumber(f, col, COL_R, 1.0),
+                           TableGetNumber(f, col, COL_G, 0.0),
+                           TableGetNumber(f, col, COL_B, 0.0)));
+    ann->SetVisibleInAllSlices(TableGetNumber(f, col, COL_VIS_SLICES, 0) != 0);
+    ann->SetVisibleInAllPlanes(TableGetNumber(f, col, COL_VIS_PLANES, 0) != 0);
+    ann->SetSelected(TableGetNumber(f, col, COL_SELECTED, 0) != 0);
+
+    TagList tags;
+    if(TableHasField(f, col, COL_TAGS))
+      {
+      std::vector<std::string> tv;
+      CSVParser::ParseLine(f[col[COL_TAGS]], tv, ';');
+      for(unsigned int k = 0; k < tv.size(); k++)
+        if(!tv[k].empty())
+          tags.push_back(tv[k]);
+      }
+    ann->SetTags(tags);
+
+    // Line segments must lie in their plane, as in LineSegmentAnnotation::Load
+    if(annot::LineSegmentAnnotation *lsa = dynamic_cast<annot::LineSegmentAnnotation *>(ann.GetPointer()))
+      {
+      int plane = ann->GetPlane();
+      if(plane < 0 || plane > 2 || lsa->GetSegment().first[plane] != lsa->GetSegment().second[plane])
+        throw IRISException("Invalid line segment annotation in annotation table at line %d.", line_no);
+      }
+
+    loaded.push_back(ann);
+    }
+
+  if(!append)
+    m_Annotations.clear();
+  this->AddAnnotations(loaded);
+}
+
+bool ImageAnnotationData::IsTableFileName(const std::string &filename)
+{
+  std::string ext = itksys::SystemTools::LowerCase(
+        itksys::SystemTools::GetFilenameLastExtension(filename));
+  return ext == ".csv" || ext == ".tsv";
+}
+
 template<class TAnnotPtr>
 ImageAnnotationIterator<TAnnotPtr>
 ::ImageAnnotationIterator(const ImageAnnotationData *data)
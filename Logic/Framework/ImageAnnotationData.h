@@ -5,6 +5,7 @@
 #include <utility>
 #include <string>
 #include <list>
+#include <iostream>
 #include "itkDataObject.h"
 #include "itkObjectFactory.h"
 #include "TagList.h"
@@ -202,11 +203,35 @@ public:
 
   void AddAnnotation(AbstractAnnotation *annot);
 
+  /** Add a list of annotations at once. The list is emptied */
+  void AddAnnotations(AnnotationList &annots);
+
   void Reset();
 
   void SaveAnnotations(Registry &reg);
   void LoadAnnotations(Registry &reg);
 
+  /**
+   * Write the annotations as a table of delimited text (CSV or TSV), with a
+   * header row of column names followed by one row per annotation. This is
+   * much more compact and faster to read than the registry format.
+   */
+  void SaveAnnotationsAsTable(std::ostream &os, char delimiter = ',') const;
+
+  /**
+   * Read annotations from a table of delimited text. The delimiter (comma or
+   * tab) is detected from the header row. Columns are identified by their
+   * names in the header and may come in any order. Only the coordinates are
+   * required (X, Y, Z, plus X2, Y2, Z2 for line segments), so that landmark
+   * lists produced by other software can be imported; the Type column
+   * defaults to Landmark. Lines starting with '#' are ignored. If append is
+   * false, the current annotations are removed.
+   */
+  void LoadAnnotationsFromTable(std::istream &is, bool append = false);
+
+  /** Check if a filename has an extension used for annotation tables */
+  static bool IsTableFileName(const std::string &filename);
+
 protected:
   ImageAnnotationData() {}
   ~ImageAnnotationData() {}
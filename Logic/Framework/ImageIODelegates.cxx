@@ -4,6 +4,7 @@
 #include "GenericImageData.h"
 #include "HistoryManager.h"
 #include "IRISImageData.h"
+#include "SegmentationJournal.h"
 
 
 /* =============================
@@ -29,6 +30,20 @@ void LoadAnatomicImageDelegate
     }
 }
 
+void LoadAnatomicImageDelegate::ConfigureImageIO(GuidedNativeImageIO *io)
+{
+  io->SetShareNativeImage(m_Driver->GetGlobalState()->GetShareImagesBetweenSessions());
+}
+
+void LoadAnatomicImageDelegate
+::RetainSharedImageData(GuidedNativeImageIO *io, ImageWrapperBase *layer)
+{
+  // The shared memory stays available to other sessions after the native
+  // image is discarded, until the layer is unloaded
+  if(io->GetSharedImageData())
+    layer->SetUserData("SharedImageData", io->GetSharedImageData());
+}
+
 
 /* =============================
    MAIN Image
@@ -46,7 +61,9 @@ ImageWrapperBase *LoadMainImageDelegate::UpdateApplicationWithImage(GuidedNative
   m_Driver->UpdateIRISMainImage(io, this->GetMetaDataRegistry());
 
   // Return the main image
-  return m_Driver->GetIRISImageData()->GetMain();
+  ImageWrapperBase *layer = m_Driver->GetIRISImageData()->GetMain();
+  this->RetainSharedImageData(io, layer);
+  return layer;
 }
 
 LoadMainImageDelegate::LoadMainImageDelegate()
@@ -74,7 +91,9 @@ ImageWrapperBase *LoadOverlayImageDelegate::UpdateApplicationWithImage(GuidedNat
   m_Driver->AddIRISOverlayImage(io, this->GetMetaDataRegistry());
 
   // Return it
-  return m_Driver->GetIRISImageData()->GetLastOverlay();
+  ImageWrapperBase *layer = m_Driver->GetIRISImageData()->GetLastOverlay();
+  this->RetainSharedImageData(io, layer);
+  return layer;
 }
 
 
@@ -204,6 +223,24 @@ LoadSegmentationImageDelegate
                    "ITK-SNAP will ignore the header in the image you are loading.",
                    object.c_str()));
     }
+
+  // Check if there are edits to this segmentation that were not saved because
+  // ITK-SNAP did not exit normally. These will be replayed when the image is
+  // loaded into the application.
+  if(!m_Driver->IsSnakeModeActive())
+    {
+    unsigned int n_rec = SegmentationJournal::GetNumberOfRecoverableRecords(
+          io->GetFileNameOfNativeImage(), io->GetDimensionsOfNativeImage());
+    if(n_rec > 0)
+      {
+      wl.push_back(IRISWarning(
+                     "Warning: Unsaved Edits Recovered. "
+                     "ITK-SNAP did not exit normally the last time this segmentation "
+                     "was edited. %d unsaved edits have been recovered from the edit "
+                     "journal and applied to the segmentation. Save the segmentation "
+                     "to keep them.", n_rec));
+      }
+    }
 }
 
 ImageWrapperBase *LoadSegmentationImageDelegate::UpdateApplicationWithImage(GuidedNativeImageIO *io)
@@ -43,6 +43,12 @@ public:
 
   irisGetSetMacro(DisplayName, const std::string &)
 
+  /**
+   * Configure the IO object before the image data are read, after the header
+   * has been validated
+   */
+  virtual void ConfigureImageIO(GuidedNativeImageIO *io) {}
+
   virtual void ValidateHeader(GuidedNativeImageIO *io, IRISWarningList &wl) {}
   virtual void ValidateImage(GuidedNativeImageIO *io, IRISWarningList &wl) {}
   virtual void UnloadCurrentImage() = 0;
@@ -80,9 +86,15 @@ public:
 
   virtual void ValidateHeader(GuidedNativeImageIO *io, IRISWarningList &wl) ITK_OVERRIDE;
 
+  /** Share the image with other sessions if this is enabled in GlobalState */
+  virtual void ConfigureImageIO(GuidedNativeImageIO *io) ITK_OVERRIDE;
+
 protected:
   LoadAnatomicImageDelegate() {}
   virtual ~LoadAnatomicImageDelegate() {}
+
+  // Keep the image shared with other sessions for the lifetime of the layer
+  void RetainSharedImageData(GuidedNativeImageIO *io, ImageWrapperBase *layer);
 };
 
 class LoadMainImageDelegate : public LoadAnatomicImageDelegate
@@ -0,0 +1,149 @@
+#include "NativeImagePrefetcher.h"
+#include "GuidedNativeImageIO.h"
+#include "IRISException.h"
+#include <algorithm>
+
+NativeImagePrefetcher::NativeImagePrefetcher()
+{
+  m_NextJob = 0;
+  m_NextTake = 0;
+  m_NumberOfThreads = 0;
+  m_MaximumReadAhead = 2;
+  m_Cancelled = false;
+}
+
+NativeImagePrefetcher::~NativeImagePrefetcher()
+{
+  this->Cancel();
+}
+
+unsigned int
+NativeImagePrefetcher::AddImage(const std::string &fname, const Registry &ioHints,
+                                GuidedNativeImageIO *io)
+{
+  assert(m_Workers.size() == 0);
+
+  Job job;
+  job.FileName = fname;
+  job.Hints = ioHints;
+  job.State = JOB_PENDING;
+  job.IO = io ? io : GuidedNativeImageIO::New().GetPointer();
+  m_Jobs.push_back(job);
+
+  return m_Jobs.size() - 1;
+}
+
+void NativeImagePrefetcher::Start()
+{
+  assert(m_Workers.size() == 0);
+
+  // Reading is mostly limited by disk and decompression, so there is little
+  // point in using many more threads than images we may hold in memory
+  unsigned int n_threads = m_NumberOfThreads;
+  if(n_threads == 0)
+    n_threads = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+  n_threads = std::min(n_threads, m_MaximumReadAhead + 1);
+  n_threads = std::min(n_threads, (unsigned int) m_Jobs.size());
+
+  for(unsigned int i = 0; i < n_threads; i++)
+    m_Workers.push_back(std::thread(&NativeImagePrefetcher::WorkerLoop, this));
+}
+
+void NativeImagePrefetcher::WorkerLoop()
+{
+  while(true)
+    {
+    unsigned int k;
+
+    // Wait until there is a job we are allowed to start
+      {
+      std::unique_lock<std::mutex> lock(m_Mutex);
+      while(!m_Cancelled && m_NextJob < m_Jobs.size()
+            && m_NextJob > m_NextTake + m_MaximumReadAhead)
+        m_SlotFreeCondition.wait(lock);
+
+      if(m_Cancelled || m_NextJob >= m_Jobs.size())
+        return;
+
+      k = m_NextJob++;
+      m_Jobs[k].State = JOB_RUNNING;
+      }
+
+    // Read the image without holding the lock. The consumer does not touch
+    // the IO object until the job is done
+    Job &job = m_Jobs[k];
+    SmartPtr<GuidedNativeImageIO> io = job.IO;
+    std::exception_ptr error;
+    try
+      {
+        {
+        std::lock_guard<std::mutex> hlock(m_HeaderMutex);
+        io->ReadNativeImageHeader(job.FileName.c_str(), job.Hints);
+        }
+      io->ReadNativeImageData();
+      }
+    catch(...)
+      {
+      error = std::current_exception();
+      }
+
+    // Hand the image over to the consumer
+      {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      job.IO = io;
+      job.Error = error;
+      job.State = JOB_DONE;
+      }
+    m_JobReadyCondition.notify_all();
+    }
+}
+
+SmartPtr<GuidedNativeImageIO>
+NativeImagePrefetcher::TakeImage(unsigned int index)
+{
+  assert(index == m_NextTake && index < m_Jobs.size());
+
+  SmartPtr<GuidedNativeImageIO> io;
+  std::exception_ptr error;
+
+    {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    Job &job = m_Jobs[index];
+    while(job.State != JOB_DONE)
+      m_JobReadyCondition.wait(lock);
+
+    // Release our reference to the image, so that the memory is freed as
+    // soon as the consumer is done with it
+    io = job.IO;
+    error = job.Error;
+    job.IO = NULL;
+    m_NextTake++;
+    }
+
+  // Let the workers read further ahead
+  m_SlotFreeCondition.notify_all();
+
+  if(error)
+    std::rethrow_exception(error);
+
+  return io;
+}
+
+void NativeImagePrefetcher::Cancel()
+{
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Cancelled = true;
+    }
+  m_SlotFreeCondition.notify_all();
+
+  // Workers finish the image they are reading and exit
+  for(unsigned int i = 0; i < m_Workers.size(); i++)
+    if(m_Workers[i].joinable())
+      m_Workers[i].join();
+  m_Workers.clear();
+
+  // Drop everything that has not been consumed
+  for(unsigned int i = 0; i < m_Jobs.size(); i++)
+    m_Jobs[i].IO = NULL;
+}
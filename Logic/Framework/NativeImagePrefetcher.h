@@ -0,0 +1,115 @@
+#ifndef NATIVEIMAGEPREFETCHER_H
+#define NATIVEIMAGEPREFETCHER_H
+
+#include "SNAPCommon.h"
+#include "Registry.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+class GuidedNativeImageIO;
+
+/**
+ * \class NativeImagePrefetcher
+ * \brief Reads a list of images from disk on a pool of worker threads
+ *
+ * This class is used when opening workspaces. The layers are read and
+ * decompressed concurrently, while the consumer (IRISApplication) takes
+ * them one by one, in the order in which they were added, and installs
+ * them into the application on the calling thread. This way the order of
+ * the layers and all the events fired are the same as with serial loading.
+ *
+ * To keep memory use bounded, workers never read more than MaximumReadAhead
+ * images past the image that the consumer is currently waiting for. Images
+ * that have been taken by the consumer are no longer referenced here.
+ *
+ * Exceptions thrown while reading an image are captured by the worker and
+ * rethrown to the consumer by TakeImage().
+ */
+class NativeImagePrefetcher : public itk::Object
+{
+public:
+
+  irisITKObjectMacro(NativeImagePrefetcher, itk::Object)
+
+  /** Number of worker threads, zero means pick based on the hardware */
+  irisGetSetMacro(NumberOfThreads, unsigned int)
+
+  /** How many images may be held in memory ahead of the consumer */
+  irisGetSetMacro(MaximumReadAhead, unsigned int)
+
+  /**
+   * Add an image to the queue. The IO hints are copied. The image is read
+   * with the given IO object, which the caller may have configured (e.g.,
+   * with AbstractLoadImageDelegate::ConfigureImageIO), or with a new one if
+   * it is NULL. Must be called before Start(). Returns the index of the image
+   * in the queue.
+   */
+  unsigned int AddImage(const std::string &fname, const Registry &ioHints,
+                        GuidedNativeImageIO *io = NULL);
+
+  /** Number of images in the queue */
+  unsigned int GetNumberOfImages() const { return m_Jobs.size(); }
+
+  /** Start reading images in the background */
+  void Start();
+
+  /**
+   * Wait until the image with the given index has been read and return the
+   * IO object that holds it. Images must be taken in increasing order. If
+   * reading failed, the exception is rethrown here.
+   */
+  SmartPtr<GuidedNativeImageIO> TakeImage(unsigned int index);
+
+  /**
+   * Stop the workers and discard all images that have not been taken. This
+   * is called automatically on destruction, so that an exception thrown
+   * while installing a layer does not leave threads running.
+   */
+  void Cancel();
+
+protected:
+
+  NativeImagePrefetcher();
+  virtual ~NativeImagePrefetcher();
+
+  enum JobState { JOB_PENDING, JOB_RUNNING, JOB_DONE };
+
+  struct Job
+  {
+    std::string FileName;
+    Registry Hints;
+    JobState State;
+    SmartPtr<GuidedNativeImageIO> IO;
+    std::exception_ptr Error;
+  };
+
+  void WorkerLoop();
+
+  // Jobs in the order they will be consumed
+  std::vector<Job> m_Jobs;
+
+  // Index of the next job a worker can pick up
+  unsigned int m_NextJob;
+
+  // Index of the job the consumer is waiting on / will take next
+  unsigned int m_NextTake;
+
+  unsigned int m_NumberOfThreads, m_MaximumReadAhead;
+  bool m_Cancelled;
+
+  std::vector<std::thread> m_Workers;
+  std::mutex m_Mutex;
+  std::condition_variable m_JobReadyCondition, m_SlotFreeCondition;
+
+  // ITK image IO factories and DICOM parsing are not safe to run
+  // concurrently, so header reading is serialized across workers.
+  std::mutex m_HeaderMutex;
+};
+
+#endif // NATIVEIMAGEPREFETCHER_H
@@ -0,0 +1,316 @@
+#include "RegistrationMetricEstimator.h"
+#include "itkBinShrinkImageFilter.h"
+#include <vnl/vnl_inverse.h>
+#include <vnl/vnl_matrix_fixed.h>
+#include <vnl/vnl_vector_fixed.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+RegistrationMetricEstimator::RegistrationMetricEstimator()
+{
+  m_MaximumCacheDimension = 64;
+  m_TimeBudget = 50.0;
+  m_FixedMin = m_FixedMax = m_MovingMin = m_MovingMax = 0.0f;
+  m_PendingId = m_LastRequestId = 0;
+  m_HasPending = m_HasResult = m_StopWorker = false;
+}
+
+RegistrationMetricEstimator::~RegistrationMetricEstimator()
+{
+  this->StopWorker();
+}
+
+SmartPtr<RegistrationMetricEstimator::FloatImageType>
+RegistrationMetricEstimator::Downsample(FloatImageType *image)
+{
+  typedef itk::BinShrinkImageFilter<FloatImageType, FloatImageType> ShrinkFilter;
+  SmartPtr<ShrinkFilter> shrink = ShrinkFilter::New();
+  shrink->SetInput(image);
+
+  FloatImageType::SizeType size = image->GetBufferedRegion().GetSize();
+  for(unsigned int d = 0; d < 3; d++)
+    {
+    unsigned int f = (size[d] + m_MaximumCacheDimension - 1) / m_MaximumCacheDimension;
+    shrink->SetShrinkFactor(d, std::max(1u, f));
+    }
+
+  shrink->Update();
+
+  SmartPtr<FloatImageType> result = shrink->GetOutput();
+  result->DisconnectPipeline();
+  return result;
+}
+
+static void GetIntensityRange(itk::Image<float, 3> *image, float &vmin, float &vmax)
+{
+  const float *p = image->GetBufferPointer();
+  size_t n = image->GetPixelContainer()->Size();
+  vmin = vmax = n > 0 ? p[0] : 0.0f;
+  for(size_t i = 1; i < n; i++)
+    {
+    vmin = std::min(vmin, p[i]);
+    vmax = std::max(vmax, p[i]);
+    }
+}
+
+void RegistrationMetricEstimator::SetImages(FloatImageType *fixed, FloatImageType *moving)
+{
+  // Downsample before taking the lock, so that background evaluation with the
+  // old cache can continue in the meantime
+  SmartPtr<FloatImageType> fixed_cache = this->Downsample(fixed);
+  SmartPtr<FloatImageType> moving_cache = this->Downsample(moving);
+
+  std::lock_guard<std::mutex> lock(m_CacheMutex);
+  m_FixedCache = fixed_cache;
+  m_MovingCache = moving_cache;
+  GetIntensityRange(m_FixedCache, m_FixedMin, m_FixedMax);
+  GetIntensityRange(m_MovingCache, m_MovingMin, m_MovingMax);
+}
+
+void RegistrationMetricEstimator::ReleaseImages()
+{
+  std::lock_guard<std::mutex> lock(m_CacheMutex);
+  m_FixedCache = NULL;
+  m_MovingCache = NULL;
+}
+
+bool RegistrationMetricEstimator::IsCacheReady()
+{
+  std::lock_guard<std::mutex> lock(m_CacheMutex);
+  return m_FixedCache && m_MovingCache;
+}
+
+// Find the two voxels and the weight for linear interpolation along one axis.
+// Returns false if the coordinate is outside of the image.
+static inline bool LinearInterpolationWeights(double x, int n, int &i0, int &i1, double &w)
+{
+  if(n == 1)
+    {
+    // Flat dimension, e.g., a 2D image
+    i0 = i1 = 0; w = 0.0;
+    return x >= -0.5 && x <= 0.5;
+    }
+
+  if(x < 0.0 || x > n - 1)
+    return false;
+
+  i0 = std::min((int) x, n - 2);
+  i1 = i0 + 1;
+  w = x - i0;
+  return true;
+}
+
+// Compute the histogram bin of an intensity
+static inline int HistogramBin(float v, float vmin, double scale, int nbins)
+{
+  int bin = (int) ((v - vmin) * scale);
+  return std::max(0, std::min(nbins - 1, bin));
+}
+
+RegistrationMetricEstimator::Result
+RegistrationMetricEstimator::Evaluate(
+    const MatrixType &matrix, const VectorType &offset, double time_budget_ms)
+{
+  typedef vnl_matrix_fixed<double, 3, 3> Mat3;
+  typedef vnl_vector_fixed<double, 3> Vec3;
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point t_start = Clock::now();
+
+  std::lock_guard<std::mutex> lock(m_CacheMutex);
+
+  Result result;
+  if(!m_FixedCache || !m_MovingCache)
+    return result;
+
+  // Map from voxel index to physical point for both images
+  Mat3 Mf = m_FixedCache->GetDirection().GetVnlMatrix(), Mm = m_MovingCache->GetDirection().GetVnlMatrix();
+  for(unsigned int j = 0; j < 3; j++)
+    for(unsigned int i = 0; i < 3; i++)
+      {
+      Mf(i,j) *= m_FixedCache->GetSpacing()[j];
+      Mm(i,j) *= m_MovingCache->GetSpacing()[j];
+      }
+  Vec3 Of = m_FixedCache->GetOrigin().GetVnlVector(), Om = m_MovingCache->GetOrigin().GetVnlVector();
+
+  // Compose into a map from fixed cache voxels to moving cache continuous index
+  Mat3 Mm_inv = vnl_inverse(Mm);
+  Mat3 A = matrix.GetVnlMatrix();
+  Vec3 b = offset.GetVnlVector();
+  Mat3 K = Mm_inv * A * Mf;
+  Vec3 k = Mm_inv * (A * Of + b - Om);
+  Vec3 dx = K.get_column(0);
+
+  FloatImageType::SizeType nf = m_FixedCache->GetBufferedRegion().GetSize();
+  FloatImageType::SizeType nm = m_MovingCache->GetBufferedRegion().GetSize();
+  const float *fbuf = m_FixedCache->GetBufferPointer();
+  const float *mbuf = m_MovingCache->GetBufferPointer();
+  const size_t mstride[3] = { 1, nm[0], nm[0] * nm[1] };
+
+  // Accumulators
+  const int nbins = NumberOfHistogramBins;
+  std::vector<double> joint(nbins * nbins, 0.0);
+  double fscale = m_FixedMax > m_FixedMin ? nbins / (double) (m_FixedMax - m_FixedMin) : 0.0;
+  double mscale = m_MovingMax > m_MovingMin ? nbins / (double) (m_MovingMax - m_MovingMin) : 0.0;
+  double sf = 0, sm = 0, sff = 0, smm = 0, sfm = 0, sdd = 0;
+  unsigned long n = 0;
+
+  // Visit slices in interleaved order, so that stopping early still gives
+  // samples from the whole image
+  const unsigned int n_phases = std::min((unsigned int) nf[2], 4u);
+  unsigned int n_slices = 0;
+  bool timeout = false;
+  for(unsigned int phase = 0; phase < n_phases && !timeout; phase++)
+    {
+    for(unsigned int z = phase; z < nf[2] && !timeout; z += n_phases)
+      {
+      for(unsigned int y = 0; y < nf[1]; y++)
+        {
+        const float *fp = fbuf + nf[0] * (y + nf[1] * z);
+        Vec3 p = K * Vec3(0.0, y, z) + k;
+        for(unsigned int x = 0; x < nf[0]; x++, p += dx)
+          {
+          int i0[3], i1[3];
+          double w[3];
+          if(!LinearInterpolationWeights(p[0], nm[0], i0[0], i1[0], w[0]) ||
+             !LinearInterpolationWeights(p[1], nm[1], i0[1], i1[1], w[1]) ||
+             !LinearInterpolationWeights(p[2], nm[2], i0[2], i1[2], w[2]))
+            continue;
+
+          // Trilinear interpolation of the moving image
+          const float *m00 = mbuf + i0[1] * mstride[1] + i0[2] * mstride[2];
+          const float *m10 = mbuf + i1[1] * mstride[1] + i0[2] * mstride[2];
+          const float *m01 = mbuf + i0[1] * mstride[1] + i1[2] * mstride[2];
+          const float *m11 = mbuf + i1[1] * mstride[1] + i1[2] * mstride[2];
+          double v00 = m00[i0[0]] + w[0] * (m00[i1[0]] - m00[i0[0]]);
+          double v10 = m10[i0[0]] + w[0] * (m10[i1[0]] - m10[i0[0]]);
+          double v01 = m01[i0[0]] + w[0] * (m01[i1[0]] - m01[i0[0]]);
+          double v11 = m11[i0[0]] + w[0] * (m11[i1[0]] - m11[i0[0]]);
+          double v0 = v00 + w[1] * (v10 - v00);
+          double v1 = v01 + w[1] * (v11 - v01);
+          double vm = v0 + w[2] * (v1 - v0);
+          double vf = fp[x];
+
+          sf += vf; sm += vm;
+          sff += vf * vf; smm += vm * vm; sfm += vf * vm;
+          sdd += (vf - vm) * (vf - vm);
+          joint[HistogramBin(vf, m_FixedMin, fscale, nbins) * nbins +
+                HistogramBin(vm, m_MovingMin, mscale, nbins)] += 1.0;
+          n++;
+          }
+        }
+
+      n_slices++;
+      if(time_budget_ms >= 0.0)
+        {
+        double elapsed = std::chrono::duration<double, std::milli>(Clock::now() - t_start).count();
+        timeout = elapsed > time_budget_ms;
+        }
+      }
+    }
+
+  result.NumberOfSamples = n;
+  result.FractionEvaluated = n_slices / (double) nf[2];
+  if(n == 0)
+    return result;
+
+  // Correlation and mean squared difference
+  double mf = sf / n, mm = sm / n;
+  double vf = sff / n - mf * mf, vm = smm / n - mm * mm, cfm = sfm / n - mf * mm;
+  result.NCC = (vf > 0 && vm > 0) ? cfm / sqrt(vf * vm) : 0.0;
+  result.SSD = sdd / n;
+
+  // Entropies from the joint histogram
+  std::vector<double> pf(nbins, 0.0), pm(nbins, 0.0);
+  double hfm = 0.0, hf = 0.0, hm = 0.0;
+  for(int i = 0; i < nbins; i++)
+    {
+    for(int j = 0; j < nbins; j++)
+      {
+      double p = joint[i * nbins + j] / n;
+      pf[i] += p; pm[j] += p;
+      if(p > 0)
+        hfm -= p * log(p);
+      }
+    }
+  for(int i = 0; i < nbins; i++)
+    {
+    if(pf[i] > 0) hf -= pf[i] * log(pf[i]);
+    if(pm[i] > 0) hm -= pm[i] * log(pm[i]);
+    }
+  result.NMI = hfm > 0 ? (hf + hm) / hfm : 0.0;
+
+  return result;
+}
+
+unsigned long
+RegistrationMetricEstimator::RequestEvaluation(const MatrixType &matrix, const VectorType &offset)
+{
+  unsigned long id;
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if(!m_Worker.joinable())
+      {
+      m_StopWorker = false;
+      m_Worker = std::thread(&RegistrationMetricEstimator::WorkerLoop, this);
+      }
+
+    m_PendingMatrix = matrix;
+    m_PendingOffset = offset;
+    m_PendingId = id = ++m_LastRequestId;
+    m_HasPending = true;
+    }
+  m_RequestCondition.notify_one();
+  return id;
+}
+
+bool RegistrationMetricEstimator::GetLatestResult(Result &result)
+{
+  std::lock_guard<std::mutex> lock(m_Mutex);
+  if(!m_HasResult)
+    return false;
+
+  result = m_LatestResult;
+  m_HasResult = false;
+  return true;
+}
+
+void RegistrationMetricEstimator::WorkerLoop()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while(true)
+    {
+    while(!m_StopWorker && !m_HasPending)
+      m_RequestCondition.wait(lock);
+
+    if(m_StopWorker)
+      break;
+
+    // Take the request and evaluate it without holding the lock
+    MatrixType matrix = m_PendingMatrix;
+    VectorType offset = m_PendingOffset;
+    unsigned long id = m_PendingId;
+    double budget = m_TimeBudget;
+    m_HasPending = false;
+    lock.unlock();
+
+    Result result = this->Evaluate(matrix, offset, budget);
+    result.RequestId = id;
+
+    lock.lock();
+    m_LatestResult = result;
+    m_HasResult = true;
+    }
+}
+
+void RegistrationMetricEstimator::StopWorker()
+{
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_StopWorker = true;
+    }
+  m_RequestCondition.notify_one();
+
+  if(m_Worker.joinable())
+    m_Worker.join();
+}
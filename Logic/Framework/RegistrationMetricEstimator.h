@@ -0,0 +1,152 @@
+#ifndef REGISTRATIONMETRICESTIMATOR_H
+#define REGISTRATIONMETRICESTIMATOR_H
+
+#include "SNAPCommon.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkImage.h"
+#include "itkMatrix.h"
+#include "itkVector.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * \class RegistrationMetricEstimator
+ * \brief Fast approximate similarity between a fixed and a moving image
+ *
+ * This class provides live feedback on alignment quality during manual
+ * registration. The fixed and moving images are downsampled once into a
+ * cache by block averaging, so that no dimension exceeds
+ * MaximumCacheDimension. For a given affine transform (mapping fixed
+ * physical coordinates to moving physical coordinates, as in the image
+ * wrappers), the moving cache is sampled at every voxel of the fixed cache
+ * with trilinear interpolation. Since the transform is affine, each line of
+ * the fixed cache maps to a line in moving voxel space that is walked with a
+ * constant increment. NCC, NMI and SSD are computed in the same pass.
+ *
+ * Evaluation is bounded by a time budget. Slices of the fixed cache are
+ * visited in an interleaved order, so that if the budget runs out the samples
+ * still cover the whole image. The result reports the fraction of the slices
+ * that were used.
+ *
+ * RequestEvaluation() passes a transform to a background thread, replacing
+ * any request that has not been started yet, so that only the most recent
+ * transform is evaluated when the user drags the image around. Results are
+ * polled with GetLatestResult(), which is easy to do from a GUI timer.
+ */
+class RegistrationMetricEstimator : public itk::Object
+{
+public:
+
+  irisITKObjectMacro(RegistrationMetricEstimator, itk::Object)
+
+  typedef itk::Image<float, 3> FloatImageType;
+  typedef itk::Matrix<double, 3, 3> MatrixType;
+  typedef itk::Vector<double, 3> VectorType;
+
+  /** Number of bins per image in the joint histogram used for NMI */
+  static const unsigned int NumberOfHistogramBins = 32;
+
+  /** Metric values computed for a transform */
+  struct Result
+  {
+    // Normalized cross-correlation (over the whole overlap, not patch-wise)
+    double NCC;
+
+    // Normalized mutual information, (H(F) + H(M)) / H(F,M)
+    double NMI;
+
+    // Mean squared intensity difference
+    double SSD;
+
+    // Number of fixed samples that mapped inside of the moving image
+    unsigned long NumberOfSamples;
+
+    // Fraction of the fixed cache that was visited within the time budget
+    double FractionEvaluated;
+
+    // The value returned by RequestEvaluation() for this transform
+    unsigned long RequestId;
+
+    Result()
+      : NCC(0.0), NMI(0.0), SSD(0.0), NumberOfSamples(0),
+        FractionEvaluated(0.0), RequestId(0) {}
+  };
+
+  /** Largest dimension of the downsampled images (default 64) */
+  irisGetSetMacro(MaximumCacheDimension, unsigned int)
+
+  /** Time budget for evaluation in the background, in ms (default 50) */
+  irisGetSetMacro(TimeBudget, double)
+
+  /**
+   * Build the cache from the fixed and moving images, which may be given at
+   * full resolution or as a regular subsample. The images are not referenced
+   * after this call. Blocks until the evaluation that may
+   * be running in the background has finished.
+   */
+  void SetImages(FloatImageType *fixed, FloatImageType *moving);
+
+  /** Release the cache */
+  void ReleaseImages();
+
+  /** Whether the cache has been built */
+  bool IsCacheReady();
+
+  /** Get the downsampled images (for testing) */
+  FloatImageType *GetFixedCache() { return m_FixedCache; }
+  FloatImageType *GetMovingCache() { return m_MovingCache; }
+
+  /**
+   * Compute the metrics on the calling thread. A negative time budget means
+   * that the whole fixed cache is evaluated.
+   */
+  Result Evaluate(const MatrixType &matrix, const VectorType &offset,
+                  double time_budget_ms = -1.0);
+
+  /**
+   * Schedule the evaluation of the metrics for a transform in the background.
+   * Returns an id that is copied into the corresponding result.
+   */
+  unsigned long RequestEvaluation(const MatrixType &matrix, const VectorType &offset);
+
+  /**
+   * Get the result of the most recently completed background evaluation.
+   * Returns false if no evaluation has completed since the last call.
+   */
+  bool GetLatestResult(Result &result);
+
+protected:
+
+  RegistrationMetricEstimator();
+  virtual ~RegistrationMetricEstimator();
+
+  // Downsample an image by block averaging
+  SmartPtr<FloatImageType> Downsample(FloatImageType *image);
+
+  void WorkerLoop();
+  void StopWorker();
+
+  unsigned int m_MaximumCacheDimension;
+  double m_TimeBudget;
+
+  // The downsampled images and their intensity ranges, protected by m_CacheMutex
+  SmartPtr<FloatImageType> m_FixedCache, m_MovingCache;
+  float m_FixedMin, m_FixedMax, m_MovingMin, m_MovingMax;
+  std::mutex m_CacheMutex;
+
+  // Background evaluation state, protected by m_Mutex
+  MatrixType m_PendingMatrix;
+  VectorType m_PendingOffset;
+  unsigned long m_PendingId, m_LastRequestId;
+  bool m_HasPending, m_HasResult, m_StopWorker;
+  Result m_LatestResult;
+
+  std::thread m_Worker;
+  std::mutex m_Mutex;
+  std::condition_variable m_RequestCondition;
+};
+
+#endif // REGISTRATIONMETRICESTIMATOR_H
@@ -502,6 +502,51 @@ SNAPImageData
   return m_LevelSetDriver->GetCurrentState();
 }
 
+bool
+SNAPImageData
+::GetLevelSetActiveLayer(std::vector<SNAPLevelSetDriver3d::IndexType> &indices) const
+{
+  return m_LevelSetDriver && m_LevelSetDriver->GetActiveLayer(indices);
+}
+
+unsigned int
+SNAPImageData
+::GetLevelSetBoundaryFacesReached(unsigned int distance)
+{
+  assert(m_LevelSetDriver);
+  itk::MutexLockHolder<itk::FastMutexLock> holder(*m_LevelSetPipelineMutexLock);
+  return m_LevelSetDriver->GetBoundaryFacesReachedByActiveLayer(distance);
+}
+
+bool
+SNAPImageData
+::ResampleSegmentationToSpeed()
+{
+  assert(m_LevelSetDriver && IsSpeedLoaded());
+
+  // The external advection field is only defined in the old region
+  if(m_ExternalAdvectionField)
+    return false;
+
+  // Enter a thread-safe section
+  m_LevelSetPipelineMutexLock->Lock();
+
+  // Restart the driver on the new speed image
+  m_LevelSetDriver->ResampleToSpeedImage(m_SpeedWrapper->GetImage());
+
+  // The snake wrapper takes the geometry of the new main image
+  m_SnakeWrapper->InitializeToWrapper(
+        m_MainImageWrapper, m_LevelSetDriver->GetCurrentState(), NULL, NULL);
+
+  // Leave a thread-safe section
+  m_LevelSetPipelineMutexLock->Unlock();
+
+  // Fire events (layers changed and level set image changed)
+  this->InvokeEvent(LayerChangeEvent());
+  this->InvokeEvent(LevelSetImageChangeEvent());
+  return true;
+}
+
 SNAPLevelSetDriver<3>::LevelSetFunctionType *
 SNAPImageData
 ::GetLevelSetFunction()
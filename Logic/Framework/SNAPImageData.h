@@ -141,6 +141,10 @@ public:
   void RemoveExternalAdvectionField()
     { m_ExternalAdvectionField = NULL; }
 
+  /** Check whether an external advection field is in use */
+  bool HasExternalAdvectionField() const
+    { return m_ExternalAdvectionField.IsNotNull(); }
+
   /** Set the color label used for the segmentation */
   irisSetMacro(ColorLabel, ColorLabel);
   irisGetMacro(ColorLabel, ColorLabel);
@@ -200,6 +204,29 @@ public:
    */
   LevelSetImageType *GetLevelSetImage();
 
+  /**
+   * Get the voxels in the active layer of the level set being evolved, if the
+   * solver keeps track of them (see SNAPLevelSetDriver::GetActiveLayer). The
+   * caller should hold the level set pipeline lock
+   */
+  bool GetLevelSetActiveLayer(std::vector<SNAPLevelSetDriver3d::IndexType> &indices) const;
+
+  /**
+   * Get the faces of the image that the evolving contour has come within the
+   * given number of voxels of, one bit per face (see
+   * SNAPLevelSetDriver::GetBoundaryFacesReachedByActiveLayer)
+   */
+  unsigned int GetLevelSetBoundaryFacesReached(unsigned int distance);
+
+  /**
+   * Carry the evolving contour over to the current speed image, after the
+   * main and speed images have been extracted from a new region of interest
+   * that covers the old one. The evolution continues from the resampled
+   * contour. Returns false if an external advection field is in use, since
+   * it only covers the old region
+   */
+  bool ResampleSegmentationToSpeed();
+
   /** This method is public for testing purposes.  It will give a pointer to 
    * the level set function used internally for segmentation */
   SNAPLevelSetDriver<3>::LevelSetFunctionType *GetLevelSetFunction();
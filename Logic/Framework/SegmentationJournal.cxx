@@ -0,0 +1,443 @@
+#include "SegmentationJournal.h"
+#include "RLEImageRegionIterator.h"
+#include <itksys/SystemTools.hxx>
+#include <cstring>
+
+// Every record starts with this marker
+static const unsigned int JOURNAL_RECORD_MARKER = 0x44524352; // 'RCRD'
+static const unsigned int JOURNAL_VERSION = 1;
+static const char JOURNAL_MAGIC[16] = "ITK-SNAP JRNL";
+
+// Helpers for writing and reading plain data into record payloads
+template <class T> static void JournalPut(std::string &buf, const T &value)
+{
+  buf.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <class T> static bool JournalGet(const std::string &buf, size_t &pos, T &value)
+{
+  if(pos + sizeof(T) > buf.size())
+    return false;
+  memcpy(&value, buf.data() + pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+// FNV-1a hash, used to detect torn or corrupt records
+static unsigned int JournalChecksum(const std::string &buf)
+{
+  unsigned int h = 2166136261u;
+  for(size_t i = 0; i < buf.size(); i++)
+    {
+    h ^= (unsigned char) buf[i];
+    h *= 16777619u;
+    }
+  return h;
+}
+
+SegmentationJournal::SegmentationJournal()
+{
+  m_File = NULL;
+  m_Writing = false;
+  m_StopWriter = false;
+}
+
+SegmentationJournal::~SegmentationJournal()
+{
+  // A journal that is destroyed without being closed is kept on disk
+  if(m_File)
+    this->Close(false);
+}
+
+std::string SegmentationJournal::GetJournalFileName(const std::string &segFile)
+{
+  return segFile + ".journal";
+}
+
+void
+SegmentationJournal
+::MakeHeader(const std::string &segFile, const Vector3ui &dims, Header &hdr)
+{
+  memset(&hdr, 0, sizeof(Header));
+  memcpy(hdr.Magic, JOURNAL_MAGIC, sizeof(hdr.Magic));
+  hdr.Version = JOURNAL_VERSION;
+  for(int d = 0; d < 3; d++)
+    hdr.Dimensions[d] = dims[d];
+  hdr.SegmentationFileSize = itksys::SystemTools::FileLength(segFile);
+  hdr.SegmentationFileTime = itksys::SystemTools::ModifiedTime(segFile);
+}
+
+bool
+SegmentationJournal
+::ReadAndCheckHeader(FILE *f, const std::string &segFile, const Vector3ui &dims)
+{
+  Header hdr, ref;
+  if(fread(&hdr, sizeof(Header), 1, f) != 1)
+    return false;
+
+  // The journal is only valid for the version of the file it was started with
+  MakeHeader(segFile, dims, ref);
+  return memcmp(&hdr, &ref, sizeof(Header)) == 0;
+}
+
+bool
+SegmentationJournal
+::Open(const std::string &segFile, const Vector3ui &dims, bool append)
+{
+  // Close the current journal, if any
+  if(m_File)
+    this->Close(true);
+
+  m_SegmentationFileName = segFile;
+  m_JournalFileName = GetJournalFileName(segFile);
+  m_Dimensions = dims;
+
+  // Check if we can append to the existing journal, and find the end of
+  // the last complete record in it
+  bool can_append = false;
+  long valid_end = 0, file_end = 0;
+  if(append)
+    {
+    FILE *f = fopen(m_JournalFileName.c_str(), "rb");
+    if(f)
+      {
+      can_append = ReadAndCheckHeader(f, segFile, dims);
+      if(can_append)
+        {
+        std::string payload;
+        valid_end = ftell(f);
+        while(ReadRecord(f, payload))
+          valid_end = ftell(f);
+        fseek(f, 0, SEEK_END);
+        file_end = ftell(f);
+        }
+      fclose(f);
+      }
+    }
+
+  if(can_append && valid_end == file_end)
+    {
+    m_File = fopen(m_JournalFileName.c_str(), "ab");
+    }
+  else if(can_append)
+    {
+    // A record was torn by a crash. New records written after it would never
+    // be replayed, so the journal is rewritten without the torn bytes
+    std::string valid(valid_end, '\0');
+    FILE *f = fopen(m_JournalFileName.c_str(), "rb");
+    bool read_ok = f && fread(&valid[0], 1, valid_end, f) == (size_t) valid_end;
+    if(f)
+      fclose(f);
+
+    if(read_ok)
+      {
+      m_File = fopen(m_JournalFileName.c_str(), "wb");
+      if(m_File)
+        {
+        fwrite(valid.data(), 1, valid.size(), m_File);
+        fflush(m_File);
+        }
+      }
+    }
+  else
+    {
+    m_File = fopen(m_JournalFileName.c_str(), "wb");
+    if(m_File)
+      {
+      Header hdr;
+      MakeHeader(segFile, dims, hdr);
+      fwrite(&hdr, sizeof(Header), 1, m_File);
+      fflush(m_File);
+      }
+    }
+
+  if(!m_File)
+    return false;
+
+  // Start the writer thread
+  m_StopWriter = false;
+  m_Writing = false;
+  m_Writer = std::thread(&SegmentationJournal::WriterLoop, this);
+  return true;
+}
+
+void
+SegmentationJournal
+::AppendCommit(const DeltaList &deltas, const std::string &name, bool reverse)
+{
+  if(!m_File)
+    return;
+
+  // Serialize the record payload
+  std::string payload;
+  JournalPut(payload, (int) (reverse ? -1 : 1));
+  JournalPut(payload, (unsigned int) name.size());
+  payload.append(name);
+  JournalPut(payload, (unsigned int) deltas.size());
+
+  std::list<Delta *> ordered(deltas);
+  if(reverse)
+    ordered.reverse();
+
+  for(std::list<Delta *>::const_iterator it = ordered.begin(); it != ordered.end(); ++it)
+    {
+    Delta *delta = *it;
+    const Delta::RegionType &region = delta->GetRegion();
+    for(int d = 0; d < 3; d++)
+      {
+      JournalPut(payload, (long long) region.GetIndex()[d]);
+      JournalPut(payload, (unsigned long long) region.GetSize()[d]);
+      }
+
+    unsigned long long n_rle = delta->GetNumberOfRLEs();
+    JournalPut(payload, n_rle);
+    for(size_t i = 0; i < n_rle; i++)
+      {
+      JournalPut(payload, (unsigned long long) delta->GetRLELength(i));
+      JournalPut(payload, (LabelType) delta->GetRLEValue(i));
+      }
+    }
+
+  // Wrap the payload with the marker, length and checksum
+  std::string record;
+  JournalPut(record, JOURNAL_RECORD_MARKER);
+  JournalPut(record, (unsigned long long) payload.size());
+  record.append(payload);
+  JournalPut(record, JournalChecksum(payload));
+
+  // Hand the record to the writer
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Queue.push_back(record);
+    }
+  m_QueueCondition.notify_one();
+}
+
+void SegmentationJournal::WriterLoop()
+{
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while(true)
+    {
+    while(!m_StopWriter && m_Queue.empty())
+      m_QueueCondition.wait(lock);
+
+    if(m_Queue.empty())
+      break;
+
+    // Take all the pending records and write them without holding the lock
+    std::deque<std::string> batch;
+    batch.swap(m_Queue);
+    m_Writing = true;
+    lock.unlock();
+
+    for(size_t i = 0; i < batch.size(); i++)
+      fwrite(batch[i].data(), 1, batch[i].size(), m_File);
+    fflush(m_File);
+
+    lock.lock();
+    m_Writing = false;
+    m_IdleCondition.notify_all();
+    }
+}
+
+void SegmentationJournal::Flush()
+{
+  if(!m_File)
+    return;
+
+  std::unique_lock<std::mutex> lock(m_Mutex);
+  while(m_Writing || !m_Queue.empty())
+    m_IdleCondition.wait(lock);
+}
+
+void SegmentationJournal::StopWriter()
+{
+    {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_StopWriter = true;
+    }
+  m_QueueCondition.notify_one();
+
+  // The writer drains the queue before exiting
+  if(m_Writer.joinable())
+    m_Writer.join();
+}
+
+void SegmentationJournal::Truncate()
+{
+  if(!m_File)
+    return;
+
+  // Discard the records that have not been written yet and wait for the
+  // writer to finish with the current batch
+    {
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Queue.clear();
+    while(m_Writing)
+      m_IdleCondition.wait(lock);
+
+    // Rewrite the journal with just the header for the newly saved file
+    fclose(m_File);
+    m_File = fopen(m_JournalFileName.c_str(), "wb");
+    if(m_File)
+      {
+      Header hdr;
+      MakeHeader(m_SegmentationFileName, m_Dimensions, hdr);
+      fwrite(&hdr, sizeof(Header), 1, m_File);
+      fflush(m_File);
+      }
+    }
+
+  // If the file could not be reopened, there is nothing more to do
+  if(!m_File)
+    {
+    StopWriter();
+    itksys::SystemTools::RemoveFile(m_JournalFileName);
+    }
+}
+
+void SegmentationJournal::Close(bool remove)
+{
+  if(!m_File)
+    return;
+
+  StopWriter();
+  fclose(m_File);
+  m_File = NULL;
+
+  if(remove)
+    itksys::SystemTools::RemoveFile(m_JournalFileName);
+}
+
+bool SegmentationJournal::ReadRecord(FILE *f, std::string &payload)
+{
+  unsigned int marker, checksum;
+  unsigned long long size;
+
+  if(fread(&marker, sizeof(marker), 1, f) != 1 || marker != JOURNAL_RECORD_MARKER)
+    return false;
+
+  if(fread(&size, sizeof(size), 1, f) != 1)
+    return false;
+
+  // Guard against garbage sizes
+  long pos = ftell(f);
+  if(fseek(f, 0, SEEK_END) != 0)
+    return false;
+  long end = ftell(f);
+  fseek(f, pos, SEEK_SET);
+  if(size + sizeof(checksum) > (unsigned long long) (end - pos))
+    return false;
+
+  payload.resize(size);
+  if(size > 0 && fread(&payload[0], 1, size, f) != size)
+    return false;
+
+  if(fread(&checksum, sizeof(checksum), 1, f) != 1)
+    return false;
+
+  return checksum == JournalChecksum(payload);
+}
+
+bool
+SegmentationJournal
+::ApplyRecord(const std::string &payload, LabelImageType *image)
+{
+  size_t pos = 0;
+  int sign;
+  unsigned int name_len, n_deltas;
+
+  if(!JournalGet(payload, pos, sign) || !JournalGet(payload, pos, name_len))
+    return false;
+  pos += name_len;
+  if(!JournalGet(payload, pos, n_deltas))
+    return false;
+
+  typedef itk::ImageRegionIterator<LabelImageType> IteratorType;
+  for(unsigned int k = 0; k < n_deltas; k++)
+    {
+    Delta::RegionType region;
+    for(int d = 0; d < 3; d++)
+      {
+      long long idx;
+      unsigned long long sz;
+      if(!JournalGet(payload, pos, idx) || !JournalGet(payload, pos, sz))
+        return false;
+      region.SetIndex(d, idx);
+      region.SetSize(d, sz);
+      }
+
+    if(!image->GetLargestPossibleRegion().IsInside(region))
+      return false;
+
+    unsigned long long n_rle;
+    if(!JournalGet(payload, pos, n_rle))
+      return false;
+
+    // Same arithmetic as in LabelImageWrapper::Undo/Redo
+    IteratorType lit(image, region);
+    for(unsigned long long i = 0; i < n_rle; i++)
+      {
+      unsigned long long n;
+      LabelType d;
+      if(!JournalGet(payload, pos, n) || !JournalGet(payload, pos, d))
+        return false;
+
+      for(unsigned long long j = 0; j < n && !lit.IsAtEnd(); j++)
+        {
+        if(d != 0)
+          lit.Set(sign > 0 ? lit.Get() + d : lit.Get() - d);
+        ++lit;
+        }
+      }
+    }
+
+  return true;
+}
+
+unsigned int
+SegmentationJournal
+::GetNumberOfRecoverableRecords(const std::string &segFile, const Vector3ui &dims)
+{
+  FILE *f = fopen(GetJournalFileName(segFile).c_str(), "rb");
+  if(!f)
+    return 0;
+
+  unsigned int n = 0;
+  if(ReadAndCheckHeader(f, segFile, dims))
+    {
+    std::string payload;
+    while(ReadRecord(f, payload))
+      n++;
+    }
+
+  fclose(f);
+  return n;
+}
+
+unsigned int
+SegmentationJournal
+::Replay(const std::string &segFile, LabelImageType *image)
+{
+  FILE *f = fopen(GetJournalFileName(segFile).c_str(), "rb");
+  if(!f)
+    return 0;
+
+  LabelImageType::SizeType sz = image->GetLargestPossibleRegion().GetSize();
+  Vector3ui dims(sz[0], sz[1], sz[2]);
+
+  unsigned int n = 0;
+  if(ReadAndCheckHeader(f, segFile, dims))
+    {
+    std::string payload;
+    while(ReadRecord(f, payload) && ApplyRecord(payload, image))
+      n++;
+    }
+
+  fclose(f);
+
+  if(n > 0)
+    image->Modified();
+
+  return n;
+}
@@ -0,0 +1,141 @@
+#ifndef SEGMENTATIONJOURNAL_H
+#define SEGMENTATIONJOURNAL_H
+
+#include "SNAPCommon.h"
+#include "UndoDataManager.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include <cstdio>
+#include <string>
+#include <list>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * \class SegmentationJournal
+ * \brief Append-only on-disk log of the edits made to a segmentation
+ *
+ * The journal mirrors the commits made to the undo system of a segmentation
+ * layer into a compact binary file stored next to the segmentation file
+ * (the segmentation filename with the ".journal" suffix). Each record holds
+ * the run-length encoded deltas of one commit, its name and its direction
+ * (edit/redo or undo). Records are serialized on the calling thread, which
+ * is cheap because deltas are already run-length encoded, and are written
+ * and flushed to disk by a background thread.
+ *
+ * The journal header stores the dimensions of the segmentation and the size
+ * and modification time of the segmentation file at the time the journal was
+ * started. A journal is only replayed onto a file that matches the header.
+ * When the segmentation is saved, the journal is truncated. When the layer
+ * is unloaded normally, the journal is deleted, so that a journal left on
+ * disk means that the application did not exit cleanly.
+ *
+ * Records are checksummed, so a record torn by a crash in the middle of a
+ * write is detected and replay stops at the last complete record.
+ */
+class SegmentationJournal : public itk::Object
+{
+public:
+
+  irisITKObjectMacro(SegmentationJournal, itk::Object)
+
+  typedef RLEImage<LabelType> LabelImageType;
+  typedef UndoDelta<LabelType> Delta;
+  typedef std::list<Delta *> DeltaList;
+
+  /** Get the journal filename associated with a segmentation file */
+  static std::string GetJournalFileName(const std::string &segFile);
+
+  /**
+   * Start journaling the edits to a segmentation stored in segFile. If
+   * append is true and a journal that matches segFile and the dimensions
+   * already exists, new records are appended to it (this is used after
+   * recovery), after dropping any torn record at its end. Otherwise a new,
+   * empty journal is created. Returns false if
+   * the journal file can not be written, in which case the journal stays
+   * closed and all other calls do nothing.
+   */
+  bool Open(const std::string &segFile, const Vector3ui &dims, bool append);
+
+  /** Is the journal currently open */
+  bool IsOpen() const { return m_File != NULL; }
+
+  /** The segmentation filename that the journal is attached to */
+  irisGetMacro(SegmentationFileName, const std::string &)
+
+  /**
+   * Append a commit to the journal. If reverse is true, the commit is being
+   * undone: its deltas are recorded in reverse order, to be subtracted from
+   * the image.
+   */
+  void AppendCommit(const DeltaList &deltas, const std::string &name, bool reverse);
+
+  /** Wait until all the appended records have been written to disk */
+  void Flush();
+
+  /**
+   * Discard all records. This is called after the segmentation has been
+   * saved to the file that the journal is attached to, and the header is
+   * updated to match the newly saved file.
+   */
+  void Truncate();
+
+  /** Stop journaling. The journal file is deleted if remove is true */
+  void Close(bool remove);
+
+  /**
+   * Check if there is a journal for segFile that can be replayed onto the
+   * segmentation stored in that file, and return the number of records in it.
+   */
+  static unsigned int GetNumberOfRecoverableRecords(
+      const std::string &segFile, const Vector3ui &dims);
+
+  /**
+   * Replay the journal for segFile onto the image, which should contain the
+   * segmentation as read from segFile. Returns the number of records applied.
+   * Replay stops at the first incomplete or corrupt record.
+   */
+  static unsigned int Replay(const std::string &segFile, LabelImageType *image);
+
+protected:
+
+  SegmentationJournal();
+  virtual ~SegmentationJournal();
+
+  // Header written at the start of every journal
+  struct Header
+  {
+    char Magic[16];
+    unsigned int Version;
+    unsigned int Dimensions[3];
+    unsigned long long SegmentationFileSize;
+    long long SegmentationFileTime;
+  };
+
+  static void MakeHeader(const std::string &segFile, const Vector3ui &dims, Header &hdr);
+  static bool ReadAndCheckHeader(FILE *f, const std::string &segFile, const Vector3ui &dims);
+
+  // Read the next record in the file, false if there are no more valid records
+  static bool ReadRecord(FILE *f, std::string &payload);
+
+  // Apply a record payload to the image
+  static bool ApplyRecord(const std::string &payload, LabelImageType *image);
+
+  void WriterLoop();
+  void StopWriter();
+
+  FILE *m_File;
+  std::string m_SegmentationFileName, m_JournalFileName;
+  Vector3ui m_Dimensions;
+
+  // Records waiting to be written by the writer thread
+  std::deque<std::string> m_Queue;
+  bool m_Writing, m_StopWriter;
+  std::thread m_Writer;
+  std::mutex m_Mutex;
+  std::condition_variable m_QueueCondition, m_IdleCondition;
+};
+
+#endif // SEGMENTATIONJOURNAL_H
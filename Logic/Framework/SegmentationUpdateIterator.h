@@ -46,6 +46,9 @@
 #include "SNAPCommon.h"
 #include "ImageWrapperTraits.h"
 #include "UndoDataManager.h"
+#include <set>
+#include <algorithm>
+#include <cassert>
 
 
 /**
@@ -284,4 +287,134 @@ protected:
 };
 
 
+/**
+ * Compares voxel indices in the order in which the voxels are stored in the
+ * image, i.e., by z, then by y, then by x. Voxels sorted in this order can be
+ * painted one image line at a time.
+ */
+struct ImageLineOrderCompare
+{
+  bool operator() (const itk::Index<3> &a, const itk::Index<3> &b) const
+  {
+    for(int d = 2; d >= 0; d--)
+      if(a[d] != b[d])
+        return a[d] < b[d];
+    return false;
+  }
+};
+
+/**
+ * \class SegmentationVoxelSetUpdate
+ * \brief Paints a sparse set of voxels with a label as a single undo delta.
+ *
+ * This is used by the 3D spray paint tool. The delta covers the bounding box
+ * of the voxels. The voxels that are not painted are encoded as zero runs,
+ * so the cost is proportional to the number of painted voxels and lines, not
+ * to the size of the bounding box.
+ */
+class SegmentationVoxelSetUpdate
+{
+public:
+  typedef itk::Index<3>                                        IndexType;
+  typedef itk::ImageRegion<3>                                  RegionType;
+  typedef LabelImageWrapper::ImageType                         LabelImageType;
+  typedef UndoDataManager<LabelType>::Delta                    UndoDelta;
+  typedef std::set<IndexType, ImageLineOrderCompare>           VoxelSet;
+
+  /**
+   * Paint the voxels, which must be inside of the image, respecting the draw
+   * over mask. Returns the delta, which the caller owns, or NULL if no voxel
+   * was changed. The number of changed voxels is returned in n_changed.
+   */
+  static UndoDelta *Paint(LabelImageType *image, const VoxelSet &voxels,
+                          LabelType label, DrawOverFilter draw_over,
+                          unsigned long &n_changed)
+  {
+    n_changed = 0;
+    if(voxels.empty())
+      return NULL;
+
+    // Compute the bounding box of the painted voxels
+    IndexType lower = *voxels.begin(), upper = *voxels.begin();
+    for(VoxelSet::const_iterator it = voxels.begin(); it != voxels.end(); ++it)
+      {
+      for(int d = 0; d < 3; d++)
+        {
+        lower[d] = std::min(lower[d], (*it)[d]);
+        upper[d] = std::max(upper[d], (*it)[d]);
+        }
+      }
+
+    RegionType bbox;
+    bbox.SetIndex(lower);
+    for(int d = 0; d < 3; d++)
+      bbox.SetSize(d, upper[d] - lower[d] + 1);
+
+    UndoDelta *delta = new UndoDelta();
+    delta->SetRegion(bbox);
+
+    // Position in the bounding box up to which the delta has been encoded
+    size_t pos = 0;
+    VoxelSet::const_iterator vit = voxels.begin();
+    while(vit != voxels.end())
+      {
+      // Find the extent of the painted voxels in the current line
+      IndexType first = *vit, last = *vit;
+      VoxelSet::const_iterator vend = vit;
+      for(; vend != voxels.end() && (*vend)[1] == first[1] && (*vend)[2] == first[2]; ++vend)
+        last = *vend;
+
+      // Skip to the start of the line segment. The lines are visited in the
+      // order in which they are stored, so the offset never goes back
+      size_t offset = (first[0] - lower[0])
+          + bbox.GetSize(0) * ((first[1] - lower[1]) + bbox.GetSize(1) * (first[2] - lower[2]));
+      assert(offset >= pos);
+      delta->EncodeRun(0, offset - pos);
+
+      // Walk along the line segment, painting the voxels in the set
+      RegionType segment(first, bbox.GetSize());
+      segment.SetSize(0, last[0] - first[0] + 1);
+      segment.SetSize(1, 1);
+      segment.SetSize(2, 1);
+
+      itk::ImageRegionIterator<LabelImageType> lit(image, segment);
+      for(; !lit.IsAtEnd(); ++lit)
+        {
+        LabelType vd = 0;
+        if(vit != vend && (*vit)[0] == lit.GetIndex()[0])
+          {
+          LabelType lOld = lit.Get();
+          if(lOld != label &&
+             (draw_over.CoverageMode == PAINT_OVER_ALL ||
+              (draw_over.CoverageMode == PAINT_OVER_ONE && lOld == draw_over.DrawOverLabel) ||
+              (draw_over.CoverageMode == PAINT_OVER_VISIBLE && lOld != 0)))
+            {
+            vd = label - lOld;
+            lit.Set(label);
+            n_changed++;
+            }
+          ++vit;
+          }
+        delta->Encode(vd);
+        }
+
+      pos = offset + segment.GetSize(0);
+      }
+
+    // Zeros to the end of the bounding box
+    delta->EncodeRun(0, bbox.GetNumberOfPixels() - pos);
+    delta->FinishEncoding();
+
+    if(n_changed == 0)
+      {
+      delete delta;
+      return NULL;
+      }
+
+    image->Modified();
+    return delta;
+  }
+};
+
+
 #endif // SegmentationUpdateIterator
@@ -61,6 +61,9 @@ public:
 
   void Encode(const TPixel &value);
 
+  /** Encode n consecutive voxels with the same value */
+  void EncodeRun(const TPixel &value, size_t n);
+
   void FinishEncoding();
 
   size_t GetNumberOfRLEs()
@@ -124,6 +127,7 @@ public:
     void DeleteDeltas();
     size_t GetNumberOfRLEs() const;
     const DList &GetDeltas() const { return m_Deltas; }
+    const std::string &GetName() const { return m_Name; }
   protected:
     DList m_Deltas;
     std::string m_Name;
@@ -149,6 +153,10 @@ public:
   size_t GetNumberOfCommits()
     { return m_CommitList.size(); }
 
+  /** Get the most recent commit (only valid if there are commits) */
+  const Commit &GetLastCommit() const
+    { return m_CommitList.back(); }
+
 private:
 
   // Current staging list - where deltas are added
@@ -16,6 +16,9 @@
 #include "InputSelectionImageFilter.h"
 #include "Rebroadcaster.h"
 
+#include <algorithm>
+#include <cmath>
+
 
 /* ===============================================================
     ColorLabelTableDisplayMappingPolicy implementation
@@ -247,6 +250,14 @@ CachingCurveAndColorMapDisplayMappingPolicy<TWrapperTraits>
   return m_Wrapper->GetHistogram(nBins);
 }
 
+template<class TWrapperTraits>
+void
+CachingCurveAndColorMapDisplayMappingPolicy<TWrapperTraits>
+::GetContrastSources(std::vector<ScalarImageWrapperBase *> &sources)
+{
+  sources.push_back(m_Wrapper);
+}
+
 template<class TWrapperTraits>
 typename CachingCurveAndColorMapDisplayMappingPolicy<TWrapperTraits>::DisplaySlicePointer
 CachingCurveAndColorMapDisplayMappingPolicy<TWrapperTraits>
@@ -379,6 +390,94 @@ AbstractContinuousImageDisplayMappingPolicy
   if(ilow >= ihigh)
     { ilow = imin; ihigh = imax; }
 
+  this->FitCurveToNativeRange(ilow, ihigh);
+}
+
+bool
+AbstractContinuousImageDisplayMappingPolicy
+::AutoFitContrastInSlices(const itk::ImageRegion<2> regions[3], unsigned long maxSamples)
+{
+  std::vector<ScalarImageWrapperBase *> sources;
+  this->GetContrastSources(sources);
+  if(sources.empty())
+    return false;
+
+  unsigned long nSlices = 0;
+  for(unsigned int dim = 0; dim < 3; dim++)
+    if(regions[dim].GetNumberOfPixels() > 0)
+      nSlices++;
+  if(nSlices == 0)
+    return false;
+
+  // The samples from all the components and slices are pooled, so each
+  // slice of each component gets its share
+  unsigned long maxPerSlice =
+      std::max(maxSamples / (unsigned long) (sources.size() * nSlices), 1ul);
+
+  std::vector<double> samples;
+  for(unsigned int i = 0; i < sources.size(); i++)
+    for(unsigned int dim = 0; dim < 3; dim++)
+      if(regions[dim].GetNumberOfPixels() > 0)
+        sources[i]->SampleNativeIntensitiesInSlice(
+              dim, regions[dim], maxPerSlice, samples);
+
+  return this->AutoFitContrastToSamples(samples);
+}
+
+bool
+AbstractContinuousImageDisplayMappingPolicy
+::AutoFitContrastInRegion(const itk::ImageRegion<3> &region, unsigned long maxSamples)
+{
+  std::vector<ScalarImageWrapperBase *> sources;
+  this->GetContrastSources(sources);
+  if(sources.empty())
+    return false;
+
+  unsigned long maxPerSource = std::max(maxSamples / (unsigned long) sources.size(), 1ul);
+
+  std::vector<double> samples;
+  for(unsigned int i = 0; i < sources.size(); i++)
+    sources[i]->SampleNativeIntensities(region, maxPerSource, samples);
+
+  return this->AutoFitContrastToSamples(samples);
+}
+
+bool
+AbstractContinuousImageDisplayMappingPolicy
+::AutoFitContrastToSamples(std::vector<double> &samples)
+{
+  if(samples.empty())
+    return false;
+
+  // Find the 0.1% and 99.9% quantiles. After the first partial sort, the
+  // high quantile is among the samples that follow the low one
+  size_t n = samples.size();
+  size_t klow = (size_t) std::floor(0.001 * (n - 1));
+  size_t khigh = (size_t) std::ceil(0.999 * (n - 1));
+  std::nth_element(samples.begin(), samples.begin() + klow, samples.end());
+  double ilow = samples[klow];
+  std::nth_element(samples.begin() + klow, samples.begin() + khigh, samples.end());
+  double ihigh = samples[khigh];
+
+  // Same fallback as for the histogram: use the full range of the samples
+  if(ilow >= ihigh)
+    {
+    ilow = *std::min_element(samples.begin(), samples.end());
+    ihigh = *std::max_element(samples.begin(), samples.end());
+    }
+
+  // There is no window to fit in a constant region
+  if(ilow >= ihigh)
+    return false;
+
+  this->FitCurveToNativeRange(ilow, ihigh);
+  return true;
+}
+
+void
+AbstractContinuousImageDisplayMappingPolicy
+::FitCurveToNativeRange(double ilow, double ihigh)
+{
   // Compute the unit coordinate values that correspond to min and max
   Vector2d irange = this->GetNativeImageRangeForCurve();
   double factor = 1.0 / (irange[1] - irange[0]);
@@ -857,6 +956,24 @@ MultiChannelDisplayMappingPolicy<TWrapperTraits>
 
 }
 
+template<class TWrapperTraits>
+void
+MultiChannelDisplayMappingPolicy<TWrapperTraits>
+::GetContrastSources(std::vector<ScalarImageWrapperBase *> &sources)
+{
+  // Same as for the histogram: in RGB mode, the curve applies to all the
+  // components, otherwise just to the selected scalar representation
+  if(m_DisplayMode.UseRGB || m_DisplayMode.RenderAsGrid)
+    {
+    for(unsigned int i = 0; i < m_Wrapper->GetNumberOfComponents(); i++)
+      sources.push_back(m_Wrapper->GetScalarRepresentation(SCALAR_REP_COMPONENT, i));
+    }
+  else
+    {
+    sources.push_back(m_ScalarRepresentation);
+    }
+}
+
 
 template<class TWrapperTraits>
 void
@@ -149,6 +149,25 @@ public:
    */
   virtual void AutoFitContrast();
 
+  /**
+   * Automatically fit the contrast mapping to the 0.1% and 99.9% quantiles
+   * of the intensities in a region of each of the three display slices, e.g.,
+   * the part of the slice that is visible on the screen. The intensities are
+   * read from the slices generated for display, at a regular subsample of at
+   * most maxSamples voxels in total, split evenly between the slices, so this
+   * is fast even for very large images. Empty regions are skipped. If no
+   * voxels are sampled, the contrast is left unchanged and false is returned.
+   */
+  bool AutoFitContrastInSlices(const itk::ImageRegion<2> regions[3],
+                               unsigned long maxSamples = 100000);
+
+  /**
+   * Same as above, but for a region of the image, e.g., the segmentation
+   * ROI, given in the voxel coordinates of the image.
+   */
+  bool AutoFitContrastInRegion(const itk::ImageRegion<3> &region,
+                               unsigned long maxSamples = 200000);
+
   /**
    * Has the intensity curve been adjusted from its default (reset) state?
    */
@@ -159,6 +178,20 @@ public:
    */
   Vector2d GetCurveMinMaxNative();
 
+protected:
+
+  /**
+   * Get the scalar images whose intensities are mapped by the curve. When
+   * the curve is shared by several components, their samples are pooled.
+   */
+  virtual void GetContrastSources(std::vector<ScalarImageWrapperBase *> &sources) = 0;
+
+  /** Fit the contrast to the quantiles of a list of samples, reordering it */
+  bool AutoFitContrastToSamples(std::vector<double> &samples);
+
+  /** Scale the curve to map a range of native intensities to [0 1] */
+  void FitCurveToNativeRange(double ilow, double ihigh);
+
 };
 
 class AbstractCachingAndColorMapDisplayMappingPolicy
@@ -266,6 +299,9 @@ protected:
   CachingCurveAndColorMapDisplayMappingPolicy();
   ~CachingCurveAndColorMapDisplayMappingPolicy();
 
+  virtual void GetContrastSources(
+      std::vector<ScalarImageWrapperBase *> &sources) ITK_OVERRIDE;
+
 
   // Filter that generates the lookup table
   typedef IntensityToColorLookupTableImageFilter<
@@ -479,6 +515,9 @@ protected:
   MultiChannelDisplayMappingPolicy();
   ~MultiChannelDisplayMappingPolicy();
 
+  virtual void GetContrastSources(
+      std::vector<ScalarImageWrapperBase *> &sources) ITK_OVERRIDE;
+
   typedef RGBALookupTableIntensityMappingFilter<InputSliceType> ApplyLUTFilter;
   typedef itk::Image<unsigned char, 1>                         LookupTableType;
 
@@ -0,0 +1,123 @@
+#ifndef GRADIENTMAGNITUDEPERCENTILEIMAGEFILTER_H
+#define GRADIENTMAGNITUDEPERCENTILEIMAGEFILTER_H
+
+#include <itkImageToImageFilter.h>
+#include <itkSimpleDataObjectDecorator.h>
+#include <vector>
+
+/**
+ * This ITK-style filter estimates the range of the gradient magnitude of a
+ * scalar image, which is used to normalize the edge-based speed function.
+ * The gradient is computed by central differences in voxel units, as in
+ * EdgePreprocessingImageFilter, but only on a regular subsample of the
+ * voxels, so that at most MaximumNumberOfSamples voxels are visited. The
+ * output is a high percentile of the sampled gradient magnitudes, which,
+ * unlike the maximum, is not thrown off by a few noisy voxels.
+ *
+ * Like ThreadedHistogramImageFilter, the filter passes the input through and
+ * is meant to be kept in the pipeline of an image wrapper, so that the value
+ * is only recomputed when the image is modified. The image is accessed using
+ * GetPixel(), so image adaptors are supported.
+ */
+template <class TInputImage>
+class GradientMagnitudePercentileImageFilter :
+    public itk::ImageToImageFilter<TInputImage, TInputImage>
+{
+public:
+
+  /** Standard class typedefs. */
+  typedef GradientMagnitudePercentileImageFilter              Self;
+  typedef itk::ImageToImageFilter< TInputImage, TInputImage > Superclass;
+  typedef itk::SmartPointer< Self >                           Pointer;
+  typedef itk::SmartPointer< const Self >                     ConstPointer;
+
+  /** Image related typedefs. */
+  typedef TInputImage                                         InputImageType;
+  typedef typename TInputImage::Pointer                    InputImagePointer;
+  typedef typename TInputImage::RegionType                        RegionType;
+  typedef typename TInputImage::IndexType                          IndexType;
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self)
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(GradientMagnitudePercentileImageFilter, ImageToImageFilter)
+
+  /** Type of DataObjects used for scalar outputs */
+  typedef itk::SimpleDataObjectDecorator<double> DoubleObjectType;
+
+  /** The percentile of the gradient magnitude to compute, between 0 and 100 */
+  itkSetMacro(Percentile, double)
+  itkGetMacro(Percentile, double)
+
+  /** The largest number of voxels at which the gradient is sampled */
+  itkSetMacro(MaximumNumberOfSamples, unsigned long)
+  itkGetMacro(MaximumNumberOfSamples, unsigned long)
+
+  /** The percentile of the gradient magnitude */
+  double GetPercentileValue() const { return this->GetPercentileOutput()->Get(); }
+  DoubleObjectType *GetPercentileOutput();
+  const DoubleObjectType *GetPercentileOutput() const;
+
+  /** The largest gradient magnitude among the sampled voxels */
+  itkGetConstMacro(MaximumValue, double)
+
+  /** The stride along each axis used by the last update */
+  itkGetConstMacro(Stride, unsigned int)
+
+protected:
+
+  GradientMagnitudePercentileImageFilter();
+  virtual ~GradientMagnitudePercentileImageFilter() {}
+  void PrintSelf(std::ostream & os, itk::Indent indent) const ITK_OVERRIDE;
+
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType DataObjectPointerArraySizeType;
+  using Superclass::MakeOutput;
+  virtual itk::DataObject::Pointer MakeOutput(DataObjectPointerArraySizeType idx) ITK_OVERRIDE;
+
+  /** Pass the input through unmodified. Do this by Grafting in the
+    AllocateOutputs method. */
+  void AllocateOutputs() ITK_OVERRIDE;
+
+  /** Pick the stride and initialize the per-thread samples */
+  void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  /** Pool the samples and compute the percentile */
+  void AfterThreadedGenerateData() ITK_OVERRIDE;
+
+  /** Multi-thread version GenerateData. */
+  void  ThreadedGenerateData(const RegionType &outputRegionForThread,
+                             itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+  // Override since the filter needs all the data for the algorithm
+  void GenerateInputRequestedRegion() ITK_OVERRIDE;
+
+  // Override since the filter produces all of its output
+  void EnlargeOutputRequestedRegion(itk::DataObject *data) ITK_OVERRIDE;
+
+private:
+
+  GradientMagnitudePercentileImageFilter(const Self &); //purposely not implemented
+  void operator=(const Self &);                         //purposely not implemented
+
+  // Parameters
+  double m_Percentile;
+  unsigned long m_MaximumNumberOfSamples;
+
+  // Subsampling stride, same along all axes
+  unsigned int m_Stride;
+
+  // Largest sampled value
+  double m_MaximumValue;
+
+  // Per-thread gradient magnitude samples
+  std::vector< std::vector<float> > m_ThreadSamples;
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "GradientMagnitudePercentileImageFilter.hxx"
+#endif
+
+#endif // GRADIENTMAGNITUDEPERCENTILEIMAGEFILTER_H
@@ -0,0 +1,200 @@
+#ifndef GRADIENTMAGNITUDEPERCENTILEIMAGEFILTER_HXX
+#define GRADIENTMAGNITUDEPERCENTILEIMAGEFILTER_HXX
+
+#include "GradientMagnitudePercentileImageFilter.h"
+#include "ImageFunctions.h"
+#include <algorithm>
+#include <cmath>
+
+template <class TInputImage>
+GradientMagnitudePercentileImageFilter<TInputImage>
+::GradientMagnitudePercentileImageFilter()
+{
+  this->SetNumberOfRequiredOutputs(2);
+  this->ProcessObject::SetNthOutput(1, this->MakeOutput(1));
+  this->GetPercentileOutput()->Set(0.0);
+
+  m_Percentile = 99.9;
+  m_MaximumNumberOfSamples = 1 << 20;
+  m_Stride = 1;
+  m_MaximumValue = 0.0;
+}
+
+template <class TInputImage>
+itk::DataObject::Pointer
+GradientMagnitudePercentileImageFilter<TInputImage>
+::MakeOutput(DataObjectPointerArraySizeType idx)
+{
+  if(idx == 1)
+    return DoubleObjectType::New().GetPointer();
+  return TInputImage::New().GetPointer();
+}
+
+template <class TInputImage>
+typename GradientMagnitudePercentileImageFilter<TInputImage>::DoubleObjectType *
+GradientMagnitudePercentileImageFilter<TInputImage>
+::GetPercentileOutput()
+{
+  return static_cast<DoubleObjectType *>(this->ProcessObject::GetOutput(1));
+}
+
+template <class TInputImage>
+const typename GradientMagnitudePercentileImageFilter<TInputImage>::DoubleObjectType *
+GradientMagnitudePercentileImageFilter<TInputImage>
+::GetPercentileOutput() const
+{
+  return static_cast<const DoubleObjectType *>(this->ProcessObject::GetOutput(1));
+}
+
+template <class TInputImage>
+void
+GradientMagnitudePercentileImageFilter<TInputImage>
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+  if ( this->GetInput() )
+    {
+    InputImagePointer image =
+      const_cast< typename Superclass::InputImageType * >( this->GetInput() );
+    image->SetRequestedRegionToLargestPossibleRegion();
+    }
+}
+
+template <class TInputImage>
+void
+GradientMagnitudePercentileImageFilter<TInputImage>
+::EnlargeOutputRequestedRegion(itk::DataObject *data)
+{
+  Superclass::EnlargeOutputRequestedRegion(data);
+  data->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <class TInputImage>
+void
+GradientMagnitudePercentileImageFilter<TInputImage>
+::AllocateOutputs()
+{
+  // Pass the input through as the output
+  InputImagePointer image =
+    const_cast< TInputImage * >( this->GetInput() );
+
+  this->GraftOutput(image);
+}
+
+template <class TInputImage>
+void
+GradientMagnitudePercentileImageFilter<TInputImage>
+::BeforeThreadedGenerateData()
+{
+  // Find the smallest stride that keeps the number of samples under the limit
+  m_Stride = GetRegularSamplingStride(this->GetInput()->GetBufferedRegion(),
+                                      m_MaximumNumberOfSamples);
+
+  m_ThreadSamples.clear();
+  m_ThreadSamples.resize(this->GetNumberOfThreads());
+}
+
+template <class TInputImage>
+void
+GradientMagnitudePercentileImageFilter<TInputImage>
+::ThreadedGenerateData(const RegionType &outputRegionForThread,
+                       itk::ThreadIdType threadId)
+{
+  if ( outputRegionForThread.GetNumberOfPixels() == 0 )
+    return;
+
+  const TInputImage *input = this->GetInput();
+  const RegionType &region = input->GetBufferedRegion();
+
+  // The central difference weights. The gradient is in voxel units, like the
+  // gradient computed by EdgePreprocessingImageFilter, which it normalizes
+  double w[ImageDimension];
+  for(unsigned int d = 0; d < ImageDimension; d++)
+    w[d] = 0.5;
+
+  // The first and last sampled index in the thread's region along each axis.
+  // The samples lie on a grid aligned with the image, regardless of how the
+  // image is split between the threads
+  IndexType first, last, idx;
+  for(unsigned int d = 0; d < ImageDimension; d++)
+    {
+    long r0 = region.GetIndex(d);
+    long t0 = outputRegionForThread.GetIndex(d);
+    long t1 = t0 + outputRegionForThread.GetSize(d) - 1;
+    first[d] = r0 + ((t0 - r0 + m_Stride - 1) / m_Stride) * m_Stride;
+    last[d] = t1;
+    if(first[d] > last[d])
+      return;
+    }
+
+  std::vector<float> &samples = m_ThreadSamples[threadId];
+
+  // Visit the sample grid, with the first axis changing fastest
+  idx = first;
+  while(true)
+    {
+    // Compute the gradient with zero flux boundary conditions
+    double gmag2 = 0.0;
+    for(unsigned int d = 0; d < ImageDimension; d++)
+      {
+      IndexType iPrev = idx, iNext = idx;
+      if(iPrev[d] > region.GetIndex(d))
+        iPrev[d]--;
+      if(iNext[d] < (long) (region.GetIndex(d) + region.GetSize(d) - 1))
+        iNext[d]++;
+      double g = w[d] * (static_cast<double>(input->GetPixel(iNext))
+                         - static_cast<double>(input->GetPixel(iPrev)));
+      gmag2 += g * g;
+      }
+    samples.push_back(static_cast<float>(sqrt(gmag2)));
+
+    // Move to the next sample
+    unsigned int k = 0;
+    for(; k < ImageDimension; k++)
+      {
+      idx[k] += m_Stride;
+      if(idx[k] <= last[k])
+        break;
+      idx[k] = first[k];
+      }
+    if(k == ImageDimension)
+      break;
+    }
+}
+
+template <class TInputImage>
+void
+GradientMagnitudePercentileImageFilter<TInputImage>
+::AfterThreadedGenerateData()
+{
+  // Pool the samples from all the threads
+  std::vector<float> samples;
+  for(unsigned int i = 0; i < m_ThreadSamples.size(); i++)
+    samples.insert(samples.end(), m_ThreadSamples[i].begin(), m_ThreadSamples[i].end());
+  m_ThreadSamples.clear();
+
+  double value = 0.0;
+  m_MaximumValue = 0.0;
+  if(samples.size())
+    {
+    // Find the percentile and the maximum without sorting
+    size_t k = (size_t) floor((samples.size() - 1) * std::min(100.0, std::max(0.0, m_Percentile)) / 100.0);
+    std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+    value = samples[k];
+    m_MaximumValue = *std::max_element(samples.begin() + k, samples.end());
+    }
+
+  this->GetPercentileOutput()->Set(value);
+}
+
+template <class TInputImage>
+void
+GradientMagnitudePercentileImageFilter<TInputImage>
+::PrintSelf(std::ostream &os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Percentile: " << m_Percentile << std::endl;
+  os << indent << "MaximumNumberOfSamples: " << m_MaximumNumberOfSamples << std::endl;
+}
+
+#endif // GRADIENTMAGNITUDEPERCENTILEIMAGEFILTER_HXX
@@ -66,14 +66,50 @@
 #include <itkTimeProbe.h>
 #include "itksys/MD5.h"
 #include "ExtendedGDCMSerieHelper.h"
+#include "SharedImageSegment.h"
+#include "ImageFingerprint.h"
 #include "itkComposeImageFilter.h"
 #include "itkStreamingImageFilter.h"
 
 #include <itk_zlib.h>
+#include <memory>
+#include <cstring>
 
 
 using namespace std;
 
+/**
+ * A pixel container that wraps the data of a shared memory segment and keeps
+ * the segment mapped for as long as the container exists. The container does
+ * not own the memory, so ITK never frees or reallocates it.
+ */
+template <class TElement>
+class SharedImageImportContainer
+    : public itk::ImportImageContainer<itk::SizeValueType, TElement>
+{
+public:
+  typedef SharedImageImportContainer                               Self;
+  typedef itk::ImportImageContainer<itk::SizeValueType, TElement>  Superclass;
+  typedef itk::SmartPointer<Self>                                  Pointer;
+  typedef itk::SmartPointer<const Self>                            ConstPointer;
+
+  itkNewMacro(Self)
+  itkTypeMacro(SharedImageImportContainer, ImportImageContainer)
+
+  void SetSegment(const std::shared_ptr<SharedImageSegment> &segment)
+    {
+    m_Segment = segment;
+    this->SetImportPointer(static_cast<TElement *>(segment->GetData()),
+                           segment->GetDataSize() / sizeof(TElement), false);
+    }
+
+protected:
+  SharedImageImportContainer() {}
+  virtual ~SharedImageImportContainer() {}
+
+  std::shared_ptr<SharedImageSegment> m_Segment;
+};
+
 bool GuidedNativeImageIO::m_StaticDataInitialized = false;
 
 RegistryEnumMap<GuidedNativeImageIO::FileFormat> GuidedNativeImageIO::m_EnumFileFormat;
@@ -297,6 +333,7 @@ GuidedNativeImageIO
   m_NativeFileName = "";
   m_NativeByteOrder = itk::ImageIOBase::OrderNotApplicable;
   m_NativeSizeInBytes = 0;
+  m_ShareNativeImage = false;
 }
 
 GuidedNativeImageIO::FileFormat 
@@ -568,7 +605,16 @@ GuidedNativeImageIO
 {
   // Based on the component type, read image in native mode
   DispatchBase *dispatch = this->CreateDispatch(m_IOBase->GetComponentType());
-  dispatch->ReadNative(this, m_NativeFileName.c_str(), m_Hints);
+  m_SharedImageData = NULL;
+
+  // Use the copy of the image published by another session if there is one.
+  // Otherwise, read the file and publish the image for the other sessions
+  if(!m_ShareNativeImage || !dispatch->ReadShared(this))
+    {
+    dispatch->ReadNative(this, m_NativeFileName.c_str(), m_Hints);
+    if(m_ShareNativeImage)
+      dispatch->PublishShared(this);
+    }
   delete dispatch;
 
   // Get rid of the IOBase, it may store useless data (in case of NIFTI)
@@ -916,6 +962,140 @@ GuidedNativeImageIO
   return std::string(hex_code);
 }
 
+bool
+GuidedNativeImageIO
+::GetSharedMemoryIdentity(std::string &key, std::string &hash)
+{
+  // A series of DICOM files is not identified by a single file
+  if(m_FileFormat == FORMAT_DICOM_DIR && m_DICOMFiles.size() > 1)
+    return false;
+
+  // The hints that affect the loaded data are part of the key
+  std::ostringstream extra;
+  extra << m_Hints["Format"][""] << "|" << m_Hints["DICOM.SeriesId"][""] << "|";
+  if(m_Hints.HasFolder("Raw"))
+    m_Hints.Folder("Raw").Print(extra);
+
+  // The file is identified by its path, size and modification time, so the
+  // segment can be found and matched to the file without reading the file
+  key = SharedImageSegment::MakeKey(m_NativeFileName.c_str(), extra.str());
+  hash = SharedImageSegment::MakeFileHash(m_NativeFileName.c_str(), extra.str());
+  return !key.empty() && !hash.empty();
+}
+
+template<typename TScalar>
+bool
+GuidedNativeImageIO
+::DoReadNativeFromSharedMemory()
+{
+  typedef itk::VectorImage<TScalar, 3> NativeImageType;
+  typedef SharedImageImportContainer<TScalar> ContainerType;
+
+  std::string key, file_hash;
+  if(!this->GetSharedMemoryIdentity(key, file_hash))
+    return false;
+
+  std::shared_ptr<SharedImageSegment> segment(new SharedImageSegment());
+  if(!segment->Attach(key))
+    return false;
+
+  // The shared image must come from the same file and agree with its header
+  const SharedImageSegment::ImageInfo &info = segment->GetImageInfo();
+  size_t nvox = 1;
+  bool match = (segment->GetFileHash() == file_hash
+                && info.ComponentType == (int) m_NativeType
+                && info.NumberOfComponents == m_NativeComponents);
+  for(int i = 0; i < 3; i++)
+    {
+    match = match && info.Size[i] == m_NativeDimensions[i];
+    nvox *= info.Size[i];
+    }
+  if(!match || segment->GetDataSize() != nvox * m_NativeComponents * sizeof(TScalar))
+    return false;
+
+  // Create a native image around the shared data
+  typename NativeImageType::Pointer image = NativeImageType::New();
+  typename NativeImageType::RegionType region;
+  typename NativeImageType::SpacingType spacing;
+  typename NativeImageType::PointType origin;
+  typename NativeImageType::DirectionType direction;
+  for(int i = 0; i < 3; i++)
+    {
+    region.SetSize(i, info.Size[i]);
+    spacing[i] = info.Spacing[i];
+    origin[i] = info.Origin[i];
+    for(int j = 0; j < 3; j++)
+      direction(i, j) = info.Direction[3 * i + j];
+    }
+
+  image->SetRegions(region);
+  image->SetSpacing(spacing);
+  image->SetOrigin(origin);
+  image->SetDirection(direction);
+  image->SetNumberOfComponentsPerPixel(m_NativeComponents);
+  image->SetMetaDataDictionary(m_IOBase->GetMetaDataDictionary());
+
+  typename ContainerType::Pointer pc = ContainerType::New();
+  pc->SetSegment(segment);
+  image->SetPixelContainer(pc);
+
+  // The file identity does not cover the contents, so the mapped data are
+  // checked against the publisher's digest. The slabs are hashed on several
+  // threads, which is much faster than reading the file again
+  ImageFingerprint fp;
+  fp.Compute(ImageFingerprint::BufferSliceSource<NativeImageType>(image));
+  if(fp.GetDigest() != segment->GetContentDigest())
+    return false;
+
+  m_NativeImage = image;
+  m_SharedImageData = pc.GetPointer();
+  return true;
+}
+
+template<typename TScalar>
+void
+GuidedNativeImageIO
+::DoPublishNativeToSharedMemory()
+{
+  typedef itk::VectorImage<TScalar, 3> NativeImageType;
+  typedef SharedImageImportContainer<TScalar> ContainerType;
+
+  std::string key, file_hash;
+  NativeImageType *image = dynamic_cast<NativeImageType *>(m_NativeImage.GetPointer());
+  if(!image || !this->GetSharedMemoryIdentity(key, file_hash))
+    return;
+
+  SharedImageSegment::ImageInfo info;
+  info.ComponentType = (int) m_NativeType;
+  info.NumberOfComponents = image->GetNumberOfComponentsPerPixel();
+  for(int i = 0; i < 3; i++)
+    {
+    info.Size[i] = image->GetBufferedRegion().GetSize(i);
+    info.Spacing[i] = image->GetSpacing()[i];
+    info.Origin[i] = image->GetOrigin()[i];
+    for(int j = 0; j < 3; j++)
+      info.Direction[3 * i + j] = image->GetDirection()(i, j);
+    }
+
+  // Digest of the data, which attaching sessions check the mapping against
+  ImageFingerprint fp;
+  fp.Compute(ImageFingerprint::BufferSliceSource<NativeImageType>(image));
+
+  // This fails if another session has already published the same file, in
+  // which case we keep our own copy
+  std::shared_ptr<SharedImageSegment> segment(new SharedImageSegment());
+  size_t size = image->GetPixelContainer()->Size() * sizeof(TScalar);
+  if(!segment->Publish(key, info, image->GetBufferPointer(), size,
+                       file_hash, fp.GetDigest()))
+    return;
+
+  // Switch to the shared copy, releasing our own
+  typename ContainerType::Pointer pc = ContainerType::New();
+  pc->SetSegment(segment);
+  image->SetPixelContainer(pc);
+  m_SharedImageData = pc.GetPointer();
+}
+
 
 
 
@@ -1267,6 +1447,15 @@ CastNativeImage<TOutputImage,TCastFunctor>
   // Pointer to the input buffer
   TNative *ib = ipc->GetImportPointer();
 
+  // Shared memory can not be resized or handed over, so convert a copy
+  if(dynamic_cast<SharedImageImportContainer<TNative> *>(ipc))
+    {
+    nbNative = ipc->Size() * szNative;
+    TNative *copy = reinterpret_cast<TNative *>(malloc(nbNative));
+    memcpy(copy, ib, nbNative);
+    ib = copy;
+    }
+
   // If target is larger than native, expand the pixel container
   if(nbNative < nbTarget)
     {
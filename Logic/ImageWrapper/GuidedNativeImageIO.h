@@ -179,6 +179,10 @@ public:
   Vector3ui GetDimensionsOfNativeImage() const
     { return m_NativeDimensions; }
 
+  /** Get the IO hints that were passed to ReadNativeImageHeader() */
+  const Registry &GetHints() const
+    { return m_Hints; }
+
   /**
    * This method returns the image internally stored in this object. This is
    * a pointer to an itk::VectorImage of some native format. Use one of the
@@ -207,6 +211,23 @@ public:
    */
   std::string GetNativeImageMD5Hash();
 
+  /**
+   * Allow the native image to be shared with other SNAP sessions on this
+   * machine (see SharedImageSegment). When this is on, ReadNativeImageData()
+   * first tries to map the data published by another session that loaded the
+   * same file, and otherwise publishes the data it reads from the file. Off by
+   * default; it should only be turned on for images that are not edited.
+   */
+  irisGetSetMacro(ShareNativeImage, bool)
+
+  /**
+   * When the native image is shared, this object keeps the shared memory
+   * mapped. Holding on to it after the native image is discarded keeps the
+   * data available to the other sessions.
+   */
+  itk::Object *GetSharedImageData() const
+    { return m_SharedImageData; }
+
   /**
    * Discard the native image. Use this once you've cast the native image to 
    * the format of interest.
@@ -303,12 +324,20 @@ protected:
   /** Templated function that computes an MD5 hash from the stored image */
   template <typename TScalar> std::string DoGetNativeMD5Hash();
 
+  /** Templated function that maps the native image published by another session */
+  template <typename TScalar> bool DoReadNativeFromSharedMemory();
+
+  /** Templated function that publishes the native image for other sessions */
+  template <typename TScalar> void DoPublishNativeToSharedMemory();
+
   /** A dispatch class that calls templated functions in the main class. */
   class DispatchBase {
   public:
     virtual void ReadNative(GuidedNativeImageIO *self, const char *fname, Registry &folder) = 0;
     virtual void SaveNative(GuidedNativeImageIO *self, const char *fname, Registry &folder) = 0;
     virtual std::string GetNativeMD5Hash(GuidedNativeImageIO *self) = 0;
+    virtual bool ReadShared(GuidedNativeImageIO *self) = 0;
+    virtual void PublishShared(GuidedNativeImageIO *self) = 0;
     virtual ~DispatchBase() {}
   };
 
@@ -320,6 +349,10 @@ protected:
       { self->DoSaveNative<TScalar>(fname, folder); }
     virtual std::string GetNativeMD5Hash(GuidedNativeImageIO *self)
       { return self->DoGetNativeMD5Hash<TScalar>(); }
+    virtual bool ReadShared(GuidedNativeImageIO *self)
+      { return self->DoReadNativeFromSharedMemory<TScalar>(); }
+    virtual void PublishShared(GuidedNativeImageIO *self)
+      { self->DoPublishNativeToSharedMemory<TScalar>(); }
   };
 
   /** 
@@ -367,6 +400,15 @@ protected:
   // Number of images per z-position in the DICOM series (e.g., multi-echo data)
   int m_DICOMImagesPerIPP;
 
+  // Sharing of the native image with other sessions
+  bool m_ShareNativeImage;
+  SmartPtr<itk::Object> m_SharedImageData;
+
+  // Key of the shared memory segment for the current file and the hash of
+  // the file identity that matches the segment to the file. Returns false if
+  // the image can not be shared
+  bool GetSharedMemoryIdentity(std::string &key, std::string &hash);
+
   /** Registry mappings for these enums */
   static bool m_StaticDataInitialized;
   static RegistryEnumMap<FileFormat> m_EnumFileFormat;
@@ -49,6 +49,8 @@
 #include "itkRegionOfInterestImageFilter.h"
 #include "itkIdentityTransform.h"
 #include "AdaptiveSlicingPipeline.h"
+#include "FastAffineResampleImageFilter.h"
+#include "LabelResampleImageFilter.h"
 #include "SNAPSegmentationROISettings.h"
 #include "itkCommand.h"
 #include "ImageCoordinateGeometry.h"
@@ -72,6 +74,7 @@
 #include "itkTransform.h"
 #include "itkExtractImageFilter.h"
 #include "AffineTransformHelper.h"
+#include "ImageFingerprint.h"
 
 
 #include <vnl/vnl_inverse.h>
@@ -140,6 +143,13 @@ public:
                         image->GetNameOfClass());
     return NULL;
   }
+
+  static void UpdateFingerprint(ImageType *image, ImageFingerprint &fp,
+                                bool incremental, unsigned int z0, unsigned int z1)
+  {
+    throw IRISException("UpdateFingerprint unsupported for class %s",
+                        image->GetNameOfClass());
+  }
 };
 
 template <class TImage>
@@ -156,6 +166,17 @@ public:
     image->FillBuffer(p);
   }
 
+  // Hash the whole buffer, or only the slabs containing slices z0 to z1
+  static void UpdateFingerprint(ImageType *image, ImageFingerprint &fp,
+                                bool incremental, unsigned int z0, unsigned int z1)
+  {
+    ImageFingerprint::BufferSliceSource<ImageType> source(image);
+    if(incremental)
+      fp.UpdateSlices(source, z0, z1);
+    else
+      fp.Compute(source);
+  }
+
   static void Write(ImageType *image, const char *fname, Registry &hints)
   {
     SmartPtr<GuidedNativeImageIO> io = GuidedNativeImageIO::New();
@@ -209,6 +230,27 @@ public:
             element_product((to_double(vROIIndex) - 0.5), vOldSpacing) +
             vNewSpacing * 0.5);
 
+      // Affine transforms with the common interpolation modes are resampled
+      // by a dedicated filter that is much faster than the ITK one
+      typedef FastAffineResampleImageFilter<ImageType, ImageType> FastResampleFilterType;
+      if(FastResampleFilterType::CanResample(transform, roi.GetInterpolationMethod()))
+        {
+        typename FastResampleFilterType::Pointer fltFast = FastResampleFilterType::New();
+        fltFast->SetInput(image);
+        fltFast->SetTransform(transform);
+        fltFast->SetInterpolationMethod(roi.GetInterpolationMethod());
+        fltFast->SetSize(to_itkSize(roi.GetResampleDimensions()));
+        fltFast->SetOutputSpacing(vNewSpacing.data_block());
+        fltFast->SetOutputOrigin(vNewOrigin.data_block());
+        fltFast->SetOutputDirection(refspace->GetDirection());
+
+        if(progressCommand)
+          fltFast->AddObserver(itk::AnyEvent(),progressCommand);
+
+        fltFast->Update();
+        return fltFast->GetOutput();
+        }
+
       // Create a filter for resampling the image
       typedef itk::ResampleImageFilter<ImageType,ImageType> ResampleFilterType;
       typename ResampleFilterType::Pointer fltSample = ResampleFilterType::New();
@@ -371,6 +413,16 @@ public:
     image->FillBuffer(p);
   }
 
+  static void UpdateFingerprint(ImageType *image, ImageFingerprint &fp,
+                                bool incremental, unsigned int z0, unsigned int z1)
+  {
+    ImageFingerprint::RLESliceSource<ImageType> source(image);
+    if(incremental)
+      fp.UpdateSlices(source, z0, z1);
+    else
+      fp.Compute(source);
+  }
+
   static void Write(ImageType *image, const char *fname, Registry &hints)
   {
     //use specialized RoI filter to convert to itk::Image
@@ -432,6 +484,36 @@ public:
               element_product((to_double(vROIIndex) - 0.5), vOldSpacing) +
               vNewSpacing * 0.5);
 
+          // Affine transforms are resampled by a label-aware filter, which
+          // interpolates each label separately and assigns the label with the
+          // largest weight, rather than interpolating the label values. It
+          // writes the run-length encoded output directly
+          typedef LabelResampleImageFilter<ImageType> LabelResampleFilterType;
+          if (LabelResampleFilterType::CanResample(transform))
+          {
+              // Only the region of interest is sampled
+              typedef itk::RegionOfInterestImageFilter<ImageType, ImageType> ChopFilterType;
+              typename ChopFilterType::Pointer fltChop = ChopFilterType::New();
+              fltChop->SetInput(image);
+              fltChop->SetRegionOfInterest(roi.GetROI());
+              fltChop->Update();
+
+              typename LabelResampleFilterType::Pointer fltLabel = LabelResampleFilterType::New();
+              fltLabel->SetInput(fltChop->GetOutput());
+              fltLabel->SetTransform(transform);
+              fltLabel->SetInterpolationMethod(roi.GetInterpolationMethod());
+              fltLabel->SetSize(to_itkSize(roi.GetResampleDimensions()));
+              fltLabel->SetOutputSpacing(vNewSpacing.data_block());
+              fltLabel->SetOutputOrigin(vNewOrigin.data_block());
+              fltLabel->SetOutputDirection(ref_space->GetDirection());
+
+              if (progressCommand)
+                  fltLabel->AddObserver(itk::AnyEvent(), progressCommand);
+
+              fltLabel->Update();
+              return fltLabel->GetOutput();
+          }
+
           //use specialized RoI filter to convert the region to be resampled to itk::Image
           typedef itk::RegionOfInterestImageFilter<ImageType, UncompressedType> outConverterType;
           typename outConverterType::Pointer outConv = outConverterType::New();
@@ -490,38 +572,12 @@ public:
                                         bool force_resampling,
                                         itk::Command *progressCommand)
   {
-    //the interpolator will operate on uncompressed region
+    // The interpolator is only used for transforms that the label-aware
+    // filter can not handle, and operates on the uncompressed region. Any
+    // other interpolator would produce labels that are not in the image
     typedef itk::InterpolateImageFunction<UncompressedType> Interpolator;
-    SmartPtr<Interpolator> interp = NULL;
-
-    // Choose the interpolator
-    switch(roi.GetInterpolationMethod())
-      {
-      case NEAREST_NEIGHBOR :
-        typedef itk::NearestNeighborInterpolateImageFunction<UncompressedType, double> NNInterpolatorType;
-        interp = NNInterpolatorType::New().GetPointer();
-        break;
-
-      case TRILINEAR:
-          typedef itk::LinearInterpolateImageFunction<UncompressedType, double> LinearInterpolatorType;
-          interp = LinearInterpolatorType::New().GetPointer();
-          break;
-
-      case TRICUBIC:
-          typedef itk::BSplineInterpolateImageFunction<UncompressedType, double> CubicInterpolatorType;
-          interp = CubicInterpolatorType::New().GetPointer();
-          break;
-
-      case SINC_WINDOW_05:
-          // More typedefs are needed for the sinc interpolator
-          static const unsigned int VRadius = 5;
-          typedef itk::Function::HammingWindowFunction<VRadius> WindowFunction;
-          typedef itk::ConstantBoundaryCondition<UncompressedType> Condition;
-          typedef itk::WindowedSincInterpolateImageFunction<
-              UncompressedType, VRadius, WindowFunction, Condition, double> SincInterpolatorType;
-          interp = SincInterpolatorType::New().GetPointer();
-          break;
-      };
+    typedef itk::NearestNeighborInterpolateImageFunction<UncompressedType, double> NNInterpolatorType;
+    SmartPtr<Interpolator> interp = NNInterpolatorType::New().GetPointer();
 
     return Self::template DeepCopyImageRegion<Interpolator>(image, refspace, transform, interp, roi, force_resampling, progressCommand);
   }
@@ -542,6 +598,7 @@ ImageWrapper<TTraits,TBase>
 {
   Reset();
   delete m_IOHints;
+  delete m_Fingerprint;
 }
 
 template<class TTraits, class TBase>
@@ -561,6 +618,10 @@ ImageWrapper<TTraits,TBase>
   // Create empty IO hints
   m_IOHints = new Registry();
 
+  // The fingerprint is computed on demand
+  m_Fingerprint = new ImageFingerprint();
+  m_FingerprintMTime = 0;
+
   // Create slicer objects
   m_Slicer[0] = SlicerType::New();
   m_Slicer[1] = SlicerType::New();
@@ -865,6 +926,8 @@ ImageWrapper<TTraits,TBase>
   // For orthogonal slicing to be usable, two conditions must be met
   //   1. The reference space and the new image must have the same geometry
   //   2. The transform must be identity
+  // Otherwise, the slicing pipeline still avoids 3D interpolation when the
+  // image grid is aligned with the display slices (see AxisAlignedSlicer)
 
   // Check if the images have same dimensions
   double tol = 1e-5;
@@ -1005,6 +1068,7 @@ ImageWrapper<TTraits,TBase>
 
   // Store the time when the image was assigned
   m_ImageAssignTime = m_Image->GetTimeStamp();
+  m_Fingerprint->Reset();
 }
 
 template<class TTraits, class TBase>
@@ -1362,6 +1426,14 @@ ImageWrapper<TTraits,TBase>
   return traninv->GetCoordinateIndexZeroBased(2);
 }
 
+template<class TTraits, class TBase>
+itk::ImageRegion<2>
+ImageWrapper<TTraits,TBase>
+::GetDisplaySliceRegionForImageRegion(unsigned int iSlice, const itk::ImageRegion<3> &region)
+{
+  return m_Slicer[iSlice]->GetOutputRegionForInputRegion(region);
+}
+
 template<class TTraits, class TBase>
 typename ImageWrapper<TTraits,TBase>::SliceType*
 ImageWrapper<TTraits,TBase>
@@ -1553,6 +1625,7 @@ ImageWrapper<TTraits,TBase>
 
   // This is so that IsDrawable() behaves correctly
   m_ImageAssignTime = m_Image->GetTimeStamp();
+  m_Fingerprint->Reset();
 }
 
 template<class TTraits, class TBase>
@@ -1575,16 +1648,20 @@ ImageWrapper<TTraits,TBase>
 }
 
 
-struct RemoveTransparencyFunctor
+// Range of the slice pixels [lo, hi) whose centers are covered by a
+// thumbnail pixel centered at u with radius r, in slice index units. When
+// the thumbnail pixel is smaller than a slice pixel, the nearest pixel is used
+static void ComputeThumbnailFootprint(double u, double r, int n, int &lo, int &hi)
 {
-  typedef ImageWrapperBase::DisplayPixelType PixelType;
-  PixelType operator()(const PixelType &p)
-  {
-    PixelType pnew = p;
-    pnew[3] = 255;
-    return pnew;
-  }
-};
+  lo = std::max(0, (int) std::ceil(u - r));
+  hi = std::min(n, (int) std::ceil(u + r));
+  if(hi <= lo)
+    {
+    int i = (int) std::floor(u + 0.5);
+    lo = (i >= 0 && i < n) ? i : 0;
+    hi = (i >= 0 && i < n) ? i + 1 : 0;
+    }
+}
 
 template<class TTraits, class TBase>
 typename ImageWrapper<TTraits,TBase>::DisplaySlicePointer
@@ -1593,15 +1670,17 @@ ImageWrapper<TTraits,TBase>
 {
   // For images with extreme aspect ratios (greater than 1:2) we
   // choose the direction in which the aspect ratio is closest to
-  // one. Otherwise, we choose the axial direction.
+  // one. Otherwise, we choose the axial direction. The extents of the
+  // slices are known without updating the slices.
   double aspect_ratio[3];
   for(int i = 0; i < 3; i++)
     {
     // Get the slice
-    DisplaySliceType *slice = this->GetDisplaySlice(2);
+    DisplaySliceType *slice = this->GetDisplaySlice(i);
+    slice->GetSource()->UpdateOutputInformation();
 
     // The size of the slice
-    Vector2ui slice_dim = slice->GetBufferedRegion().GetSize();
+    Vector2ui slice_dim = slice->GetLargestPossibleRegion().GetSize();
 
     // The physical extents of the slice
     Vector2d slice_extent(slice->GetSpacing()[0] * slice_dim[0],
@@ -1623,67 +1702,71 @@ ImageWrapper<TTraits,TBase>
   else
     thumb_axis = 0;
 
-  // Get the display slice
-  // For now, just use the z-axis for exporting the thumbnails
+  // Get the display slice, updating only the chosen one
   DisplaySliceType *slice = this->GetDisplaySlice(thumb_axis);
   slice->GetSource()->UpdateLargestPossibleRegion();
 
   // The size of the slice
   Vector2ui slice_dim = slice->GetBufferedRegion().GetSize();
+  int nx = slice_dim[0], ny = slice_dim[1];
 
   // The physical extents of the slice
   Vector2d slice_extent(slice->GetSpacing()[0] * slice_dim[0],
                         slice->GetSpacing()[1] * slice_dim[1]);
 
-  // The output thumbnail will have the extents as the slice, but its size
-  // must be at max maxdim
+  // The output thumbnail is a square with the larger of the extents of the
+  // slice, centered on the slice. Its pixel size in slice pixel units
   double slice_extent_max = slice_extent.max_value();
+  double step[2] = { slice_extent_max / (maxdim * slice->GetSpacing()[0]),
+                     slice_extent_max / (maxdim * slice->GetSpacing()[1]) };
+
+  // For each row and column of the thumbnail, find the slice pixels that it
+  // covers. Each thumbnail pixel is the average of these pixels, which is
+  // what we want when shrinking the slice
+  std::vector<int> xlo(maxdim), xhi(maxdim), ylo(maxdim), yhi(maxdim);
+  for(unsigned int j = 0; j < maxdim; j++)
+    {
+    double t = j + 0.5 - 0.5 * maxdim;
+    ComputeThumbnailFootprint(0.5 * (nx - 1) + t * step[0], 0.5 * step[0], nx, xlo[j], xhi[j]);
+    ComputeThumbnailFootprint(0.5 * (ny - 1) + t * step[1], 0.5 * step[1], ny, ylo[j], yhi[j]);
+    }
+
+  // Allocate the thumbnail
+  DisplaySlicePointer result = DisplaySliceType::New();
+  typename DisplaySliceType::RegionType region;
+  region.SetSize(0, maxdim);
+  region.SetSize(1, maxdim);
+  result->SetRegions(region);
+  result->Allocate();
+
+  // Fill the thumbnail, flipping it vertically and making it opaque. The
+  // background is black
+  const DisplayPixelType *src = slice->GetBufferPointer();
+  DisplayPixelType *dst = result->GetBufferPointer();
+  for(unsigned int j1 = 0; j1 < maxdim; j1++)
+    {
+    DisplayPixelType *row = dst + (maxdim - 1 - j1) * maxdim;
+    for(unsigned int j0 = 0; j0 < maxdim; j0++)
+      {
+      unsigned int sum[3] = { 0, 0, 0 }, n = 0;
+      for(int y = ylo[j1]; y < yhi[j1]; y++)
+        {
+        const DisplayPixelType *p = src + y * nx;
+        for(int x = xlo[j0]; x < xhi[j0]; x++, n++)
+          {
+          sum[0] += p[x][0];
+          sum[1] += p[x][1];
+          sum[2] += p[x][2];
+          }
+        }
+
+      DisplayPixelType &q = row[j0];
+      for(int c = 0; c < 3; c++)
+        q[c] = n ? (unsigned char) ((sum[c] + n / 2) / n) : 0;
+      q[3] = 255;
+      }
+    }
 
-  // Create a simple square thumbnail
-  Vector2ui thumb_size(maxdim, maxdim);
-
-  // Spacing is such that the slice extent fits into the thumbnail
-  Vector2d thumb_spacing(slice_extent_max / maxdim,
-                         slice_extent_max / maxdim);
-
-  // The origin of the thumbnail is such that the centers coincide
-  Vector2d thumb_origin(0.5 * (slice_extent[0] - slice_extent_max),
-                        0.5 * (slice_extent[1] - slice_extent_max));
-
-  typedef typename itk::IdentityTransform<double, 2> TransformType;
-  TransformType::Pointer transform = TransformType::New();
-
-  typedef typename itk::ResampleImageFilter<
-      DisplaySliceType, DisplaySliceType> ResampleFilter;
-
-  // Background color for thumbnails
-  unsigned char defrgb[] = {0,0,0,255};
-
-  SmartPtr<ResampleFilter> filter = ResampleFilter::New();
-  filter->SetInput(slice);
-  filter->SetTransform(transform);
-  filter->SetSize(to_itkSize(thumb_size));
-  filter->SetOutputSpacing(thumb_spacing.data_block());
-  filter->SetOutputOrigin(thumb_origin.data_block());
-  filter->SetDefaultPixelValue(DisplayPixelType(defrgb));
-
-  // For thumbnails, the image needs to be flipped
-  typedef itk::FlipImageFilter<DisplaySliceType> FlipFilter;
-  SmartPtr<FlipFilter> flipper = FlipFilter::New();
-  flipper->SetInput(filter->GetOutput());
-  typename FlipFilter::FlipAxesArrayType flipaxes;
-  flipaxes[0] = false; flipaxes[1] = true;
-  flipper->SetFlipAxes(flipaxes);
-
-  // We also need to replace the transparency
-  typedef itk::UnaryFunctorImageFilter<
-      DisplaySliceType, DisplaySliceType, RemoveTransparencyFunctor> OpaqueFilter;
-  SmartPtr<OpaqueFilter> opaquer = OpaqueFilter::New();
-  opaquer->SetInput(flipper->GetOutput());
-
-  // Return the result
-  opaquer->Update();
-  DisplaySlicePointer result = opaquer->GetOutput();
   return result;
 }
 
@@ -1726,6 +1809,34 @@ ImageWrapper<TTraits,TBase>
   return (tsNow > m_ImageAssignTime && tsNow > m_ImageSaveTime);
 }
 
+template<class TTraits, class TBase>
+std::string
+ImageWrapper<TTraits,TBase>
+::GetContentFingerprint()
+{
+  if(!m_Image)
+    return std::string();
+
+  // Find out which slices changed, even if the image is hashed as a whole,
+  // so that the wrappers that track their edits stay in sync
+  unsigned long mtime = m_Image->GetMTime();
+  unsigned int z0 = 0, z1 = 0;
+  bool known = this->GetModifiedSlices(z0, z1);
+
+  if(mtime != m_FingerprintMTime || !m_Fingerprint->IsValid())
+    {
+    bool incremental = known && m_Fingerprint->IsValid();
+    if(!incremental || z0 <= z1)
+      {
+      typedef ImageWrapperPartialSpecializationTraits<ImageType> Specialization;
+      Specialization::UpdateFingerprint(m_Image, *m_Fingerprint, incremental, z0, z1);
+      }
+    m_FingerprintMTime = mtime;
+    }
+
+  return m_Fingerprint->GetDigest();
+}
+
 template<class TTraits, class TBase>
 void
 ImageWrapper<TTraits,TBase>
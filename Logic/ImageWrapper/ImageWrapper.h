@@ -52,6 +52,7 @@ class AdaptiveSlicingPipeline;
 
 
 class SNAPSegmentationROISettings;
+class ImageFingerprint;
 
 namespace itk {
   template <unsigned int VDimension> class ImageBase;
@@ -435,6 +436,10 @@ public:
   /** For each slicer, find out which image dimension does is slice along */
   unsigned int GetDisplaySliceImageAxis(unsigned int slice) ITK_OVERRIDE;
 
+  /** Map a region of the image to the region of a display slice it affects */
+  itk::ImageRegion<2> GetDisplaySliceRegionForImageRegion(
+      unsigned int slice, const itk::ImageRegion<3> &region) ITK_OVERRIDE;
+
   /** 
    * Replace all voxels with intensity values iOld with values iNew. 
    * \return number of voxels that had been modified
@@ -539,6 +544,12 @@ public:
    */
   virtual void WriteToFile(const char *filename, Registry &hints) ITK_OVERRIDE;
 
+  /**
+   * Fingerprint of the image contents, recomputed when the image has been
+   * modified since the last call
+   */
+  virtual std::string GetContentFingerprint() ITK_OVERRIDE;
+
   /**
    * Create a thumbnail from the image and write it to a .png file
    */
@@ -678,6 +689,19 @@ protected:
   // IO Hints registry
   Registry *m_IOHints;
 
+  // Fingerprint of the image contents, and the image time stamp when it was
+  // last updated
+  ImageFingerprint *m_Fingerprint;
+  unsigned long m_FingerprintMTime;
+
+  /**
+   * Range of slices modified since the fingerprint was last updated. Returns
+   * false if it is not known, and the whole image is hashed. Wrappers that
+   * track their edits override this; z0 > z1 means no slices were modified.
+   */
+  virtual bool GetModifiedSlices(unsigned int &z0, unsigned int &z1)
+    { return false; }
+
   /**
    * Handle a change in the image pointer (i.e., a load operation on the image or 
    * an initialization operation). This function can take two optional parameters:
@@ -269,6 +269,14 @@ public:
   /** For each slicer, find out which image dimension does is slice along */
   virtual unsigned int GetDisplaySliceImageAxis(unsigned int slice) = 0;
 
+  /**
+   * Get the region of a display slice that changes when the image changes
+   * within the given region (in voxel coordinates). The region is empty if
+   * the slice does not pass through the image region.
+   */
+  virtual itk::ImageRegion<2> GetDisplaySliceRegionForImageRegion(
+      unsigned int slice, const itk::ImageRegion<3> &region) = 0;
+
   /** Get the number of voxels */
   virtual size_t GetNumberOfVoxels() const = 0;
 
@@ -403,6 +411,15 @@ public:
    */
   virtual bool HasUnsavedChanges() const = 0;
 
+  /**
+   * A fingerprint of the image contents, for detecting whether two layers
+   * or two versions of a layer hold the same voxels. It is hashed in
+   * parallel and only slabs known to have changed are hashed again. This is
+   * not the MD5 of the image buffer used to name files; see ImageFingerprint.
+   * Layers that do not store their own image buffer throw an exception.
+   */
+  virtual std::string GetContentFingerprint() = 0;
+
   /**
    * Save metadata to a Registry file. The metadata are data that are not
    * contained in the image header are need to be restored when the image
@@ -454,7 +471,9 @@ public:
   //
 
   /**
-   * Set an ITK transform between this image and a reference image.
+   * Set an ITK transform between this image and a reference image. Besides
+   * affine transforms, this may be a displacement field transform, alone or
+   * composed with affine transforms (see AffineTransformHelper).
    */
   virtual void SetITKTransform(ImageBaseType *referenceSpace, ITKTransformType *transform) = 0;
 
@@ -546,10 +565,10 @@ public:
   virtual double GetVoxelMappedToNative(const itk::Index<3> &idx) const = 0;
 
   /**
-    Get the maximum possible value of the gradient magnitude. This will
-    compute the gradient magnitude of the image (without Gaussian smoothing)
-    and return the maximum. The value will be cached so repeated calls to
-    this are not expensive.
+    Get the upper limit of the gradient magnitude, used to normalize the
+    edge-based speed function. This is a high percentile of the gradient
+    magnitude of the image (without Gaussian smoothing), estimated on a
+    subsample of the voxels. The value is cached until the image changes.
     */
   virtual double GetImageGradientMagnitudeUpperLimit() = 0;
 
@@ -558,6 +577,25 @@ public:
     */
   virtual double GetImageGradientMagnitudeUpperLimitNative() = 0;
 
+  /**
+    Append the native intensities of a regular subsample of the voxels in a
+    region of the image to a list. The stride is the same along all axes, and
+    is the smallest one for which at most maxSamples voxels are visited. The
+    region is cropped to the image.
+    */
+  virtual void SampleNativeIntensities(
+      const itk::ImageRegion<3> &region, unsigned long maxSamples,
+      std::vector<double> &samples) = 0;
+
+  /**
+    Same as above, but for a region of the slice generated by the slicer in
+    the given display direction. Slices that are on the screen are already
+    up to date, so this does not touch the rest of the image.
+    */
+  virtual void SampleNativeIntensitiesInSlice(
+      unsigned int dim, const itk::ImageRegion<2> &region,
+      unsigned long maxSamples, std::vector<double> &samples) = 0;
+
   /**
    * Extract a GreyType representation from the image wrapper. Note that
    * internally, the scalar image wrapper can be of many itk types, e.g.,
@@ -42,15 +42,26 @@
 =========================================================================*/
 #include "LabelImageWrapper.h"
 #include "UndoDataManager.h"
+#include "SegmentationJournal.h"
 #include "Rebroadcaster.h"
+#include <algorithm>
+
+// Largest number of runs kept in the change log
+static const size_t MAX_CHANGE_LOG_RUNS = 1000000;
 
 LabelImageWrapper::LabelImageWrapper()
 {
   m_UndoManager = new UndoManagerType(4, 200000);
+  m_ChangeLogStart = 0;
+  m_ChangeLogRuns = 0;
+  m_ChangeLogMTime = 0;
+  m_FingerprintLogPosition = 0;
 }
 
 LabelImageWrapper::~LabelImageWrapper()
 {
+  // Normal unloading of the layer: the journal is no longer needed
+  this->DetachJournal();
   delete m_UndoManager;
 }
 
@@ -59,6 +70,10 @@ void LabelImageWrapper::UpdateImagePointer(
 {
   Superclass::UpdateImagePointer(image, refSpace, tran);
   m_UndoManager->Clear();
+  this->ResetChangeLog();
+
+  // The journal refers to the previous image
+  this->DetachJournal();
 
   // Modified event on the image is rebroadcast as the WrapperImageChangeEvent
   Rebroadcaster::Rebroadcast(image, itk::ModifiedEvent(),
@@ -67,6 +82,7 @@ void LabelImageWrapper::UpdateImagePointer(
 
 void LabelImageWrapper::StoreIntermediateUndoDelta(UndoManagerDelta *delta)
 {
+  this->LogChange(delta, 1);
   m_UndoManager->AddDeltaToStaging(delta);
 }
 
@@ -74,15 +90,29 @@ void LabelImageWrapper::StoreUndoPoint(const char *text, UndoManagerDelta *delta
 {
   // If there is a delta, add it to staging
   if(delta)
+    {
+    this->LogChange(delta, 1);
     m_UndoManager->AddDeltaToStaging(delta);
+    }
 
   // Commit the deltas
-  m_UndoManager->CommitStaging(text);
+  int n_rles = m_UndoManager->CommitStaging(text);
+
+  // Mirror the commit into the journal
+  if(m_Journal && n_rles > 0)
+    {
+    const UndoManagerType::Commit &commit = m_UndoManager->GetLastCommit();
+    m_Journal->AppendCommit(commit.GetDeltas(), commit.GetName(), false);
+    }
 }
 
 void LabelImageWrapper::ClearUndoPoints()
 {
   m_UndoManager->Clear();
+
+  // Undo points are cleared after edits that can not be undone, and callers
+  // may have changed the image without logging
+  this->ResetChangeLog();
 }
 
 bool LabelImageWrapper::IsUndoPossible()
@@ -95,10 +125,18 @@ void LabelImageWrapper::Undo()
   // Get the commit for the undo
   const UndoManagerType::Commit &commit = m_UndoManager->GetCommitForUndo();
 
+  // Record the undo in the journal
+  if(m_Journal)
+    m_Journal->AppendCommit(commit.GetDeltas(), commit.GetName(), true);
+
   // The label image that will undergo undo
   typedef itk::ImageRegionIterator<ImageType> IteratorType;
   ImageType *imSeg = this->GetImage();
 
+  // If the image was modified without logging, the log can not continue
+  if(imSeg->GetMTime() != m_ChangeLogMTime)
+    this->ResetChangeLog();
+
   // Iterate over all the deltas in reverse order
   UndoManagerType::DList::const_reverse_iterator dit = commit.GetDeltas().rbegin();
   for(; dit != commit.GetDeltas().rend(); ++dit)
@@ -121,10 +159,13 @@ void LabelImageWrapper::Undo()
         ++lit;
         }
       }
+
+    this->LogChange(delta, -1);
     }
 
   // Set modified flags
   imSeg->Modified();
+  m_ChangeLogMTime = imSeg->GetMTime();
 }
 
 bool LabelImageWrapper::IsRedoPossible()
@@ -137,10 +178,18 @@ void LabelImageWrapper::Redo()
   // Get the commit for the redo
   const UndoManagerType::Commit &commit = m_UndoManager->GetCommitForRedo();
 
+  // Record the redo in the journal
+  if(m_Journal)
+    m_Journal->AppendCommit(commit.GetDeltas(), commit.GetName(), false);
+
   // The label image that will undergo redo
   typedef itk::ImageRegionIterator<ImageType> IteratorType;
   ImageType *imSeg = this->GetImage();
 
+  // If the image was modified without logging, the log can not continue
+  if(imSeg->GetMTime() != m_ChangeLogMTime)
+    this->ResetChangeLog();
+
   // Iterate over all the deltas in reverse order
   UndoManagerType::DList::const_iterator dit = commit.GetDeltas().begin();
   for(; dit != commit.GetDeltas().end(); ++dit)
@@ -163,10 +212,120 @@ void LabelImageWrapper::Redo()
         ++lit;
         }
       }
+
+    this->LogChange(delta, 1);
     }
 
   // Set modified flags
   imSeg->Modified();
+  m_ChangeLogMTime = imSeg->GetMTime();
+}
+
+void LabelImageWrapper::LogChange(UndoManagerDelta *delta, int sign)
+{
+  ImageType *imSeg = this->GetImage();
+
+  LabelChange change;
+  change.Region = delta->GetRegion();
+
+  // The image already holds the new labels, and the delta holds the difference
+  // between the new and the old labels in the direction it was applied
+  itk::ImageRegionConstIterator<ImageType> it(imSeg, change.Region);
+  size_t offset = 0;
+  for(size_t i = 0; i < delta->GetNumberOfRLEs(); i++)
+    {
+    size_t n = delta->GetRLELength(i);
+    LabelType d = delta->GetRLEValue(i);
+    for(size_t j = 0; j < n; j++, ++it, ++offset)
+      {
+      if(d == 0)
+        continue;
+
+      LabelType l_new = it.Get();
+      LabelType l_old = (LabelType) (sign > 0 ? l_new - d : l_new + d);
+
+      // Extend the last run or start a new one
+      if(change.Runs.size()
+         && change.Runs.back().Offset + change.Runs.back().Length == offset
+         && change.Runs.back().OldLabel == l_old
+         && change.Runs.back().NewLabel == l_new)
+        {
+        change.Runs.back().Length++;
+        }
+      else
+        {
+        LabelChangeRun run = { offset, 1, l_old, l_new };
+        change.Runs.push_back(run);
+        }
+      }
+    }
+
+  m_ChangeLogRuns += change.Runs.size();
+  m_ChangeLog.push_back(change);
+
+  // Trim the log, but always keep the last change
+  while(m_ChangeLogRuns > MAX_CHANGE_LOG_RUNS && m_ChangeLog.size() > 1)
+    {
+    m_ChangeLogRuns -= m_ChangeLog.front().Runs.size();
+    m_ChangeLog.pop_front();
+    m_ChangeLogStart++;
+    }
+
+  m_ChangeLogMTime = imSeg->GetMTime();
+}
+
+void LabelImageWrapper::ResetChangeLog()
+{
+  // Skip a position, so that the end of the old log is no longer valid
+  m_ChangeLogStart = this->GetChangeLogEnd() + 1;
+  m_ChangeLog.clear();
+  m_ChangeLogRuns = 0;
+  m_ChangeLogMTime = this->GetImage() ? this->GetImage()->GetMTime() : 0;
+}
+
+bool LabelImageWrapper::GetChangesSince(
+    unsigned long &pos, std::vector<const LabelChange *> &changes) const
+{
+  changes.clear();
+
+  // The image has been modified in a way that was not logged
+  if(!this->GetImage() || this->GetImage()->GetMTime() != m_ChangeLogMTime)
+    return false;
+
+  // The log does not reach back to the position
+  unsigned long end = this->GetChangeLogEnd();
+  if(pos < m_ChangeLogStart || pos > end)
+    return false;
+
+  for(unsigned long k = pos; k < end; k++)
+    changes.push_back(&m_ChangeLog[k - m_ChangeLogStart]);
+
+  pos = end;
+  return true;
+}
+
+bool LabelImageWrapper::GetModifiedSlices(unsigned int &z0, unsigned int &z1)
+{
+  std::vector<const LabelChange *> changes;
+  if(!this->GetChangesSince(m_FingerprintLogPosition, changes))
+    {
+    m_FingerprintLogPosition = this->GetChangeLogEnd();
+    return false;
+    }
+
+  // Union of the slices spanned by the changes, empty if there are none
+  z0 = this->GetSize()[2];
+  z1 = 0;
+  for(size_t i = 0; i < changes.size(); i++)
+    {
+    const itk::ImageRegion<3> &region = changes[i]->Region;
+    if(region.GetSize(2) == 0)
+      continue;
+    z0 = std::min(z0, (unsigned int) region.GetIndex(2));
+    z1 = std::max(z1, (unsigned int) (region.GetIndex(2) + region.GetSize(2) - 1));
+    }
+
+  return true;
 }
 
 LabelImageWrapper::UndoManagerDelta *
@@ -182,3 +341,51 @@ LabelImageWrapper::CompressImage() const
   new_cumulative->FinishEncoding();
   return new_cumulative;
 }
+
+unsigned int LabelImageWrapper::AttachJournal(const std::string &segFile)
+{
+  // Replay the edits that were not saved the last time around
+  unsigned int n_replayed = SegmentationJournal::Replay(segFile, this->GetImage());
+
+  // Keep appending to the recovered journal, so that the recovered edits are
+  // not lost if there is another crash before the user saves
+  m_Journal = SegmentationJournal::New();
+  if(!m_Journal->Open(segFile, this->GetSize(), n_replayed > 0))
+    m_Journal = NULL;
+
+  return n_replayed;
+}
+
+void LabelImageWrapper::DetachJournal()
+{
+  if(m_Journal)
+    {
+    m_Journal->Close(true);
+    m_Journal = NULL;
+    }
+}
+
+SegmentationJournal *LabelImageWrapper::GetJournal() const
+{
+  return m_Journal;
+}
+
+void LabelImageWrapper::WriteToFile(const char *filename, Registry &hints)
+{
+  Superclass::WriteToFile(filename, hints);
+
+  // The saved file now holds all the edits. If the segmentation was saved
+  // to the file the journal is attached to, start over. Otherwise, move the
+  // journal next to the new file.
+  if(m_Journal && m_Journal->GetSegmentationFileName() == filename)
+    {
+    m_Journal->Truncate();
+    }
+  else
+    {
+    this->DetachJournal();
+    m_Journal = SegmentationJournal::New();
+    if(!m_Journal->Open(filename, this->GetSize(), false))
+      m_Journal = NULL;
+    }
+}
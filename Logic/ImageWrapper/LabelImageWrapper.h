@@ -3,9 +3,11 @@
 
 #include "ImageWrapperTraits.h"
 #include "ScalarImageWrapper.h"
+#include <deque>
 
 template <typename TPixel> class UndoDataManager;
 template <typename TPixel> class UndoDelta;
+class SegmentationJournal;
 
 class LabelImageWrapper : public ScalarImageWrapper<LabelImageWrapperTraits>
 {
@@ -30,6 +32,24 @@ public:
   typedef UndoDataManager<PixelType> UndoManagerType;
   typedef UndoDelta<PixelType>       UndoManagerDelta;
 
+  /**
+   * A run of voxels changed by an edit, given as an offset into the region of
+   * the edit (in the order of ImageRegionIterator) and the labels that the
+   * voxels had before and after the edit.
+   */
+  struct LabelChangeRun
+  {
+    size_t Offset, Length;
+    LabelType OldLabel, NewLabel;
+  };
+
+  /** The voxels changed by one delta, i.e., one edit, undo or redo step */
+  struct LabelChange
+  {
+    itk::ImageRegion<3> Region;
+    std::vector<LabelChangeRun> Runs;
+  };
+
   /**
    * We override the SetImage method to reset the undo manager when an image is
    * assigned to the segmentation.
@@ -67,6 +87,21 @@ public:
   /** Redo (undo the undo) */
   void Redo();
 
+  /** Sequence number of the next change that will be added to the change log */
+  unsigned long GetChangeLogEnd() const
+    { return m_ChangeLogStart + m_ChangeLog.size(); }
+
+  /**
+   * Get the changes made to the segmentation since the change log was at
+   * position pos (obtained from GetChangeLogEnd), in the order in which they
+   * were made, and advance pos to the end of the log. This allows derived data,
+   * such as label statistics, to be updated in proportion to the size of the
+   * edits. Returns false if the changes are not known, i.e., the log has been
+   * reset or trimmed since, or the image was modified by other means (e.g.,
+   * by replacing a label). The caller must then rescan the whole image.
+   */
+  bool GetChangesSince(unsigned long &pos, std::vector<const LabelChange *> &changes) const;
+
   /** Get the undo manager */
   itkGetMacro(UndoManager, const UndoManagerType *)
 
@@ -76,6 +111,28 @@ public:
    * array created in this call. */
   UndoManagerDelta *CompressImage() const;
 
+  /**
+   * Start mirroring the commits to the undo system into an on-disk journal
+   * next to the segmentation file, for crash recovery. If there is a valid
+   * journal for the file already (i.e., edits that were not saved before a
+   * crash), these edits are replayed onto the segmentation first, and the
+   * number of replayed commits is returned. The journal is truncated when the
+   * segmentation is saved, retargeted when it is saved to a different file,
+   * and deleted when the layer is unloaded.
+   */
+  unsigned int AttachJournal(const std::string &segFile);
+
+  /** Stop journaling and delete the journal file */
+  void DetachJournal();
+
+  /** Get the journal (may be NULL) */
+  SegmentationJournal *GetJournal() const;
+
+  /**
+   * Overridden to keep the journal in sync with the saved file
+   */
+  virtual void WriteToFile(const char *filename, Registry &hints) ITK_OVERRIDE;
+
 protected:
 
   LabelImageWrapper();
@@ -85,6 +142,31 @@ protected:
   // image. These deltas are compressed, allowing us to store a bunch of
   // undo steps with little cost in performance or memory
   UndoManagerType *m_UndoManager;
+
+  // Record the voxels changed by a delta that has just been applied to the
+  // image, in the forward (sign = 1) or backward (sign = -1) direction
+  void LogChange(UndoManagerDelta *delta, int sign);
+
+  // Forget the logged changes, e.g., after changes that are not logged
+  void ResetChangeLog();
+
+  // Log of changes in terms of old and new labels, and the sequence number of
+  // the first change in it. The log is trimmed to a maximum number of runs
+  std::deque<LabelChange> m_ChangeLog;
+  unsigned long m_ChangeLogStart;
+  size_t m_ChangeLogRuns;
+
+  // The modification time of the image after the last logged change
+  itk::ModifiedTimeType m_ChangeLogMTime;
+
+  // The fingerprint only rehashes the slices touched by logged changes
+  virtual bool GetModifiedSlices(unsigned int &z0, unsigned int &z1) ITK_OVERRIDE;
+
+  // Position in the change log up to which the fingerprint is current
+  unsigned long m_FingerprintLogPosition;
+
+  // Crash recovery journal, NULL until a file is associated with the layer
+  SmartPtr<SegmentationJournal> m_Journal;
 };
 
 #endif // LABELIMAGEWRAPPER_H
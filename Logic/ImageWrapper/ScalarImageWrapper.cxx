@@ -39,6 +39,8 @@
 #include "VectorImageWrapper.h"
 #include "ScalarImageHistogram.h"
 #include "ThreadedHistogramImageFilter.h"
+#include "GradientMagnitudePercentileImageFilter.h"
+#include "ImageFunctions.h"
 #include "GuidedNativeImageIO.h"
 #include "itkImageFileWriter.h"
 
@@ -52,6 +54,7 @@ ScalarImageWrapper<TTraits,TBase>
 {
   m_MinMaxFilter = MinMaxFilter::New();
   m_HistogramFilter = HistogramFilterType::New();
+  m_GradientMagnitudeFilter = GradientMagnitudeFilterType::New();
 
   // Set up VTK export pipeline
   //this->SetupVTKImportExport();
@@ -127,6 +130,9 @@ ScalarImageWrapper<TTraits,TBase>
   // Set the number of bins to default
   m_HistogramFilter->SetNumberOfBins(DEFAULT_HISTOGRAM_BINS);
 
+  // Update the gradient magnitude estimator
+  m_GradientMagnitudeFilter->SetInput(newImage);
+
   // Update the common representation policy
   m_CommonRepresentationPolicy.UpdateInputImage(newImage);
 
@@ -181,13 +187,21 @@ double
 ScalarImageWrapper<TTraits,TBase>
 ::GetImageGradientMagnitudeUpperLimit()
 {
-  // Paul - 12/1/2014: I have modified this code to not compute the gradient magnitude
-  // on the whole image, but instead, to compute just the difference between the max and
-  // min values. I think this is much more efficient, and this removes some problems with
-  // wrappers that wrap around ImageAdapter objects.
-  //
-  // I hope this does not cause too much trouble...
-  return m_MinMaxFilter->GetMaximum() - m_MinMaxFilter->GetMinimum();
+  // The gradient is only sampled on a subset of the voxels, and the filter
+  // only runs again if the image has been modified
+  m_GradientMagnitudeFilter->Update();
+  double glim = m_GradientMagnitudeFilter->GetPercentileValue();
+
+  // For nearly constant images, fall back to the maximum and then the range
+  if(glim <= 0.0)
+    glim = m_GradientMagnitudeFilter->GetMaximumValue();
+  if(glim <= 0.0)
+    {
+    m_MinMaxFilter->Update();
+    glim = m_MinMaxFilter->GetMaximum() - m_MinMaxFilter->GetMinimum();
+    }
+
+  return glim;
 }
 
 template<class TTraits, class TBase>
@@ -199,6 +213,48 @@ ScalarImageWrapper<TTraits,TBase>
         this->GetImageGradientMagnitudeUpperLimit());
 }
 
+template<class TTraits, class TBase>
+void
+ScalarImageWrapper<TTraits,TBase>
+::SampleNativeIntensities(
+    const itk::ImageRegion<3> &region, unsigned long maxSamples,
+    std::vector<double> &samples)
+{
+  itk::ImageRegion<3> rgn = region;
+  if(maxSamples == 0 || !rgn.Crop(this->m_Image->GetBufferedRegion()))
+    return;
+
+  unsigned int stride = GetRegularSamplingStride(rgn, maxSamples);
+  itk::Index<3> lo = rgn.GetIndex(), hi = rgn.GetUpperIndex(), idx;
+  for(idx[2] = lo[2]; idx[2] <= hi[2]; idx[2] += stride)
+    for(idx[1] = lo[1]; idx[1] <= hi[1]; idx[1] += stride)
+      for(idx[0] = lo[0]; idx[0] <= hi[0]; idx[0] += stride)
+        samples.push_back(this->m_NativeMapping(this->GetVoxel(idx)));
+}
+
+template<class TTraits, class TBase>
+void
+ScalarImageWrapper<TTraits,TBase>
+::SampleNativeIntensitiesInSlice(
+    unsigned int dim, const itk::ImageRegion<2> &region,
+    unsigned long maxSamples, std::vector<double> &samples)
+{
+  // Make sure the slice is current. This does nothing if it has already been
+  // generated for display
+  SliceType *slice = this->GetSlice(dim);
+  slice->GetSource()->UpdateLargestPossibleRegion();
+
+  itk::ImageRegion<2> rgn = region;
+  if(maxSamples == 0 || !rgn.Crop(slice->GetBufferedRegion()))
+    return;
+
+  unsigned int stride = GetRegularSamplingStride(rgn, maxSamples);
+  itk::Index<2> lo = rgn.GetIndex(), hi = rgn.GetUpperIndex(), idx;
+  for(idx[1] = lo[1]; idx[1] <= hi[1]; idx[1] += stride)
+    for(idx[0] = lo[0]; idx[0] <= hi[0]; idx[0] += stride)
+      samples.push_back(this->m_NativeMapping(slice->GetPixel(idx)));
+}
+
 
 template<class TTraits, class TBase>
 SmartPtr<typename ScalarImageWrapper<TTraits, TBase>::FloatImageSource>
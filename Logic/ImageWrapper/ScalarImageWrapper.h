@@ -40,6 +40,7 @@
 
 // Forward references
 template<class TIn> class ThreadedHistogramImageFilter;
+template<class TIn> class GradientMagnitudePercentileImageFilter;
 namespace itk {
   template<class TIn> class MinimumMaximumImageFilter;
   template<class TInputImage> class VTKImageExport;
@@ -111,6 +112,9 @@ public:
   // Histogram filter
   typedef ThreadedHistogramImageFilter<ImageType>          HistogramFilterType;
 
+  // Gradient magnitude range estimator
+  typedef GradientMagnitudePercentileImageFilter<ImageType> GradientMagnitudeFilterType;
+
   // Iterator types
   typedef typename Superclass::Iterator                               Iterator;
   typedef typename Superclass::ConstIterator                     ConstIterator;
@@ -216,10 +220,10 @@ public:
   const ScalarImageHistogram *GetHistogram(size_t nBins = 0) ITK_OVERRIDE;
 
   /**
-    Get the maximum possible value of the gradient magnitude. This will
-    compute the gradient magnitude of the image (without Gaussian smoothing)
-    and return the maximum. The value will be cached so repeated calls to
-    this are not expensive.
+    Get the upper limit of the gradient magnitude. This is a high percentile
+    of the gradient magnitude of the image (without Gaussian smoothing),
+    estimated on a subsample of the voxels. The value is cached and only
+    recomputed when the image is modified, so repeated calls are cheap.
     */
   double GetImageGradientMagnitudeUpperLimit() ITK_OVERRIDE;
 
@@ -228,6 +232,22 @@ public:
     */
   double GetImageGradientMagnitudeUpperLimitNative() ITK_OVERRIDE;
 
+  /**
+    Append the native intensities of a regular subsample of the voxels in a
+    region of the image to a list
+    */
+  void SampleNativeIntensities(
+      const itk::ImageRegion<3> &region, unsigned long maxSamples,
+      std::vector<double> &samples) ITK_OVERRIDE;
+
+  /**
+    Append the native intensities of a regular subsample of the voxels in a
+    region of the display slice in the given direction to a list
+    */
+  void SampleNativeIntensitiesInSlice(
+      unsigned int dim, const itk::ImageRegion<2> &region,
+      unsigned long maxSamples, std::vector<double> &samples) ITK_OVERRIDE;
+
 
   /**
     This method creates an ITK mini-pipeline that can be used to cast the internal
@@ -298,6 +318,11 @@ protected:
    */
   SmartPtr<HistogramFilterType> m_HistogramFilter;
 
+  /**
+   * The filter used to estimate the range of the gradient magnitude
+   */
+  SmartPtr<GradientMagnitudeFilterType> m_GradientMagnitudeFilter;
+
   // The policy used to extract a common representation image
   typedef typename TTraits::CommonRepresentationPolicy CommonRepresentationPolicy;
   CommonRepresentationPolicy m_CommonRepresentationPolicy;
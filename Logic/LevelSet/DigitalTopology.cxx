@@ -0,0 +1,120 @@
+#include "DigitalTopology.h"
+#include <cstdlib>
+
+/**
+ * Adjacency tables for the 3x3 and 3x3x3 neighborhoods, as bit masks. They
+ * are computed once when the library is loaded, so that the simple point
+ * test can be called from several threads without locking.
+ */
+struct DigitalTopologyTables
+{
+  unsigned int Size;
+
+  // All neighbors but the center, the neighbors with at most two nonzero
+  // offsets (the 18-neighborhood in 3D) and the face neighbors
+  unsigned int Punctured, Geodesic, Face;
+
+  // For each position, its 8/26-neighbors and its 4/6-neighbors
+  unsigned int ObjectAdjacency[27], BackgroundAdjacency[27];
+
+  DigitalTopologyTables(unsigned int dim)
+  {
+    Size = (dim == 2) ? 9 : 27;
+    Punctured = Geodesic = Face = 0;
+
+    int off[27][3];
+    for(unsigned int i = 0; i < Size; i++)
+      {
+      off[i][0] = (int) (i % 3) - 1;
+      off[i][1] = (int) ((i / 3) % 3) - 1;
+      off[i][2] = (dim == 2) ? 0 : (int) (i / 9) - 1;
+      }
+
+    for(unsigned int i = 0; i < Size; i++)
+      {
+      int nnz = 0;
+      for(int d = 0; d < 3; d++)
+        nnz += (off[i][d] != 0);
+
+      if(nnz > 0)
+        Punctured |= 1u << i;
+      if(nnz > 0 && nnz <= 2)
+        Geodesic |= 1u << i;
+      if(nnz == 1)
+        Face |= 1u << i;
+
+      ObjectAdjacency[i] = BackgroundAdjacency[i] = 0;
+      for(unsigned int j = 0; j < Size; j++)
+        {
+        int dmax = 0, dsum = 0;
+        for(int d = 0; d < 3; d++)
+          {
+          int delta = abs(off[i][d] - off[j][d]);
+          dmax = (delta > dmax) ? delta : dmax;
+          dsum += delta;
+          }
+        if(dmax == 1)
+          ObjectAdjacency[i] |= 1u << j;
+        if(dsum == 1)
+          BackgroundAdjacency[i] |= 1u << j;
+        }
+      }
+  }
+};
+
+static const DigitalTopologyTables g_DigitalTopologyTables2D(2);
+static const DigitalTopologyTables g_DigitalTopologyTables3D(3);
+
+// Count the components of a set of neighbors that contain one of the seeds
+static unsigned int CountComponents(
+    unsigned int set, unsigned int seeds, const unsigned int *adjacency, unsigned int size)
+{
+  unsigned int n = 0;
+  while(set & seeds)
+    {
+    unsigned int seed = 0;
+    while(!((set & seeds) & (1u << seed)))
+      seed++;
+
+    // Grow the component of the seed one ring at a time
+    unsigned int comp = 1u << seed, front = comp;
+    while(front)
+      {
+      unsigned int next = 0;
+      for(unsigned int i = 0; i < size; i++)
+        if(front & (1u << i))
+          next |= adjacency[i];
+      front = next & set & ~comp;
+      comp |= front;
+      }
+
+    set &= ~comp;
+    n++;
+    }
+  return n;
+}
+
+unsigned int
+DigitalTopology
+::GetObjectNumber(unsigned int mask, unsigned int dim)
+{
+  const DigitalTopologyTables &t =
+      (dim == 2) ? g_DigitalTopologyTables2D : g_DigitalTopologyTables3D;
+  return CountComponents(mask & t.Punctured, t.Punctured, t.ObjectAdjacency, t.Size);
+}
+
+unsigned int
+DigitalTopology
+::GetBackgroundNumber(unsigned int mask, unsigned int dim)
+{
+  const DigitalTopologyTables &t =
+      (dim == 2) ? g_DigitalTopologyTables2D : g_DigitalTopologyTables3D;
+  return CountComponents(~mask & t.Geodesic, t.Face, t.BackgroundAdjacency, t.Size);
+}
+
+bool
+DigitalTopology
+::IsSimplePoint(unsigned int mask, unsigned int dim)
+{
+  return GetObjectNumber(mask, dim) == 1 && GetBackgroundNumber(mask, dim) == 1;
+}
@@ -0,0 +1,45 @@
+#ifndef DIGITALTOPOLOGY_H
+#define DIGITALTOPOLOGY_H
+
+/**
+ * Simple point test for binary objects in 2D and 3D, used to keep the
+ * topology of an evolving segmentation fixed. A point is simple if adding it
+ * to the object, or removing it from the object, does not change the number
+ * of components, holes (tunnels) or cavities. Whether a point is simple only
+ * depends on its 3x3 (2D) or 3x3x3 (3D) neighborhood.
+ *
+ * The object uses 8-connectivity in 2D and 26-connectivity in 3D, and the
+ * background 4- and 6-connectivity, respectively. A point is simple when the
+ * object in its punctured neighborhood forms a single component, and when
+ * exactly one component of the background in its 18-neighborhood (all of
+ * the 8-neighborhood in 2D) touches one of its face neighbors (Bertrand and
+ * Malandain, 1994).
+ *
+ * The neighborhood is passed as a bit mask, with a bit set for each neighbor
+ * in the object. The bit of the neighbor at offset (dx, dy, dz), each offset
+ * in {-1, 0, 1}, is (dx+1) + 3 (dy+1) + 9 (dz+1). The center bit is ignored.
+ */
+class DigitalTopology
+{
+public:
+
+  /** Bit of the neighbor at the given offset in a neighborhood mask */
+  static unsigned int GetNeighborBit(const int *offset, unsigned int dim)
+  {
+    unsigned int bit = 0;
+    for(unsigned int d = dim; d > 0; d--)
+      bit = bit * 3 + (offset[d-1] + 1);
+    return bit;
+  }
+
+  /** Check whether the center of the neighborhood is a simple point */
+  static bool IsSimplePoint(unsigned int mask, unsigned int dim);
+
+  /** Number of components of the object in the punctured neighborhood */
+  static unsigned int GetObjectNumber(unsigned int mask, unsigned int dim);
+
+  /** Number of background components that touch a face neighbor */
+  static unsigned int GetBackgroundNumber(unsigned int mask, unsigned int dim);
+};
+
+#endif // DIGITALTOPOLOGY_H
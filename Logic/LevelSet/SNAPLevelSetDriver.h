@@ -39,6 +39,7 @@
 
 #include "SnakeParameters.h"
 #include "SNAPLevelSetFunction.h"
+#include <vector>
 // #include "SNAPLevelSetStopAndGoFilter.h"
 
 template <class TFilter> class LevelSetExtensionFilter;
@@ -124,6 +125,8 @@ public:
   /** Floating point image type used internally */
   typedef itk::Image<float, VDimension>              FloatImageType;
   typedef typename itk::SmartPointer<FloatImageType>      FloatImagePointer;
+  typedef typename FloatImageType::IndexType                   IndexType;
+  typedef typename FloatImageType::RegionType                 RegionType;
 
   /** Type definition for the level set function */
   typedef SNAPLevelSetFunction<ShortImageType, FloatImageType>
@@ -162,6 +165,34 @@ public:
   /** Get the current state of the snake (level set and narrow band) */
   FloatImageType *GetCurrentState();
 
+  /** 
+   * Get the voxels in the active layer of the sparse field solver, i.e., the
+   * voxels closest to the zero level set. Returns false if the solver does
+   * not keep track of the active layer, or if the layer has not been built
+   * yet, i.e., before the first iteration or after a restart
+   */
+  bool GetActiveLayer(std::vector<IndexType> &indices) const;
+
+  /**
+   * Check which faces of the image the contour has come within the given
+   * number of voxels of. Bit 2d of the result is set for the lower face along
+   * dimension d, and bit 2d+1 for the upper face. The active layer is used if
+   * the solver keeps track of it, and the voxels inside the level set
+   * otherwise
+   */
+  unsigned int GetBoundaryFacesReachedByActiveLayer(unsigned int distance);
+
+  /**
+   * Continue the evolution on a new speed image, typically one that covers a
+   * larger region of interest than the current one. The current level set is
+   * resampled onto the grid of the speed image, with the voxels outside of
+   * the current image set to outside, and the solver is started from it. The
+   * iteration count carries over, and from now on Restart() returns to the
+   * resampled level set. Not available with an external advection field,
+   * which only covers the current image
+   */
+  void ResampleToSpeedImage(ShortImageType *speed);
+
   /** Get the number of elapsed iterations */
   unsigned int GetElapsedIterations() const;
 
@@ -194,9 +225,22 @@ private:
   /** Last accepted snake parameters */
   SnakeParameters m_Parameters;
 
+  /** Whether the advection field was passed in to the constructor */
+  bool m_HasExternalAdvection;
+
+  /** Iterations elapsed before the level set was last resampled */
+  unsigned int m_ElapsedIterationOffset;
+
+  /** Get the faces of a region that an index is within a distance of */
+  static unsigned int GetBoundaryFacesNearIndex(
+      const RegionType &region, const IndexType &index, unsigned int distance);
+
   /** Assign the values of snake parameters to a snake function */
   void AssignParametersToPhi(const SnakeParameters &parms, bool firstTime);
 
+  /** Assign the snake parameters used by the filter, not the function */
+  void AssignParametersToFilter();
+
   /** Internal routines */
   void DoCreateLevelSetFilter();
 };
@@ -49,8 +49,15 @@
 #include "itkNarrowBandLevelSetImageFilter.h"
 #include "itkDenseFiniteDifferenceImageFilter.h"
 #include "LevelSetExtensionFilter.h"
+#include "DigitalTopology.h"
 
 #include "itkParallelSparseFieldLevelSetImageFilter.h"
+#include "itkImageDuplicator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkResampleImageFilter.h"
+#include "itkIdentityTransform.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include <algorithm>
 
 // Disable some windows debug length messages
 #if defined(_MSC_VER)
@@ -65,6 +72,10 @@
  * function that computes the timestep from the per-region timesteps then sets
  * the timestep to 0, and the filter stops. The work-around changes the step size
  * for empty regions to 1 and fixes the problem.
+ *
+ * The class also implements the optional topology preserving constraint. Voxels
+ * only cross the zero level set in the active layer, so the constraint checks
+ * the voxels whose value changes sign during the update of the active layer.
  */
 template< class TInputImage, class TOutputImage >
 class ParallelSparseFieldLevelSetImageFilterBugFix
@@ -77,6 +88,10 @@ public:
   typedef itk::SmartPointer< Self >                                                Pointer;
   typedef itk::SmartPointer< const Self >                                          ConstPointer;
   typedef typename Superclass::TimeStepType                                        TimeStepType;
+  typedef typename Superclass::IndexType                                           IndexType;
+  typedef typename Superclass::LayerType                                           LayerType;
+  typedef typename Superclass::ValueType                                           ValueType;
+  typedef typename Superclass::OutputImageType                                     OutputImageType;
 
   /** Method for creation through the object factory. */
   itkNewMacro(Self)
@@ -85,6 +100,10 @@ public:
   itkTypeMacro(ParallelSparseFieldLevelSetImageFilterBugFix,
                itk::ParallelSparseFieldLevelSetImageFilter)
 
+  /** Whether the topology of the segmentation (phi <= 0) is preserved */
+  itkSetMacro(PreserveTopology, bool)
+  itkGetMacro(PreserveTopology, bool)
+
   virtual TimeStepType ThreadedCalculateChange(itk::ThreadIdType ThreadId) ITK_OVERRIDE
   {
     TimeStepType ts = Superclass::ThreadedCalculateChange(ThreadId);
@@ -94,7 +113,94 @@ public:
       return ts;
   }
 
+  /**
+   * Append the voxels in the active layer to a list. Between updates, the
+   * active layer is split among the per-thread data, which is kept for as
+   * long as manual reinitialization is on. Returns false if the per-thread
+   * data has not been created yet or holds no active layer.
+   */
+  bool GetActiveLayer(std::vector<IndexType> &indices) const
+  {
+    if(!this->m_Data)
+      return false;
+
+    bool populated = false;
+    for(unsigned int t = 0; t < this->m_NumOfThreads; t++)
+      {
+      if(this->m_Data[t].m_Layers.empty())
+        continue;
+
+      const LayerType *layer = this->m_Data[t].m_Layers[0];
+      for(typename LayerType::ConstIterator it = layer->Begin(); it != layer->End(); ++it)
+        indices.push_back(it->m_Index);
+      populated = true;
+      }
+
+    return populated && !indices.empty();
+  }
+
   itk::SimpleFastMutexLock locky;
+
+protected:
+
+  ParallelSparseFieldLevelSetImageFilterBugFix() : m_PreserveTopology(false) {}
+
+  /**
+   * With topology preservation on, a voxel may only cross the zero level set
+   * if it is a simple point. Otherwise its value stops at the level set, on
+   * the side where it started.
+   */
+  virtual ValueType ThreadedCalculateUpdateValue(
+      const itk::ThreadIdType ThreadId, const IndexType index,
+      const TimeStepType &dt, const ValueType &value, const ValueType &change) ITK_OVERRIDE
+  {
+    ValueType newValue = value + dt * change;
+    if(!m_PreserveTopology || (value <= 0) == (newValue <= 0)
+       || this->CanChangeSign(ThreadId, index))
+      return newValue;
+
+    return (value <= 0) ? ValueType(0) : itk::NumericTraits<ValueType>::min();
+  }
+
+  /**
+   * Check whether the voxel can change sign in this iteration. The active
+   * layer is updated in place by all threads at once, so a voxel next to the
+   * slab of another thread only changes sign on every other iteration, in
+   * turn with the other thread. This way the neighbors of a voxel do not
+   * change sign while the voxel is being tested.
+   */
+  bool CanChangeSign(itk::ThreadIdType ThreadId, const IndexType &index)
+  {
+    unsigned int z = static_cast<unsigned int>(index[this->m_SplitAxis]);
+    bool atBoundary =
+        (z > 0 && this->GetThreadNumber(z - 1) != ThreadId) ||
+        (z + 1 < this->m_ZSize && this->GetThreadNumber(z + 1) != ThreadId);
+    if(atBoundary && (this->GetElapsedIterations() + ThreadId) % 2)
+      return false;
+
+    // Voxels outside of the image are in the background
+    const unsigned int dim = OutputImageType::ImageDimension;
+    const typename OutputImageType::RegionType &region =
+        this->m_OutputImage->GetBufferedRegion();
+
+    unsigned int nNeighbors = 1, mask = 0;
+    for(unsigned int d = 0; d < dim; d++)
+      nNeighbors *= 3;
+
+    for(unsigned int k = 0; k < nNeighbors; k++)
+      {
+      IndexType nbr = index;
+      for(unsigned int d = 0, q = k; d < dim; d++, q /= 3)
+        nbr[d] += static_cast<int>(q % 3) - 1;
+
+      if(region.IsInside(nbr) && this->m_OutputImage->GetPixel(nbr) <= 0)
+        mask |= 1u << k;
+      }
+
+    return DigitalTopology::IsSimplePoint(mask, dim);
+  }
+
+  bool m_PreserveTopology;
 };
 
 
@@ -122,9 +228,13 @@ SNAPLevelSetDriver<VDimension>
   m_LevelSetFunction->SetSpeedScaleFactor(1.0 / 0x7fff);
 
   // Set the external advection if any
+  m_HasExternalAdvection = (externalAdvection != NULL);
   if(externalAdvection)
     m_LevelSetFunction->SetAdvectionField(externalAdvection);
 
+  // No iterations so far
+  m_ElapsedIterationOffset = 0;
+
   // Remember the input and output images for later initialization
   m_InitializationImage = init;
 
@@ -198,6 +308,7 @@ SNAPLevelSetDriver<VDimension>
     filter->SetNumberOfLayers(3);
     filter->SetIsoSurfaceValue(0.0f);
     filter->SetDifferenceFunction(m_LevelSetFunction);
+    filter->SetPreserveTopology(m_Parameters.GetPreserveTopology());
     filter->InPlaceOn();
     }
 /*
@@ -314,12 +425,125 @@ SNAPLevelSetDriver<VDimension>
   return m_LevelSetFilter->GetOutput();
 }
 
+template<unsigned int VDimension>
+bool
+SNAPLevelSetDriver<VDimension>
+::GetActiveLayer(std::vector<IndexType> &indices) const
+{
+  typedef ParallelSparseFieldLevelSetImageFilterBugFix<
+      FloatImageType, FloatImageType> SparseFieldFilterType;
+
+  // Only the sparse field solver keeps track of the active layer
+  const SparseFieldFilterType *filter =
+      dynamic_cast<const SparseFieldFilterType *>(m_LevelSetFilter.GetPointer());
+  if(!filter)
+    return false;
+
+  indices.clear();
+  return filter->GetActiveLayer(indices);
+}
+
+template<unsigned int VDimension>
+unsigned int
+SNAPLevelSetDriver<VDimension>
+::GetBoundaryFacesNearIndex(
+    const RegionType &region, const IndexType &index, unsigned int distance)
+{
+  unsigned int faces = 0;
+  for(unsigned int d = 0; d < VDimension; d++)
+    {
+    long lower = index[d] - region.GetIndex(d);
+    long upper = region.GetIndex(d) + (long) region.GetSize(d) - 1 - index[d];
+    if(lower <= (long) distance)
+      faces |= 1u << (2 * d);
+    if(upper <= (long) distance)
+      faces |= 1u << (2 * d + 1);
+    }
+  return faces;
+}
+
+template<unsigned int VDimension>
+unsigned int
+SNAPLevelSetDriver<VDimension>
+::GetBoundaryFacesReachedByActiveLayer(unsigned int distance)
+{
+  FloatImageType *phi = this->GetCurrentState();
+  RegionType region = phi->GetBufferedRegion();
+  unsigned int faces = 0;
+
+  std::vector<IndexType> layer;
+  if(this->GetActiveLayer(layer))
+    {
+    for(size_t i = 0; i < layer.size(); i++)
+      faces |= GetBoundaryFacesNearIndex(region, layer[i], distance);
+    }
+  else
+    {
+    // The dense solver has no active layer, so look at the whole level set
+    typedef itk::ImageRegionConstIteratorWithIndex<FloatImageType> IteratorType;
+    for(IteratorType it(phi, region); !it.IsAtEnd(); ++it)
+      if(it.Get() <= 0)
+        faces |= GetBoundaryFacesNearIndex(region, it.GetIndex(), distance);
+    }
+
+  return faces;
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::ResampleToSpeedImage(ShortImageType *speed)
+{
+  // The external advection field can not follow the new speed image
+  if(m_HasExternalAdvection)
+    throw itk::ExceptionObject(__FILE__, __LINE__,
+                               "Can not resample a level set evolving "
+                               "with an external advection field");
+
+  // Copy the current state, so that resampling it does not update the filter
+  typedef itk::ImageDuplicator<FloatImageType> DuplicatorType;
+  typename DuplicatorType::Pointer duplicator = DuplicatorType::New();
+  duplicator->SetInputImage(this->GetCurrentState());
+  duplicator->Update();
+  FloatImagePointer phi = duplicator->GetOutput();
+
+  // The voxels outside of the current image are outside of the contour, at
+  // the largest distance that the solver keeps track of
+  float outside = 1.0f;
+  typedef itk::ImageRegionConstIterator<FloatImageType> IteratorType;
+  for(IteratorType it(phi, phi->GetBufferedRegion()); !it.IsAtEnd(); ++it)
+    outside = std::max(outside, it.Get());
+
+  // Resample the level set onto the grid of the speed image
+  typedef itk::ResampleImageFilter<FloatImageType, FloatImageType> ResampleFilterType;
+  typename ResampleFilterType::Pointer fltSample = ResampleFilterType::New();
+  fltSample->SetInput(phi);
+  fltSample->SetTransform(itk::IdentityTransform<double, VDimension>::New());
+  fltSample->SetInterpolator(
+        itk::LinearInterpolateImageFunction<FloatImageType, double>::New());
+  fltSample->SetOutputParametersFromImage(speed);
+  fltSample->SetDefaultPixelValue(outside);
+  fltSample->UpdateLargestPossibleRegion();
+
+  FloatImagePointer phiNew = fltSample->GetOutput();
+  phiNew->DisconnectPipeline();
+
+  // Keep counting the iterations from where the current filter stopped
+  m_ElapsedIterationOffset += m_LevelSetFilter->GetElapsedIterations();
+
+  // Start over with the new speed image and level set
+  m_InitializationImage = phiNew;
+  m_LevelSetFunction->SetSpeedImage(speed);
+  AssignParametersToPhi(m_Parameters, false);
+  DoCreateLevelSetFilter();
+}
+
 template<unsigned int VDimension>
 unsigned int
 SNAPLevelSetDriver<VDimension>
 ::GetElapsedIterations() const
 {
-  return m_LevelSetFilter->GetElapsedIterations();
+  return m_ElapsedIterationOffset + m_LevelSetFilter->GetElapsedIterations();
 }
 
 template<unsigned int VDimension>
@@ -352,6 +576,25 @@ SNAPLevelSetDriver<VDimension>
     {
     DoCreateLevelSetFilter();
     }
+  else
+    {
+    AssignParametersToFilter();
+    }
+}
+
+template<unsigned int VDimension>
+void
+SNAPLevelSetDriver<VDimension>
+::AssignParametersToFilter()
+{
+  typedef ParallelSparseFieldLevelSetImageFilterBugFix<
+      FloatImageType, FloatImageType> SparseFieldFilterType;
+
+  // The topology constraint is only implemented by the sparse field solver
+  SparseFieldFilterType *filter =
+      dynamic_cast<SparseFieldFilterType *>(m_LevelSetFilter.GetPointer());
+  if(filter)
+    filter->SetPreserveTopology(m_Parameters.GetPreserveTopology());
 }
 
 #endif
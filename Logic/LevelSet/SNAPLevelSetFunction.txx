@@ -87,12 +87,13 @@ SNAPLevelSetFunction<TSpeedImageType,TImageType>
 {
   
   // There is still the business of the advection image to attend to
-  // Compute \f$ \nabla g() \f$ (will be cached from run to run)
+  // Compute \f$ \nabla g() \f$ (will be cached from run to run). The speed
+  // image may have been replaced by a larger one, so the whole field is updated
   if(!m_UseExternalAdvectionField)
     {
     assert(m_AdvectionSpeedExponent >= 0);
     m_AdvectionFilter->SetExponent((unsigned int)m_AdvectionSpeedExponent);
-    m_AdvectionFilter->Update();
+    m_AdvectionFilter->UpdateLargestPossibleRegion();
     m_AdvectionField = 
       reinterpret_cast< VectorImageType* > (
         m_AdvectionFilter->GetOutput());
@@ -63,6 +63,7 @@ SnakeParameters
   p.m_AdvectionSpeedExponent = 0;       
 
   p.m_Solver = PARALLEL_SPARSE_FIELD_SOLVER;
+  p.m_PreserveTopology = false;
 
   return p;
 }
@@ -93,6 +94,7 @@ SnakeParameters
   p.m_AdvectionSpeedExponent = 0;       
 
   p.m_Solver = PARALLEL_SPARSE_FIELD_SOLVER;
+  p.m_PreserveTopology = false;
 
   return p;
 }
@@ -123,6 +125,7 @@ SnakeParameters
   p.m_AdvectionSpeedExponent = 0;       
 
   p.m_Solver = PARALLEL_SPARSE_FIELD_SOLVER;
+  p.m_PreserveTopology = false;
 
   return p;
 }
@@ -145,5 +148,6 @@ SnakeParameters
     m_LaplacianSpeedExponent == p.m_LaplacianSpeedExponent &&
     m_AdvectionWeight == p.m_AdvectionWeight &&
     m_AdvectionSpeedExponent == p.m_AdvectionSpeedExponent && 
-    m_Solver == p.m_Solver);
+    m_Solver == p.m_Solver &&
+    m_PreserveTopology == p.m_PreserveTopology);
 }
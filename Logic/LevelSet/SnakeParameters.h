@@ -129,6 +129,15 @@ public:
     this->m_Solver = value;
   }
 
+  /** Whether the evolution preserves the topology of the segmentation, i.e.,
+   * the number of components, holes and cavities. Only used by the parallel
+   * sparse field solver */
+  itkGetConstMacro(PreserveTopology,bool);
+  void SetPreserveTopology( bool value )
+  {
+    this->m_PreserveTopology = value;
+  }
+
   /** Type of equation (well known parameter sets) */
   itkGetConstMacro(SnakeType,SnakeType);
   void SetSnakeType( SnakeType value )
@@ -206,6 +215,8 @@ private:
   int m_AdvectionSpeedExponent;   
 
   SolverType m_Solver;
+
+  bool m_PreserveTopology;
 };
 
 #endif // __SnakeParameters_h_
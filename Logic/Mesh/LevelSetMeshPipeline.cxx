@@ -41,6 +41,13 @@
 #include "LevelSetMeshPipeline.h"
 #include "VTKMeshPipeline.h"
 #include "MeshOptions.h"
+#include "ImageWrapperBase.h"
+#include <vtkFloatArray.h>
+#include <vtkPoints.h>
+#include <vtkMarchingCubesTriangleCases.h>
+#include <vnl/vnl_det.h>
+#include <vnl/vnl_inverse.h>
+#include <algorithm>
 
 LevelSetMeshPipeline
 ::LevelSetMeshPipeline()
@@ -52,6 +59,7 @@ LevelSetMeshPipeline
   m_MeshOptions = MeshOptions::New();
   m_MeshOptions->SetUseGaussianSmoothing(false);
   m_VTKPipeline->SetMeshOptions(m_MeshOptions);
+  m_Preview = false;
 }
 
 LevelSetMeshPipeline
@@ -88,6 +96,177 @@ LevelSetMeshPipeline
 
   // Run the pipeline
   m_VTKPipeline->ComputeMesh(m_Mesh, lock);
+  m_Preview = false;
+
+  // Set the modified flag so that we can use the MTime() of this object for dirty checks
+  this->Modified();
+}
+
+void
+LevelSetMeshPipeline
+::UpdatePreviewMesh(const std::vector<IndexType> &voxels)
+{
+  // Corners and edges of a cell, in the order used by vtkMarchingCubes
+  static const int corner[8][3] = {
+    {0,0,0}, {1,0,0}, {1,1,0}, {0,1,0}, {0,0,1}, {1,0,1}, {1,1,1}, {0,1,1} };
+  static const int edge[12][2] = {
+    {0,1}, {1,2}, {3,2}, {0,3}, {4,5}, {5,6}, {7,6}, {4,7}, {0,4}, {1,5}, {3,7}, {2,6} };
+
+  // As in UpdateMesh, the mesh is a new object every time
+  m_Mesh = vtkSmartPointer<vtkPolyData>::New();
+
+  const float *phi = m_InputImage->GetBufferPointer();
+  itk::ImageRegion<3> region = m_InputImage->GetBufferedRegion();
+  long size[3], stride[3];
+  for(int d = 0; d < 3; d++)
+    {
+    size[d] = region.GetSize(d);
+    stride[d] = d ? stride[d-1] * size[d-1] : 1;
+    }
+
+  // The offsets of the cell corners, and for each edge, the offset of its
+  // first corner and its axis. A mesh vertex is keyed by the voxel and axis
+  // of the edge that it lies on, or just by the voxel if it lies on one
+  long cornerOffset[8], edgeOffset[12];
+  int edgeAxis[12];
+  for(int k = 0; k < 8; k++)
+    cornerOffset[k] = corner[k][0] * stride[0] + corner[k][1] * stride[1] + corner[k][2] * stride[2];
+  for(int e = 0; e < 12; e++)
+    {
+    const int *c0 = corner[edge[e][0]], *c1 = corner[edge[e][1]];
+    edgeAxis[e] = (c0[0] != c1[0]) ? 0 : ((c0[1] != c1[1]) ? 1 : 2);
+    edgeOffset[e] = std::min(cornerOffset[edge[e][0]], cornerOffset[edge[e][1]]);
+    }
+
+  // Find the cells that have one of the voxels as a corner, by the offset of
+  // their first corner
+  std::vector<long> cells;
+  cells.reserve(voxels.size() * 8);
+  for(size_t i = 0; i < voxels.size(); i++)
+    {
+    for(int k = 0; k < 8; k++)
+      {
+      long offset = 0;
+      bool inside = true;
+      for(int d = 0; d < 3 && inside; d++)
+        {
+        long x = voxels[i][d] - region.GetIndex(d) - corner[k][d];
+        inside = (x >= 0 && x + 1 < size[d]);
+        offset += x * stride[d];
+        }
+      if(inside)
+        cells.push_back(offset);
+      }
+    }
+  std::sort(cells.begin(), cells.end());
+  cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+  // Contour the cells, recording each triangle by the keys of its vertices
+  vtkMarchingCubesTriangleCases *cases = vtkMarchingCubesTriangleCases::GetCases();
+  std::vector<long> triangles;
+  for(size_t i = 0; i < cells.size(); i++)
+    {
+    int index = 0;
+    for(int k = 0; k < 8; k++)
+      if(phi[cells[i] + cornerOffset[k]] >= 0.0f)
+        index |= (1 << k);
+
+    for(const EDGE_LIST *e = cases[index].edges; *e > -1; e++)
+      {
+      long v0 = cells[i] + edgeOffset[*e], v1 = v0 + stride[edgeAxis[*e]];
+      if(phi[v0] == 0.0f)
+        triangles.push_back(v0 * 3);
+      else if(phi[v1] == 0.0f)
+        triangles.push_back(v1 * 3);
+      else
+        triangles.push_back(v0 * 3 + edgeAxis[*e]);
+      }
+    }
+
+  std::vector<long> keys(triangles);
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // Map from VTK image coordinates to NIFTI coordinates, as in VTKMeshPipeline.
+  // Normals are mapped by the inverse transpose and flipped if the map flips
+  vnl_matrix_fixed<double, 4, 4> vtk2nii =
+    ImageWrapperBase::ConstructVTKtoNiftiTransform(
+      m_InputImage->GetDirection().GetVnlMatrix(),
+      m_InputImage->GetOrigin().GetVnlVector(),
+      m_InputImage->GetSpacing().GetVnlVector());
+  vnl_matrix_fixed<double, 3, 3> A(vtk2nii.extract(3, 3));
+  vnl_matrix_fixed<double, 3, 3> An = vnl_inverse(A).transpose();
+  if(vnl_det(A) < 0)
+    An *= -1.0;
+
+  // Place the vertices on the edges by linear interpolation, and compute the
+  // normals from the gradient of the level set, as vtkMarchingCubes does
+  vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+  points->SetNumberOfPoints(keys.size());
+  vtkSmartPointer<vtkFloatArray> normals = vtkSmartPointer<vtkFloatArray>::New();
+  normals->SetNumberOfComponents(3);
+  normals->SetNumberOfTuples(keys.size());
+
+  for(size_t i = 0; i < keys.size(); i++)
+    {
+    long v[2], x[2][3];
+    int a = keys[i] % 3;
+    v[0] = keys[i] / 3;
+    bool on_voxel = (phi[v[0]] == 0.0f);
+    v[1] = on_voxel ? v[0] : v[0] + stride[a];
+    double t = on_voxel ? 0.0 : phi[v[0]] / (phi[v[0]] - phi[v[1]]);
+
+    vnl_vector_fixed<double, 4> p(0.0, 0.0, 0.0, 1.0);
+    vnl_vector_fixed<double, 3> g(0.0);
+    for(int j = 0; j < 2; j++)
+      {
+      double w = j ? t : 1.0 - t;
+      for(int d = 0; d < 3; d++)
+        {
+        x[j][d] = (v[j] / stride[d]) % size[d];
+        p[d] += w * (region.GetIndex(d) + x[j][d]) * m_InputImage->GetSpacing()[d];
+
+        // One-sided differences at the image boundary
+        long xm = std::max(x[j][d] - 1, 0L), xp = std::min(x[j][d] + 1, size[d] - 1);
+        if(xp > xm)
+          {
+          double ds = phi[v[j] + (xp - x[j][d]) * stride[d]] - phi[v[j] + (xm - x[j][d]) * stride[d]];
+          g[d] += w * ds / ((xp - xm) * m_InputImage->GetSpacing()[d]);
+          }
+        }
+      }
+
+    for(int d = 0; d < 3; d++)
+      p[d] += m_InputImage->GetOrigin()[d];
+
+    vnl_vector_fixed<double, 4> q = vtk2nii * p;
+    points->SetPoint(i, q[0], q[1], q[2]);
+
+    // The normals point down the gradient, as in vtkMarchingCubes
+    vnl_vector_fixed<double, 3> n = An * (-g);
+    double len = n.magnitude();
+    if(len > 0)
+      n /= len;
+    normals->SetTuple3(i, n[0], n[1], n[2]);
+    }
+
+  // Skip the triangles that are degenerate because of vertices on voxels
+  vtkSmartPointer<vtkCellArray> polys = vtkSmartPointer<vtkCellArray>::New();
+  for(size_t i = 0; i < triangles.size(); i += 3)
+    {
+    const long *tri = &triangles[i];
+    if(tri[0] == tri[1] || tri[1] == tri[2] || tri[0] == tri[2])
+      continue;
+
+    polys->InsertNextCell(3);
+    for(int j = 0; j < 3; j++)
+      polys->InsertCellPoint(std::lower_bound(keys.begin(), keys.end(), tri[j]) - keys.begin());
+    }
+
+  m_Mesh->SetPoints(points);
+  m_Mesh->SetPolys(polys);
+  m_Mesh->GetPointData()->SetNormals(normals);
+  m_Preview = true;
 
   // Set the modified flag so that we can use the MTime() of this object for dirty checks
   this->Modified();
@@ -103,6 +282,7 @@ LevelSetMeshPipeline
 ::SetImage(InputImageType *image)
 {
   // Hook the input into the pipeline
+  m_InputImage = image;
   m_VTKPipeline->SetImage(image);
 }
 
@@ -40,10 +40,12 @@
 #include "vtkSmartPointer.h"
 #include "itkObject.h"
 #include "itkObjectFactory.h"
+#include <vector>
 
 // Forward reference to itk classes
 namespace itk {
   template <class TPixel,unsigned int VDimension> class Image;
+  template <unsigned int VDimension> class Index;
   class FastMutexLock;
 }
 
@@ -57,7 +59,11 @@ class vtkPolyData;
  * \brief A pipeline used to compute a mesh of the zero level set in SNAP.
  *
  * This pipeline takes a floating point image computed by the level
- * set filter and uses a contour algorithm to get a triangular mesh
+ * set filter and uses a contour algorithm to get a triangular mesh.
+ *
+ * While the level set is evolving, a preview mesh can be computed instead
+ * by running marching cubes only over the cells next to the active layer of
+ * the sparse field solver, skipping the rest of the VTK pipeline.
  */
 class LevelSetMeshPipeline : public itk::Object
 {
@@ -68,6 +74,7 @@ public:
   /** Input image type */
   typedef itk::Image<float,3> InputImageType;
   typedef itk::SmartPointer<InputImageType> InputImagePointer;
+  typedef itk::Index<3> IndexType;
 
   /** Set the input segmentation image */
   void SetImage(InputImageType *input);
@@ -81,9 +88,19 @@ public:
       update clashing with level set evolution iteration. */
   void UpdateMesh(itk::FastMutexLock *lock = NULL);
 
+  /** Compute a preview mesh of the zero level set over the cells that have
+      a corner in the given list of voxels, such as the active layer of the
+      sparse field solver. The cells are contoured as by marching cubes, but
+      there is no smoothing, decimation or stripping. The image is accessed
+      throughout, so the caller should hold the level set lock. */
+  void UpdatePreviewMesh(const std::vector<IndexType> &voxels);
+
   /** Get the stored mesh */
   vtkPolyData *GetMesh();
 
+  /** Whether the stored mesh is a preview, built by UpdatePreviewMesh */
+  irisIsMacro(Preview)
+
 protected:
   
   /** Constructor, which builds the pipeline */
@@ -108,6 +125,9 @@ private:
 
   // The output mesh
   vtkSmartPointer<vtkPolyData> m_Mesh;
+
+  // Whether the output mesh is a preview
+  bool m_Preview;
 };
 
 #endif //__LevelSetMeshPipeline_h_
@@ -62,6 +62,8 @@
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkRecursiveGaussianImageFilter.h"
 #include "itkVTKImageExport.h"
+#include "itkFastMutexLock.h"
+#include "itkMutexLockHolder.h"
 
 // VTK includes
 #include <vtkCellArray.h>
@@ -103,7 +105,7 @@ MeshManager
 
 void 
 MeshManager
-::UpdateVTKMeshes(itk::Command *command)
+::UpdateVTKMeshes(itk::Command *command, bool preview)
 {
   // The mesh is constructed differently depending on whether there is an
   // actively evolving level set or not SNAP mode or in IRIS mode
@@ -131,8 +133,25 @@ MeshManager
     // Make sure the pipeline has the right options
     pipeline->SetMeshOptions(m_GlobalState->GetMeshOptions());
 
+    // For a preview, extract the mesh from the cells next to the active layer.
+    // The level set must not change between reading the active layer and
+    // contouring it
+    bool have_preview = false;
+    if(preview)
+      {
+      SNAPImageData *snap = m_Driver->GetSNAPImageData();
+      std::vector<SNAPLevelSetDriver3d::IndexType> active;
+      itk::MutexLockHolder<itk::FastMutexLock> holder(*snap->GetLevelSetPipelineMutexLock());
+      if(snap->GetLevelSetActiveLayer(active))
+        {
+        pipeline->UpdatePreviewMesh(active);
+        have_preview = true;
+        }
+      }
+
     // Compute the mesh only for the current segmentation color
-    pipeline->UpdateMesh(m_Driver->GetSNAPImageData()->GetLevelSetPipelineMutexLock());
+    if(!have_preview)
+      pipeline->UpdateMesh(m_Driver->GetSNAPImageData()->GetLevelSetPipelineMutexLock());
     }
   else
     {
@@ -226,8 +245,9 @@ bool MeshManager::IsMeshDirty()
     SmartPtr<LevelSetMeshPipeline> pipeline =
         static_cast<LevelSetMeshPipeline *>(wrapper->GetUserData("MeshPipeline"));
 
-    // No pipeline? That means the mesh has not been constructed yet
-    if(!pipeline)
+    // No pipeline? That means the mesh has not been constructed yet. A
+    // preview mesh must still be replaced by a full one
+    if(!pipeline || pipeline->IsPreview())
       return true;
 
     // Get the pipelines
@@ -76,9 +76,11 @@ public:
   void Initialize(IRISApplication *driver);
 
   /**
-   * Generate VTK meshes from input data.
+   * Generate VTK meshes from input data. When a preview is requested and the
+   * level set is being evolved by the sparse field solver, the mesh is only
+   * extracted near the active layer, without the full VTK pipeline.
    */
-  void UpdateVTKMeshes(itk::Command *command);
+  void UpdateVTKMeshes(itk::Command *command, bool preview = false);
 
   /**
    * Get the mapping of labels to vtk mesh pointers. This method has a
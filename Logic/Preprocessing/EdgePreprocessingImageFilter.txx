@@ -81,8 +81,8 @@ EdgePreprocessingImageFilter<TInputImage,TOutputImage>
   // anyway. Too much streaming increases execution time unnecessarilty
   m_GPUBlurFilter->SetInternalNumberOfStreamDivisions(1);
   m_GPUBlurFilter->SetMaximumError(0.1);
-  //m_ROIFilter = ROIFilter::New();
-  //m_ROIFilter->SetInput(m_GPUBlurFilter->GetOutput());
+  //m_ROIFilter = ROIFilter::New();
+  //m_ROIFilter->SetInput(m_GPUBlurFilter->GetOutput());
 
   m_GradMagFilter = GradMagFilter::New();
   m_GradMagFilter->SetInput(m_GPUBlurFilter->GetOutput());
@@ -135,6 +135,10 @@ EdgePreprocessingImageFilter<TInputImage,TOutputImage>
         settings->GetGaussianBlurScale() * settings->GetGaussianBlurScale());
 #endif
 
+  // The gradient is in voxel units, like the blur and like the gradient
+  // magnitude upper limit of the image wrapper, which normalizes it
+  m_GradMagFilter->SetUseImageSpacingOff();
+
   // Construct the functor
   // TODO: fixme!
   FunctorType functor;
@@ -50,6 +50,7 @@
 
 template <class TInputImage, class TOutputImage, class TPreviewImage> class IRISSlicer;
 template <class TInputImage, class TOutputImage> class NonOrthogonalSlicer;
+template <class TInputImage, class TOutputImage, class TPreviewImage> class AxisAlignedSlicer;
 class ImageCoordinateTransform;
 
 using itk::DataObjectDecorator;
@@ -66,7 +67,11 @@ template<typename TParametersValueType,
  * This filter encapsulates the ITK-SNAP slicing pipeline. It includes both
  * the straight (orthogonal) slicer and the oblique slicer.
  *
- *
+ * When orthogonal slicing is off, but the display slice is aligned with the
+ * voxel grid of the image (e.g., an overlay with a different resolution or
+ * field of view, but the same orientation as the main image), the image is
+ * sliced by the AxisAlignedSlicer, which resamples the nearest native slices
+ * in 2D instead of interpolating in 3D. This choice is made automatically.
  */
 template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
 class AdaptiveSlicingPipeline
@@ -100,6 +105,7 @@ public:
   /** Slicers */
   typedef IRISSlicer<TInputImage,TOutputImage,TPreviewImage> OrthogonalSlicerType;
   typedef NonOrthogonalSlicer<TInputImage,TOutputImage>   NonOrthogonalSlicerType;
+  typedef AxisAlignedSlicer<TInputImage,TOutputImage,TPreviewImage> AxisAlignedSlicerType;
 
   /** Reference space for non-orthogonal slicing */
   typedef typename itk::ImageBase<InputImageDimension> NonOrthogonalSliceReferenceSpace;
@@ -141,6 +147,16 @@ public:
   itkSetMacro(UseOrthogonalSlicing, bool)
   itkGetMacro(UseOrthogonalSlicing, bool)
 
+  /**
+   * Whether the axis-aligned slicer may be used in place of the oblique
+   * slicer when the slice is aligned with the image grid (on by default)
+   */
+  itkSetMacro(UseAxisAlignedSlicing, bool)
+  itkGetMacro(UseAxisAlignedSlicing, bool)
+
+  /** Whether the axis-aligned slicer was selected at the last update */
+  itkGetMacro(AxisAlignedSlicingActive, bool)
+
   /** Set the slice index for the orthogonal slicer */
   itkGetMacro(SliceIndex, IndexType)
   itkSetMacro(SliceIndex, IndexType)
@@ -155,6 +171,14 @@ public:
   /** Loop up intensity at an arbitrary slice index in reference space */
   OutputPixelType LookupIntensityAtReferenceIndex(const itk::ImageBase<3> *ref_space, const IndexType &index);
 
+  /**
+   * Get the region of the output slice that changes when the input image
+   * changes within the given region. The region is empty if the slice does
+   * not pass through the input region. It is exact for orthogonal slicing,
+   * and covers the whole slice otherwise.
+   */
+  OutputImageRegionType GetOutputRegionForInputRegion(const InputImageRegionType &region) const;
+
 protected:
 
   AdaptiveSlicingPipeline();
@@ -174,9 +198,12 @@ protected:
 
   itk::SmartPointer<OrthogonalSlicerType> m_OrthogonalSlicer;
   itk::SmartPointer<NonOrthogonalSlicerType> m_ObliqueSlicer;
+  itk::SmartPointer<AxisAlignedSlicerType> m_AxisAlignedSlicer;
 
   bool m_UseOrthogonalSlicing;
 
+  bool m_UseAxisAlignedSlicing, m_AxisAlignedSlicingActive;
+
   IndexType m_SliceIndex;
 
   void MapInputsToSlicers();
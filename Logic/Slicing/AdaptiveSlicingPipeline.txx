@@ -46,6 +46,7 @@
 #include "AdaptiveSlicingPipeline.h"
 #include "IRISSlicer.h"
 #include "NonOrthogonalSlicer.h"
+#include "AxisAlignedSlicer.h"
 #include "IRISVectorTypesToITKConversion.h"
 
 template<class TInputImage> class AdaptiveSlicingPipeline_PixelFiller
@@ -93,9 +94,33 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
   // Create the two slicer types
   m_OrthogonalSlicer = OrthogonalSlicerType::New();
   m_ObliqueSlicer = NonOrthogonalSlicerType::New();
+  m_AxisAlignedSlicer = AxisAlignedSlicerType::New();
 
   // Initially use the ortho
   m_UseOrthogonalSlicing = true;
+  m_UseAxisAlignedSlicing = true;
+  m_AxisAlignedSlicingActive = false;
+}
+
+template<typename TInputImage, typename TOutputImage, typename TPreviewImage>
+void
+AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
+::SetUseNearestNeighbor(bool flag)
+{
+  if(flag != m_ObliqueSlicer->GetUseNearestNeighbor())
+    {
+    m_ObliqueSlicer->SetUseNearestNeighbor(flag);
+    m_AxisAlignedSlicer->SetUseNearestNeighbor(flag);
+    this->Modified();
+    }
+}
+
+template<typename TInputImage, typename TOutputImage, typename TPreviewImage>
+bool
+AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
+::GetUseNearestNeighbor() const
+{
+  return m_ObliqueSlicer->GetUseNearestNeighbor();
 }
 
 template<typename TInputImage, typename TOutputImage, typename TPreviewImage>
@@ -144,9 +169,25 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
     }
   else
     {
-    m_ObliqueSlicer->SetInput(this->GetInput());
-    m_ObliqueSlicer->SetTransform(this->GetObliqueTransform());
-    m_ObliqueSlicer->SetReferenceImage(this->GetObliqueReferenceImage());
+    // The slice may be aligned with the image grid, even though the image is
+    // not in the reference space, and then a cheaper slicer can be used
+    m_AxisAlignedSlicingActive = m_UseAxisAlignedSlicing
+        && AxisAlignedSlicerType::CanSlice(
+          this->GetInput(), this->GetObliqueReferenceImage(),
+          this->GetObliqueTransform(), m_ObliqueSlicer->GetUseNearestNeighbor());
+
+    if(m_AxisAlignedSlicingActive)
+      {
+      m_AxisAlignedSlicer->SetInput(this->GetInput());
+      m_AxisAlignedSlicer->SetTransform(this->GetObliqueTransform());
+      m_AxisAlignedSlicer->SetReferenceImage(this->GetObliqueReferenceImage());
+      }
+    else
+      {
+      m_ObliqueSlicer->SetInput(this->GetInput());
+      m_ObliqueSlicer->SetTransform(this->GetObliqueTransform());
+      m_ObliqueSlicer->SetReferenceImage(this->GetObliqueReferenceImage());
+      }
     }
 }
 
@@ -168,6 +209,12 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
     m_OrthogonalSlicer->GetOutput()->SetRequestedRegionToLargestPossibleRegion();
     output->CopyInformation(m_OrthogonalSlicer->GetOutput());
     }
+  else if(m_AxisAlignedSlicingActive)
+    {
+    m_AxisAlignedSlicer->UpdateOutputInformation();
+    m_AxisAlignedSlicer->GetOutput()->SetRequestedRegionToLargestPossibleRegion();
+    output->CopyInformation(m_AxisAlignedSlicer->GetOutput());
+    }
   else
     {
     m_ObliqueSlicer->UpdateOutputInformation();
@@ -190,6 +237,10 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
     {
     m_OrthogonalSlicer->PropagateRequestedRegion(output);
     }
+  else if(m_AxisAlignedSlicingActive)
+    {
+    m_AxisAlignedSlicer->PropagateRequestedRegion(output);
+    }
   else
     {
     m_ObliqueSlicer->PropagateRequestedRegion(output);
@@ -220,6 +271,11 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
     m_OrthogonalSlicer->Update();
     output->Graft(m_OrthogonalSlicer->GetOutput());
     }
+  else if(m_AxisAlignedSlicingActive)
+    {
+    m_AxisAlignedSlicer->Update();
+    output->Graft(m_AxisAlignedSlicer->GetOutput());
+    }
   else
     {
     m_ObliqueSlicer->Update();
@@ -288,6 +344,26 @@ AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
     }
 }
 
+template<typename TInputImage, typename TOutputImage, typename TPreviewImage>
+typename AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>::OutputImageRegionType
+AdaptiveSlicingPipeline<TInputImage, TOutputImage, TPreviewImage>
+::GetOutputRegionForInputRegion(const InputImageRegionType &region) const
+{
+  OutputImageRegionType outRegion;
+  if(m_UseOrthogonalSlicing)
+    {
+    // The orthogonal slicer copies voxels, so the region can be mapped exactly
+    if(!m_OrthogonalSlicer->CopyInputRegionToOutputRegion(outRegion, region))
+      outRegion = OutputImageRegionType();
+    }
+  else
+    {
+    // Resampled slices may depend on any voxel in the input region
+    outRegion = this->GetOutput()->GetLargestPossibleRegion();
+    }
+  return outRegion;
+}
+
 
 
 
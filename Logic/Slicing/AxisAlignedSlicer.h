@@ -0,0 +1,176 @@
+#ifndef AXISALIGNEDSLICER_H
+#define AXISALIGNEDSLICER_H
+
+#include "itkImageToImageFilter.h"
+#include "itkTransform.h"
+#include "itkDataObjectDecorator.h"
+#include "itkVectorImage.h"
+#include <vector>
+
+template <class TInputImage, class TOutputImage, class TPreviewImage> class IRISSlicer;
+template <typename TPixel, unsigned int VDim, typename CounterType> class RLEImage;
+
+namespace itk
+{
+template <typename TImage, typename TAccessor> class ImageAdaptor;
+}
+
+/**
+ * Whether the values of an image can be interpolated linearly by the
+ * AxisAlignedSlicer, i.e., whether interpolating the stored values gives the
+ * same result as the NonOrthogonalSlicer. This is not the case for label
+ * images, and for adaptors that compute a derived quantity from a vector.
+ */
+template <class TInputImage>
+class AxisAlignedSlicerTraits
+{
+public:
+  static bool CanInterpolate() { return true; }
+};
+
+template <typename TPixel, unsigned int VDim, typename CounterType>
+class AxisAlignedSlicerTraits< RLEImage<TPixel, VDim, CounterType> >
+{
+public:
+  static bool CanInterpolate() { return false; }
+};
+
+template <typename TPixel, unsigned int VDim, typename TAccessor>
+class AxisAlignedSlicerTraits< itk::ImageAdaptor<itk::VectorImage<TPixel, VDim>, TAccessor> >
+{
+public:
+  static bool CanInterpolate() { return false; }
+};
+
+
+/**
+ * A slicer for images that are not in the reference space, but whose voxel
+ * grid is aligned with the display slice, e.g., an overlay with a different
+ * voxel size or field of view and the same direction cosines. In that case
+ * each axis of the slice maps to one axis of the input image by a scale and
+ * an offset, and the slice lies between two native slices of the input.
+ *
+ * These one or two native slices are extracted with the orthogonal slicer,
+ * blended, and resampled in 2D with separable linear (or nearest neighbor)
+ * weights that are computed once per row and column. The result matches the
+ * NonOrthogonalSlicer, including at the edges of the image, without its
+ * per-voxel trilinear interpolation. The inputs are the same as for the
+ * NonOrthogonalSlicer; CanSlice() checks whether the filter applies.
+ */
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+class AxisAlignedSlicer
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef AxisAlignedSlicer                                              Self;
+  typedef itk::ImageToImageFilter<TInputImage, TOutputImage>       Superclass;
+  typedef itk::SmartPointer<Self>                                     Pointer;
+  typedef itk::SmartPointer<const Self>                          ConstPointer;
+
+  typedef TInputImage                                          InputImageType;
+  typedef typename InputImageType::RegionType             InputImageRegionType;
+
+  typedef TOutputImage                                        OutputImageType;
+  typedef typename OutputImageType::Pointer                OutputImagePointer;
+  typedef typename OutputImageType::InternalPixelType     OutputComponentType;
+  typedef typename OutputImageType::RegionType           OutputImageRegionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self)
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(AxisAlignedSlicer, ImageToImageFilter)
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+  itkStaticConstMacro(InputImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  typedef itk::ImageBase<InputImageDimension>          ReferenceImageBaseType;
+  typedef itk::Transform<double, InputImageDimension, InputImageDimension> TransformType;
+
+  /** The slicer used to extract the native slices */
+  typedef IRISSlicer<TInputImage, TOutputImage, TPreviewImage> NativeSlicerType;
+
+  /**
+   * The mapping from the output index (i,j) to the continuous index into
+   * the input buffer: the input axes that follow i and j, the axis normal
+   * to the slice, and the scale and offset along each
+   */
+  struct Mapping
+  {
+    int Axis[3];
+    double Scale[2], Offset[3];
+  };
+
+  /**
+   * Compute the mapping for an input, reference slice and transform.
+   * Returns false if the slice is not aligned with the input voxel grid.
+   */
+  static bool ComputeMapping(const InputImageType *input,
+                             const ReferenceImageBaseType *reference,
+                             const TransformType *transform,
+                             Mapping &mapping);
+
+  /** Check whether this filter can be used in place of the oblique slicer */
+  static bool CanSlice(const InputImageType *input,
+                       const ReferenceImageBaseType *reference,
+                       const TransformType *transform,
+                       bool use_nn);
+
+  /** Reference image input */
+  itkSetInputMacro(ReferenceImage, ReferenceImageBaseType)
+  itkGetInputMacro(ReferenceImage, ReferenceImageBaseType)
+
+  /** Transform input */
+  itkSetDecoratedObjectInputMacro(Transform, TransformType)
+  itkGetDecoratedObjectInputMacro(Transform, TransformType)
+
+  /** Interpolation type */
+  itkSetMacro(UseNearestNeighbor, bool)
+  itkGetMacro(UseNearestNeighbor, bool)
+
+protected:
+
+  AxisAlignedSlicer();
+  ~AxisAlignedSlicer() {}
+
+  virtual void VerifyInputInformation() ITK_OVERRIDE { }
+
+  virtual void GenerateOutputInformation() ITK_OVERRIDE;
+
+  virtual void GenerateInputRequestedRegion() ITK_OVERRIDE;
+
+  virtual void GenerateData() ITK_OVERRIDE;
+
+  // The two input voxels on either side of a sample along one axis, as
+  // offsets into the native slice, and their weights. Taps that fall outside
+  // of the image have zero weight, as in the trilinear interpolator, and
+  // samples more than half a voxel outside of the image are not inside
+  struct Tap
+  {
+    int Offset[2];
+    double Weight[2];
+    bool Inside;
+  };
+
+  // Compute the taps for the output indices start, ..., start + count - 1
+  // along an axis with the given scale and offset
+  void ComputeTaps(double offset, double scale, int start, int count,
+                   int size, int stride, std::vector<Tap> &taps) const;
+
+private:
+
+  bool m_UseNearestNeighbor;
+
+  // Slicers for the native slices on either side of the display slice
+  itk::SmartPointer<NativeSlicerType> m_NativeSlicer[2];
+
+  // The two native slices blended together
+  std::vector<double> m_Blend;
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "AxisAlignedSlicer.txx"
+#endif
+
+#endif // AXISALIGNEDSLICER_H
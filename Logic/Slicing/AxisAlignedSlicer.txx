@@ -0,0 +1,272 @@
+#ifndef AXISALIGNEDSLICER_TXX
+#define AXISALIGNEDSLICER_TXX
+
+#include "AxisAlignedSlicer.h"
+#include "IRISSlicer.h"
+#include "itkContinuousIndex.h"
+#include <algorithm>
+#include <cmath>
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+AxisAlignedSlicer<TInputImage, TOutputImage, TPreviewImage>
+::AxisAlignedSlicer()
+  : m_UseNearestNeighbor(false)
+{
+  m_NativeSlicer[0] = NativeSlicerType::New();
+  m_NativeSlicer[1] = NativeSlicerType::New();
+}
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+bool
+AxisAlignedSlicer<TInputImage, TOutputImage, TPreviewImage>
+::ComputeMapping(const InputImageType *input,
+                 const ReferenceImageBaseType *reference,
+                 const TransformType *transform,
+                 Mapping &mapping)
+{
+  if(!input || !reference || !transform)
+    return false;
+
+  // Only linear transforms map the slice to a plane
+  if(transform->GetTransformCategory() != TransformType::Linear)
+    return false;
+
+  // Map the first voxel of the slice and its neighbors along the two slice
+  // axes into the input image
+  itk::ContinuousIndex<double, 3> cix[3];
+  for(int k = 0; k < 3; k++)
+    {
+    typename ReferenceImageBaseType::IndexType idx;
+    typename ReferenceImageBaseType::PointType pRef;
+    idx.Fill(0);
+    if(k > 0)
+      idx[k - 1] = 1;
+    reference->TransformIndexToPhysicalPoint(idx, pRef);
+    input->TransformPhysicalPointToContinuousIndex(transform->TransformPoint(pRef), cix[k]);
+    }
+
+  // Each slice axis must step along a single input axis. The tolerance is
+  // in input voxels per output voxel
+  const double tol = 1.0e-6;
+  for(int a = 0; a < 2; a++)
+    {
+    double step[3];
+    int amax = 0;
+    for(int d = 0; d < 3; d++)
+      {
+      step[d] = cix[a + 1][d] - cix[0][d];
+      if(fabs(step[d]) > fabs(step[amax]))
+        amax = d;
+      }
+
+    if(fabs(step[amax]) < tol)
+      return false;
+
+    for(int d = 0; d < 3; d++)
+      if(d != amax && fabs(step[d]) > tol)
+        return false;
+
+    mapping.Axis[a] = amax;
+    mapping.Scale[a] = step[amax];
+    }
+
+  if(mapping.Axis[0] == mapping.Axis[1])
+    return false;
+
+  // The offsets are relative to the start of the input buffer
+  mapping.Axis[2] = 3 - mapping.Axis[0] - mapping.Axis[1];
+  for(int a = 0; a < 3; a++)
+    {
+    int d = mapping.Axis[a];
+    mapping.Offset[a] = cix[0][d] - input->GetBufferedRegion().GetIndex(d);
+    }
+
+  return true;
+}
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+bool
+AxisAlignedSlicer<TInputImage, TOutputImage, TPreviewImage>
+::CanSlice(const InputImageType *input,
+           const ReferenceImageBaseType *reference,
+           const TransformType *transform,
+           bool use_nn)
+{
+  if(!use_nn && !AxisAlignedSlicerTraits<TInputImage>::CanInterpolate())
+    return false;
+
+  Mapping mapping;
+  return ComputeMapping(input, reference, transform, mapping);
+}
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+void
+AxisAlignedSlicer<TInputImage, TOutputImage, TPreviewImage>
+::GenerateOutputInformation()
+{
+  // As for the oblique slicer, the output is in screen space, and only its
+  // size matters
+  OutputImagePointer output = this->GetOutput();
+  typename OutputImageType::SpacingType out_spacing;
+  typename OutputImageType::DirectionType out_direction;
+  typename OutputImageType::PointType out_origin;
+
+  out_origin.Fill(0.0);
+  out_spacing.Fill(1.0);
+  out_direction.SetIdentity();
+
+  OutputImageRegionType out_region;
+  for(int d = 0; d < ImageDimension; d++)
+    {
+    out_region.SetIndex(d, this->GetReferenceImage()->GetLargestPossibleRegion().GetIndex(d));
+    out_region.SetSize(d, this->GetReferenceImage()->GetLargestPossibleRegion().GetSize(d));
+    }
+
+  output->SetSpacing(out_spacing);
+  output->SetOrigin(out_origin);
+  output->SetDirection(out_direction);
+  output->SetLargestPossibleRegion(out_region);
+  output->SetNumberOfComponentsPerPixel(this->GetInput()->GetNumberOfComponentsPerPixel());
+}
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+void
+AxisAlignedSlicer<TInputImage, TOutputImage, TPreviewImage>
+::GenerateInputRequestedRegion()
+{
+  // The native slicers request the slices that they need, but the input
+  // must be complete for them to do so
+  InputImageType *inputPtr = const_cast<InputImageType *>(this->GetInput());
+  if(inputPtr)
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+void
+AxisAlignedSlicer<TInputImage, TOutputImage, TPreviewImage>
+::ComputeTaps(double offset, double scale, int start, int count,
+              int size, int stride, std::vector<Tap> &taps) const
+{
+  taps.resize(count);
+  for(int k = 0; k < count; k++)
+    {
+    double x = offset + scale * (start + k);
+    Tap &t = taps[k];
+    t.Inside = (x >= -0.5 && x < size - 0.5);
+    if(!t.Inside)
+      {
+      t.Offset[0] = t.Offset[1] = 0;
+      t.Weight[0] = t.Weight[1] = 0.0;
+      }
+    else if(m_UseNearestNeighbor)
+      {
+      int i0 = std::min(size - 1, (int) floor(x + 0.5));
+      t.Offset[0] = t.Offset[1] = i0 * stride;
+      t.Weight[0] = 1.0;
+      t.Weight[1] = 0.0;
+      }
+    else
+      {
+      int i0 = (int) floor(x);
+      double f = x - i0;
+      t.Weight[0] = (i0 >= 0) ? 1.0 - f : 0.0;
+      t.Weight[1] = (i0 + 1 < size) ? f : 0.0;
+      t.Offset[0] = std::max(i0, 0) * stride;
+      t.Offset[1] = std::min(i0 + 1, size - 1) * stride;
+      }
+    }
+}
+
+template <typename TInputImage, typename TOutputImage, typename TPreviewImage>
+void
+AxisAlignedSlicer<TInputImage, TOutputImage, TPreviewImage>
+::GenerateData()
+{
+  const InputImageType *input = this->GetInput();
+  OutputImageType *output = this->GetOutput();
+  this->AllocateOutputs();
+
+  OutputImageRegionType region = output->GetBufferedRegion();
+  int nc = output->GetNumberOfComponentsPerPixel();
+  OutputComponentType *out = output->GetBufferPointer();
+  size_t n_out = region.GetNumberOfPixels() * nc;
+
+  Mapping m;
+  if(!ComputeMapping(input, this->GetReferenceImage(), this->GetTransform(), m))
+    itkExceptionMacro("The slice is not aligned with the input image grid");
+
+  // Find the native slices on either side of the display slice
+  InputImageRegionType inRegion = input->GetBufferedRegion();
+  int nx = inRegion.GetSize(m.Axis[0]), ny = inRegion.GetSize(m.Axis[1]);
+  int nz = inRegion.GetSize(m.Axis[2]);
+  std::vector<Tap> tz;
+  ComputeTaps(m.Offset[2], 0.0, 0, 1, nz, 1, tz);
+  if(!tz[0].Inside)
+    {
+    std::fill(out, out + n_out, OutputComponentType(0));
+    return;
+    }
+
+  // Extract the slices and blend them
+  size_t n_slice = (size_t) nx * ny * nc;
+  m_Blend.assign(n_slice, 0.0);
+  for(int k = 0; k < 2; k++)
+    {
+    double w = tz[0].Weight[k];
+    if(w == 0.0)
+      continue;
+
+    NativeSlicerType *slicer = m_NativeSlicer[k];
+    slicer->SetInput(input);
+    slicer->SetPixelDirectionImageAxis(m.Axis[0]);
+    slicer->SetLineDirectionImageAxis(m.Axis[1]);
+    slicer->SetSliceDirectionImageAxis(m.Axis[2]);
+    slicer->SetPixelTraverseForward(true);
+    slicer->SetLineTraverseForward(true);
+    slicer->SetSliceIndex(tz[0].Offset[k] + inRegion.GetIndex(m.Axis[2]));
+    slicer->Update();
+
+    const OutputComponentType *src = slicer->GetOutput()->GetBufferPointer();
+    for(size_t q = 0; q < n_slice; q++)
+      m_Blend[q] += w * src[q];
+    }
+
+  // Resample the blended slice, with the weights computed once per column
+  // and once per row
+  std::vector<Tap> tx, ty;
+  ComputeTaps(m.Offset[0], m.Scale[0], region.GetIndex(0), region.GetSize(0), nx, nc, tx);
+  ComputeTaps(m.Offset[1], m.Scale[1], region.GetIndex(1), region.GetSize(1), ny, nx * nc, ty);
+
+  const double *blend = &m_Blend[0];
+  for(size_t j = 0; j < ty.size(); j++)
+    {
+    const Tap &y = ty[j];
+    if(!y.Inside)
+      {
+      std::fill(out, out + tx.size() * nc, OutputComponentType(0));
+      out += tx.size() * nc;
+      continue;
+      }
+
+    const double *r0 = blend + y.Offset[0], *r1 = blend + y.Offset[1];
+    for(size_t i = 0; i < tx.size(); i++)
+      {
+      const Tap &x = tx[i];
+      if(!x.Inside)
+        {
+        for(int c = 0; c < nc; c++)
+          *out++ = 0;
+        continue;
+        }
+
+      for(int c = 0; c < nc; c++)
+        {
+        double v0 = x.Weight[0] * r0[x.Offset[0] + c] + x.Weight[1] * r0[x.Offset[1] + c];
+        double v1 = x.Weight[0] * r1[x.Offset[0] + c] + x.Weight[1] * r1[x.Offset[1] + c];
+        *out++ = static_cast<OutputComponentType>(y.Weight[0] * v0 + y.Weight[1] * v1);
+        }
+      }
+    }
+}
+
+#endif // AXISALIGNEDSLICER_TXX
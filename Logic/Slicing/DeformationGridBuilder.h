@@ -0,0 +1,110 @@
+#ifndef DEFORMATIONGRIDBUILDER_H
+#define DEFORMATIONGRIDBUILDER_H
+
+#include "SNAPCommon.h"
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include <vector>
+
+/**
+ * Builds the geometry of the deformation grid that is drawn over a slice of
+ * a warp field (a layer with three components displayed as a grid). The
+ * grid consists of the lines of the slice along each axis, sampled every
+ * few voxels, with each voxel displaced by the warp.
+ *
+ * The position of a grid vertex is a linear function of its slice index and
+ * of the warp vector stored in the slice, which the renderer computes once
+ * per slice. Only the sampled lines are visited, and the vertices along a
+ * line can be sampled too, so that they are not much closer than a screen
+ * pixel. The vertices are stored in an array of (x,y) pairs with one line
+ * strip per grid line, ready to be drawn as a vertex array.
+ *
+ * The builder keeps its geometry between calls to Update(), and only builds
+ * it again when the slice, its contents, the mapping or the sampling change.
+ */
+template <class TSliceImage>
+class DeformationGridBuilder : public itk::Object
+{
+public:
+  typedef DeformationGridBuilder                    Self;
+  typedef itk::Object                         Superclass;
+  typedef itk::SmartPointer<Self>                Pointer;
+  typedef itk::SmartPointer<const Self>     ConstPointer;
+
+  itkNewMacro(Self)
+  itkTypeMacro(DeformationGridBuilder, itk::Object)
+
+  typedef TSliceImage                          SliceType;
+
+  /**
+   * The linear map from slice index and warp vector to the drawing
+   * coordinates of a grid vertex. The vertex at index (i,j) with warp vector
+   * phi is Origin + i * DIndex[0] + j * DIndex[1] + sum_a phi[a] * DPhi[a].
+   */
+  struct Mapping
+  {
+    Vector3d Origin, DIndex[2], DPhi[3];
+
+    bool operator == (const Mapping &other) const;
+    bool operator != (const Mapping &other) const
+      { return !(*this == other); }
+  };
+
+  /** Set the slice of the warp field. It must have at least 3 components */
+  void SetSlice(SliceType *slice);
+
+  /** Set the mapping to drawing coordinates */
+  void SetMapping(const Mapping &mapping);
+
+  /**
+   * Set the sampling of the grid. The lines that run along axis d are drawn
+   * at every lineSpacing[d]-th index along the other axis, and have a vertex
+   * at every vertexSpacing[d]-th voxel, plus one at the end of the line.
+   */
+  void SetSampling(const Vector2i &lineSpacing, const Vector2i &vertexSpacing);
+
+  /** Build the geometry if any of the inputs have changed */
+  void Update();
+
+  /** The (x,y) coordinates of the vertices of all the line strips */
+  const std::vector<float> &GetVertices() const
+    { return m_Vertices; }
+
+  /** The first vertex of each line strip, followed by the number of vertices */
+  const std::vector<unsigned int> &GetLineStarts() const
+    { return m_LineStarts; }
+
+  /** Number of line strips */
+  unsigned int GetNumberOfLines() const
+    { return m_LineStarts.empty() ? 0 : m_LineStarts.size() - 1; }
+
+  /** The number of times the geometry has been built, for testing */
+  irisGetMacro(BuildCount, unsigned long)
+
+protected:
+
+  DeformationGridBuilder();
+  virtual ~DeformationGridBuilder() {}
+
+  void BuildGeometry();
+
+  SmartPtr<SliceType> m_Slice;
+  Mapping m_Mapping;
+  Vector2i m_LineSpacing, m_VertexSpacing;
+
+  // The state of the inputs when the geometry was last built
+  SliceType *m_BuiltSlice;
+  itk::ModifiedTimeType m_BuiltSliceMTime;
+  Mapping m_BuiltMapping;
+  Vector2i m_BuiltLineSpacing, m_BuiltVertexSpacing;
+
+  std::vector<float> m_Vertices;
+  std::vector<unsigned int> m_LineStarts;
+  unsigned long m_BuildCount;
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "DeformationGridBuilder.txx"
+#endif
+
+#endif // DEFORMATIONGRIDBUILDER_H
@@ -0,0 +1,153 @@
+#ifndef DEFORMATIONGRIDBUILDER_TXX
+#define DEFORMATIONGRIDBUILDER_TXX
+
+#include "DeformationGridBuilder.h"
+#include <algorithm>
+
+template <class TSliceImage>
+bool
+DeformationGridBuilder<TSliceImage>::Mapping
+::operator == (const Mapping &other) const
+{
+  return Origin == other.Origin
+      && DIndex[0] == other.DIndex[0] && DIndex[1] == other.DIndex[1]
+      && DPhi[0] == other.DPhi[0] && DPhi[1] == other.DPhi[1]
+      && DPhi[2] == other.DPhi[2];
+}
+
+template <class TSliceImage>
+DeformationGridBuilder<TSliceImage>
+::DeformationGridBuilder()
+{
+  m_Mapping.Origin.fill(0.0);
+  for(int a = 0; a < 2; a++)
+    m_Mapping.DIndex[a].fill(0.0);
+  for(int a = 0; a < 3; a++)
+    m_Mapping.DPhi[a].fill(0.0);
+
+  m_LineSpacing.fill(1);
+  m_VertexSpacing.fill(1);
+
+  // Nothing has been built yet
+  m_BuiltSlice = NULL;
+  m_BuiltSliceMTime = 0;
+  m_BuiltMapping = m_Mapping;
+  m_BuiltLineSpacing.fill(0);
+  m_BuiltVertexSpacing.fill(0);
+  m_BuildCount = 0;
+}
+
+template <class TSliceImage>
+void
+DeformationGridBuilder<TSliceImage>
+::SetSlice(SliceType *slice)
+{
+  m_Slice = slice;
+}
+
+template <class TSliceImage>
+void
+DeformationGridBuilder<TSliceImage>
+::SetMapping(const Mapping &mapping)
+{
+  m_Mapping = mapping;
+}
+
+template <class TSliceImage>
+void
+DeformationGridBuilder<TSliceImage>
+::SetSampling(const Vector2i &lineSpacing, const Vector2i &vertexSpacing)
+{
+  for(int d = 0; d < 2; d++)
+    {
+    m_LineSpacing[d] = std::max(lineSpacing[d], 1);
+    m_VertexSpacing[d] = std::max(vertexSpacing[d], 1);
+    }
+}
+
+template <class TSliceImage>
+void
+DeformationGridBuilder<TSliceImage>
+::Update()
+{
+  if(m_Slice.GetPointer() == m_BuiltSlice
+     && (!m_Slice || m_Slice->GetMTime() == m_BuiltSliceMTime)
+     && m_Mapping == m_BuiltMapping
+     && m_LineSpacing == m_BuiltLineSpacing
+     && m_VertexSpacing == m_BuiltVertexSpacing)
+    return;
+
+  this->BuildGeometry();
+
+  m_BuiltSlice = m_Slice;
+  m_BuiltSliceMTime = m_Slice ? m_Slice->GetMTime() : 0;
+  m_BuiltMapping = m_Mapping;
+  m_BuiltLineSpacing = m_LineSpacing;
+  m_BuiltVertexSpacing = m_VertexSpacing;
+  m_BuildCount++;
+}
+
+template <class TSliceImage>
+void
+DeformationGridBuilder<TSliceImage>
+::BuildGeometry()
+{
+  m_Vertices.clear();
+  m_LineStarts.clear();
+
+  if(!m_Slice || m_Slice->GetNumberOfComponentsPerPixel() < 3)
+    return;
+
+  typename SliceType::RegionType region = m_Slice->GetBufferedRegion();
+  const typename SliceType::InternalPixelType *buffer = m_Slice->GetBufferPointer();
+  int nc = m_Slice->GetNumberOfComponentsPerPixel();
+  int size[2], start[2];
+  for(int a = 0; a < 2; a++)
+    {
+    size[a] = region.GetSize(a);
+    start[a] = region.GetIndex(a);
+    }
+
+  for(int d = 0; d < 2; d++)
+    {
+    int e = 1 - d;
+    if(size[d] < 2)
+      continue;
+
+    // The stride between the voxels of a line, and between the lines
+    int stride = (d == 0) ? nc : nc * size[0];
+    int lineStride = (d == 0) ? nc * size[0] : nc;
+
+    // The sampled lines are those whose index is a multiple of the spacing
+    int first = ((-start[e]) % m_LineSpacing[d] + m_LineSpacing[d]) % m_LineSpacing[d];
+    for(int j = first; j < size[e]; j += m_LineSpacing[d])
+      {
+      m_LineStarts.push_back(m_Vertices.size() / 2);
+
+      // Position of the first voxel of the line, before the warp
+      Vector3d x0 = m_Mapping.Origin + m_Mapping.DIndex[e] * (double) (start[e] + j)
+          + m_Mapping.DIndex[d] * (double) start[d];
+
+      for(int i = 0; i < size[d]; )
+        {
+        const typename SliceType::InternalPixelType *pix = buffer + j * lineStride + i * stride;
+        Vector3d x = x0 + m_Mapping.DIndex[d] * (double) i
+            + m_Mapping.DPhi[0] * (double) pix[0]
+            + m_Mapping.DPhi[1] * (double) pix[1]
+            + m_Mapping.DPhi[2] * (double) pix[2];
+
+        m_Vertices.push_back((float) x[0]);
+        m_Vertices.push_back((float) x[1]);
+
+        // Always end the line at its last voxel
+        if(i == size[d] - 1)
+          break;
+        i = std::min(i + m_VertexSpacing[d], size[d] - 1);
+        }
+      }
+    }
+
+  m_LineStarts.push_back(m_Vertices.size() / 2);
+}
+
+#endif // DEFORMATIONGRIDBUILDER_TXX
@@ -0,0 +1,173 @@
+#ifndef FASTAFFINERESAMPLEIMAGEFILTER_H
+#define FASTAFFINERESAMPLEIMAGEFILTER_H
+
+#include "SNAPCommon.h"
+#include "itkImageToImageFilter.h"
+#include "itkTransform.h"
+#include "itkImage.h"
+
+/**
+ * Helper traits that compute the cubic B-spline coefficients of the input
+ * image. Only scalar images are supported; for other image types the traits
+ * report that cubic interpolation is unavailable.
+ */
+template <class TInputImage>
+class FastAffineResampleCubicTraits
+{
+public:
+  typedef itk::Image<double, TInputImage::ImageDimension> CoefficientImageType;
+
+  static bool IsSupported() { return false; }
+
+  static SmartPtr<CoefficientImageType> ComputeCoefficients(const TInputImage *)
+    { return NULL; }
+};
+
+template <class TPixel, unsigned int VDim>
+class FastAffineResampleCubicTraits< itk::Image<TPixel, VDim> >
+{
+public:
+  typedef itk::Image<double, VDim> CoefficientImageType;
+
+  static bool IsSupported() { return true; }
+
+  static SmartPtr<CoefficientImageType> ComputeCoefficients(const itk::Image<TPixel, VDim> *image);
+};
+
+
+/**
+ * \class FastAffineResampleImageFilter
+ * \brief Resamples a whole 3D image into a new voxel grid under a linear transform
+ *
+ * The filter produces the same output as itk::ResampleImageFilter with the
+ * nearest neighbor, linear or cubic B-spline interpolator, but is much faster
+ * for the affine transforms that SNAP uses to reslice images into the
+ * reference space. Because the transform is linear, the continuous index of
+ * the input sample is an affine function of the output index. It is computed
+ * once per output line and then incremented along the line, and the range of
+ * the line that falls inside of the input image is found up front, so there
+ * is no per-voxel transform or bounds check. Input pixels are read directly
+ * from the buffer, as in FastLinearInterpolator, rather than through virtual
+ * interpolator calls. The output is split into slabs between the threads.
+ *
+ * Nearest neighbor interpolation copies the input values without any
+ * arithmetic, so it is the mode to use for segmentation images. The filter
+ * accepts itk::Image and itk::VectorImage inputs with the same pixel layout
+ * as the output; cubic interpolation is only available for itk::Image.
+ */
+template <class TInputImage, class TOutputImage>
+class FastAffineResampleImageFilter
+    : public itk::ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef FastAffineResampleImageFilter                                  Self;
+  typedef itk::ImageToImageFilter<TInputImage, TOutputImage>       Superclass;
+  typedef itk::SmartPointer<Self>                                     Pointer;
+  typedef itk::SmartPointer<const Self>                          ConstPointer;
+
+  typedef TInputImage                                          InputImageType;
+  typedef typename InputImageType::InternalPixelType       InputComponentType;
+
+  typedef TOutputImage                                        OutputImageType;
+  typedef typename OutputImageType::InternalPixelType     OutputComponentType;
+  typedef typename OutputImageType::RegionType           OutputImageRegionType;
+  typedef typename OutputImageType::SizeType                         SizeType;
+  typedef typename OutputImageType::SpacingType                   SpacingType;
+  typedef typename OutputImageType::PointType                       PointType;
+  typedef typename OutputImageType::DirectionType               DirectionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self)
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(FastAffineResampleImageFilter, ImageToImageFilter)
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TOutputImage::ImageDimension);
+
+  /** Transform from the output physical space to the input physical space */
+  typedef itk::Transform<double, ImageDimension, ImageDimension> TransformType;
+
+  /** Cubic interpolation support */
+  typedef FastAffineResampleCubicTraits<TInputImage>              CubicTraits;
+  typedef typename CubicTraits::CoefficientImageType     CoefficientImageType;
+
+  /**
+   * Check whether the filter can handle a given transform and interpolation
+   * method. Callers should fall back to itk::ResampleImageFilter otherwise.
+   */
+  static bool CanResample(const TransformType *transform, InterpolationMethod method);
+
+  /** The transform, must be linear. A NULL transform means identity */
+  itkSetConstObjectMacro(Transform, TransformType)
+  itkGetConstObjectMacro(Transform, TransformType)
+
+  /** Interpolation method: nearest neighbor, linear or cubic */
+  itkSetMacro(InterpolationMethod, InterpolationMethod)
+  itkGetMacro(InterpolationMethod, InterpolationMethod)
+
+  /** Value assigned to all components of voxels that map outside of the input */
+  itkSetMacro(DefaultValue, double)
+  itkGetMacro(DefaultValue, double)
+
+  /** Geometry of the output image */
+  itkSetMacro(Size, SizeType)
+  itkGetConstReferenceMacro(Size, SizeType)
+
+  itkSetMacro(OutputSpacing, SpacingType)
+  itkGetConstReferenceMacro(OutputSpacing, SpacingType)
+  void SetOutputSpacing(const double *spacing);
+
+  itkSetMacro(OutputOrigin, PointType)
+  itkGetConstReferenceMacro(OutputOrigin, PointType)
+  void SetOutputOrigin(const double *origin);
+
+  itkSetMacro(OutputDirection, DirectionType)
+  itkGetConstReferenceMacro(OutputDirection, DirectionType)
+
+protected:
+
+  FastAffineResampleImageFilter();
+  ~FastAffineResampleImageFilter() {}
+
+  virtual void GenerateOutputInformation() ITK_OVERRIDE;
+
+  virtual void GenerateInputRequestedRegion() ITK_OVERRIDE;
+
+  virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  virtual void ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread,
+                                    itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+  virtual void AfterThreadedGenerateData() ITK_OVERRIDE;
+
+  // Cast an interpolated value to the output type, clamping to its range
+  static inline OutputComponentType CastWithClamp(double value);
+
+  // Cubic B-spline weights and mirrored sample indices along one axis
+  static inline void ComputeCubicWeights(double x, int size, double *w, int *idx);
+
+private:
+
+  typename TransformType::ConstPointer m_Transform;
+  InterpolationMethod m_InterpolationMethod;
+  double m_DefaultValue;
+
+  SizeType m_Size;
+  SpacingType m_OutputSpacing;
+  PointType m_OutputOrigin;
+  DirectionType m_OutputDirection;
+
+  // The affine map from the output index to the continuous index into the
+  // input buffer, computed before threading
+  double m_IndexMatrix[3][3], m_IndexOffset[3];
+
+  // B-spline coefficients for cubic interpolation
+  SmartPtr<CoefficientImageType> m_Coefficients;
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "FastAffineResampleImageFilter.txx"
+#endif
+
+#endif // FASTAFFINERESAMPLEIMAGEFILTER_H
@@ -0,0 +1,388 @@
+#ifndef FASTAFFINERESAMPLEIMAGEFILTER_TXX
+#define FASTAFFINERESAMPLEIMAGEFILTER_TXX
+
+#include "FastAffineResampleImageFilter.h"
+#include "itkBSplineDecompositionImageFilter.h"
+#include "itkContinuousIndex.h"
+#include "itkNumericTraits.h"
+#include "itkProgressReporter.h"
+#include <algorithm>
+#include <cmath>
+
+template <class TPixel, unsigned int VDim>
+SmartPtr<typename FastAffineResampleCubicTraits< itk::Image<TPixel, VDim> >::CoefficientImageType>
+FastAffineResampleCubicTraits< itk::Image<TPixel, VDim> >
+::ComputeCoefficients(const itk::Image<TPixel, VDim> *image)
+{
+  // Same coefficients as computed by itk::BSplineInterpolateImageFunction
+  typedef itk::Image<TPixel, VDim> ImageType;
+  typedef itk::BSplineDecompositionImageFilter<ImageType, CoefficientImageType> FilterType;
+  typename FilterType::Pointer filter = FilterType::New();
+  filter->SetSplineOrder(3);
+  filter->SetInput(image);
+  filter->Update();
+
+  SmartPtr<CoefficientImageType> coeff = filter->GetOutput();
+  return coeff;
+}
+
+template <class TInputImage, class TOutputImage>
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::FastAffineResampleImageFilter()
+  : m_InterpolationMethod(TRILINEAR), m_DefaultValue(0.0)
+{
+  m_Size.Fill(0);
+  m_OutputSpacing.Fill(1.0);
+  m_OutputOrigin.Fill(0.0);
+  m_OutputDirection.SetIdentity();
+
+  for(int a = 0; a < 3; a++)
+    {
+    m_IndexOffset[a] = 0.0;
+    for(int b = 0; b < 3; b++)
+      m_IndexMatrix[a][b] = 0.0;
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+bool
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::CanResample(const TransformType *transform, InterpolationMethod method)
+{
+  // The incremental stepping only works if the transform is affine
+  if(transform && transform->GetTransformCategory() != TransformType::Linear)
+    return false;
+
+  switch(method)
+    {
+    case NEAREST_NEIGHBOR:
+    case TRILINEAR:
+      return true;
+    case TRICUBIC:
+      return CubicTraits::IsSupported();
+    default:
+      return false;
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::SetOutputSpacing(const double *spacing)
+{
+  SpacingType s;
+  for(unsigned int d = 0; d < ImageDimension; d++)
+    s[d] = spacing[d];
+  this->SetOutputSpacing(s);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::SetOutputOrigin(const double *origin)
+{
+  PointType p;
+  for(unsigned int d = 0; d < ImageDimension; d++)
+    p[d] = origin[d];
+  this->SetOutputOrigin(p);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::GenerateOutputInformation()
+{
+  // The superclass is not called because it would copy the input geometry
+  OutputImageType *output = this->GetOutput();
+  const InputImageType *input = this->GetInput();
+  if(!output || !input)
+    return;
+
+  OutputImageRegionType region;
+  region.SetSize(m_Size);
+  output->SetLargestPossibleRegion(region);
+  output->SetSpacing(m_OutputSpacing);
+  output->SetOrigin(m_OutputOrigin);
+  output->SetDirection(m_OutputDirection);
+  output->SetNumberOfComponentsPerPixel(input->GetNumberOfComponentsPerPixel());
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::GenerateInputRequestedRegion()
+{
+  // Any part of the input may be sampled, so we need all of it
+  Superclass::GenerateInputRequestedRegion();
+  InputImageType *input = const_cast<InputImageType *>(this->GetInput());
+  if(input)
+    input->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::BeforeThreadedGenerateData()
+{
+  const InputImageType *input = this->GetInput();
+  OutputImageType *output = this->GetOutput();
+
+  if(!CanResample(m_Transform.GetPointer(), m_InterpolationMethod))
+    itkExceptionMacro(<< "Unsupported transform or interpolation method");
+
+  // Map the output voxel (0,0,0) and its three neighbors along the axes into
+  // the continuous index space of the input. Since the transform is linear,
+  // this gives us the affine map between the two index spaces.
+  itk::ContinuousIndex<double, ImageDimension> cix[ImageDimension + 1];
+  for(unsigned int k = 0; k <= ImageDimension; k++)
+    {
+    typename OutputImageType::IndexType idx;
+    idx.Fill(0);
+    if(k > 0)
+      idx[k - 1] = 1;
+
+    PointType p, q;
+    output->TransformIndexToPhysicalPoint(idx, p);
+    q = m_Transform.IsNotNull() ? m_Transform->TransformPoint(p) : p;
+    input->TransformPhysicalPointToContinuousIndex(q, cix[k]);
+    }
+
+  // Store the map relative to the start of the input buffer
+  typename InputImageType::IndexType ibase = input->GetBufferedRegion().GetIndex();
+  for(unsigned int a = 0; a < ImageDimension; a++)
+    {
+    m_IndexOffset[a] = cix[0][a] - ibase[a];
+    for(unsigned int b = 0; b < ImageDimension; b++)
+      m_IndexMatrix[a][b] = cix[b + 1][a] - cix[0][a];
+    }
+
+  // Cubic interpolation works on the B-spline coefficients, not the image
+  if(m_InterpolationMethod == TRICUBIC)
+    m_Coefficients = CubicTraits::ComputeCoefficients(input);
+  else
+    m_Coefficients = NULL;
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::AfterThreadedGenerateData()
+{
+  m_Coefficients = NULL;
+}
+
+template <class TInputImage, class TOutputImage>
+typename FastAffineResampleImageFilter<TInputImage, TOutputImage>::OutputComponentType
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::CastWithClamp(double value)
+{
+  // Same behavior as itk::ResampleImageFilter
+  typedef itk::NumericTraits<OutputComponentType> NT;
+  if(value < NT::NonpositiveMin())
+    return NT::NonpositiveMin();
+  else if(value > NT::max())
+    return NT::max();
+  else
+    return static_cast<OutputComponentType>(value);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::ComputeCubicWeights(double x, int size, double *w, int *idx)
+{
+  // Weights of the cubic B-spline, as in itk::BSplineInterpolateImageFunction
+  double fx = std::floor(x);
+  double t = x - fx;
+  w[3] = t * t * t / 6.0;
+  w[0] = 1.0 / 6.0 + 0.5 * t * (t - 1.0) - w[3];
+  w[2] = t + w[0] - 2.0 * w[3];
+  w[1] = 1.0 - w[0] - w[2] - w[3];
+
+  // Mirror boundary conditions
+  int i0 = (int) fx - 1, period = 2 * size - 2;
+  for(int k = 0; k < 4; k++)
+    {
+    int i = i0 + k;
+    if(size == 1)
+      i = 0;
+    else
+      {
+      i = (i < 0) ? (-i) % period : i % period;
+      if(i >= size)
+        i = period - i;
+      }
+    idx[k] = i;
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+FastAffineResampleImageFilter<TInputImage, TOutputImage>
+::ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread,
+                       itk::ThreadIdType threadId)
+{
+  typedef itk::OffsetValueType OffsetType;
+
+  const InputImageType *input = this->GetInput();
+  OutputImageType *output = this->GetOutput();
+
+  // Layout of the input buffer
+  int nc = input->GetNumberOfComponentsPerPixel();
+  typename InputImageType::SizeType isz = input->GetBufferedRegion().GetSize();
+  int size[3] = { (int) isz[0], (int) isz[1], (int) isz[2] };
+  OffsetType ystride = size[0], zstride = ystride * size[1];
+  const InputComponentType *in_buffer = input->GetBufferPointer();
+  const double *coeff_buffer = m_Coefficients ? m_Coefficients->GetBufferPointer() : NULL;
+
+  OutputComponentType def_value = static_cast<OutputComponentType>(m_DefaultValue);
+
+  // The output region is processed one line along x at a time
+  const OutputImageRegionType &rgn = outputRegionForThread;
+  int nx = (int) rgn.GetSize(0);
+  int y0 = (int) rgn.GetIndex(1), y1 = y0 + (int) rgn.GetSize(1);
+  int z0 = (int) rgn.GetIndex(2), z1 = z0 + (int) rgn.GetSize(2);
+  itk::ProgressReporter progress(this, threadId, rgn.GetSize(1) * rgn.GetSize(2));
+
+  for(int z = z0; z < z1; z++)
+    {
+    for(int y = y0; y < y1; y++)
+      {
+      typename OutputImageType::IndexType idx_line;
+      idx_line[0] = rgn.GetIndex(0); idx_line[1] = y; idx_line[2] = z;
+      OutputComponentType *out = output->GetBufferPointer() + nc * output->ComputeOffset(idx_line);
+
+      // Continuous index of the first voxel on the line, and the step along it
+      double c[3], s[3];
+      for(int a = 0; a < 3; a++)
+        {
+        c[a] = m_IndexMatrix[a][0] * idx_line[0] + m_IndexMatrix[a][1] * y
+               + m_IndexMatrix[a][2] * z + m_IndexOffset[a];
+        s[a] = m_IndexMatrix[a][0];
+        }
+
+      // Find the range [k0, k1) of the voxels whose samples fall in the input
+      // buffer, i.e., in [-0.5, size - 0.5) along every axis
+      int k0 = 0, k1 = nx;
+      for(int a = 0; a < 3; a++)
+        {
+        double lo = -0.5 - c[a], hi = size[a] - 0.5 - c[a];
+        if(s[a] == 0.0)
+          {
+          if(lo > 0.0 || hi <= 0.0)
+            k1 = 0;
+          }
+        else
+          {
+          // Clamp before converting to int, since the step can be tiny
+          double t0 = std::max(-1.0, std::min(nx + 1.0, lo / s[a]));
+          double t1 = std::max(-1.0, std::min(nx + 1.0, hi / s[a]));
+          if(s[a] > 0)
+            {
+            k0 = std::max(k0, (int) std::ceil(t0));
+            k1 = std::min(k1, (int) std::ceil(t1));
+            }
+          else
+            {
+            k0 = std::max(k0, (int) std::floor(t1) + 1);
+            k1 = std::min(k1, (int) std::floor(t0) + 1);
+            }
+          }
+        }
+      if(k1 < k0)
+        k1 = k0;
+
+      // Voxels before the range
+      for(int k = 0; k < k0 * nc; k++)
+        *out++ = def_value;
+
+      // Voxels in the range. The sample indices are clamped to the buffer so
+      // that round-off at the edges of the range can never read outside of it
+      if(m_InterpolationMethod == NEAREST_NEIGHBOR)
+        {
+        for(int k = k0; k < k1; k++)
+          {
+          int ix = std::max(0, std::min(size[0] - 1, (int) std::floor(c[0] + k * s[0] + 0.5)));
+          int iy = std::max(0, std::min(size[1] - 1, (int) std::floor(c[1] + k * s[1] + 0.5)));
+          int iz = std::max(0, std::min(size[2] - 1, (int) std::floor(c[2] + k * s[2] + 0.5)));
+          const InputComponentType *src = in_buffer + nc * (ix + iy * ystride + iz * zstride);
+          for(int j = 0; j < nc; j++)
+            *out++ = static_cast<OutputComponentType>(src[j]);
+          }
+        }
+      else if(m_InterpolationMethod == TRILINEAR)
+        {
+        for(int k = k0; k < k1; k++)
+          {
+          // Corner indices and fractional offsets. Neighbors outside of the
+          // buffer are replaced by the edge voxel, as in ITK
+          int i0[3], i1[3];
+          double f[3];
+          for(int a = 0; a < 3; a++)
+            {
+            double p = c[a] + k * s[a];
+            double fp = std::floor(p);
+            f[a] = p - fp;
+            i0[a] = std::max(0, std::min(size[a] - 1, (int) fp));
+            i1[a] = std::max(0, std::min(size[a] - 1, (int) fp + 1));
+            }
+
+          OffsetType o000 = nc * (i0[0] + i0[1] * ystride + i0[2] * zstride);
+          OffsetType o100 = nc * (i1[0] + i0[1] * ystride + i0[2] * zstride);
+          OffsetType o010 = nc * (i0[0] + i1[1] * ystride + i0[2] * zstride);
+          OffsetType o110 = nc * (i1[0] + i1[1] * ystride + i0[2] * zstride);
+          OffsetType o001 = nc * (i0[0] + i0[1] * ystride + i1[2] * zstride);
+          OffsetType o101 = nc * (i1[0] + i0[1] * ystride + i1[2] * zstride);
+          OffsetType o011 = nc * (i0[0] + i1[1] * ystride + i1[2] * zstride);
+          OffsetType o111 = nc * (i1[0] + i1[1] * ystride + i1[2] * zstride);
+
+          for(int j = 0; j < nc; j++)
+            {
+            double v00 = in_buffer[o000 + j] + f[0] * (in_buffer[o100 + j] - (double) in_buffer[o000 + j]);
+            double v10 = in_buffer[o010 + j] + f[0] * (in_buffer[o110 + j] - (double) in_buffer[o010 + j]);
+            double v01 = in_buffer[o001 + j] + f[0] * (in_buffer[o101 + j] - (double) in_buffer[o001 + j]);
+            double v11 = in_buffer[o011 + j] + f[0] * (in_buffer[o111 + j] - (double) in_buffer[o011 + j]);
+            double v0 = v00 + f[1] * (v10 - v00);
+            double v1 = v01 + f[1] * (v11 - v01);
+            *out++ = CastWithClamp(v0 + f[2] * (v1 - v0));
+            }
+          }
+        }
+      else
+        {
+        // Cubic interpolation is only supported for scalar images
+        for(int k = k0; k < k1; k++)
+          {
+          double w[3][4];
+          int ix[4], iy[4], iz[4];
+          ComputeCubicWeights(c[0] + k * s[0], size[0], w[0], ix);
+          ComputeCubicWeights(c[1] + k * s[1], size[1], w[1], iy);
+          ComputeCubicWeights(c[2] + k * s[2], size[2], w[2], iz);
+
+          double v = 0.0;
+          for(int r = 0; r < 4; r++)
+            {
+            double vz = 0.0;
+            for(int q = 0; q < 4; q++)
+              {
+              const double *row = coeff_buffer + iz[r] * zstride + iy[q] * ystride;
+              double vy = w[0][0] * row[ix[0]] + w[0][1] * row[ix[1]]
+                          + w[0][2] * row[ix[2]] + w[0][3] * row[ix[3]];
+              vz += w[1][q] * vy;
+              }
+            v += w[2][r] * vz;
+            }
+          *out++ = CastWithClamp(v);
+          }
+        }
+
+      // Voxels after the range
+      for(int k = k1 * nc; k < nx * nc; k++)
+        *out++ = def_value;
+
+      progress.CompletedPixel();
+      }
+    }
+}
+
+#endif // FASTAFFINERESAMPLEIMAGEFILTER_TXX
@@ -138,6 +138,14 @@ public:
   itkGetMacro(BypassMainInput, bool)
   itkSetMacro(BypassMainInput, bool)
 
+  /**
+   * Compute the region of the output slice that is generated from a region of
+   * the input image, i.e., the reverse of CallCopyOutputRegionToInputRegion.
+   * Returns false if the input region does not intersect the current slice.
+   */
+  bool CopyInputRegionToOutputRegion(OutputImageRegionType &destRegion,
+                                     const InputImageRegionType &srcRegion) const;
+
 protected:
   IRISSlicer();
   virtual ~IRISSlicer() {};
@@ -291,6 +299,14 @@ public:
   itkGetMacro(BypassMainInput, bool)
   itkSetMacro(BypassMainInput, bool)
 
+  /**
+    * Compute the region of the output slice that is generated from a region of
+    * the input image, i.e., the reverse of CallCopyOutputRegionToInputRegion.
+    * Returns false if the input region does not intersect the current slice.
+    */
+  bool CopyInputRegionToOutputRegion(OutputImageRegionType &destRegion,
+                                     const InputImageRegionType &srcRegion) const;
+
 protected:
 
   IRISSlicer();
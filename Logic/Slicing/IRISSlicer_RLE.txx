@@ -156,6 +156,40 @@ void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
     }
 }
 
+template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
+bool IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
+::CopyInputRegionToOutputRegion(OutputImageRegionType &destRegion,
+                                const InputImageRegionType &srcRegion) const
+{
+  // The input region must contain the slice
+  long k = m_SliceIndex;
+  if (k < srcRegion.GetIndex(m_SliceDirectionImageAxis)
+      || k >= srcRegion.GetIndex(m_SliceDirectionImageAxis)
+      + (long) srcRegion.GetSize(m_SliceDirectionImageAxis))
+    return false;
+
+  // The mapping of a range along each axis is its own inverse, see
+  // CallCopyOutputRegionToInputRegion
+  unsigned int axis[2] = { m_PixelDirectionImageAxis, m_LineDirectionImageAxis };
+  bool forward[2] = { m_PixelTraverseForward, m_LineTraverseForward };
+  for (unsigned int d = 0; d < 2; d++)
+    {
+    destRegion.SetSize(d, srcRegion.GetSize(axis[d]));
+    if (forward[d])
+      {
+      destRegion.SetIndex(d, srcRegion.GetIndex(axis[d]));
+      }
+    else
+      {
+      destRegion.SetIndex(
+            d, this->GetInput()->GetLargestPossibleRegion().GetSize(axis[d])
+            - (srcRegion.GetIndex(axis[d]) + srcRegion.GetSize(axis[d])));
+      }
+    }
+
+  return true;
+}
+
 template< typename TPixel, typename CounterType, class TOutputImage, class TPreviewImage>
 void IRISSlicer<RLEImage<TPixel, 3, CounterType>, TOutputImage, TPreviewImage>
 ::GenerateInputRequestedRegion()
@@ -0,0 +1,156 @@
+#ifndef LABELRESAMPLEIMAGEFILTER_H
+#define LABELRESAMPLEIMAGEFILTER_H
+
+#include "SNAPCommon.h"
+#include "itkImageToImageFilter.h"
+#include "itkTransform.h"
+#include <vector>
+
+/**
+ * \class LabelResampleImageFilter
+ * \brief Resamples a run-length encoded segmentation into a new voxel grid
+ *
+ * Interpolating the label values of a segmentation produces labels that are
+ * not in the input, and nearest neighbor interpolation gives jagged
+ * boundaries. This filter interpolates the indicator image of each label
+ * instead, and assigns every output voxel the label with the largest
+ * interpolated weight. The weights are accumulated for the labels found
+ * among the input samples of the voxel, which are few, so the cost does not
+ * grow with the number of labels. The interpolation method selects the
+ * kernel:
+ *
+ *   NEAREST_NEIGHBOR   the nearest input voxel
+ *   TRILINEAR          the eight neighbors with trilinear weights
+ *   TRICUBIC, SINC     a Gaussian kernel, for smoother boundaries and to
+ *                      avoid aliasing when downsampling
+ *
+ * As in FastAffineResampleImageFilter, the transform must be linear, and
+ * the continuous index of the input sample is stepped along each output
+ * line. Only the part of each line that maps into the bounding box of the
+ * labels (other than the clear label) is sampled; the input is decoded into
+ * a dense buffer over that box only. Each output line is encoded directly
+ * into the run-length encoded output, and the output is split into slabs
+ * between the threads.
+ */
+template <class TLabelImage>
+class LabelResampleImageFilter
+    : public itk::ImageToImageFilter<TLabelImage, TLabelImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef LabelResampleImageFilter                                     Self;
+  typedef itk::ImageToImageFilter<TLabelImage, TLabelImage>      Superclass;
+  typedef itk::SmartPointer<Self>                                   Pointer;
+  typedef itk::SmartPointer<const Self>                        ConstPointer;
+
+  typedef TLabelImage                                        LabelImageType;
+  typedef typename LabelImageType::PixelType                      PixelType;
+  typedef typename LabelImageType::RLLine                            RLLine;
+  typedef typename LabelImageType::RegionType                    RegionType;
+  typedef typename LabelImageType::SizeType                        SizeType;
+  typedef typename LabelImageType::SpacingType                  SpacingType;
+  typedef typename LabelImageType::PointType                      PointType;
+  typedef typename LabelImageType::DirectionType              DirectionType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self)
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(LabelResampleImageFilter, ImageToImageFilter)
+
+  itkStaticConstMacro(ImageDimension, unsigned int, TLabelImage::ImageDimension);
+
+  /** Transform from the output physical space to the input physical space */
+  typedef itk::Transform<double, ImageDimension, ImageDimension> TransformType;
+
+  /**
+   * Check whether the filter can handle a given transform. Callers should
+   * fall back to itk::ResampleImageFilter otherwise.
+   */
+  static bool CanResample(const TransformType *transform);
+
+  /** The transform, must be linear. A NULL transform means identity */
+  itkSetConstObjectMacro(Transform, TransformType)
+  itkGetConstObjectMacro(Transform, TransformType)
+
+  /** Interpolation method, which selects the kernel (see above) */
+  itkSetMacro(InterpolationMethod, InterpolationMethod)
+  itkGetMacro(InterpolationMethod, InterpolationMethod)
+
+  /**
+   * Standard deviation of the Gaussian kernel, in input voxels. If zero, it
+   * is half of the output voxel size, and at least half of an input voxel.
+   */
+  itkSetMacro(GaussianSigma, double)
+  itkGetMacro(GaussianSigma, double)
+
+  /** Geometry of the output image */
+  itkSetMacro(Size, SizeType)
+  itkGetConstReferenceMacro(Size, SizeType)
+
+  itkSetMacro(OutputSpacing, SpacingType)
+  itkGetConstReferenceMacro(OutputSpacing, SpacingType)
+  void SetOutputSpacing(const double *spacing);
+
+  itkSetMacro(OutputOrigin, PointType)
+  itkGetConstReferenceMacro(OutputOrigin, PointType)
+  void SetOutputOrigin(const double *origin);
+
+  itkSetMacro(OutputDirection, DirectionType)
+  itkGetConstReferenceMacro(OutputDirection, DirectionType)
+
+protected:
+
+  LabelResampleImageFilter();
+  ~LabelResampleImageFilter() {}
+
+  virtual void GenerateOutputInformation() ITK_OVERRIDE;
+
+  virtual void GenerateInputRequestedRegion() ITK_OVERRIDE;
+
+  virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  virtual void ThreadedGenerateData(const RegionType& outputRegionForThread,
+                                    itk::ThreadIdType threadId) ITK_OVERRIDE;
+
+  virtual void AfterThreadedGenerateData() ITK_OVERRIDE;
+
+  // Decode the input into the dense buffer over the bounding box of the labels
+  void DecodeInput();
+
+  // Compute the kernel taps and weights along one axis for a sample at x
+  inline int ComputeTaps(int axis, double x, int *idx, double *w) const;
+
+private:
+
+  typename TransformType::ConstPointer m_Transform;
+  InterpolationMethod m_InterpolationMethod;
+  double m_GaussianSigma;
+
+  SizeType m_Size;
+  SpacingType m_OutputSpacing;
+  PointType m_OutputOrigin;
+  DirectionType m_OutputDirection;
+
+  // The affine map from the output index to the continuous index into the
+  // input buffer, computed before threading
+  double m_IndexMatrix[3][3], m_IndexOffset[3];
+
+  // Size of the input buffer
+  int m_InputSize[3];
+
+  // Bounding box of the labels in the input buffer, inclusive, and the
+  // labels decoded over this box. The box is empty if all voxels are clear
+  int m_BoxLower[3], m_BoxUpper[3];
+  std::vector<PixelType> m_Dense;
+
+  // Gaussian kernel: standard deviation and radius along each axis
+  double m_Sigma[3];
+  int m_Radius[3];
+};
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "LabelResampleImageFilter.txx"
+#endif
+
+#endif // LABELRESAMPLEIMAGEFILTER_H
@@ -0,0 +1,436 @@
+#ifndef LABELRESAMPLEIMAGEFILTER_TXX
+#define LABELRESAMPLEIMAGEFILTER_TXX
+
+#include "LabelResampleImageFilter.h"
+#include "itkContinuousIndex.h"
+#include "itkProgressReporter.h"
+#include <algorithm>
+#include <cmath>
+
+// Largest radius of the Gaussian kernel, in input voxels
+static const int LABEL_RESAMPLE_MAX_RADIUS = 8;
+
+template <class TLabelImage>
+LabelResampleImageFilter<TLabelImage>
+::LabelResampleImageFilter()
+  : m_InterpolationMethod(TRILINEAR), m_GaussianSigma(0.0)
+{
+  m_Size.Fill(0);
+  m_OutputSpacing.Fill(1.0);
+  m_OutputOrigin.Fill(0.0);
+  m_OutputDirection.SetIdentity();
+
+  for(int a = 0; a < 3; a++)
+    {
+    m_IndexOffset[a] = 0.0;
+    for(int b = 0; b < 3; b++)
+      m_IndexMatrix[a][b] = 0.0;
+    m_InputSize[a] = 0;
+    m_BoxLower[a] = 0;
+    m_BoxUpper[a] = -1;
+    m_Sigma[a] = 0.0;
+    m_Radius[a] = 1;
+    }
+}
+
+template <class TLabelImage>
+bool
+LabelResampleImageFilter<TLabelImage>
+::CanResample(const TransformType *transform)
+{
+  // The incremental stepping only works if the transform is affine
+  return !transform || transform->GetTransformCategory() == TransformType::Linear;
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::SetOutputSpacing(const double *spacing)
+{
+  SpacingType s;
+  for(unsigned int d = 0; d < ImageDimension; d++)
+    s[d] = spacing[d];
+  this->SetOutputSpacing(s);
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::SetOutputOrigin(const double *origin)
+{
+  PointType p;
+  for(unsigned int d = 0; d < ImageDimension; d++)
+    p[d] = origin[d];
+  this->SetOutputOrigin(p);
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::GenerateOutputInformation()
+{
+  // The superclass is not called because it would copy the input geometry
+  LabelImageType *output = this->GetOutput();
+  const LabelImageType *input = this->GetInput();
+  if(!output || !input)
+    return;
+
+  RegionType region;
+  region.SetSize(m_Size);
+  output->SetLargestPossibleRegion(region);
+  output->SetSpacing(m_OutputSpacing);
+  output->SetOrigin(m_OutputOrigin);
+  output->SetDirection(m_OutputDirection);
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::GenerateInputRequestedRegion()
+{
+  // Any part of the input may be sampled, so we need all of it
+  Superclass::GenerateInputRequestedRegion();
+  LabelImageType *input = const_cast<LabelImageType *>(this->GetInput());
+  if(input)
+    input->SetRequestedRegionToLargestPossibleRegion();
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::DecodeInput()
+{
+  const LabelImageType *input = this->GetInput();
+  typename LabelImageType::BufferType *buffer = input->GetBuffer();
+  const RLLine *lines = buffer->GetBufferPointer();
+  int ny = m_InputSize[1], nz = m_InputSize[2];
+
+  // Find the bounding box of the labels other than the clear label
+  for(int a = 0; a < 3; a++)
+    {
+    m_BoxLower[a] = m_InputSize[a];
+    m_BoxUpper[a] = -1;
+    }
+
+  for(int z = 0; z < nz; z++)
+    {
+    for(int y = 0; y < ny; y++)
+      {
+      const RLLine &line = lines[y + z * ny];
+      int x = 0;
+      for(size_t k = 0; k < line.size(); x += line[k].first, k++)
+        {
+        if(line[k].second == 0)
+          continue;
+        m_BoxLower[0] = std::min(m_BoxLower[0], x);
+        m_BoxUpper[0] = std::max(m_BoxUpper[0], x + (int) line[k].first - 1);
+        m_BoxLower[1] = std::min(m_BoxLower[1], y);
+        m_BoxUpper[1] = std::max(m_BoxUpper[1], y);
+        m_BoxLower[2] = std::min(m_BoxLower[2], z);
+        m_BoxUpper[2] = std::max(m_BoxUpper[2], z);
+        }
+      }
+    }
+
+  m_Dense.clear();
+  if(m_BoxUpper[0] < m_BoxLower[0])
+    return;
+
+  // Decode the labels over the box. All non-clear runs lie inside of it
+  int bx = m_BoxUpper[0] - m_BoxLower[0] + 1;
+  int by = m_BoxUpper[1] - m_BoxLower[1] + 1;
+  int bz = m_BoxUpper[2] - m_BoxLower[2] + 1;
+  m_Dense.assign((size_t) bx * by * bz, 0);
+
+  for(int z = m_BoxLower[2]; z <= m_BoxUpper[2]; z++)
+    {
+    for(int y = m_BoxLower[1]; y <= m_BoxUpper[1]; y++)
+      {
+      const RLLine &line = lines[y + z * ny];
+      PixelType *out = &m_Dense[bx * ((y - m_BoxLower[1]) + by * (size_t) (z - m_BoxLower[2]))];
+      int x = 0;
+      for(size_t k = 0; k < line.size(); x += line[k].first, k++)
+        if(line[k].second != 0)
+          std::fill(out + x - m_BoxLower[0], out + x - m_BoxLower[0] + line[k].first,
+                    line[k].second);
+      }
+    }
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::BeforeThreadedGenerateData()
+{
+  const LabelImageType *input = this->GetInput();
+  LabelImageType *output = this->GetOutput();
+
+  if(!CanResample(m_Transform.GetPointer()))
+    itkExceptionMacro(<< "Unsupported transform");
+
+  // Map the output voxel (0,0,0) and its three neighbors along the axes into
+  // the continuous index space of the input. Since the transform is linear,
+  // this gives us the affine map between the two index spaces.
+  itk::ContinuousIndex<double, ImageDimension> cix[ImageDimension + 1];
+  for(unsigned int k = 0; k <= ImageDimension; k++)
+    {
+    typename LabelImageType::IndexType idx;
+    idx.Fill(0);
+    if(k > 0)
+      idx[k - 1] = 1;
+
+    PointType p, q;
+    output->TransformIndexToPhysicalPoint(idx, p);
+    q = m_Transform.IsNotNull() ? m_Transform->TransformPoint(p) : p;
+    input->TransformPhysicalPointToContinuousIndex(q, cix[k]);
+    }
+
+  // Store the map relative to the start of the input buffer
+  typename LabelImageType::IndexType ibase = input->GetBufferedRegion().GetIndex();
+  for(unsigned int a = 0; a < ImageDimension; a++)
+    {
+    m_IndexOffset[a] = cix[0][a] - ibase[a];
+    for(unsigned int b = 0; b < ImageDimension; b++)
+      m_IndexMatrix[a][b] = cix[b + 1][a] - cix[0][a];
+    m_InputSize[a] = (int) input->GetBufferedRegion().GetSize(a);
+    }
+
+  // The Gaussian kernel covers the output voxel, so that thin structures are
+  // not lost when downsampling
+  for(unsigned int a = 0; a < ImageDimension; a++)
+    {
+    if(m_GaussianSigma > 0.0)
+      {
+      m_Sigma[a] = m_GaussianSigma;
+      }
+    else
+      {
+      double step = 0.0;
+      for(unsigned int b = 0; b < ImageDimension; b++)
+        step += m_IndexMatrix[a][b] * m_IndexMatrix[a][b];
+      m_Sigma[a] = 0.5 * std::max(1.0, std::sqrt(step));
+      }
+    m_Radius[a] = std::max(1, std::min(LABEL_RESAMPLE_MAX_RADIUS,
+                                       (int) std::ceil(3.0 * m_Sigma[a])));
+    }
+
+  this->DecodeInput();
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::AfterThreadedGenerateData()
+{
+  std::vector<PixelType>().swap(m_Dense);
+}
+
+template <class TLabelImage>
+int
+LabelResampleImageFilter<TLabelImage>
+::ComputeTaps(int axis, double x, int *idx, double *w) const
+{
+  int last = m_InputSize[axis] - 1;
+  double fx = std::floor(x);
+  if(m_InterpolationMethod == NEAREST_NEIGHBOR)
+    {
+    idx[0] = std::max(0, std::min(last, (int) std::floor(x + 0.5)));
+    w[0] = 1.0;
+    return 1;
+    }
+  else if(m_InterpolationMethod == TRILINEAR)
+    {
+    // Neighbors outside of the buffer are replaced by the edge voxel, as in ITK
+    idx[0] = std::max(0, std::min(last, (int) fx));
+    idx[1] = std::max(0, std::min(last, (int) fx + 1));
+    w[1] = x - fx;
+    w[0] = 1.0 - w[1];
+    return 2;
+    }
+  else
+    {
+    int r = m_Radius[axis], n = 2 * r;
+    double sum = 0.0, scale = -0.5 / (m_Sigma[axis] * m_Sigma[axis]);
+    for(int k = 0; k < n; k++)
+      {
+      int i = (int) fx - r + 1 + k;
+      w[k] = std::exp(scale * (i - x) * (i - x));
+      idx[k] = std::max(0, std::min(last, i));
+      sum += w[k];
+      }
+    for(int k = 0; k < n; k++)
+      w[k] /= sum;
+    return n;
+    }
+}
+
+// Restrict [k0, k1) to the steps k at which c + k * s lies in [lo, hi)
+static inline void LabelResampleClipRange(double c, double s, double lo, double hi,
+                                          int nx, int &k0, int &k1)
+{
+  lo -= c;
+  hi -= c;
+  if(s == 0.0)
+    {
+    if(lo > 0.0 || hi <= 0.0)
+      k1 = 0;
+    }
+  else
+    {
+    // Clamp before converting to int, since the step can be tiny
+    double t0 = std::max(-1.0, std::min(nx + 1.0, lo / s));
+    double t1 = std::max(-1.0, std::min(nx + 1.0, hi / s));
+    if(s > 0)
+      {
+      k0 = std::max(k0, (int) std::ceil(t0));
+      k1 = std::min(k1, (int) std::ceil(t1));
+      }
+    else
+      {
+      k0 = std::max(k0, (int) std::floor(t1) + 1);
+      k1 = std::min(k1, (int) std::floor(t0) + 1);
+      }
+    }
+}
+
+// Append a run to a run-length encoded line, merging it with the last run
+template <class TLine, class TPixel>
+static inline void LabelResampleAppendRun(TLine &line, TPixel label, int length)
+{
+  if(length <= 0)
+    return;
+  if(line.size() && line.back().second == label)
+    line.back().first += length;
+  else
+    line.push_back(std::make_pair((typename TLine::value_type::first_type) length, label));
+}
+
+template <class TLabelImage>
+void
+LabelResampleImageFilter<TLabelImage>
+::ThreadedGenerateData(const RegionType &outputRegionForThread,
+                       itk::ThreadIdType threadId)
+{
+  LabelImageType *output = this->GetOutput();
+  typename LabelImageType::BufferType *outBuffer = output->GetBuffer();
+
+  // Layout of the dense buffer over the bounding box of the labels
+  bool empty = m_Dense.empty();
+  int bx = m_BoxUpper[0] - m_BoxLower[0] + 1;
+  int by = m_BoxUpper[1] - m_BoxLower[1] + 1;
+  const PixelType *dense = empty ? NULL : &m_Dense[0];
+
+  // How far outside of the box a sample can be and still have a tap in it
+  double reach = 0.5;
+  if(m_InterpolationMethod == TRILINEAR)
+    reach = 1.0;
+  else if(m_InterpolationMethod != NEAREST_NEIGHBOR)
+    reach = *std::max_element(m_Radius, m_Radius + 3);
+
+  // Kernel taps along each axis, and the weights of the labels in the kernel
+  const int maxTaps = 2 * LABEL_RESAMPLE_MAX_RADIUS;
+  int tx[maxTaps], ty[maxTaps], tz[maxTaps];
+  double wx[maxTaps], wy[maxTaps], wz[maxTaps];
+  std::vector<std::pair<PixelType, double> > votes;
+
+  // The output region is processed one line along x at a time
+  const RegionType &rgn = outputRegionForThread;
+  int nx = (int) rgn.GetSize(0);
+  int y0 = (int) rgn.GetIndex(1), y1 = y0 + (int) rgn.GetSize(1);
+  int z0 = (int) rgn.GetIndex(2), z1 = z0 + (int) rgn.GetSize(2);
+  itk::ProgressReporter progress(this, threadId, rgn.GetSize(1) * rgn.GetSize(2));
+
+  for(int z = z0; z < z1; z++)
+    {
+    for(int y = y0; y < y1; y++)
+      {
+      // Continuous index of the first voxel on the line, and the step along it
+      double c[3], s[3];
+      for(int a = 0; a < 3; a++)
+        {
+        c[a] = m_IndexMatrix[a][0] * rgn.GetIndex(0) + m_IndexMatrix[a][1] * y
+               + m_IndexMatrix[a][2] * z + m_IndexOffset[a];
+        s[a] = m_IndexMatrix[a][0];
+        }
+
+      // Find the range [k0, k1) of the voxels whose samples fall in the input
+      // buffer, i.e., in [-0.5, size - 0.5) along every axis, and close
+      // enough to the bounding box of the labels to have a tap in it
+      int k0 = 0, k1 = empty ? 0 : nx;
+      for(int a = 0; a < 3 && k1 > k0; a++)
+        {
+        LabelResampleClipRange(c[a], s[a], -0.5, m_InputSize[a] - 0.5, nx, k0, k1);
+        LabelResampleClipRange(c[a], s[a], m_BoxLower[a] - reach,
+                               m_BoxUpper[a] + reach, nx, k0, k1);
+        }
+      if(k1 < k0)
+        k1 = k0;
+
+      // The voxels outside of the range are clear
+      RLLine line;
+      LabelResampleAppendRun(line, (PixelType) 0, k0);
+
+      for(int k = k0; k < k1; k++)
+        {
+        int nTx = ComputeTaps(0, c[0] + k * s[0], tx, wx);
+        int nTy = ComputeTaps(1, c[1] + k * s[1], ty, wy);
+        int nTz = ComputeTaps(2, c[2] + k * s[2], tz, wz);
+
+        // Add up the weights of each label among the taps. Taps outside of
+        // the bounding box are clear
+        votes.clear();
+        size_t last = 0;
+        for(int iz = 0; iz < nTz; iz++)
+          {
+          int qz = tz[iz] - m_BoxLower[2];
+          bool inz = qz >= 0 && tz[iz] <= m_BoxUpper[2];
+          for(int iy = 0; iy < nTy; iy++)
+            {
+            int qy = ty[iy] - m_BoxLower[1];
+            bool iny = inz && qy >= 0 && ty[iy] <= m_BoxUpper[1];
+            const PixelType *row = iny ? dense + bx * (qy + by * (size_t) qz) : NULL;
+            double wzy = wz[iz] * wy[iy];
+            for(int ix = 0; ix < nTx; ix++)
+              {
+              int qx = tx[ix] - m_BoxLower[0];
+              PixelType label = (row && qx >= 0 && tx[ix] <= m_BoxUpper[0]) ? row[qx] : 0;
+              double w = wzy * wx[ix];
+
+              // Consecutive taps usually have the same label
+              if(last < votes.size() && votes[last].first == label)
+                {
+                votes[last].second += w;
+                continue;
+                }
+              for(last = 0; last < votes.size(); last++)
+                if(votes[last].first == label)
+                  break;
+              if(last == votes.size())
+                votes.push_back(std::make_pair(label, 0.0));
+              votes[last].second += w;
+              }
+            }
+          }
+
+        // Assign the label with the largest weight
+        size_t best = 0;
+        for(size_t j = 1; j < votes.size(); j++)
+          if(votes[j].second > votes[best].second)
+            best = j;
+        LabelResampleAppendRun(line, votes[best].first, 1);
+        }
+
+      LabelResampleAppendRun(line, (PixelType) 0, nx - k1);
+
+      // Store the line in the output
+      typename LabelImageType::BufferType::IndexType lineIndex;
+      lineIndex[0] = y;
+      lineIndex[1] = z;
+      outBuffer->GetPixel(lineIndex).swap(line);
+
+      progress.CompletedPixel();
+      }
+    }
+}
+
+#endif // LABELRESAMPLEIMAGEFILTER_TXX
@@ -46,6 +46,8 @@
 #include "itkImageToImageFilter.h"
 #include "itkTransform.h"
 #include "itkDataObjectDecorator.h"
+#include "itkVectorImage.h"
+#include <vector>
 
 using itk::DataObjectDecorator;
 using itk::ProcessObject;
@@ -74,6 +76,9 @@ public:
 
   inline void ProcessVoxel(double *cix, bool use_nn, OutputComponentType **out_ptr);
 
+  inline void ProcessRun(double *cix, const double *step, int n, bool use_nn,
+                         OutputComponentType **out_ptr);
+
   inline void SkipVoxels(int n, OutputComponentType **out_ptr);
 
 protected:
@@ -85,18 +90,76 @@ protected:
   // Number of components
   int m_NumComponents;
 
-  // Temporary buffer
+  // Temporary buffer, large enough for a block of samples processed by ProcessRun
   double *m_Buffer;
 };
 
 
+/**
+ * This helper maps points through a transform that is not linear, such as a
+ * displacement field produced by deformable registration, possibly composed
+ * with affine transforms in an itk::CompositeTransform. Affine components are
+ * applied as a matrix and offset, and displacement fields are sampled with
+ * FastLinearInterpolator, with the same boundary behavior as the ITK
+ * displacement field transform (edge voxels are repeated up to half a voxel
+ * outside of the field, zero displacement beyond that). Components of any
+ * other kind are evaluated through their TransformPoint(). Since the
+ * interpolators keep state, each thread must use its own instance.
+ */
+template <unsigned int VDim>
+class NonOrthogonalSlicerWarpEvaluator
+{
+public:
+  typedef itk::Transform<double, VDim, VDim> TransformType;
+
+  NonOrthogonalSlicerWarpEvaluator(const TransformType *transform);
+  ~NonOrthogonalSlicerWarpEvaluator();
+
+  /** Map a physical point through the transform */
+  void TransformPoint(const double *in, double *out);
+
+protected:
+
+  // The displacement fields are sampled as vector images of doubles
+  typedef itk::VectorImage<double, VDim> FieldBufferType;
+  typedef FastLinearInterpolator<FieldBufferType, double, VDim> FieldInterpolator;
+
+  // One of the transforms in the chain
+  struct Step
+  {
+    // For affine steps, the matrix and offset. For displacement fields, the
+    // map from the physical point to the continuous index into the field
+    double A[VDim][VDim], b[VDim];
+
+    // The field interpolator and field dimensions, for displacement fields
+    FieldInterpolator *Interpolator;
+    int Size[VDim];
+
+    // The transform itself, for transforms of other kinds
+    const TransformType *Generic;
+  };
+
+  // The steps, in the order in which they are applied
+  std::vector<Step> m_Steps;
+
+  void AddTransform(const TransformType *transform);
+
+private:
+  NonOrthogonalSlicerWarpEvaluator(const NonOrthogonalSlicerWarpEvaluator &);
+  void operator = (const NonOrthogonalSlicerWarpEvaluator &);
+};
+
+
 /**
  * This is an alternative slicer that functions more or less like an ITK
  * ResampleImageFilter, but more efficiently and directly maps the data to
  * a 2D slice.
  *
  * The filter takes a transform and a reference image from which the slice is
- * generated.
+ * generated. For linear transforms, only two points per output line are
+ * mapped through the transform and the line is sampled by stepping. Other
+ * transforms, i.e., displacement fields, are evaluated at every voxel using
+ * NonOrthogonalSlicerWarpEvaluator.
  */
 template <typename TInputImage, typename TOutputImage>
 class NonOrthogonalSlicer
@@ -139,6 +202,7 @@ public:
 
   /** The worker class */
   typedef NonOrthogonalSlicerPixelAccessTraitsWorker<TInputImage, TOutputImage> WorkerType;
+  typedef NonOrthogonalSlicerWarpEvaluator<InputImageDimension> WarpEvaluatorType;
 
   /** Reference image input */
   itkSetInputMacro(ReferenceImage, ReferenceImageBaseType)
@@ -196,6 +260,12 @@ public:
     assert(0);
   }
 
+  inline void ProcessRun(double *cix, const double *step, int n, bool use_nn,
+                         OutputComponentType **out_ptr)
+  {
+    assert(0);
+  }
+
   inline void SkipVoxels(int n, OutputComponentType **out_ptr) {}
 };
 
@@ -217,6 +287,8 @@ public:
   ~NonOrthogonalSlicerPixelAccessTraitsWorker();
 
   inline void ProcessVoxel(double *cix, bool use_nn, OutputComponentType **out_ptr);
+  inline void ProcessRun(double *cix, const double *step, int n, bool use_nn,
+                         OutputComponentType **out_ptr);
   inline void SkipVoxels(int n, OutputComponentType **out_ptr);
 
 protected:
@@ -228,7 +300,7 @@ protected:
   // Number of components
   int m_NumComponents;
 
-  // Temporary buffer for interpolation
+  // Temporary buffer for interpolation, large enough for a block of samples
   double *m_Buffer;
 
   // Temporary buffer for computing the derived quantity
@@ -258,6 +330,8 @@ public:
   ~NonOrthogonalSlicerPixelAccessTraitsWorker();
 
   inline void ProcessVoxel(double *cix, bool use_nn, OutputComponentType **out_ptr);
+  inline void ProcessRun(double *cix, const double *step, int n, bool use_nn,
+                         OutputComponentType **out_ptr);
   inline void SkipVoxels(int n, OutputComponentType **out_ptr);
 
 protected:
@@ -272,8 +346,9 @@ protected:
   // Number of components
   int m_NumComponents, m_ExtractComponent;
 
-  // Temporary buffer
+  // Temporary buffers for single samples and for runs of samples
   double m_BufferValue;
+  double *m_RunBuffer;
 };
 
 
@@ -46,6 +46,159 @@
 #include "NonOrthogonalSlicer.h"
 #include "FastLinearInterpolator.h"
 #include "ImageRegionConstIteratorWithIndexOverride.h"
+#include "itkCompositeTransform.h"
+#include "itkDisplacementFieldTransform.h"
+#include "itkMatrixOffsetTransformBase.h"
+
+template <unsigned int VDim>
+NonOrthogonalSlicerWarpEvaluator<VDim>
+::NonOrthogonalSlicerWarpEvaluator(const TransformType *transform)
+{
+  if(transform)
+    this->AddTransform(transform);
+}
+
+template <unsigned int VDim>
+NonOrthogonalSlicerWarpEvaluator<VDim>
+::~NonOrthogonalSlicerWarpEvaluator()
+{
+  for(unsigned int i = 0; i < m_Steps.size(); i++)
+    delete m_Steps[i].Interpolator;
+}
+
+template <unsigned int VDim>
+void
+NonOrthogonalSlicerWarpEvaluator<VDim>
+::AddTransform(const TransformType *transform)
+{
+  typedef itk::CompositeTransform<double, VDim> CompositeType;
+  typedef itk::MatrixOffsetTransformBase<double, VDim, VDim> AffineType;
+  typedef itk::DisplacementFieldTransform<double, VDim> WarpType;
+  typedef typename WarpType::DisplacementFieldType FieldType;
+
+  // The composite transform applies the last transform in its queue first
+  const CompositeType *composite = dynamic_cast<const CompositeType *>(transform);
+  if(composite)
+    {
+    for(int i = (int) composite->GetNumberOfTransforms() - 1; i >= 0; i--)
+      this->AddTransform(composite->GetNthTransformConstPointer(i));
+    return;
+    }
+
+  Step step;
+  step.Interpolator = NULL;
+  step.Generic = NULL;
+
+  const AffineType *affine = dynamic_cast<const AffineType *>(transform);
+  const WarpType *warp = dynamic_cast<const WarpType *>(transform);
+  if(affine)
+    {
+    for(unsigned int a = 0; a < VDim; a++)
+      {
+      for(unsigned int c = 0; c < VDim; c++)
+        step.A[a][c] = affine->GetMatrix()(a, c);
+      step.b[a] = affine->GetOffset()[a];
+      }
+    }
+  else if(warp)
+    {
+    // A transform without a field is the identity
+    FieldType *field = const_cast<FieldType *>(warp->GetDisplacementField());
+    if(!field)
+      return;
+
+    // The field is sampled as a vector image with VDim components, which
+    // has the same memory layout as the image of vectors
+    double *buffer = reinterpret_cast<double *>(field->GetBufferPointer());
+    step.Interpolator = new FieldInterpolator(field, buffer, VDim);
+
+    // Map from the physical point to the continuous index into the buffer
+    const typename FieldType::DirectionType &p2i = field->GetPhysicalPointToIndex();
+    for(unsigned int a = 0; a < VDim; a++)
+      {
+      step.b[a] = -field->GetBufferedRegion().GetIndex(a);
+      for(unsigned int c = 0; c < VDim; c++)
+        {
+        step.A[a][c] = p2i(a, c);
+        step.b[a] -= p2i(a, c) * field->GetOrigin()[c];
+        }
+      step.Size[a] = field->GetBufferedRegion().GetSize(a);
+      }
+    }
+  else
+    {
+    step.Generic = transform;
+    }
+
+  m_Steps.push_back(step);
+}
+
+template <unsigned int VDim>
+void
+NonOrthogonalSlicerWarpEvaluator<VDim>
+::TransformPoint(const double *in, double *out)
+{
+  double p[VDim], q[VDim];
+  for(unsigned int a = 0; a < VDim; a++)
+    p[a] = in[a];
+
+  for(unsigned int i = 0; i < m_Steps.size(); i++)
+    {
+    Step &step = m_Steps[i];
+    if(step.Interpolator)
+      {
+      // Compute the continuous index into the field. Like ITK, use the edge
+      // values within half a voxel of the field and no displacement outside
+      bool inside = true;
+      for(unsigned int a = 0; a < VDim; a++)
+        {
+        double x = step.b[a];
+        for(unsigned int c = 0; c < VDim; c++)
+          x += step.A[a][c] * p[c];
+
+        if(x < -0.5 || x >= step.Size[a] - 0.5)
+          {
+          inside = false;
+          break;
+          }
+
+        q[a] = std::max(0.0, std::min(x, step.Size[a] - 1.0));
+        }
+
+      if(inside)
+        {
+        double u[VDim];
+        step.Interpolator->Interpolate(q, u);
+        for(unsigned int a = 0; a < VDim; a++)
+          p[a] += u[a];
+        }
+      }
+    else if(step.Generic)
+      {
+      typename TransformType::InputPointType pt;
+      for(unsigned int a = 0; a < VDim; a++)
+        pt[a] = p[a];
+      pt = step.Generic->TransformPoint(pt);
+      for(unsigned int a = 0; a < VDim; a++)
+        p[a] = pt[a];
+      }
+    else
+      {
+      for(unsigned int a = 0; a < VDim; a++)
+        {
+        q[a] = step.b[a];
+        for(unsigned int c = 0; c < VDim; c++)
+          q[a] += step.A[a][c] * p[c];
+        }
+      for(unsigned int a = 0; a < VDim; a++)
+        p[a] = q[a];
+      }
+    }
+
+  for(unsigned int a = 0; a < VDim; a++)
+    out[a] = p[a];
+}
+
 
 template <class TInputImage, class TOutputImage>
 NonOrthogonalSlicer<TInputImage, TOutputImage>
@@ -148,6 +301,11 @@ NonOrthogonalSlicer<TInputImage, TOutputImage>
   // Whether to use nn
   bool use_nn = this->GetUseNearestNeighbor();
 
+  // Transforms that are not linear can not be stepped along the line, and
+  // are evaluated at every voxel instead
+  bool is_linear = transform->GetTransformCategory() == TransformType::Linear;
+  WarpEvaluatorType warp(is_linear ? NULL : transform);
+
   // Loop over the lines in the input image
   for(IterType it(this->GetOutput(), outputRegionForThread); !it.IsAtEnd(); it.NextLine())
     {
@@ -172,6 +330,33 @@ NonOrthogonalSlicer<TInputImage, TOutputImage>
     reference->TransformIndexToPhysicalPoint(idxStart, pRefStart);
     reference->TransformIndexToPhysicalPoint(idxNext, pRefNext);
 
+    // Sample the warp along the line, skipping voxels that fall outside
+    if(!is_linear)
+      {
+      for(int i = 0; i < line_len; i++)
+        {
+        typename ReferenceImageBaseType::PointType pRef, pInp;
+        for(int d = 0; d < InputImageDimension; d++)
+          pRef[d] = pRefStart[d] + i * (pRefNext[d] - pRefStart[d]);
+
+        warp.TransformPoint(pRef.GetDataPointer(), pInp.GetDataPointer());
+
+        itk::ContinuousIndex<double, InputImageDimension> cix;
+        input->TransformPhysicalPointToContinuousIndex(pInp, cix);
+
+        bool inside = true;
+        for(int d = 0; d < InputImageDimension; d++)
+          if(cix[d] < cixCubeStart[d] || cix[d] >= cixCubeEnd[d])
+            inside = false;
+
+        if(inside)
+          worker.ProcessVoxel(cix.GetDataPointer(), use_nn, &outPixelPtr);
+        else
+          worker.SkipVoxels(1, &outPixelPtr);
+        }
+      continue;
+      }
+
     // Apply the affine transform to this point - so it's relative to the input image
     typename ReferenceImageBaseType::PointType pInpStart, pInpNext;
     pInpStart = transform->TransformPoint(pRefStart);
@@ -242,14 +427,52 @@ NonOrthogonalSlicer<TInputImage, TOutputImage>
           cixSample[d] += kStart * cixStep[d];
         }
 
-      // Process the voxels that cross the image cube
-      for(int i = kStart; i <= kEnd; i++)
+      // Find the run of samples whose neighbors are all inside of the image,
+      // i.e., 0 <= cix < size - 1 on every axis. The bounds are shrunk by a
+      // small margin to allow for roundoff as the positions are accumulated
+      int rStart = kStart, rEnd = kEnd;
+      for(int d = 0; d < InputImageDimension; d++)
+        {
+        double x0 = cixCubeStart[d] + 0.5 + 1.0e-4, x1 = cixCubeEnd[d] - 0.5 - 1.0e-4;
+        double dx = cixStep[d], x = cixSample[d];
+        if(dx == 0.0)
+          {
+          if(x < x0 || x > x1)
+            rEnd = rStart - 1;
+          }
+        else
+          {
+          double z0 = (x0 - x) / dx, z1 = (x1 - x) / dx;
+          if(z0 > z1)
+            std::swap(z0, z1);
+          z0 = std::min(std::max(z0, 0.0), kEnd - kStart + 1.0);
+          z1 = std::min(std::max(z1, -1.0), (double) (kEnd - kStart));
+          rStart = std::max(rStart, kStart + (int) ceil(z0));
+          rEnd = std::min(rEnd, kStart + (int) floor(z1));
+          }
+        }
+
+      // Process the voxels that cross the image cube. The interior run is
+      // interpolated without bounds checks, and only the samples near the
+      // edges of the image go through the checked path
+      for(int i = kStart; i <= kEnd; )
         {
-        worker.ProcessVoxel(cixSample.GetDataPointer(), use_nn, &outPixelPtr);
+        if(i == rStart && rEnd >= rStart)
+          {
+          // This advances the sample location past the run
+          worker.ProcessRun(cixSample.GetDataPointer(), cixStep.GetDataPointer(),
+                            rEnd - rStart + 1, use_nn, &outPixelPtr);
+          i = rEnd + 1;
+          }
+        else
+          {
+          worker.ProcessVoxel(cixSample.GetDataPointer(), use_nn, &outPixelPtr);
 
-        // Update the sample location
-        for(int d = 0; d < InputImageDimension; d++)
-          cixSample[d] += cixStep[d];
+          // Update the sample location
+          for(int d = 0; d < InputImageDimension; d++)
+            cixSample[d] += cixStep[d];
+          i++;
+          }
         }
 
       // Process the rest
@@ -267,14 +490,14 @@ NonOrthogonalSlicerPixelAccessTraitsWorker<TInputImage, TOutputImage>
   : m_Interpolator(image)
 {
   m_NumComponents = m_Interpolator.GetPointerIncrement();
-  m_Buffer = new double[m_NumComponents];
+  m_Buffer = new double[m_NumComponents * Interpolator::RUN_BLOCK];
 }
 
 template <class TInputImage, class TOutputImage>
 NonOrthogonalSlicerPixelAccessTraitsWorker<TInputImage, TOutputImage>
 ::~NonOrthogonalSlicerPixelAccessTraitsWorker()
 {
-  delete m_Buffer;
+  delete [] m_Buffer;
 }
 
 template <class TInputImage, class TOutputImage>
@@ -301,6 +524,25 @@ NonOrthogonalSlicerPixelAccessTraitsWorker<TInputImage, TOutputImage>
     }
 }
 
+template <class TInputImage, class TOutputImage>
+void
+NonOrthogonalSlicerPixelAccessTraitsWorker<TInputImage, TOutputImage>
+::ProcessRun(double *cix, const double *step, int n, bool use_nn, OutputComponentType **out_ptr)
+{
+  for(int i = 0; i < n; i += Interpolator::RUN_BLOCK)
+    {
+    int nb = std::min(n - i, (int) Interpolator::RUN_BLOCK);
+    if(use_nn)
+      m_Interpolator.InterpolateNearestNeighborRun(cix, step, nb, m_Buffer);
+    else
+      m_Interpolator.InterpolateRun(cix, step, nb, m_Buffer);
+
+    int n_total = nb * m_NumComponents;
+    for(int k = 0; k < n_total; k++)
+      *(*out_ptr)++ = static_cast<OutputComponentType>(m_Buffer[k]);
+    }
+}
+
 template <class TInputImage, class TOutputImage>
 void
 NonOrthogonalSlicerPixelAccessTraitsWorker<TInputImage, TOutputImage>
@@ -327,12 +569,14 @@ NonOrthogonalSlicerPixelAccessTraitsWorker<itk::VectorImageToImageAdaptor<TPixel
 {
   m_NumComponents = m_Interpolator.GetPointerIncrement();
   m_ExtractComponent = adaptor->GetPixelAccessor().GetExtractComponentIdx();
+  m_RunBuffer = new double[Interpolator::RUN_BLOCK];
 }
 
 template <typename TPixelType, unsigned int Dimension, typename TOutputImage>
 NonOrthogonalSlicerPixelAccessTraitsWorker<itk::VectorImageToImageAdaptor<TPixelType, Dimension>, TOutputImage>
 ::~NonOrthogonalSlicerPixelAccessTraitsWorker()
 {
+  delete [] m_RunBuffer;
 }
 
 template <typename TPixelType, unsigned int Dimension, typename TOutputImage>
@@ -356,6 +600,25 @@ NonOrthogonalSlicerPixelAccessTraitsWorker<itk::VectorImageToImageAdaptor<TPixel
     }
 }
 
+template <typename TPixelType, unsigned int Dimension, typename TOutputImage>
+void
+NonOrthogonalSlicerPixelAccessTraitsWorker<itk::VectorImageToImageAdaptor<TPixelType, Dimension>, TOutputImage>
+::ProcessRun(double *cix, const double *step, int n, bool use_nn, OutputComponentType **out_ptr)
+{
+  // Only the extracted component is sampled
+  for(int i = 0; i < n; i += Interpolator::RUN_BLOCK)
+    {
+    int nb = std::min(n - i, (int) Interpolator::RUN_BLOCK);
+    if(use_nn)
+      m_Interpolator.InterpolateNearestNeighborRun(cix, step, nb, m_RunBuffer);
+    else
+      m_Interpolator.InterpolateRun(cix, step, nb, m_RunBuffer);
+
+    for(int k = 0; k < nb; k++)
+      *(*out_ptr)++ = static_cast<OutputComponentType>(m_RunBuffer[k]);
+    }
+}
+
 template <typename TPixelType, unsigned int Dimension, typename TOutputImage>
 void
 NonOrthogonalSlicerPixelAccessTraitsWorker<itk::VectorImageToImageAdaptor<TPixelType, Dimension>, TOutputImage>
@@ -378,7 +641,7 @@ NonOrthogonalSlicerPixelAccessTraitsWorker<
     m_Adaptor(adaptor)
 {
   m_NumComponents = m_Interpolator.GetPointerIncrement();
-  m_Buffer = new double[m_NumComponents];
+  m_Buffer = new double[m_NumComponents * Interpolator::RUN_BLOCK];
 }
 
 template <typename TPixelType, unsigned int Dimension, typename TAccessor, typename TOutputImage>
@@ -386,7 +649,7 @@ NonOrthogonalSlicerPixelAccessTraitsWorker<
   itk::ImageAdaptor<itk::VectorImage<TPixelType, Dimension>, TAccessor>, TOutputImage>
 ::~NonOrthogonalSlicerPixelAccessTraitsWorker()
 {
-  delete m_Buffer;
+  delete [] m_Buffer;
 }
 
 template <typename TPixelType, unsigned int Dimension, typename TAccessor, typename TOutputImage>
@@ -420,6 +683,31 @@ NonOrthogonalSlicerPixelAccessTraitsWorker<
 }
 
 
+template <typename TPixelType, unsigned int Dimension, typename TAccessor, typename TOutputImage>
+void
+NonOrthogonalSlicerPixelAccessTraitsWorker<
+  itk::ImageAdaptor<itk::VectorImage<TPixelType, Dimension>, TAccessor>, TOutputImage>
+::ProcessRun(double *cix, const double *step, int n, bool use_nn, OutputComponentType **out_ptr)
+{
+  for(int i = 0; i < n; i += Interpolator::RUN_BLOCK)
+    {
+    int nb = std::min(n - i, (int) Interpolator::RUN_BLOCK);
+    if(use_nn)
+      m_Interpolator.InterpolateNearestNeighborRun(cix, step, nb, m_Buffer);
+    else
+      m_Interpolator.InterpolateRun(cix, step, nb, m_Buffer);
+
+    // The accessor is applied to each interpolated vector
+    for(int k = 0; k < nb; k++)
+      {
+      for(int j = 0; j < m_NumComponents; j++)
+        m_VectorPixel[j] = static_cast<OutputComponentType>(m_Buffer[k * m_NumComponents + j]);
+      *(*out_ptr)++ =
+          m_Adaptor->GetPixelAccessor().Get(m_VectorPixel.GetDataPointer());
+      }
+    }
+}
+
 template <typename TPixelType, unsigned int Dimension, typename TAccessor, typename TOutputImage>
 void
 NonOrthogonalSlicerPixelAccessTraitsWorker<
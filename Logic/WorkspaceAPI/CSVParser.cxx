@@ -66,3 +66,61 @@ const vector<string> &CSVParser::GetParsedStrings() const
 {
   return m_Data;
 }
+
+bool CSVParser::ParseLine(const std::string &line, std::vector<std::string> &fields, char delimiter)
+{
+  fields.clear();
+
+  // Ignore the carriage return in files with DOS line endings
+  size_t n = line.length();
+  if(n > 0 && line[n-1] == '\r')
+    n--;
+
+  string word;
+  bool in_quoted = false;
+  for(size_t k = 0; k < n; k++)
+    {
+    char c = line[k];
+    if(c == '"')
+      {
+      if(in_quoted && k+1 < n && line[k+1] == '"')
+        {
+        // Escaped quote
+        word.push_back(c);
+        ++k;
+        }
+      else
+        {
+        in_quoted = !in_quoted;
+        }
+      }
+    else if(c == delimiter && !in_quoted)
+      {
+      fields.push_back(word);
+      word.clear();
+      }
+    else
+      {
+      word.push_back(c);
+      }
+    }
+
+  fields.push_back(word);
+  return !in_quoted;
+}
+
+std::string CSVParser::QuoteField(const std::string &field, char delimiter)
+{
+  if(field.find_first_of(string(1, delimiter) + "\"\r\n") == string::npos)
+    return field;
+
+  string quoted("\"");
+  for(size_t k = 0; k < field.length(); k++)
+    {
+    if(field[k] == '"')
+      quoted.push_back('"');
+    quoted.push_back(field[k]);
+    }
+  quoted.push_back('"');
+  return quoted;
+}
@@ -17,6 +17,17 @@ public:
 
   const std::vector<std::string> &GetParsedStrings()  const;
 
+  /**
+   * Parse a single line of delimited text with quote escapes into fields.
+   * Returns false if the line ends inside of a quoted field. In that case
+   * the caller should append a newline and the next line, and parse again.
+   */
+  static bool ParseLine(const std::string &line, std::vector<std::string> &fields,
+                        char delimiter = ',');
+
+  /** Quote a field for writing if it contains the delimiter, quotes or newlines */
+  static std::string QuoteField(const std::string &field, char delimiter = ',');
+
 protected:
 
   int m_Columns;
@@ -0,0 +1,188 @@
+#include "ImageAnnotationData.h"
+#include "Registry.h"
+#include "IRISException.h"
+#include "LogicTestCommon.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+#include <clocale>
+#include <string>
+
+typedef ImageAnnotationData::AnnotationList AnnotationList;
+typedef ImageAnnotationData::AnnotationConstIterator AnnotationConstIterator;
+
+double randomCoord()
+{
+  return (rand() % 100000) / 100.0 - 200.0;
+}
+
+// Create a random set of landmarks and line segments
+ImageAnnotationData::Pointer makeAnnotations(unsigned int n)
+{
+  ImageAnnotationData::Pointer data = ImageAnnotationData::New();
+  const char *texts[] = { "simple", "with, comma", "with \"quotes\"", "two\nlines", "tab\there", "" };
+  for(unsigned int i = 0; i < n; i++)
+    {
+    int plane = rand() % 3;
+    ImageAnnotationData::AnnotationPtr ann;
+    if(rand() % 2)
+      {
+      SmartPtr<annot::LandmarkAnnotation> lma = annot::LandmarkAnnotation::New();
+      annot::Landmark lm;
+      lm.Pos = Vector3d(randomCoord(), randomCoord(), randomCoord());
+      lm.Offset = Vector2d(randomCoord(), randomCoord());
+      lm.Text = texts[rand() % 6];
+      lma->SetLandmark(lm);
+      ann = lma.GetPointer();
+      }
+    else
+      {
+      SmartPtr<annot::LineSegmentAnnotation> lsa = annot::LineSegmentAnnotation::New();
+      annot::LineSegment seg;
+      seg.first = Vector3d(randomCoord(), randomCoord(), randomCoord());
+      seg.second = Vector3d(randomCoord(), randomCoord(), randomCoord());
+      seg.second[plane] = seg.first[plane];
+      lsa->SetSegment(seg);
+      ann = lsa.GetPointer();
+      }
+
+    ann->SetPlane(plane);
+    ann->SetColor(Vector3d((rand() % 256) / 255.0, (rand() % 256) / 255.0, 0.5));
+    ann->SetVisibleInAllPlanes(rand() % 2 != 0);
+    ann->SetVisibleInAllSlices(rand() % 2 != 0);
+    ann->SetSelected(rand() % 2 != 0);
+
+    TagList tags;
+    if(rand() % 2)
+      tags.AddTag("Tag A");
+    if(rand() % 2)
+      tags.AddTag("semi;colon");
+    ann->SetTags(tags);
+
+    data->AddAnnotation(ann);
+    }
+  return data;
+}
+
+bool close(const Vector3d &a, const Vector3d &b, double tol)
+{
+  return fabs(a[0] - b[0]) <= tol && fabs(a[1] - b[1]) <= tol && fabs(a[2] - b[2]) <= tol;
+}
+
+// Compare two annotation lists. The tolerance allows for the limited precision
+// with which the registry format stores numbers
+bool compareAnnotations(ImageAnnotationData *a, ImageAnnotationData *b, double tol)
+{
+  const AnnotationList &la = a->GetAnnotations(), &lb = b->GetAnnotations();
+  if(la.size() != lb.size())
+    return false;
+
+  for(AnnotationConstIterator ia = la.begin(), ib = lb.begin(); ia != la.end(); ++ia, ++ib)
+    {
+    annot::AbstractAnnotation *x = *ia, *y = *ib;
+    if(x->GetType() != y->GetType() || x->GetPlane() != y->GetPlane()
+       || x->GetSelected() != y->GetSelected()
+       || x->GetVisibleInAllPlanes() != y->GetVisibleInAllPlanes()
+       || x->GetVisibleInAllSlices() != y->GetVisibleInAllSlices()
+       || x->GetTags() != y->GetTags()
+       || !close(x->GetColor(), y->GetColor(), tol))
+      return false;
+
+    if(x->GetType() == annot::LANDMARK)
+      {
+      const annot::Landmark &p = static_cast<annot::LandmarkAnnotation *>(x)->GetLandmark();
+      const annot::Landmark &q = static_cast<annot::LandmarkAnnotation *>(y)->GetLandmark();
+      if(p.Text != q.Text || !close(p.Pos, q.Pos, tol)
+         || fabs(p.Offset[0] - q.Offset[0]) > tol || fabs(p.Offset[1] - q.Offset[1]) > tol)
+        return false;
+      }
+    else
+      {
+      const annot::LineSegment &p = static_cast<annot::LineSegmentAnnotation *>(x)->GetSegment();
+      const annot::LineSegment &q = static_cast<annot::LineSegmentAnnotation *>(y)->GetSegment();
+      if(!close(p.first, q.first, tol) || !close(p.second, q.second, tol))
+        return false;
+      }
+    }
+
+  return true;
+}
+
+int main(int, char *[])
+{
+  srand(12345);
+  ImageAnnotationData::Pointer source = makeAnnotations(5000);
+
+  // Round trip through the registry format
+  Registry reg;
+  source->SaveAnnotations(reg);
+  ImageAnnotationData::Pointer from_reg = ImageAnnotationData::New();
+  from_reg->LoadAnnotations(reg);
+  TEST_CHECK(compareAnnotations(source, from_reg, 1e-3), "registry round trip failed");
+
+  // Round trip through CSV and TSV must be exact
+  char delimiters[] = { ',', '\t' };
+  for(int k = 0; k < 2; k++)
+    {
+    std::stringstream ss;
+    source->SaveAnnotationsAsTable(ss, delimiters[k]);
+    ImageAnnotationData::Pointer from_table = ImageAnnotationData::New();
+    from_table->LoadAnnotationsFromTable(ss);
+    TEST_CHECK(compareAnnotations(source, from_table, 0.0), "table round trip failed");
+    }
+
+  // Import of a landmark list with only some of the columns, in another order
+  std::stringstream partial;
+  partial << "# exported from another program\r\n"
+          << "Z,Y,X,Text\r\n"
+          << "3,2,1,first\r\n"
+          << "6.5,5.5,4.5,\"second, with comma\"\r\n";
+  ImageAnnotationData::Pointer imported = ImageAnnotationData::New();
+  imported->LoadAnnotationsFromTable(partial);
+  TEST_CHECK(imported->GetAnnotations().size() == 2, "partial import count");
+  annot::LandmarkAnnotation *lm2 =
+      dynamic_cast<annot::LandmarkAnnotation *>(imported->GetAnnotations().back().GetPointer());
+  TEST_CHECK(lm2 && lm2->GetLandmark().Text == "second, with comma", "partial import text");
+  TEST_CHECK(close(lm2->GetLandmark().Pos, Vector3d(4.5, 5.5, 6.5), 0.0), "partial import position");
+
+  // Numbers are read with a period as the decimal separator, even when the
+  // locale uses a comma. The test is skipped if no such locale is installed
+  const char *commaLocales[] = { "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR" };
+  std::string oldLocale = setlocale(LC_NUMERIC, NULL);
+  for(int i = 0; i < 5; i++)
+    {
+    if(setlocale(LC_NUMERIC, commaLocales[i]) && localeconv()->decimal_point[0] == ',')
+      {
+      partial.clear();
+      partial.seekg(0);
+      ImageAnnotationData::Pointer localized = ImageAnnotationData::New();
+      localized->LoadAnnotationsFromTable(partial);
+      setlocale(LC_NUMERIC, oldLocale.c_str());
+      annot::LandmarkAnnotation *lm3 =
+          dynamic_cast<annot::LandmarkAnnotation *>(localized->GetAnnotations().back().GetPointer());
+      TEST_CHECK(lm3 && close(lm3->GetLandmark().Pos, Vector3d(4.5, 5.5, 6.5), 0.0),
+                 "import depends on the locale");
+      break;
+      }
+    }
+  setlocale(LC_NUMERIC, oldLocale.c_str());
+
+  // Appending keeps the existing annotations
+  std::stringstream more;
+  more << "X\tY\tZ\n7\t8\t9\n";
+  imported->LoadAnnotationsFromTable(more, true);
+  TEST_CHECK(imported->GetAnnotations().size() == 3, "append failed");
+
+  // A line segment that does not lie in its plane is rejected, and the
+  // current annotations are left alone
+  std::stringstream bad;
+  bad << "Type,Plane,X,Y,Z,X2,Y2,Z2\nLineSegment,2,0,0,1,5,5,2\n";
+  bool thrown = false;
+  try { imported->LoadAnnotationsFromTable(bad); }
+  catch(IRISException &) { thrown = true; }
+  TEST_CHECK(thrown, "invalid line segment accepted");
+  TEST_CHECK(imported->GetAnnotations().size() == 3, "failed import modified annotations");
+
+  return EXIT_SUCCESS;
+}
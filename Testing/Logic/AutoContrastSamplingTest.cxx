@@ -0,0 +1,99 @@
+#include "ImageWrapperTraits.h"
+#include "ScalarImageWrapper.h"
+#include "DisplayMappingPolicy.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+typedef AnatomicScalarImageWrapper::ImageType ImageType;
+typedef itk::ImageRegion<3> RegionType;
+
+// The 0.1% and 99.9% quantiles of all the native intensities in a region
+Vector2d exactQuantiles(AnatomicScalarImageWrapper *wrapper, const RegionType &region)
+{
+  std::vector<double> v;
+  itk::ImageRegionIteratorWithIndex<ImageType> it(wrapper->GetImage(), region);
+  for(; !it.IsAtEnd(); ++it)
+    v.push_back(wrapper->GetVoxelMappedToNative(it.GetIndex()));
+
+  size_t klow = (size_t) floor(0.001 * (v.size() - 1));
+  size_t khigh = (size_t) ceil(0.999 * (v.size() - 1));
+  std::sort(v.begin(), v.end());
+  return Vector2d(v[klow], v[khigh]);
+}
+
+int main(int, char *[])
+{
+  // An image that is mostly air, with a box of anatomy in the middle and a
+  // few very bright voxels in the box
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(makeRegion(0, 0, 0, 64, 64, 48));
+  image->Allocate();
+  image->FillBuffer(-2000);
+
+  RegionType box = makeRegion(16, 16, 8, 32, 32, 32);
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, box);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    ImageType::IndexType idx = it.GetIndex();
+    it.Set((short) (2 * ((idx[0] * 37 + idx[1] * 11 + idx[2] * 5) % 1000)));
+    }
+  for(int i = 0; i < 3; i++)
+    {
+    ImageType::IndexType idx = {{ 20 + 4 * i, 30, 12 + 2 * i }};
+    image->SetPixel(idx, 30000);
+    }
+
+  AnatomicScalarImageWrapper::Pointer wrapper = AnatomicScalarImageWrapper::New();
+  wrapper->SetImage(image);
+  wrapper->SetNativeMapping(LinearInternalToNativeIntensityMapping(0.5, 100.0));
+
+  // The subsample is a regular grid with the same stride along all axes
+  std::vector<double> samples;
+  wrapper->SampleNativeIntensities(box, 5000, samples);
+  TEST_CHECK(samples.size() == 16 * 16 * 16, "wrong number of samples: " << samples.size());
+  TEST_CHECK(*std::min_element(samples.begin(), samples.end()) >= 100.0,
+             "sampled outside of the region");
+  TEST_CHECK(*std::max_element(samples.begin(), samples.end()) == 15100.0,
+             "native mapping not applied");
+
+  // Regions are cropped to the image
+  samples.clear();
+  wrapper->SampleNativeIntensities(makeRegion(60, 60, 40, 100, 100, 100), 1000000, samples);
+  TEST_CHECK(samples.size() == 4 * 4 * 8, "region not cropped");
+  samples.clear();
+  wrapper->SampleNativeIntensities(makeRegion(100, 0, 0, 10, 10, 10), 1000, samples);
+  TEST_CHECK(samples.empty(), "sampled outside of the image");
+
+  AbstractContinuousImageDisplayMappingPolicy *policy =
+      dynamic_cast<AbstractContinuousImageDisplayMappingPolicy *>(wrapper->GetDisplayMapping());
+  TEST_CHECK(policy, "no continuous display mapping");
+
+  // The whole-image fit is dominated by the air
+  policy->AutoFitContrast();
+  Vector2d wholeFit = policy->GetCurveMinMaxNative();
+  TEST_CHECK(wholeFit[0] < -500.0, "whole image window does not include the air");
+
+  // The fit to the box ignores the air and the bright voxels
+  Vector2d exact = exactQuantiles(wrapper, box);
+  TEST_CHECK(policy->AutoFitContrastInRegion(box, 5000), "fit to region failed");
+  Vector2d boxFit = policy->GetCurveMinMaxNative();
+  TEST_CHECK(fabs(boxFit[0] - exact[0]) < 20.0 && fabs(boxFit[1] - exact[1]) < 20.0,
+             "region window is far from the quantiles");
+  TEST_CHECK(boxFit[1] < 2000.0, "region window includes the bright voxels");
+
+  // Regions with no voxels or a single intensity leave the contrast unchanged
+  TEST_CHECK(!policy->AutoFitContrastInRegion(makeRegion(100, 0, 0, 10, 10, 10)),
+             "fit to a region outside of the image");
+  TEST_CHECK(!policy->AutoFitContrastInRegion(makeRegion(0, 0, 0, 10, 10, 10)),
+             "fit to a constant region");
+  Vector2d unchanged = policy->GetCurveMinMaxNative();
+  TEST_CHECK(unchanged == boxFit, "failed fit changed the contrast");
+
+  return EXIT_SUCCESS;
+}
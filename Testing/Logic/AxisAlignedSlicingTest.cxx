@@ -0,0 +1,200 @@
+#include "AxisAlignedSlicer.h"
+#include "NonOrthogonalSlicer.h"
+#include "AdaptiveSlicingPipeline.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkVectorImage.h>
+#include <itkAffineTransform.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+typedef itk::Image<float, 3> FloatImage;
+typedef itk::Image<float, 2> FloatSlice;
+typedef itk::VectorImage<unsigned char, 3> VectorImage;
+typedef itk::VectorImage<unsigned char, 2> VectorSlice;
+typedef itk::AffineTransform<double, 3> TransformType;
+
+// An overlay with a coarser, anisotropic voxel size
+template <class TImage>
+typename TImage::Pointer makeImage(unsigned int nc)
+{
+  typename TImage::Pointer image = makeRandomImage<TImage>(nc);
+  double spacing[] = { 2.0, 2.0, 3.0 };
+  image->SetSpacing(spacing);
+  return image;
+}
+
+// A display slice with a finer voxel size, whose rows run along the image z
+// axis (backwards) and whose columns run along x, like a coronal view. It
+// extends past the edges of the image
+FloatImage::Pointer makeReference(double y)
+{
+  FloatImage::Pointer reference = FloatImage::New();
+  FloatImage::RegionType region;
+  region.SetSize(0, 90); region.SetSize(1, 70); region.SetSize(2, 1);
+  reference->SetRegions(region);
+
+  double spacing[] = { 0.8, 0.8, 1.0 };
+  reference->SetSpacing(spacing);
+
+  FloatImage::DirectionType dir;
+  dir.Fill(0.0);
+  dir(2,0) = -1.0; dir(0,1) = 1.0; dir(1,2) = 1.0;
+  reference->SetDirection(dir);
+
+  FloatImage::PointType origin;
+  origin[0] = -4.0; origin[1] = y; origin[2] = 125.0;
+  reference->SetOrigin(origin);
+  return reference;
+}
+
+// Slice with both slicers and return the largest difference. The oblique
+// slicer may sample up to one step past the edge of the image along a line,
+// so the samples within one step of the edge are not compared
+template <class TImage, class TSlice>
+double compare(TImage *image, FloatImage *reference, TransformType *tran, bool use_nn)
+{
+  typedef NonOrthogonalSlicer<TImage, TSlice> ObliqueType;
+  typedef AxisAlignedSlicer<TImage, TSlice, TImage> AlignedType;
+
+  typename ObliqueType::Pointer oblique = ObliqueType::New();
+  oblique->SetInput(image);
+  oblique->SetReferenceImage(reference);
+  oblique->SetTransform(tran);
+  oblique->SetUseNearestNeighbor(use_nn);
+
+  typename AlignedType::Pointer aligned = AlignedType::New();
+  aligned->SetInput(image);
+  aligned->SetReferenceImage(reference);
+  aligned->SetTransform(tran);
+  aligned->SetUseNearestNeighbor(use_nn);
+
+  oblique->Update();
+  aligned->Update();
+
+  TSlice *s1 = oblique->GetOutput(), *s2 = aligned->GetOutput();
+  if(s1->GetBufferedRegion() != s2->GetBufferedRegion()
+     || s1->GetNumberOfComponentsPerPixel() != s2->GetNumberOfComponentsPerPixel())
+    return 1.0e100;
+
+  typename AlignedType::Mapping m;
+  AlignedType::ComputeMapping(image, reference, tran, m);
+  double size[2], step[2];
+  for(int a = 0; a < 2; a++)
+    {
+    size[a] = image->GetBufferedRegion().GetSize(m.Axis[a]);
+    step[a] = fabs(m.Scale[a]);
+    }
+
+  int nx = s1->GetBufferedRegion().GetSize(0), ny = s1->GetBufferedRegion().GetSize(1);
+  int nc = s1->GetNumberOfComponentsPerPixel();
+  double maxdiff = 0.0;
+  int n_compared = 0;
+  for(int j = 0; j < ny; j++)
+    {
+    double y = m.Offset[1] + m.Scale[1] * j;
+    if(y < step[1] - 0.5 || y >= size[1] - 0.5 - step[1])
+      continue;
+    for(int i = 0; i < nx; i++)
+      {
+      double x = m.Offset[0] + m.Scale[0] * i;
+      if(x < step[0] - 0.5 || x >= size[0] - 0.5 - step[0])
+        continue;
+      n_compared++;
+      for(int c = 0; c < nc; c++)
+        {
+        size_t q = (j * nx + i) * nc + c;
+        maxdiff = std::max(maxdiff, fabs((double) s1->GetBufferPointer()[q] - s2->GetBufferPointer()[q]));
+        }
+      }
+    }
+
+  // The slice must cover enough of the image for the test to mean anything
+  return n_compared > nx * ny / 4 ? maxdiff : 1.0e100;
+}
+
+int main(int, char *[])
+{
+  srand(12345);
+  FloatImage::Pointer fimg = makeImage<FloatImage>(1);
+  VectorImage::Pointer vimg = makeImage<VectorImage>(3);
+  TransformType::Pointer identity = TransformType::New();
+
+  // A display slice between two native slices, and one on a native slice
+  double ypos[] = { 37.3, 38.0 };
+  for(int k = 0; k < 2; k++)
+    {
+    FloatImage::Pointer reference = makeReference(ypos[k]);
+
+    typedef AxisAlignedSlicer<FloatImage, FloatSlice, FloatImage> AlignedType;
+    AlignedType::Mapping m;
+    TEST_CHECK(AlignedType::ComputeMapping(fimg, reference, identity, m), "slice not aligned");
+    TEST_CHECK(m.Axis[0] == 2 && m.Axis[1] == 0 && m.Axis[2] == 1, "wrong axes");
+    TEST_CHECK(fabs(m.Scale[0] + 0.8 / 3.0) < 1e-9 && fabs(m.Scale[1] - 0.4) < 1e-9, "wrong scale");
+
+    double d = compare<FloatImage, FloatSlice>(fimg, reference, identity, false);
+    TEST_CHECK(d < 1e-3, "linear slices differ at y = " << ypos[k]);
+
+    d = compare<FloatImage, FloatSlice>(fimg, reference, identity, true);
+    TEST_CHECK(d == 0.0, "nearest neighbor slices differ at y = " << ypos[k]);
+
+    // Vector images; the components are truncated after interpolation
+    d = compare<VectorImage, VectorSlice>(vimg, reference, identity, false);
+    TEST_CHECK(d <= 1.0, "vector slices differ at y = " << ypos[k]);
+    d = compare<VectorImage, VectorSlice>(vimg, reference, identity, true);
+    TEST_CHECK(d == 0.0, "vector nearest neighbor slices differ at y = " << ypos[k]);
+    }
+
+  // A translation keeps the slice aligned
+  FloatImage::Pointer reference = makeReference(37.3);
+  TransformType::Pointer shift = TransformType::New();
+  TransformType::OutputVectorType offset;
+  offset[0] = 3.3; offset[1] = -1.7; offset[2] = 5.1;
+  shift->Translate(offset);
+  double d = compare<FloatImage, FloatSlice>(fimg, reference, shift, false);
+  TEST_CHECK(d < 1e-3, "translated slices differ");
+
+  // A rotation does not
+  typedef AxisAlignedSlicer<FloatImage, FloatSlice, FloatImage> AlignedType;
+  TransformType::Pointer rot = TransformType::New();
+  TransformType::OutputVectorType axis;
+  axis[0] = 0.1; axis[1] = 0.9; axis[2] = 0.2;
+  rot->Rotate3D(axis, 0.05);
+  TEST_CHECK(!AlignedType::CanSlice(fimg, reference, rot, false), "rotated slice accepted");
+
+  // The pipeline selects the slicer by itself
+  typedef AdaptiveSlicingPipeline<FloatImage, FloatSlice, FloatImage> PipelineType;
+  PipelineType::Pointer pipeline = PipelineType::New();
+  pipeline->SetInput(fimg);
+  pipeline->SetObliqueReferenceImage(reference);
+  pipeline->SetObliqueTransform(shift);
+  pipeline->SetUseOrthogonalSlicing(false);
+  pipeline->Update();
+  TEST_CHECK(pipeline->GetAxisAlignedSlicingActive(), "aligned slicer not selected");
+  std::vector<float> fast(pipeline->GetOutput()->GetBufferPointer(),
+                          pipeline->GetOutput()->GetBufferPointer() + 90 * 70);
+
+  pipeline->SetObliqueTransform(rot);
+  pipeline->Update();
+  TEST_CHECK(!pipeline->GetAxisAlignedSlicingActive(), "aligned slicer selected for rotation");
+
+  pipeline->SetObliqueTransform(shift);
+  pipeline->SetUseAxisAlignedSlicing(false);
+  pipeline->Update();
+  TEST_CHECK(!pipeline->GetAxisAlignedSlicingActive(), "aligned slicer not disabled");
+
+  TEST_CHECK(pipeline->GetOutput()->GetBufferedRegion().GetNumberOfPixels() == 90 * 70,
+             "wrong slice size");
+  int n_diff = 0;
+  for(size_t i = 0; i < fast.size(); i++)
+    if(fabs(fast[i] - pipeline->GetOutput()->GetBufferPointer()[i]) > 1e-3)
+      n_diff++;
+
+  // Only the samples at the edge of the image may differ
+  TEST_CHECK(n_diff <= 2 * 70, "pipeline slices differ");
+
+  return EXIT_SUCCESS;
+}
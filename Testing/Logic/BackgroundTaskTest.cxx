@@ -0,0 +1,151 @@
+#include "BackgroundTask.h"
+#include "IRISException.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkMeanImageFilter.h>
+#include <itkCommand.h>
+#include <iostream>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+
+// A task that counts to a number, checking for cancellation
+class CountingTask : public BackgroundTask
+{
+public:
+  irisITKObjectMacro(CountingTask, BackgroundTask)
+  irisGetSetMacro(Steps, int)
+  irisGetSetMacro(Fail, bool)
+
+protected:
+  CountingTask() : m_Steps(100), m_Fail(false) {}
+
+  virtual void Run() ITK_OVERRIDE
+  {
+    for(int i = 0; i < m_Steps; i++)
+      {
+      this->ThrowIfCancelRequested();
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+      this->SetProgress((i + 1.0) / m_Steps);
+      if(m_Fail && i == m_Steps / 2)
+        throw IRISException("Failed on purpose");
+      }
+  }
+
+  int m_Steps;
+  bool m_Fail;
+};
+
+// A task that runs an ITK filter on a large image
+class FilterTask : public BackgroundTask
+{
+public:
+  irisITKObjectMacro(FilterTask, BackgroundTask)
+
+protected:
+  virtual void Run() ITK_OVERRIDE
+  {
+    typedef itk::Image<float, 3> ImageType;
+    ImageType::Pointer image = ImageType::New();
+    ImageType::RegionType region;
+    region.SetSize(0, 200); region.SetSize(1, 200); region.SetSize(2, 200);
+    image->SetRegions(region);
+    image->Allocate();
+    image->FillBuffer(1.0f);
+
+    typedef itk::MeanImageFilter<ImageType, ImageType> FilterType;
+    FilterType::Pointer filter = FilterType::New();
+    FilterType::InputSizeType radius;
+    radius.Fill(4);
+    filter->SetInput(image);
+    filter->SetRadius(radius);
+    filter->SetNumberOfThreads(1);
+    filter->AddObserver(itk::ProgressEvent(), this->CreateProgressCommand());
+    filter->Update();
+  }
+};
+
+// Counts events fired by a task on the calling thread
+class EventCounter : public itk::Object
+{
+public:
+  irisITKObjectMacro(EventCounter, itk::Object)
+
+  void OnProgress() { m_Progress++; }
+  void OnFinished() { m_Finished++; }
+
+  int m_Progress, m_Finished;
+
+protected:
+  EventCounter() : m_Progress(0), m_Finished(0) {}
+};
+
+void listen(BackgroundTask *task, const itk::EventObject &event,
+            EventCounter *ec, void (EventCounter::*fn)())
+{
+  typedef itk::SimpleMemberCommand<EventCounter> Cmd;
+  Cmd::Pointer cmd = Cmd::New();
+  cmd->SetCallbackFunction(ec, fn);
+  task->AddObserver(event, cmd);
+}
+
+// Pump the events like the GUI would, until all tasks are done
+void pump(BackgroundTaskManager *tm)
+{
+  while(tm->ProcessTaskEvents())
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+int main(int, char *[])
+{
+  BackgroundTaskManager::Pointer tm = BackgroundTaskManager::New();
+  tm->SetProgressInterval(50.0);
+
+  // A task that runs to completion, with rate-limited progress events
+  CountingTask::Pointer t1 = CountingTask::New();
+  EventCounter::Pointer ec = EventCounter::New();
+  listen(t1, BackgroundTask::TaskProgressEvent(), ec, &EventCounter::OnProgress);
+  listen(t1, BackgroundTask::TaskFinishedEvent(), ec, &EventCounter::OnFinished);
+  tm->Submit(t1);
+  pump(tm);
+
+  TEST_CHECK(t1->GetState() == BackgroundTask::TASK_COMPLETED, "task did not complete");
+  TEST_CHECK(t1->GetProgress() == 1.0, "progress not complete");
+  TEST_CHECK(ec->m_Finished == 1, "finished event not fired once");
+  TEST_CHECK(ec->m_Progress > 0 && ec->m_Progress < 100, "progress events not rate-limited");
+
+  // A task that fails
+  CountingTask::Pointer t2 = CountingTask::New();
+  t2->SetFail(true);
+  tm->Submit(t2);
+  pump(tm);
+  TEST_CHECK(t2->GetState() == BackgroundTask::TASK_FAILED, "task did not fail");
+  TEST_CHECK(t2->GetErrorMessage() == "Failed on purpose", "wrong error message");
+
+  // Cancel a task while it runs, and one that waits for the single worker
+  BackgroundTaskManager::Pointer tm1 = BackgroundTaskManager::New();
+  tm1->SetNumberOfThreads(1);
+  CountingTask::Pointer t3 = CountingTask::New();
+  t3->SetSteps(100000);
+  CountingTask::Pointer t4 = CountingTask::New();
+  tm1->Submit(t3);
+  tm1->Submit(t4);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  tm1->CancelAllTasks();
+  pump(tm1);
+  TEST_CHECK(t3->GetState() == BackgroundTask::TASK_CANCELED, "running task not canceled");
+  TEST_CHECK(t4->GetState() == BackgroundTask::TASK_CANCELED, "queued task not canceled");
+  TEST_CHECK(t4->GetProgress() == 0.0, "queued task was run");
+
+  // Cancel an ITK filter through the progress command
+  FilterTask::Pointer t5 = FilterTask::New();
+  tm->Submit(t5);
+  while(t5->GetProgress() == 0.0 && !t5->IsFinished())
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  t5->RequestCancel();
+  t5->WaitUntilFinished();
+  pump(tm);
+  TEST_CHECK(t5->GetState() == BackgroundTask::TASK_CANCELED, "filter not aborted");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+#include "AffineTransformHelper.h"
+#include "Registry.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkMatrixOffsetTransformBase.h>
+#include <itkImageFileWriter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+typedef AffineTransformHelper::DisplacementField FieldImage;
+typedef AffineTransformHelper::ITKTransformBase TransformBase;
+typedef AffineTransformHelper::ITKTransformMOTB AffineTransform;
+typedef TransformBase::InputPointType PointType;
+
+// The largest distance between where two transforms map a set of points
+double maxDifference(const TransformBase *t1, const TransformBase *t2,
+                     const std::vector<PointType> &points)
+{
+  double diff = 0.0;
+  for(size_t i = 0; i < points.size(); i++)
+    diff = std::max(diff, t1->TransformPoint(points[i]).EuclideanDistanceTo(
+                      t2->TransformPoint(points[i])));
+  return diff;
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc < 2)
+    {
+    std::cerr << "Usage: DeformableTransformIOTest temp_dir" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A smooth displacement field
+  FieldImage::Pointer field = FieldImage::New();
+  field->SetRegions(makeRegion(0, 0, 0, 20, 16, 12));
+  FieldImage::SpacingType spacing;
+  spacing[0] = 1.0; spacing[1] = 1.5; spacing[2] = 2.0;
+  field->SetSpacing(spacing);
+  field->Allocate();
+  itk::ImageRegionIteratorWithIndex<FieldImage> it(field, field->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    FieldImage::IndexType idx = it.GetIndex();
+    FieldImage::PixelType u;
+    u[0] = 2.0 * sin(idx[1] * 0.3);
+    u[1] = -1.5 * cos(idx[2] * 0.4);
+    u[2] = 0.1 * idx[0];
+    it.Set(u);
+    }
+
+  std::string warp_file = std::string(argv[1]) + "/DeformableTransformIOTest_warp.nii.gz";
+  typedef itk::ImageFileWriter<FieldImage> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(field);
+  writer->SetFileName(warp_file.c_str());
+  writer->Update();
+
+  // An affine transform
+  AffineTransform::Pointer affine = AffineTransform::New();
+  AffineTransform::MatrixType matrix;
+  AffineTransform::OutputVectorType offset;
+  matrix.SetIdentity();
+  matrix(0,0) = 1.1; matrix(0,1) = 0.2; matrix(2,1) = -0.1; matrix(1,1) = 0.9;
+  offset[0] = 3.0; offset[1] = -2.0; offset[2] = 1.5;
+  affine->SetMatrix(matrix);
+  affine->SetOffset(offset);
+
+  // Points at the nodes of the field, where there is no interpolation error
+  std::vector<PointType> points;
+  for(int z = 1; z < 11; z += 3)
+    for(int y = 1; y < 15; y += 4)
+      for(int x = 1; x < 19; x += 5)
+        {
+        FieldImage::IndexType idx = {{ x, y, z }};
+        PointType p;
+        field->TransformIndexToPhysicalPoint(idx, p);
+        points.push_back(p);
+        }
+
+  // The transform read from the file displaces points and then applies the affine
+  SmartPtr<TransformBase> tread =
+      AffineTransformHelper::ReadDeformableTransform(warp_file.c_str(), affine);
+  SmartPtr<TransformBase> tmem =
+      AffineTransformHelper::CreateDeformableTransform(field, affine);
+  TEST_CHECK(!AffineTransformHelper::IsLinear(tread), "warp read as a linear transform");
+  TEST_CHECK(maxDifference(tread, tmem, points) < 1e-4,
+             "warp read from file differs from the one created in memory");
+
+  for(size_t i = 0; i < points.size(); i++)
+    {
+    FieldImage::IndexType idx;
+    field->TransformPhysicalPointToIndex(points[i], idx);
+    PointType expected = affine->TransformPoint(points[i] + field->GetPixel(idx));
+    TEST_CHECK(tread->TransformPoint(points[i]).EuclideanDistanceTo(expected) < 1e-4,
+               "point " << points[i] << " not displaced before the affine transform");
+    }
+
+  // The affine part of the deformable transform is reported as its matrix
+  AffineTransformHelper::ITKMatrix m;
+  AffineTransformHelper::ITKVector v;
+  AffineTransformHelper::GetMatrixAndOffset(tread, m, v);
+  TEST_CHECK(m == matrix && v == offset, "wrong affine part of the deformable transform");
+
+  // Replacing the affine part keeps the field
+  SmartPtr<TransformBase> tid = AffineTransformHelper::ReplaceAffinePart(
+                                  tread, AffineTransform::New().GetPointer());
+  TEST_CHECK(AffineTransformHelper::GetDisplacementField(tid)
+             == AffineTransformHelper::GetDisplacementField(tread),
+             "field lost when replacing the affine part");
+
+  // The workspace refers to the warp file, and reading it back gives the
+  // same transform
+  Registry reg;
+  AffineTransformHelper::WriteToRegistry(&reg, tread);
+  TEST_CHECK(!reg.Folder("ImageTransform")["IsIdentity"][true],
+             "deformable transform saved as the identity");
+  std::string saved_file = reg.Folder("ImageTransform")["WarpFile"][""];
+  TEST_CHECK(saved_file.length(), "warp file not saved to the registry");
+
+  SmartPtr<TransformBase> treg = AffineTransformHelper::ReadFromRegistry(&reg);
+  TEST_CHECK(maxDifference(tread, treg, points) < 1e-4,
+             "deformable transform changed by saving to the registry");
+
+  // A warp with no affine part is not the identity either
+  Registry reg_warp;
+  AffineTransformHelper::WriteToRegistry(&reg_warp, tid);
+  SmartPtr<TransformBase> twarp = AffineTransformHelper::ReadFromRegistry(&reg_warp);
+  TEST_CHECK(maxDifference(tid, twarp, points) < 1e-4,
+             "warp without an affine part changed by saving to the registry");
+
+  // A field that did not come from a file can only be saved by its affine part
+  Registry reg_mem;
+  reg_mem.Folder("ImageTransform")["WarpFile"] << warp_file;
+  AffineTransformHelper::WriteToRegistry(&reg_mem, tmem);
+  TEST_CHECK(!reg_mem.Folder("ImageTransform").HasEntry("WarpFile"),
+             "in-memory field saved with a stale warp file");
+  SmartPtr<TransformBase> tmemreg = AffineTransformHelper::ReadFromRegistry(&reg_mem);
+  TEST_CHECK(maxDifference(affine.GetPointer(), tmemreg, points) < 1e-6,
+             "affine part of an in-memory deformable transform not saved");
+
+  return EXIT_SUCCESS;
+}
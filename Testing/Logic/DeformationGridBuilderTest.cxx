@@ -0,0 +1,161 @@
+#include "DeformationGridBuilder.h"
+#include "LogicTestCommon.h"
+#include <itkVectorImage.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+typedef itk::VectorImage<short, 2> SliceType;
+typedef DeformationGridBuilder<SliceType> BuilderType;
+
+// A warp field slice with a non-zero start index
+SliceType::Pointer makeSlice()
+{
+  SliceType::Pointer slice = SliceType::New();
+  SliceType::RegionType region;
+  region.SetIndex(0, 3); region.SetIndex(1, -2);
+  region.SetSize(0, 45); region.SetSize(1, 31);
+  slice->SetRegions(region);
+  slice->SetNumberOfComponentsPerPixel(3);
+  slice->Allocate();
+
+  short *p = slice->GetBufferPointer();
+  for(size_t i = 0; i < region.GetNumberOfPixels() * 3; i++)
+    p[i] = (short) ((i * 37) % 101 - 50);
+  return slice;
+}
+
+// The vertex at a slice index, computed directly from the mapping
+void vertexAt(SliceType *slice, const BuilderType::Mapping &m, int i, int j, double x[2])
+{
+  SliceType::IndexType idx = {{ i, j }};
+  SliceType::PixelType pix = slice->GetPixel(idx);
+  Vector3d v = m.Origin + m.DIndex[0] * (double) i + m.DIndex[1] * (double) j;
+  for(int a = 0; a < 3; a++)
+    v += m.DPhi[a] * (double) pix[a];
+  x[0] = v[0]; x[1] = v[1];
+}
+
+// Check the geometry against the slice, and return the number of vertices
+int checkGeometry(BuilderType *grid, SliceType *slice, const BuilderType::Mapping &m,
+                  const Vector2i &lineSpacing, const Vector2i &vertexSpacing)
+{
+  const std::vector<float> &vtx = grid->GetVertices();
+  const std::vector<unsigned int> &starts = grid->GetLineStarts();
+  SliceType::RegionType region = slice->GetBufferedRegion();
+
+  unsigned int line = 0;
+  for(int d = 0; d < 2; d++)
+    {
+    int e = 1 - d;
+    int i0 = region.GetIndex(d), i1 = i0 + region.GetSize(d) - 1;
+    for(int j = region.GetIndex(e); j < region.GetIndex(e) + (int) region.GetSize(e); j++)
+      {
+      if(((j % lineSpacing[d]) + lineSpacing[d]) % lineSpacing[d] != 0)
+        continue;
+
+      // Expected vertices: every few voxels and the last voxel
+      std::vector<int> expected;
+      for(int i = i0; i < i1; i += vertexSpacing[d])
+        expected.push_back(i);
+      expected.push_back(i1);
+
+      if(line >= grid->GetNumberOfLines()
+         || starts[line + 1] - starts[line] != expected.size())
+        return -1;
+
+      for(size_t k = 0; k < expected.size(); k++)
+        {
+        double x[2];
+        int idx[2];
+        idx[d] = expected[k]; idx[e] = j;
+        vertexAt(slice, m, idx[0], idx[1], x);
+        const float *v = &vtx[2 * (starts[line] + k)];
+        if(fabs(v[0] - x[0]) > 1e-3 || fabs(v[1] - x[1]) > 1e-3)
+          return -1;
+        }
+      line++;
+      }
+    }
+
+  return (line == grid->GetNumberOfLines()) ? (int) (vtx.size() / 2) : -1;
+}
+
+int main(int, char *[])
+{
+  SliceType::Pointer slice = makeSlice();
+
+  BuilderType::Mapping m;
+  m.Origin[0] = 10.5; m.Origin[1] = -3.25; m.Origin[2] = 0.0;
+  m.DIndex[0][0] = 1.5; m.DIndex[0][1] = 0.1; m.DIndex[0][2] = 0.0;
+  m.DIndex[1][0] = -0.2; m.DIndex[1][1] = 2.0; m.DIndex[1][2] = 0.0;
+  m.DPhi[0][0] = 0.01; m.DPhi[0][1] = 0.02; m.DPhi[0][2] = 0.0;
+  m.DPhi[1][0] = -0.03; m.DPhi[1][1] = 0.01; m.DPhi[1][2] = 0.0;
+  m.DPhi[2][0] = 0.005; m.DPhi[2][1] = -0.01; m.DPhi[2][2] = 1.0;
+
+  BuilderType::Pointer grid = BuilderType::New();
+  grid->SetSlice(slice);
+  grid->SetMapping(m);
+
+  // Every line and every voxel, as the grid used to be drawn
+  Vector2i one(1, 1);
+  grid->SetSampling(one, one);
+  grid->Update();
+  int nFull = checkGeometry(grid, slice, m, one, one);
+  TEST_CHECK(nFull == 2 * 45 * 31, "wrong full geometry");
+
+  // Sampled lines and vertices
+  Vector2i lineSpacing(4, 3), vertexSpacing(3, 5);
+  grid->SetSampling(lineSpacing, vertexSpacing);
+  grid->Update();
+  int nSampled = checkGeometry(grid, slice, m, lineSpacing, vertexSpacing);
+  TEST_CHECK(nSampled > 0, "wrong sampled geometry");
+  TEST_CHECK(nSampled < nFull / 8, "too many sampled vertices");
+  TEST_CHECK(grid->GetBuildCount() == 2, "geometry not rebuilt for new sampling");
+
+  // The geometry is cached until something changes
+  grid->Update();
+  grid->SetSampling(lineSpacing, vertexSpacing);
+  grid->SetMapping(m);
+  grid->SetSlice(slice);
+  grid->Update();
+  TEST_CHECK(grid->GetBuildCount() == 2, "geometry rebuilt without changes");
+
+  // A change in the warp rebuilds the geometry
+  SliceType::IndexType idx = {{ 3, 1 }};
+  SliceType::PixelType pix = slice->GetPixel(idx);
+  pix[0] += 100;
+  slice->SetPixel(idx, pix);
+  slice->Modified();
+  grid->Update();
+  TEST_CHECK(grid->GetBuildCount() == 3, "geometry not rebuilt for new warp");
+  TEST_CHECK(checkGeometry(grid, slice, m, lineSpacing, vertexSpacing) == nSampled,
+             "wrong geometry after warp change");
+
+  // So does a change in the mapping, e.g., after panning
+  m.Origin[0] += 7.0;
+  grid->SetMapping(m);
+  grid->Update();
+  TEST_CHECK(grid->GetBuildCount() == 4, "geometry not rebuilt for new mapping");
+  TEST_CHECK(checkGeometry(grid, slice, m, lineSpacing, vertexSpacing) == nSampled,
+             "wrong geometry after mapping change");
+
+  // And a new slice
+  SliceType::Pointer other = makeSlice();
+  grid->SetSlice(other);
+  grid->Update();
+  TEST_CHECK(grid->GetBuildCount() == 5, "geometry not rebuilt for new slice");
+
+  // No geometry for fields with fewer than three components
+  SliceType::Pointer scalar = SliceType::New();
+  scalar->SetRegions(other->GetBufferedRegion());
+  scalar->SetNumberOfComponentsPerPixel(1);
+  scalar->Allocate();
+  grid->SetSlice(scalar);
+  grid->Update();
+  TEST_CHECK(grid->GetNumberOfLines() == 0 && grid->GetVertices().empty(),
+             "geometry for a scalar slice");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+#include "FastAffineResampleImageFilter.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkVectorImage.h>
+#include <itkAffineTransform.h>
+#include <itkResampleImageFilter.h>
+#include <itkNearestNeighborInterpolateImageFunction.h>
+#include <itkLinearInterpolateImageFunction.h>
+#include <itkBSplineInterpolateImageFunction.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+typedef itk::Image<float, 3> FloatImage;
+typedef itk::Image<short, 3> LabelImage;
+typedef itk::VectorImage<float, 3> VectorImage;
+typedef itk::AffineTransform<double, 3> TransformType;
+
+// Set up an image with anisotropic voxels and an oblique direction
+template <class TImage>
+typename TImage::Pointer makeImage(unsigned int nc)
+{
+  typename TImage::Pointer image = TImage::New();
+  typename TImage::RegionType region;
+  region.SetSize(0, 48); region.SetSize(1, 40); region.SetSize(2, 24);
+  image->SetRegions(region);
+  image->SetNumberOfComponentsPerPixel(nc);
+
+  typename TImage::SpacingType spacing;
+  spacing[0] = 0.9; spacing[1] = 1.1; spacing[2] = 2.0;
+  image->SetSpacing(spacing);
+
+  typename TImage::PointType origin;
+  origin[0] = -20.0; origin[1] = 5.0; origin[2] = 12.0;
+  image->SetOrigin(origin);
+
+  typename TImage::DirectionType dir;
+  double c = cos(0.3), s = sin(0.3);
+  dir.SetIdentity();
+  dir(0,0) = c; dir(0,1) = -s; dir(1,0) = s; dir(1,1) = c;
+  image->SetDirection(dir);
+
+  image->Allocate();
+  return image;
+}
+
+// Random smooth-ish intensities
+FloatImage::Pointer makeFloatImage()
+{
+  FloatImage::Pointer image = makeImage<FloatImage>(1);
+  itk::ImageRegionIteratorWithIndex<FloatImage> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    FloatImage::IndexType idx = it.GetIndex();
+    it.Set(100.0 * sin(idx[0] * 0.3) * cos(idx[1] * 0.2) + idx[2] * 3.0 + (rand() % 100) * 0.1);
+    }
+  return image;
+}
+
+// Blocky labels
+LabelImage::Pointer makeLabelImage()
+{
+  LabelImage::Pointer image = makeImage<LabelImage>(1);
+  itk::ImageRegionIteratorWithIndex<LabelImage> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    LabelImage::IndexType idx = it.GetIndex();
+    it.Set((idx[0] / 6) * 7 + (idx[1] / 5) * 3 + idx[2] / 4);
+    }
+  return image;
+}
+
+VectorImage::Pointer makeVectorImage()
+{
+  VectorImage::Pointer image = makeImage<VectorImage>(3);
+  itk::ImageRegionIterator<VectorImage> it(image, image->GetBufferedRegion());
+  VectorImage::PixelType pix(3);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    for(int j = 0; j < 3; j++)
+      pix[j] = (rand() % 1000) * 0.1f + j * 50.0f;
+    it.Set(pix);
+    }
+  return image;
+}
+
+// A rotation, scaling and shift in physical space
+TransformType::Pointer makeTransform()
+{
+  TransformType::Pointer tran = TransformType::New();
+  TransformType::OutputVectorType axis;
+  axis[0] = 0.2; axis[1] = 0.5; axis[2] = 0.8;
+  TransformType::OutputVectorType offset;
+  offset[0] = 3.2; offset[1] = -2.7; offset[2] = 1.9;
+  TransformType::InputPointType center;
+  center[0] = 0.0; center[1] = 25.0; center[2] = 35.0;
+  tran->SetCenter(center);
+  tran->Rotate3D(axis, 0.25);
+  tran->Scale(1.07);
+  tran->Translate(offset);
+  return tran;
+}
+
+// Resample an image with the ITK filter and with the fast filter, and return
+// the fraction of voxels that differ by more than the tolerance
+template <class TImage, class TInterpolator>
+double compare(TImage *image, InterpolationMethod method, double tol)
+{
+  TransformType::Pointer tran = makeTransform();
+
+  // The output grid is coarser than the input and shifted
+  typename TImage::SizeType size;
+  size[0] = 40; size[1] = 44; size[2] = 30;
+  double spacing[] = { 1.2, 1.0, 1.5 };
+  double origin[] = { -22.0, 2.0, 10.0 };
+
+  typedef itk::ResampleImageFilter<TImage, TImage> ITKFilter;
+  typename ITKFilter::Pointer fi = ITKFilter::New();
+  fi->SetInput(image);
+  fi->SetTransform(tran);
+  fi->SetInterpolator(TInterpolator::New());
+  fi->SetSize(size);
+  fi->SetOutputSpacing(spacing);
+  fi->SetOutputOrigin(origin);
+  fi->SetOutputDirection(image->GetDirection());
+  fi->Update();
+
+  typedef FastAffineResampleImageFilter<TImage, TImage> FastFilter;
+  typename FastFilter::Pointer ff = FastFilter::New();
+  ff->SetInput(image);
+  ff->SetTransform(tran);
+  ff->SetInterpolationMethod(method);
+  ff->SetSize(size);
+  ff->SetOutputSpacing(spacing);
+  ff->SetOutputOrigin(origin);
+  ff->SetOutputDirection(image->GetDirection());
+  ff->Update();
+
+  TImage *a = fi->GetOutput(), *b = ff->GetOutput();
+  if(a->GetBufferedRegion() != b->GetBufferedRegion()
+     || a->GetNumberOfComponentsPerPixel() != b->GetNumberOfComponentsPerPixel()
+     || a->GetOrigin() != b->GetOrigin() || a->GetSpacing() != b->GetSpacing())
+    return 1.0;
+
+  // Compare the buffers component by component
+  size_t n = a->GetPixelContainer()->Size(), n_diff = 0, n_inside = 0;
+  const typename TImage::InternalPixelType *pa = a->GetBufferPointer(), *pb = b->GetBufferPointer();
+  for(size_t i = 0; i < n; i++)
+    {
+    if(fabs(pa[i] - (double) pb[i]) > tol)
+      n_diff++;
+    if(pa[i] != 0)
+      n_inside++;
+    }
+
+  // Most of the output should map inside of the input
+  if(n_inside < n / 4)
+    return 1.0;
+
+  return n_diff * 1.0 / n;
+}
+
+int main(int, char *[])
+{
+  srand(12345);
+  FloatImage::Pointer fimg = makeFloatImage();
+  LabelImage::Pointer limg = makeLabelImage();
+  VectorImage::Pointer vimg = makeVectorImage();
+
+  // Labels must be copied exactly. A voxel here or there may round the other
+  // way when it falls exactly half way between two input voxels
+  double d_nn = compare<LabelImage, itk::NearestNeighborInterpolateImageFunction<LabelImage> >(
+        limg, NEAREST_NEIGHBOR, 0.0);
+  TEST_CHECK(d_nn < 1e-4, "nearest neighbor differs from ITK");
+
+  double d_lin = compare<FloatImage, itk::LinearInterpolateImageFunction<FloatImage> >(
+        fimg, TRILINEAR, 1e-3);
+  TEST_CHECK(d_lin < 1e-4, "linear differs from ITK");
+
+  double d_cub = compare<FloatImage, itk::BSplineInterpolateImageFunction<FloatImage> >(
+        fimg, TRICUBIC, 1e-3);
+  TEST_CHECK(d_cub < 1e-4, "cubic differs from ITK");
+
+  double d_vnn = compare<VectorImage, itk::NearestNeighborInterpolateImageFunction<VectorImage> >(
+        vimg, NEAREST_NEIGHBOR, 0.0);
+  TEST_CHECK(d_vnn < 1e-4, "vector nearest neighbor differs from ITK");
+
+  double d_vlin = compare<VectorImage, itk::LinearInterpolateImageFunction<VectorImage> >(
+        vimg, TRILINEAR, 1e-3);
+  TEST_CHECK(d_vlin < 1e-4, "vector linear differs from ITK");
+
+  // Unsupported combinations must be rejected, so that callers fall back to ITK
+  TransformType::Pointer tran = makeTransform();
+  typedef FastAffineResampleImageFilter<FloatImage, FloatImage> FloatFilter;
+  typedef FastAffineResampleImageFilter<VectorImage, VectorImage> VectorFilter;
+  TEST_CHECK(FloatFilter::CanResample(tran, TRICUBIC), "cubic rejected for scalar image");
+  TEST_CHECK(FloatFilter::CanResample(NULL, TRILINEAR), "identity transform rejected");
+  TEST_CHECK(!FloatFilter::CanResample(tran, SINC_WINDOW_05), "sinc accepted");
+  TEST_CHECK(!VectorFilter::CanResample(tran, TRICUBIC), "cubic accepted for vector image");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,117 @@
+#include "GradientMagnitudePercentileImageFilter.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkGradientMagnitudeImageFilter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkImageRegionConstIterator.h>
+#include <itkCommand.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+typedef itk::Image<short, 3> ImageType;
+typedef GradientMagnitudePercentileImageFilter<ImageType> FilterType;
+
+ImageType::Pointer makeImage(int nx, int ny, int nz)
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  region.SetSize(0, nx); region.SetSize(1, ny); region.SetSize(2, nz);
+  image->SetRegions(region);
+  ImageType::SpacingType spacing;
+  spacing[0] = 1.0; spacing[1] = 2.0; spacing[2] = 0.5;
+  image->SetSpacing(spacing);
+  image->Allocate();
+  return image;
+}
+
+// The percentile of the gradient magnitude over all voxels, computed with
+// ITK the same way as in EdgePreprocessingImageFilter
+double fullPercentile(ImageType *image, double pct)
+{
+  typedef itk::Image<float, 3> FloatImage;
+  typedef itk::GradientMagnitudeImageFilter<ImageType, FloatImage> GMFilter;
+  GMFilter::Pointer gm = GMFilter::New();
+  gm->SetInput(image);
+  gm->SetUseImageSpacingOff();
+  gm->Update();
+
+  std::vector<float> v;
+  itk::ImageRegionConstIterator<FloatImage> it(gm->GetOutput(), gm->GetOutput()->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    v.push_back(it.Get());
+  size_t k = (size_t) floor((v.size() - 1) * pct / 100.0);
+  std::nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+void countRuns(itk::Object *, const itk::EventObject &, void *cd)
+{
+  (*static_cast<int *>(cd))++;
+}
+
+int main(int, char *[])
+{
+  srand(12345);
+
+  // A linear ramp has the same gradient everywhere away from the edges
+  ImageType::Pointer ramp = makeImage(60, 50, 40);
+  itk::ImageRegionIteratorWithIndex<ImageType> it(ramp, ramp->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    ImageType::IndexType idx = it.GetIndex();
+    it.Set(3 * idx[0] + 4 * idx[1] + idx[2]);
+    }
+
+  // The gradient is in voxel units, so the anisotropic spacing is ignored
+  double g_ramp = sqrt(3.0 * 3.0 + 4.0 * 4.0 + 1.0 * 1.0);
+
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(ramp);
+  filter->SetPercentile(50.0);
+  filter->Update();
+  TEST_CHECK(fabs(filter->GetPercentileValue() - g_ramp) < 1e-4, "wrong ramp gradient");
+  TEST_CHECK(filter->GetStride() == 1, "small image should not be subsampled");
+  TEST_CHECK(fabs(fullPercentile(ramp, 50.0) - g_ramp) < 1e-4,
+             "ramp gradient differs from the edge preprocessing gradient");
+
+  // The value is cached until the image is modified
+  int n_runs = 0;
+  itk::CStyleCommand::Pointer cmd = itk::CStyleCommand::New();
+  cmd->SetClientData(&n_runs);
+  cmd->SetCallback(countRuns);
+  filter->AddObserver(itk::StartEvent(), cmd);
+  filter->Update();
+  TEST_CHECK(n_runs == 0, "filter ran again");
+
+  for(it.GoToBegin(); !it.IsAtEnd(); ++it)
+    it.Set(it.Get() * 2);
+  ramp->Modified();
+  filter->Update();
+  TEST_CHECK(n_runs == 1, "filter did not run after modification");
+  TEST_CHECK(fabs(filter->GetPercentileValue() - 2 * g_ramp) < 1e-4, "filter not updated");
+
+  // A smooth image with noise, subsampled, against the full computation
+  ImageType::Pointer noisy = makeImage(200, 180, 120);
+  itk::ImageRegionIteratorWithIndex<ImageType> itn(noisy, noisy->GetBufferedRegion());
+  for(; !itn.IsAtEnd(); ++itn)
+    {
+    ImageType::IndexType idx = itn.GetIndex();
+    double f = 1000 * sin(idx[0] * 0.11) * cos(idx[1] * 0.07) + 500 * sin(idx[2] * 0.13);
+    itn.Set((short) (f + rand() % 50));
+    }
+
+  FilterType::Pointer fn = FilterType::New();
+  fn->SetInput(noisy);
+  fn->SetMaximumNumberOfSamples(200000);
+  fn->Update();
+
+  double p_full = fullPercentile(noisy, 99.9);
+  TEST_CHECK(fn->GetStride() > 1, "large image not subsampled");
+  TEST_CHECK(fabs(fn->GetPercentileValue() - p_full) < 0.1 * p_full, "subsampled estimate off");
+  TEST_CHECK(fn->GetMaximumValue() >= fn->GetPercentileValue(), "maximum below percentile");
+
+  return EXIT_SUCCESS;
+}
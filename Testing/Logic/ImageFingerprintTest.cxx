@@ -0,0 +1,136 @@
+#include "ImageFingerprint.h"
+#include "UndoDataManager.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkVectorImage.h>
+#include <itkImageRegionIterator.h>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+
+typedef itk::Image<short, 3> DenseImageType;
+typedef itk::VectorImage<unsigned char, 3> VectorImageType;
+typedef LabelImageWrapper::ImageType LabelImageType;
+typedef itk::ImageRegion<3> RegionType;
+
+template <class TSource>
+std::string fingerprint(const TSource &source, size_t slab, unsigned int threads)
+{
+  ImageFingerprint fp;
+  fp.SetBytesPerSlab(slab);
+  fp.SetNumberOfThreads(threads);
+  fp.Compute(source);
+  return fp.GetDigest();
+}
+
+int main(int argc, char *argv[])
+{
+  // A dense image with a pattern, three slices per slab
+  DenseImageType::Pointer dense = DenseImageType::New();
+  dense->SetRegions(makeRegion(0, 0, 0, 40, 30, 25));
+  dense->Allocate();
+  itk::ImageRegionIterator<DenseImageType> it(dense, dense->GetBufferedRegion());
+  for(int i = 0; !it.IsAtEnd(); ++it, ++i)
+    it.Set((short) ((i * 7919) % 1000 - 500));
+
+  size_t slab = 3 * 40 * 30 * sizeof(short);
+  ImageFingerprint::BufferSliceSource<DenseImageType> denseSource(dense);
+
+  ImageFingerprint fp;
+  fp.SetBytesPerSlab(slab);
+  fp.Compute(denseSource);
+  TEST_CHECK(fp.GetNumberOfSlabs() == 9 && fp.GetSlicesPerSlab() == 3, "wrong slabs");
+  TEST_CHECK(fp.GetDigest().size() == 32, "digest is not hex MD5");
+
+  // The digest does not depend on the number of threads
+  std::string d0 = fp.GetDigest();
+  TEST_CHECK(fingerprint(denseSource, slab, 1) == d0, "digest differs with 1 thread");
+  TEST_CHECK(fingerprint(denseSource, slab, 8) == d0, "digest differs with 8 threads");
+
+  // Modifying a voxel changes the digest, and only its slab is hashed again
+  DenseImageType::IndexType idx = {{ 11, 12, 17 }};
+  dense->SetPixel(idx, dense->GetPixel(idx) + 1);
+  TEST_CHECK(fp.UpdateSlices(denseSource, 17, 17) == 1, "wrong number of slabs rehashed");
+  TEST_CHECK(fp.GetDigest() != d0, "change not detected");
+  TEST_CHECK(fp.GetDigest() == fingerprint(denseSource, slab, 4), "update differs from compute");
+
+  // Changes in several slabs, and an empty range
+  dense->SetPixel(idx, dense->GetPixel(idx) - 1);
+  idx[2] = 24;
+  dense->SetPixel(idx, 0);
+  TEST_CHECK(fp.UpdateSlices(denseSource, 10, 24) == 6, "wrong number of slabs rehashed");
+  TEST_CHECK(fp.UpdateSlices(denseSource, 5, 4) == 0, "empty range rehashed");
+  TEST_CHECK(fp.GetDigest() == fingerprint(denseSource, slab, 4), "update differs from compute");
+
+  // The same bytes in a different shape have a different fingerprint
+  DenseImageType::Pointer reshaped = DenseImageType::New();
+  reshaped->SetRegions(makeRegion(0, 0, 0, 30, 40, 25));
+  reshaped->Allocate();
+  memcpy(reshaped->GetBufferPointer(), dense->GetBufferPointer(), 40 * 30 * 25 * sizeof(short));
+  ImageFingerprint::BufferSliceSource<DenseImageType> reshapedSource(reshaped);
+  TEST_CHECK(fp.UpdateSlices(reshapedSource, 0, 0) == 9, "new layout not hashed fully");
+  TEST_CHECK(fp.GetDigest() != fingerprint(denseSource, slab, 4), "layout not in fingerprint");
+
+  // Vector images hash all components
+  VectorImageType::Pointer vec = VectorImageType::New();
+  vec->SetRegions(makeRegion(0, 0, 0, 20, 20, 6));
+  vec->SetNumberOfComponentsPerPixel(3);
+  vec->Allocate();
+  memset(vec->GetBufferPointer(), 0, 20 * 20 * 6 * 3);
+  ImageFingerprint::BufferSliceSource<VectorImageType> vecSource(vec);
+  std::string dv = fingerprint(vecSource, 1, 3);
+  vec->GetBufferPointer()[20 * 20 * 6 * 3 - 1] = 1;
+  TEST_CHECK(fingerprint(vecSource, 1, 3) != dv, "last component not hashed");
+
+  // Run-length encoded images: the digest does not depend on how the runs
+  // are split, only on the labels
+  LabelImageType::Pointer rle = LabelImageType::New();
+  rle->SetRegions(makeRegion(0, 0, 0, 16, 12, 10));
+  rle->Allocate();
+  rle->FillBuffer(0);
+  ImageFingerprint::RLESliceSource<LabelImageType> rleSource(rle);
+  std::string dr = fingerprint(rleSource, 1, 2);
+
+  itk::Index<2> lix = {{ 4, 5 }};
+  LabelImageType::RLLine &line = rle->GetBuffer()->GetPixel(lix);
+  line.clear();
+  line.push_back(LabelImageType::RLSegment(5, 0));
+  line.push_back(LabelImageType::RLSegment(11, 0));
+  TEST_CHECK(fingerprint(rleSource, 1, 2) == dr, "split runs change the digest");
+
+  LabelImageType::IndexType lidx = {{ 15, 4, 5 }};
+  rle->SetPixel(lidx, 2);
+  TEST_CHECK(fingerprint(rleSource, 1, 2) != dr, "label change not detected");
+
+  // The label wrapper rehashes the slices touched by logged edits, and the
+  // whole image after other changes
+  LabelImageType::Pointer image = LabelImageType::New();
+  image->SetRegions(makeRegion(0, 0, 0, 16, 12, 10));
+  image->Allocate();
+  image->FillBuffer(0);
+
+  LabelImageWrapper::Pointer seg = LabelImageWrapper::New();
+  seg->SetImage(image);
+  ImageFingerprint::RLESliceSource<LabelImageType> segSource(image);
+
+  std::string ds = seg->GetContentFingerprint();
+  TEST_CHECK(ds == fingerprint(segSource, 4 << 20, 0), "wrapper digest differs");
+  TEST_CHECK(seg->GetContentFingerprint() == ds, "digest of unchanged image differs");
+
+  seg->StoreUndoPoint("box", paint(image, makeRegion(2, 3, 1, 8, 5, 4), 3));
+  std::string ds1 = seg->GetContentFingerprint();
+  TEST_CHECK(ds1 != ds, "edit not detected");
+  TEST_CHECK(ds1 == fingerprint(segSource, 4 << 20, 0), "digest after edit differs");
+
+  seg->Undo();
+  TEST_CHECK(seg->GetContentFingerprint() == ds, "digest after undo differs");
+
+  itk::ImageRegionIterator<LabelImageType> lit(image, makeRegion(0, 0, 9, 16, 12, 1));
+  for(; !lit.IsAtEnd(); ++lit)
+    lit.Set(7);
+  image->Modified();
+  TEST_CHECK(seg->GetContentFingerprint() == fingerprint(segSource, 4 << 20, 0),
+             "digest after unlogged change differs");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#include "UndoDataManager.h"
+#include "LogicTestCommon.h"
+#include <itkImageRegionIterator.h>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+
+typedef LabelImageWrapper::ImageType ImageType;
+typedef itk::ImageRegion<3> RegionType;
+
+// Apply the logged changes to a copy of the image, checking that the old
+// labels match the copy. Then check that the copy matches the image
+bool replay(LabelImageWrapper *seg, unsigned long &pos, std::vector<LabelType> &shadow)
+{
+  std::vector<const LabelImageWrapper::LabelChange *> changes;
+  if(!seg->GetChangesSince(pos, changes))
+    return false;
+
+  // The label image is run-length encoded, so voxels are compared by index
+  ImageType *image = seg->GetImage();
+  RegionType full = image->GetBufferedRegion();
+  for(size_t k = 0; k < changes.size(); k++)
+    {
+    const RegionType &r = changes[k]->Region;
+    for(size_t i = 0; i < changes[k]->Runs.size(); i++)
+      {
+      const LabelImageWrapper::LabelChangeRun &run = changes[k]->Runs[i];
+      for(size_t q = run.Offset; q < run.Offset + run.Length; q++)
+        {
+        ImageType::IndexType idx;
+        size_t off = q;
+        for(int d = 0; d < 3; d++)
+          {
+          idx[d] = r.GetIndex(d) + off % r.GetSize(d);
+          off /= r.GetSize(d);
+          }
+
+        size_t p = image->ComputeOffset(idx);
+        if(shadow[p] != run.OldLabel)
+          {
+          std::cerr << "Wrong old label at " << idx << std::endl;
+          return false;
+          }
+        shadow[p] = run.NewLabel;
+        }
+      }
+    }
+
+  for(size_t p = 0; p < full.GetNumberOfPixels(); p++)
+    if(shadow[p] != image->GetPixel(image->ComputeIndex(p)))
+      {
+      std::cerr << "Replayed image differs at offset " << p << std::endl;
+      return false;
+      }
+
+  return true;
+}
+
+int main(int argc, char *argv[])
+{
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(makeRegion(0, 0, 0, 16, 12, 10));
+  image->Allocate();
+  image->FillBuffer(0);
+
+  LabelImageWrapper::Pointer seg = LabelImageWrapper::New();
+  seg->SetImage(image);
+
+  std::vector<LabelType> shadow(16 * 12 * 10, 0);
+  unsigned long pos = seg->GetChangeLogEnd();
+  TEST_CHECK(replay(seg, pos, shadow), "empty log");
+
+  // A single edit
+  seg->StoreUndoPoint("box", paint(image, makeRegion(2, 3, 1, 8, 5, 4), 3));
+  TEST_CHECK(replay(seg, pos, shadow), "single edit");
+
+  // Overlapping intermediate deltas committed together, including an edit
+  // that changes nothing
+  seg->StoreIntermediateUndoDelta(paint(image, makeRegion(5, 5, 2, 6, 6, 6), 5));
+  seg->StoreIntermediateUndoDelta(paint(image, makeRegion(0, 0, 3, 16, 12, 1), 7));
+  seg->StoreIntermediateUndoDelta(paint(image, makeRegion(0, 0, 3, 16, 12, 1), 7));
+  seg->StoreUndoPoint("strokes");
+  TEST_CHECK(replay(seg, pos, shadow), "intermediate deltas");
+
+  // Undo and redo
+  seg->Undo();
+  TEST_CHECK(replay(seg, pos, shadow), "undo");
+  seg->Redo();
+  TEST_CHECK(replay(seg, pos, shadow), "redo");
+  seg->Undo();
+  seg->Undo();
+  TEST_CHECK(replay(seg, pos, shadow), "two undos");
+  for(size_t p = 0; p < shadow.size(); p++)
+    TEST_CHECK(shadow[p] == 0, "image not cleared by undo");
+
+  // The log can be read from an older position than the last reader's
+  unsigned long old_pos = seg->GetChangeLogEnd();
+  std::vector<LabelType> old_shadow = shadow;
+  seg->Redo();
+  TEST_CHECK(replay(seg, pos, shadow), "redo after undos");
+  TEST_CHECK(replay(seg, old_pos, old_shadow), "replay from older position");
+
+  // Changes that are not logged are detected
+  unsigned long before = pos;
+  itk::ImageRegionIterator<ImageType> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    if(it.Get() == 3)
+      it.Set(4);
+  image->Modified();
+  TEST_CHECK(!replay(seg, pos, shadow), "unlogged change not detected");
+  TEST_CHECK(pos == before, "position advanced on failure");
+
+  // After the undo points are cleared, the old positions are invalid
+  seg->ClearUndoPoints();
+  TEST_CHECK(!replay(seg, pos, shadow), "reset not detected");
+
+  // Start over from the new position
+  pos = seg->GetChangeLogEnd();
+  for(size_t p = 0; p < shadow.size(); p++)
+    shadow[p] = image->GetPixel(image->ComputeIndex(p));
+  seg->StoreUndoPoint("box", paint(image, makeRegion(1, 1, 1, 3, 3, 3), 9));
+  seg->Undo();
+  TEST_CHECK(replay(seg, pos, shadow), "edit after reset");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+#include "LabelResampleImageFilter.h"
+#include "RLEImage.h"
+#include "RLEImageRegionConstIterator.h"
+#include "LogicTestCommon.h"
+#include <itkAffineTransform.h>
+#include <itkContinuousIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <map>
+
+typedef RLEImage<LabelType> ImageType;
+typedef LabelResampleImageFilter<ImageType> FilterType;
+typedef itk::AffineTransform<double, 3> TransformType;
+
+// Anisotropic, oblique image with a few touching labels
+ImageType::Pointer makeImage()
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  region.SetSize(0, 32); region.SetSize(1, 28); region.SetSize(2, 20);
+  image->SetRegions(region);
+
+  double spacing[] = { 0.9, 1.1, 1.6 };
+  image->SetSpacing(spacing);
+  double origin[] = { -10.0, 4.0, 7.0 };
+  image->SetOrigin(origin);
+
+  ImageType::DirectionType dir;
+  double c = cos(0.3), s = sin(0.3);
+  dir.SetIdentity();
+  dir(0,0) = c; dir(0,1) = -s; dir(1,0) = s; dir(1,1) = c;
+  image->SetDirection(dir);
+
+  image->Allocate();
+  image->FillBuffer(0);
+
+  for(int z = 0; z < 20; z++)
+    for(int y = 0; y < 28; y++)
+      for(int x = 0; x < 32; x++)
+        {
+        ImageType::IndexType idx = {{ x, y, z }};
+        double d1 = (x-12)*(x-12) + (y-14)*(y-14) + 2.0*(z-10)*(z-10);
+        if(d1 < 64)
+          image->SetPixel(idx, x < 12 ? 1 : 2);
+        else if(x >= 20 && x < 29 && y >= 6 && y < 22 && z >= 4 && z < 15)
+          image->SetPixel(idx, 300);
+        }
+
+  return image;
+}
+
+TransformType::Pointer makeTransform()
+{
+  TransformType::Pointer tran = TransformType::New();
+  TransformType::OutputVectorType axis;
+  axis[0] = 0.2; axis[1] = 0.5; axis[2] = 0.8;
+  TransformType::OutputVectorType offset;
+  offset[0] = 1.2; offset[1] = -0.7; offset[2] = 0.9;
+  tran->Rotate3D(axis, 0.25);
+  tran->Translate(offset);
+  return tran;
+}
+
+ImageType::Pointer resample(ImageType *image, TransformType *tran, InterpolationMethod method,
+                            const double *spacing, const double *origin,
+                            unsigned int nx, unsigned int ny, unsigned int nz,
+                            unsigned int threads)
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(image);
+  filter->SetTransform(tran);
+  filter->SetInterpolationMethod(method);
+  ImageType::SizeType size = {{ nx, ny, nz }};
+  filter->SetSize(size);
+  filter->SetOutputSpacing(spacing);
+  filter->SetOutputOrigin(origin);
+  filter->SetOutputDirection(image->GetDirection());
+  filter->SetNumberOfThreads(threads);
+  filter->Update();
+  return filter->GetOutput();
+}
+
+bool same(ImageType *a, ImageType *b)
+{
+  if(a->GetBufferedRegion() != b->GetBufferedRegion())
+    return false;
+  itk::ImageRegionConstIterator<ImageType> ia(a, a->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> ib(b, b->GetBufferedRegion());
+  for(; !ia.IsAtEnd(); ++ia, ++ib)
+    if(ia.Get() != ib.Get())
+      return false;
+  return true;
+}
+
+// Trilinear weights of the labels at a continuous index, computed directly
+void linearWeights(ImageType *image, const itk::ContinuousIndex<double, 3> &cix,
+                   std::map<LabelType, double> &weights)
+{
+  weights.clear();
+  ImageType::SizeType size = image->GetBufferedRegion().GetSize();
+  for(int a = 0; a < 3; a++)
+    if(cix[a] < -0.5 || cix[a] >= size[a] - 0.5)
+      {
+      weights[0] = 1.0;
+      return;
+      }
+
+  for(int k = 0; k < 8; k++)
+    {
+    ImageType::IndexType idx;
+    double w = 1.0;
+    for(int a = 0; a < 3; a++)
+      {
+      double f = floor(cix[a]);
+      int i = (int) f + ((k >> a) & 1);
+      w *= ((k >> a) & 1) ? cix[a] - f : 1.0 - (cix[a] - f);
+      idx[a] = std::max(0, std::min((int) size[a] - 1, i));
+      }
+    weights[image->GetPixel(idx)] += w;
+    }
+}
+
+std::map<LabelType, unsigned long> countLabels(ImageType *image)
+{
+  std::map<LabelType, unsigned long> counts;
+  itk::ImageRegionConstIterator<ImageType> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    counts[it.Get()]++;
+  return counts;
+}
+
+int main(int argc, char *argv[])
+{
+  ImageType::Pointer image = makeImage();
+  std::map<LabelType, unsigned long> inCounts = countLabels(image);
+  TEST_CHECK(inCounts.size() == 4, "test image has wrong labels");
+
+  // Resampling into the same grid reproduces the image
+  ImageType::SizeType isz = image->GetBufferedRegion().GetSize();
+  InterpolationMethod methods[] = { NEAREST_NEIGHBOR, TRILINEAR };
+  for(int m = 0; m < 2; m++)
+    {
+    ImageType::Pointer out = resample(image, NULL, methods[m],
+                                      image->GetSpacing().GetDataPointer(),
+                                      image->GetOrigin().GetDataPointer(),
+                                      isz[0], isz[1], isz[2], 4);
+    TEST_CHECK(same(image, out), "identity resampling changed labels, method " << methods[m]);
+    }
+
+  // Rotate and upsample. The result does not depend on the number of threads
+  TransformType::Pointer tran = makeTransform();
+  double spacing[] = { 0.6, 0.7, 1.0 };
+  double origin[] = { -11.0, 3.0, 6.0 };
+  ImageType::Pointer lin1 = resample(image, tran, TRILINEAR, spacing, origin, 50, 46, 34, 1);
+  ImageType::Pointer lin4 = resample(image, tran, TRILINEAR, spacing, origin, 50, 46, 34, 4);
+  TEST_CHECK(same(lin1, lin4), "result depends on the number of threads");
+
+  // Every voxel gets the label with the largest trilinear weight
+  std::map<LabelType, double> weights;
+  unsigned long n_inside = 0;
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it(lin4, lin4->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    ImageType::PointType p;
+    lin4->TransformIndexToPhysicalPoint(it.GetIndex(), p);
+    itk::ContinuousIndex<double, 3> cix;
+    image->TransformPhysicalPointToContinuousIndex(tran->TransformPoint(p), cix);
+    linearWeights(image, cix, weights);
+
+    double wmax = 0.0;
+    for(std::map<LabelType, double>::const_iterator q = weights.begin(); q != weights.end(); ++q)
+      wmax = std::max(wmax, q->second);
+
+    LabelType label = it.Get();
+    TEST_CHECK(weights.count(label) && weights[label] > wmax - 1e-9,
+               "voxel " << it.GetIndex() << " has label " << label
+               << " without the largest weight");
+    if(label != 0)
+      n_inside++;
+    }
+  TEST_CHECK(n_inside > 10000, "labels lost in resampling");
+
+  // The Gaussian kernel, downsampling. No new labels appear, and the volume
+  // of the labels is roughly preserved
+  double coarse[] = { 1.8, 2.2, 3.2 };
+  ImageType::Pointer gauss = resample(image, NULL, TRICUBIC, coarse,
+                                      image->GetOrigin().GetDataPointer(), 16, 14, 10, 3);
+  std::map<LabelType, unsigned long> outCounts = countLabels(gauss);
+  for(std::map<LabelType, unsigned long>::const_iterator q = outCounts.begin(); q != outCounts.end(); ++q)
+    TEST_CHECK(inCounts.count(q->first), "new label " << q->first << " after downsampling");
+  double vin = inCounts[300] * 0.9 * 1.1 * 1.6;
+  double vout = outCounts[300] * 1.8 * 2.2 * 3.2;
+  TEST_CHECK(fabs(vout - vin) < 0.3 * vin, "box volume not preserved");
+
+  // An empty segmentation stays empty
+  image->FillBuffer(0);
+  image->Modified();
+  ImageType::Pointer empty = resample(image, tran, TRILINEAR, spacing, origin, 50, 46, 34, 4);
+  std::map<LabelType, unsigned long> emptyCounts = countLabels(empty);
+  TEST_CHECK(emptyCounts.size() == 1 && emptyCounts.count(0), "empty image not clear");
+
+  return EXIT_SUCCESS;
+}
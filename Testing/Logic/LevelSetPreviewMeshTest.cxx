@@ -0,0 +1,194 @@
+#include "LevelSetMeshPipeline.h"
+#include "SNAPLevelSetDriver.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <vtkPolyData.h>
+#include <vtkPointData.h>
+#include <vtkDataArray.h>
+#include <vtkTriangleFilter.h>
+#include <vtkMassProperties.h>
+#include <vtkSmartPointer.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+
+typedef itk::Image<float, 3> FloatImage;
+typedef itk::Image<short, 3> ShortImage;
+typedef FloatImage::IndexType IndexType;
+
+// A signed distance to an ellipsoid (approximately), negative inside, in an
+// image with anisotropic voxels and a flipped axis. The parallel sparse field
+// solver expects the region to start at the origin
+FloatImage::Pointer makeLevelSet(bool zeroBased)
+{
+  FloatImage::Pointer image = FloatImage::New();
+  FloatImage::RegionType region;
+  if(!zeroBased)
+    {
+    region.SetIndex(0, 3); region.SetIndex(1, 0); region.SetIndex(2, -2);
+    }
+  region.SetSize(0, 48); region.SetSize(1, 40); region.SetSize(2, 36);
+  image->SetRegions(region);
+
+  double spacing[] = { 1.2, 1.0, 0.9 };
+  image->SetSpacing(spacing);
+
+  FloatImage::DirectionType dir;
+  dir.SetIdentity();
+  dir(1,1) = -1.0;
+  image->SetDirection(dir);
+
+  double origin[] = { -20.0, 15.0, 4.0 };
+  image->SetOrigin(origin);
+  image->Allocate();
+
+  double center[] = { 27.0, 19.5, 15.0 }, radius[] = { 14.0, 11.0, 12.0 };
+  itk::ImageRegionIteratorWithIndex<FloatImage> it(image, region);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    double r = 0.0;
+    for(int d = 0; d < 3; d++)
+      {
+      double u = (it.GetIndex()[d] - center[d]) / radius[d];
+      r += u * u;
+      }
+    it.Set((float) ((sqrt(r) - 1.0) * 12.0));
+    }
+  return image;
+}
+
+// The voxels with a neighbor across the zero level set
+std::vector<IndexType> zeroCrossingVoxels(FloatImage *image)
+{
+  std::vector<IndexType> voxels;
+  FloatImage::RegionType region = image->GetBufferedRegion();
+  itk::ImageRegionIteratorWithIndex<FloatImage> it(image, region);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    bool inside = it.Get() >= 0.0f, crossing = false;
+    for(int d = 0; d < 3 && !crossing; d++)
+      {
+      for(int s = -1; s <= 1 && !crossing; s += 2)
+        {
+        IndexType idx = it.GetIndex();
+        idx[d] += s;
+        if(region.IsInside(idx) && (image->GetPixel(idx) >= 0.0f) != inside)
+          crossing = true;
+        }
+      }
+    if(crossing)
+      voxels.push_back(it.GetIndex());
+    }
+  return voxels;
+}
+
+// Total area and number of triangles of a mesh
+double area(vtkPolyData *mesh, vtkIdType &n_tri)
+{
+  vtkSmartPointer<vtkTriangleFilter> tri = vtkSmartPointer<vtkTriangleFilter>::New();
+  tri->SetInputData(mesh);
+  tri->Update();
+  n_tri = tri->GetOutput()->GetNumberOfPolys();
+
+  vtkSmartPointer<vtkMassProperties> mp = vtkSmartPointer<vtkMassProperties>::New();
+  mp->SetInputConnection(tri->GetOutputPort());
+  mp->Update();
+  return mp->GetSurfaceArea();
+}
+
+// Check that the normals all point to the same side of the surface, and
+// return the side: +1 away from the centroid, -1 towards it
+int normalSide(vtkPolyData *mesh)
+{
+  vtkDataArray *nrm = mesh->GetPointData()->GetNormals();
+  if(!nrm || mesh->GetNumberOfPoints() == 0)
+    return 0;
+
+  double c[3] = { 0, 0, 0 };
+  for(vtkIdType i = 0; i < mesh->GetNumberOfPoints(); i++)
+    for(int d = 0; d < 3; d++)
+      c[d] += mesh->GetPoint(i)[d] / mesh->GetNumberOfPoints();
+
+  int n_out = 0, n_in = 0;
+  for(vtkIdType i = 0; i < mesh->GetNumberOfPoints(); i++)
+    {
+    double dot = 0.0;
+    for(int d = 0; d < 3; d++)
+      dot += (mesh->GetPoint(i)[d] - c[d]) * nrm->GetComponent(i, d);
+    (dot > 0 ? n_out : n_in)++;
+    }
+
+  return n_in == 0 ? 1 : (n_out == 0 ? -1 : 0);
+}
+
+int main(int, char *[])
+{
+  FloatImage::Pointer phi = makeLevelSet(false);
+  std::vector<IndexType> band = zeroCrossingVoxels(phi);
+  TEST_CHECK(band.size() > 1000, "no zero crossing");
+
+  // The preview mesh over the cells next to the zero crossing matches the
+  // mesh from marching cubes over the whole image
+  LevelSetMeshPipeline::Pointer pipeline = LevelSetMeshPipeline::New();
+  pipeline->SetImage(phi);
+  pipeline->UpdateMesh();
+  vtkSmartPointer<vtkPolyData> full = pipeline->GetMesh();
+
+  pipeline->UpdatePreviewMesh(band);
+  vtkSmartPointer<vtkPolyData> preview = pipeline->GetMesh();
+  TEST_CHECK(preview.GetPointer() != full.GetPointer(), "mesh object reused");
+
+  vtkIdType nt_full, nt_preview;
+  double a_full = area(full, nt_full), a_preview = area(preview, nt_preview);
+  TEST_CHECK(nt_full == nt_preview, "different number of triangles");
+  TEST_CHECK(fabs(a_full - a_preview) < 1e-6 * a_full, "different surface area");
+
+  // The normals point the same way as those from the full pipeline
+  int side = normalSide(preview);
+  TEST_CHECK(side != 0, "inconsistent normals");
+  TEST_CHECK(side == normalSide(full), "normals flipped");
+
+  // Missing cells are missing from the mesh
+  std::vector<IndexType> half(band.begin(), band.begin() + band.size() / 2);
+  pipeline->UpdatePreviewMesh(half);
+  vtkIdType nt_half;
+  TEST_CHECK(area(pipeline->GetMesh(), nt_half) < a_full && nt_half > 0, "partial band");
+
+  // The active layer of the sparse field solver covers the zero level set
+  phi = makeLevelSet(true);
+  ShortImage::Pointer speed = ShortImage::New();
+  speed->CopyInformation(phi);
+  speed->SetRegions(phi->GetBufferedRegion());
+  speed->Allocate();
+  speed->FillBuffer(0x3fff);
+
+  SnakeParameters parms = SnakeParameters::GetDefaultInOutParameters();
+  parms.SetSolver(SnakeParameters::PARALLEL_SPARSE_FIELD_SOLVER);
+  SNAPLevelSetDriver3d driver(phi, speed, parms);
+  driver.Run(5);
+
+  std::vector<IndexType> active;
+  TEST_CHECK(driver.GetActiveLayer(active), "active layer not available");
+  TEST_CHECK(active.size() > 1000, "active layer is empty");
+
+  FloatImage *state = driver.GetCurrentState();
+  for(size_t i = 0; i < active.size(); i++)
+    TEST_CHECK(fabs(state->GetPixel(active[i])) <= 0.5 + 1e-4, "voxel not in the active layer");
+
+  pipeline->SetImage(state);
+  pipeline->UpdatePreviewMesh(active);
+  double a_active = area(pipeline->GetMesh(), nt_preview);
+  pipeline->UpdatePreviewMesh(zeroCrossingVoxels(state));
+  double a_band = area(pipeline->GetMesh(), nt_full);
+  TEST_CHECK(nt_preview == nt_full && fabs(a_active - a_band) < 1e-6 * a_band,
+             "active layer does not cover the zero level set");
+
+  // The dense solver does not track the active layer
+  parms.SetSolver(SnakeParameters::DENSE_SOLVER);
+  driver.SetSnakeParameters(parms);
+  TEST_CHECK(!driver.GetActiveLayer(active), "active layer from the dense solver");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,56 @@
+#ifndef LOGICTESTCOMMON_H
+#define LOGICTESTCOMMON_H
+
+#include "LabelImageWrapper.h"
+#include "SegmentationUpdateIterator.h"
+#include <itkImageRegion.h>
+#include <iostream>
+#include <cstdlib>
+
+/**
+ * Helpers shared by the standalone tests in this directory. Each test is a
+ * main() that returns EXIT_FAILURE on the first failed check and prints
+ * nothing when all checks pass.
+ */
+
+// Fail the test with a message if the condition does not hold
+#define TEST_CHECK(cond, msg) \
+  if(!(cond)) { std::cerr << "FAILED: " << msg << std::endl; return EXIT_FAILURE; }
+
+// A 3D region from its corner and size
+inline itk::ImageRegion<3> makeRegion(int x, int y, int z, int sx, int sy, int sz)
+{
+  itk::ImageRegion<3> r;
+  r.SetIndex(0, x); r.SetIndex(1, y); r.SetIndex(2, z);
+  r.SetSize(0, sx); r.SetSize(1, sy); r.SetSize(2, sz);
+  return r;
+}
+
+// A 64x56x40 image (scalar or vector) filled with random values
+template <class TImage>
+typename TImage::Pointer makeRandomImage(unsigned int nc)
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(makeRegion(0, 0, 0, 64, 56, 40));
+  image->SetNumberOfComponentsPerPixel(nc);
+  image->Allocate();
+
+  typename TImage::InternalPixelType *p = image->GetBufferPointer();
+  size_t n = image->GetPixelContainer()->Size();
+  for(size_t i = 0; i < n; i++)
+    p[i] = static_cast<typename TImage::InternalPixelType>((rand() % 20000) * 0.0123);
+  return image;
+}
+
+// Paint a box in a label image with a label, as the paintbrush does
+inline LabelImageWrapper::UndoManagerDelta *paint(
+    LabelImageWrapper::ImageType *image, const itk::ImageRegion<3> &r, LabelType label)
+{
+  SegmentationUpdateIterator it(image, r, label, DrawOverFilter(PAINT_OVER_ALL, 0));
+  for(; !it.IsAtEnd(); ++it)
+    it.PaintAsForeground();
+  it.Finalize();
+  return it.RelinquishDelta();
+}
+
+#endif // LOGICTESTCOMMON_H
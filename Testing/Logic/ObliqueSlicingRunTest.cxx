@@ -0,0 +1,161 @@
+#include "NonOrthogonalSlicer.h"
+#include "FastLinearInterpolator.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkVectorImage.h>
+#include <itkAffineTransform.h>
+#include <itkResampleImageFilter.h>
+#include <itkImageRegionIterator.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+typedef itk::Image<short, 3> ShortImage;
+typedef itk::Image<float, 3> FloatImage;
+typedef itk::VectorImage<unsigned char, 3> VectorImage;
+
+double frand(double a, double b)
+{
+  return a + (b - a) * (rand() * 1.0 / RAND_MAX);
+}
+
+// Check that the run interpolation gives the exact same values as sampling
+// one voxel at a time, for random lines inside of the image
+template <class TImage>
+bool checkRuns(TImage *image, bool use_nn)
+{
+  typedef FastLinearInterpolator<TImage, double, 3> Interpolator;
+  typedef typename Interpolator::OutputComponentType OutputType;
+  Interpolator fli(image);
+  int nc = fli.GetPointerIncrement();
+  const int n = 37;
+
+  std::vector<OutputType> run(n * nc), ref(n * nc);
+  for(int trial = 0; trial < 200; trial++)
+    {
+    // Pick a line that stays inside of the image
+    double cix[3], step[3], cix_ref[3];
+    for(int d = 0; d < 3; d++)
+      {
+      double size = image->GetBufferedRegion().GetSize(d);
+      step[d] = frand(-0.4, 0.4);
+      double lo = std::max(0.0, -step[d] * (n - 1)), hi = std::min(size - 1, size - 1 - step[d] * (n - 1));
+      cix[d] = cix_ref[d] = frand(lo + 0.01, hi - 0.01);
+      }
+
+    if(use_nn)
+      fli.InterpolateNearestNeighborRun(cix, step, n, &run[0]);
+    else
+      fli.InterpolateRun(cix, step, n, &run[0]);
+
+    for(int i = 0; i < n; i++)
+      {
+      typename Interpolator::InOut status = use_nn
+          ? fli.InterpolateNearestNeighbor(cix_ref, &ref[i * nc])
+          : fli.Interpolate(cix_ref, &ref[i * nc]);
+      if(status != Interpolator::INSIDE)
+        return false;
+      for(int d = 0; d < 3; d++)
+        cix_ref[d] += step[d];
+      }
+
+    for(int k = 0; k < n * nc; k++)
+      if(run[k] != ref[k])
+        return false;
+
+    // The position must be advanced past the run
+    for(int d = 0; d < 3; d++)
+      if(cix[d] != cix_ref[d])
+        return false;
+    }
+
+  return true;
+}
+
+// Slice an oblique plane through the image and compare with ITK
+bool checkSlicer(FloatImage *image)
+{
+  typedef itk::Image<float, 2> SliceImage;
+  typedef itk::AffineTransform<double, 3> TransformType;
+
+  // The reference slice, larger than the image so that some lines are clipped
+  FloatImage::Pointer reference = FloatImage::New();
+  FloatImage::RegionType region;
+  region.SetSize(0, 96); region.SetSize(1, 80); region.SetSize(2, 1);
+  reference->SetRegions(region);
+  FloatImage::PointType origin;
+  origin[0] = -10.0; origin[1] = -8.0; origin[2] = 18.5;
+  reference->SetOrigin(origin);
+
+  TransformType::Pointer tran = TransformType::New();
+  TransformType::OutputVectorType axis, offset;
+  axis[0] = 0.5; axis[1] = 0.2; axis[2] = 0.3;
+  offset[0] = 1.3; offset[1] = -0.6; offset[2] = 0.4;
+  tran->Rotate3D(axis, 0.35);
+  tran->Translate(offset);
+
+  typedef itk::ResampleImageFilter<FloatImage, FloatImage> ITKFilter;
+  ITKFilter::Pointer fi = ITKFilter::New();
+  fi->SetInput(image);
+  fi->SetTransform(tran);
+  fi->SetOutputParametersFromImage(reference);
+  fi->Update();
+
+  typedef NonOrthogonalSlicer<FloatImage, SliceImage> SlicerType;
+  SlicerType::Pointer slicer = SlicerType::New();
+  slicer->SetInput(image);
+  slicer->SetReferenceImage(reference);
+  slicer->SetTransform(tran.GetPointer());
+
+  slicer->Update();
+
+  // Compare away from the image edges, where the boundary conditions differ
+  int n_compared = 0, n_diff = 0;
+  for(int y = 0; y < 80; y++)
+    {
+    for(int x = 0; x < 96; x++)
+      {
+      FloatImage::IndexType idx3 = {{ x, y, 0 }};
+      SliceImage::IndexType idx2 = {{ x, y }};
+      FloatImage::PointType p;
+      reference->TransformIndexToPhysicalPoint(idx3, p);
+      itk::ContinuousIndex<double, 3> cix;
+      image->TransformPhysicalPointToContinuousIndex(tran->TransformPoint(p), cix);
+
+      bool inside = true;
+      for(int d = 0; d < 3; d++)
+        if(cix[d] < 1e-3 || cix[d] > image->GetBufferedRegion().GetSize(d) - 1 - 1e-3)
+          inside = false;
+      if(!inside)
+        continue;
+
+      n_compared++;
+      if(fabs(fi->GetOutput()->GetPixel(idx3) - slicer->GetOutput()->GetPixel(idx2)) > 1e-3)
+        n_diff++;
+      }
+    }
+
+  return n_compared > 96 * 80 / 4 && n_diff == 0;
+}
+
+int main(int, char *[])
+{
+  srand(12345);
+  ShortImage::Pointer simg = makeRandomImage<ShortImage>(1);
+  FloatImage::Pointer fimg = makeRandomImage<FloatImage>(1);
+  VectorImage::Pointer vimg = makeRandomImage<VectorImage>(3);
+
+  TEST_CHECK(checkRuns<ShortImage>(simg, false), "short linear run differs");
+  TEST_CHECK(checkRuns<ShortImage>(simg, true), "short nearest neighbor run differs");
+  TEST_CHECK(checkRuns<FloatImage>(fimg, false), "float linear run differs");
+  TEST_CHECK(checkRuns<FloatImage>(fimg, true), "float nearest neighbor run differs");
+  TEST_CHECK(checkRuns<VectorImage>(vimg, false), "vector linear run differs");
+  TEST_CHECK(checkRuns<VectorImage>(vimg, true), "vector nearest neighbor run differs");
+
+  TEST_CHECK(checkSlicer(fimg), "slicer differs from ITK");
+
+  return EXIT_SUCCESS;
+}
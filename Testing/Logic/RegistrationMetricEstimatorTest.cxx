@@ -0,0 +1,108 @@
+#include "RegistrationMetricEstimator.h"
+#include "LogicTestCommon.h"
+#include <itkImageRegionIteratorWithIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <chrono>
+
+typedef RegistrationMetricEstimator::FloatImageType ImageType;
+typedef RegistrationMetricEstimator::MatrixType MatrixType;
+typedef RegistrationMetricEstimator::VectorType VectorType;
+typedef RegistrationMetricEstimator::Result Result;
+
+// A smooth image with two blobs, so that the metrics change with translation
+ImageType::Pointer makeImage()
+{
+  ImageType::Pointer image = ImageType::New();
+  ImageType::RegionType region;
+  region.SetSize(0, 96); region.SetSize(1, 80); region.SetSize(2, 40);
+  image->SetRegions(region);
+  ImageType::SpacingType spacing;
+  spacing[0] = 1.0; spacing[1] = 1.0; spacing[2] = 2.0;
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, region);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    ImageType::PointType p;
+    image->TransformIndexToPhysicalPoint(it.GetIndex(), p);
+    double d1 = (p[0] - 30) * (p[0] - 30) + (p[1] - 40) * (p[1] - 40) + (p[2] - 40) * (p[2] - 40);
+    double d2 = (p[0] - 65) * (p[0] - 65) + (p[1] - 30) * (p[1] - 30) + (p[2] - 30) * (p[2] - 30);
+    it.Set(100.0 * exp(-d1 / 200.0) + 60.0 * exp(-d2 / 100.0));
+    }
+
+  return image;
+}
+
+int main(int, char *[])
+{
+  ImageType::Pointer image = makeImage();
+
+  RegistrationMetricEstimator::Pointer est = RegistrationMetricEstimator::New();
+  est->SetMaximumCacheDimension(32);
+  est->SetImages(image, image);
+  TEST_CHECK(est->IsCacheReady(), "cache not built");
+
+  // The cache should respect the maximum dimension
+  ImageType::SizeType sz = est->GetFixedCache()->GetBufferedRegion().GetSize();
+  TEST_CHECK(sz[0] <= 32 && sz[1] <= 32 && sz[2] <= 32, "cache too large");
+
+  // Identity transform: perfect alignment
+  MatrixType identity; identity.SetIdentity();
+  VectorType zero; zero.Fill(0.0);
+  Result r0 = est->Evaluate(identity, zero);
+
+  TEST_CHECK(r0.FractionEvaluated == 1.0, "full evaluation incomplete");
+  TEST_CHECK(r0.NumberOfSamples == sz[0] * sz[1] * sz[2], "wrong number of samples");
+  TEST_CHECK(fabs(r0.NCC - 1.0) < 1e-6, "NCC at identity should be 1");
+  TEST_CHECK(r0.SSD < 1e-6, "SSD at identity should be 0");
+  TEST_CHECK(fabs(r0.NMI - 2.0) < 1e-6, "NMI at identity should be 2");
+
+  // A translation makes all metrics worse
+  VectorType shift; shift[0] = 8.0; shift[1] = -6.0; shift[2] = 4.0;
+  Result r1 = est->Evaluate(identity, shift);
+
+  TEST_CHECK(r1.NumberOfSamples > 0 && r1.NumberOfSamples < r0.NumberOfSamples,
+             "shifted overlap should be partial");
+  TEST_CHECK(r1.NCC < r0.NCC - 0.05, "NCC did not decrease");
+  TEST_CHECK(r1.NMI < r0.NMI, "NMI did not decrease");
+  TEST_CHECK(r1.SSD > r0.SSD, "SSD did not increase");
+
+  // A transform that maps everything outside of the moving image
+  VectorType far; far.Fill(1000.0);
+  Result r2 = est->Evaluate(identity, far);
+  TEST_CHECK(r2.NumberOfSamples == 0, "samples found outside of the moving image");
+
+  // With a zero time budget, only part of the image is visited
+  Result r3 = est->Evaluate(identity, zero, 0.0);
+  TEST_CHECK(r3.FractionEvaluated < 1.0 && r3.NumberOfSamples > 0, "time budget ignored");
+
+  // Background evaluation: only the latest of several requests is reported last
+  est->SetTimeBudget(-1.0);
+  est->RequestEvaluation(identity, far);
+  unsigned long id = est->RequestEvaluation(identity, shift);
+  Result ra;
+  bool done = false;
+  for(int i = 0; i < 500 && !done; i++)
+    {
+    Result rtmp;
+    if(est->GetLatestResult(rtmp))
+      {
+      ra = rtmp;
+      done = (ra.RequestId == id);
+      }
+    else
+      {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+    }
+
+  TEST_CHECK(done, "background evaluation did not complete");
+  TEST_CHECK(ra.NCC == r1.NCC && ra.SSD == r1.SSD, "background result differs");
+  TEST_CHECK(!est->GetLatestResult(ra), "result returned twice");
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+#include "SegmentationComparison.h"
+#include "RLEImageRegionIterator.h"
+#include "LogicTestCommon.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cmath>
+
+typedef SegmentationComparison::LabelImageType ImageType;
+
+const int NX = 60, NY = 40, NZ = 30;
+
+ImageType::Pointer makeImage()
+{
+  ImageType::RegionType region;
+  region.SetSize(0, NX); region.SetSize(1, NY); region.SetSize(2, NZ);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(region);
+  image->Allocate();
+  image->FillBuffer(0);
+
+  double spacing[] = { 0.5, 1.0, 2.0 };
+  image->SetSpacing(spacing);
+  return image;
+}
+
+// Fill a box with a label
+void box(ImageType *image, int x0, int y0, int z0, int x1, int y1, int z1, LabelType label)
+{
+  for(int z = z0; z <= z1; z++)
+    for(int y = y0; y <= y1; y++)
+      for(int x = x0; x <= x1; x++)
+        {
+        ImageType::IndexType idx = {{ x, y, z }};
+        image->SetPixel(idx, label);
+        }
+}
+
+// Fill a ball (in voxel units) with a label
+void ball(ImageType *image, int cx, int cy, int cz, int r, LabelType label)
+{
+  for(int z = cz - r; z <= cz + r; z++)
+    for(int y = cy - r; y <= cy + r; y++)
+      for(int x = cx - r; x <= cx + r; x++)
+        if((x-cx)*(x-cx) + (y-cy)*(y-cy) + (z-cz)*(z-cz) <= r*r)
+          {
+          ImageType::IndexType idx = {{ x, y, z }};
+          image->SetPixel(idx, label);
+          }
+}
+
+int main(int argc, char *argv[])
+{
+  ImageType::Pointer a = makeImage(), b = makeImage();
+
+  // Label 1: a box, shifted by two voxels along x in the second image
+  box(a, 5, 5, 5, 14, 14, 9, 1);
+  box(b, 7, 5, 5, 16, 14, 9, 1);
+
+  // Label 2: the same ball in both images
+  ball(a, 40, 20, 15, 8, 2);
+  ball(b, 40, 20, 15, 8, 2);
+
+  // Label 3: only in the first image, partly over label 4, which is only in
+  // the second image
+  box(a, 2, 30, 20, 10, 35, 25, 3);
+  box(b, 6, 30, 2, 12, 34, 21, 4);
+
+  // Count the label pairs directly
+  SegmentationComparison::ConfusionMap expected;
+  itk::ImageRegionConstIterator<ImageType> ita(a, a->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> itb(b, b->GetBufferedRegion());
+  for(; !ita.IsAtEnd(); ++ita, ++itb)
+    expected[std::make_pair(ita.Get(), itb.Get())]++;
+
+  // Compare with different numbers of threads
+  unsigned int threads[] = { 1, 3, 8 };
+  for(int k = 0; k < 3; k++)
+    {
+    SegmentationComparison cmp;
+    cmp.SetNumberOfThreads(threads[k]);
+    cmp.SetComputeSurfaceDistances(k == 0);
+    cmp.Compute(a, b);
+    TEST_CHECK(cmp.GetConfusion() == expected,
+               "confusion counts differ with " << threads[k] << " threads");
+    }
+
+  SegmentationComparison cmp;
+  cmp.Compute(a, b);
+  const SegmentationComparison::EntryMap &stats = cmp.GetStats();
+  TEST_CHECK(stats.size() == 4, "wrong number of labels");
+
+  // Shifted boxes overlap in 8 of 10 columns
+  const SegmentationComparison::Entry &e1 = stats.find(1)->second;
+  TEST_CHECK(e1.countA == 500 && e1.countB == 500 && e1.overlap == 400, "box counts");
+  TEST_CHECK(fabs(e1.dice - 0.8) < 1e-9, "box dice " << e1.dice);
+  TEST_CHECK(fabs(e1.jaccard - 400.0 / 600.0) < 1e-9, "box jaccard " << e1.jaccard);
+  TEST_CHECK(fabs(e1.volumeA_mm3 - 500.0) < 1e-9, "box volume " << e1.volumeA_mm3);
+
+  // The surfaces are two voxels of 0.5mm apart at most
+  TEST_CHECK(fabs(e1.hausdorff_mm - 1.0) < 1e-5, "box hausdorff " << e1.hausdorff_mm);
+  TEST_CHECK(e1.mean_distance_mm > 0.0 && e1.mean_distance_mm < 1.0, "box mean distance");
+
+  // Identical balls
+  const SegmentationComparison::Entry &e2 = stats.find(2)->second;
+  TEST_CHECK(e2.countA > 0 && e2.countA == e2.countB && e2.dice == 1.0, "ball counts");
+  TEST_CHECK(e2.hausdorff_mm == 0.0 && e2.mean_distance_mm == 0.0, "ball distances");
+
+  // Labels present in one image only
+  const SegmentationComparison::Entry &e3 = stats.find(3)->second;
+  TEST_CHECK(e3.countA == 9 * 6 * 6 && e3.countB == 0 && e3.dice == 0.0, "label in A only");
+  TEST_CHECK(std::isnan(e3.hausdorff_mm), "distance defined for missing label");
+  const SegmentationComparison::Entry &e4 = stats.find(4)->second;
+  TEST_CHECK(e4.countA == 0 && e4.countB == 7 * 5 * 20, "label in B only");
+  TEST_CHECK(cmp.GetConfusion().find(std::make_pair(3, 4))->second == 5 * 5 * 2,
+             "wrong count of label 3 over label 4");
+
+  // Images of different sizes can not be compared
+  ImageType::Pointer c = ImageType::New();
+  ImageType::RegionType rc;
+  rc.SetSize(0, NX); rc.SetSize(1, NY); rc.SetSize(2, NZ - 1);
+  c->SetRegions(rc);
+  c->Allocate();
+  bool thrown = false;
+  try { cmp.Compute(a, c); } catch(std::exception &) { thrown = true; }
+  TEST_CHECK(thrown, "different sizes accepted");
+
+  return EXIT_SUCCESS;
+}
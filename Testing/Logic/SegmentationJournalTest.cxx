@@ -0,0 +1,230 @@
+#include "SegmentationJournal.h"
+#include "RLEImageRegionIterator.h"
+#include "RLERegionOfInterestImageFilter.h"
+#include "LogicTestCommon.h"
+#include <itkImageFileWriter.h>
+#include <itkImageRegionIterator.h>
+#include <itksys/SystemTools.hxx>
+#include <iostream>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+
+typedef itk::Image<LabelType, 3> DenseImageType;
+typedef RLEImage<LabelType> LabelImageType;
+typedef UndoDelta<LabelType> Delta;
+typedef SegmentationJournal::DeltaList DeltaList;
+typedef itk::ImageRegion<3> RegionType;
+
+LabelImageType::Pointer toRLE(DenseImageType *image)
+{
+  typedef itk::RegionOfInterestImageFilter<DenseImageType, LabelImageType> ConverterType;
+  ConverterType::Pointer conv = ConverterType::New();
+  conv->SetInput(image);
+  conv->SetRegionOfInterest(image->GetLargestPossibleRegion());
+  conv->Update();
+  return conv->GetOutput();
+}
+
+// Paint a box with a label and return the delta, same encoding as used by
+// SegmentationUpdateIterator
+Delta *paintBox(LabelImageType *image, const RegionType &region, LabelType label)
+{
+  Delta *delta = new Delta();
+  delta->SetRegion(region);
+  itk::ImageRegionIterator<LabelImageType> it(image, region);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    LabelType old_label = it.Get();
+    delta->Encode((LabelType) (label - old_label));
+    it.Set(label);
+    }
+  delta->FinishEncoding();
+  image->Modified();
+  return delta;
+}
+
+// Apply deltas the way LabelImageWrapper::Undo/Redo does
+void applyDeltas(LabelImageType *image, const DeltaList &deltas, bool reverse)
+{
+  DeltaList ordered(deltas);
+  if(reverse)
+    ordered.reverse();
+
+  for(DeltaList::iterator dit = ordered.begin(); dit != ordered.end(); ++dit)
+    {
+    Delta *delta = *dit;
+    itk::ImageRegionIterator<LabelImageType> lit(image, delta->GetRegion());
+    for(size_t i = 0; i < delta->GetNumberOfRLEs(); i++)
+      {
+      size_t n = delta->GetRLELength(i);
+      LabelType d = delta->GetRLEValue(i);
+      for(size_t j = 0; j < n; j++)
+        {
+        if(d != 0)
+          lit.Set(reverse ? lit.Get() - d : lit.Get() + d);
+        ++lit;
+        }
+      }
+    }
+}
+
+RegionType randomBox(unsigned int dim)
+{
+  RegionType region;
+  for(int d = 0; d < 3; d++)
+    {
+    unsigned int a = rand() % dim, b = rand() % dim;
+    region.SetIndex(d, std::min(a, b));
+    region.SetSize(d, std::max(a, b) - std::min(a, b) + 1);
+    }
+  return region;
+}
+
+unsigned long countDifferences(LabelImageType *a, LabelImageType *b)
+{
+  unsigned long n = 0;
+  itk::ImageRegionConstIterator<LabelImageType> ia(a, a->GetLargestPossibleRegion());
+  itk::ImageRegionConstIterator<LabelImageType> ib(b, b->GetLargestPossibleRegion());
+  for(; !ia.IsAtEnd(); ++ia, ++ib)
+    if(ia.Get() != ib.Get())
+      n++;
+  return n;
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " temp_dir" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::string tempdir = argv[1];
+  itksys::SystemTools::MakeDirectory(tempdir);
+  std::string segfile = tempdir + "/journal_test_seg.nii.gz";
+  srand(12345);
+
+  // Create the "saved" segmentation
+  const unsigned int dim = 24;
+  DenseImageType::Pointer saved = DenseImageType::New();
+  RegionType full;
+  full.SetSize(0, dim); full.SetSize(1, dim); full.SetSize(2, dim);
+  saved->SetRegions(full);
+  saved->Allocate();
+  saved->FillBuffer(0);
+  itk::ImageRegionIterator<DenseImageType> its(saved, full);
+  for(; !its.IsAtEnd(); ++its)
+    if(its.GetIndex()[2] < 4)
+      its.Set(1);
+
+  typedef itk::ImageFileWriter<DenseImageType> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  writer->SetInput(saved);
+  writer->SetFileName(segfile);
+  writer->Update();
+
+  Vector3ui dims(dim, dim, dim);
+
+  // Simulate an editing session with commits, undos and redos
+  LabelImageType::Pointer work = toRLE(saved);
+  SegmentationJournal::Pointer journal = SegmentationJournal::New();
+  TEST_CHECK(journal->Open(segfile, dims, false), "could not open journal");
+
+  std::vector<DeltaList> history;
+  unsigned int position = 0, n_records = 0;
+  for(int step = 0; step < 200; step++)
+    {
+    int action = rand() % 10;
+    if(action < 2 && position > 0)
+      {
+      // Undo
+      position--;
+      applyDeltas(work, history[position], true);
+      journal->AppendCommit(history[position], "undo", true);
+      }
+    else if(action < 3 && position < history.size())
+      {
+      // Redo
+      applyDeltas(work, history[position], false);
+      journal->AppendCommit(history[position], "redo", false);
+      position++;
+      }
+    else
+      {
+      // New commit made of one to three boxes, which discards the redo list
+      for(unsigned int k = position; k < history.size(); k++)
+        for(DeltaList::iterator it = history[k].begin(); it != history[k].end(); ++it)
+          delete *it;
+      history.resize(position);
+
+      DeltaList commit;
+      int n_boxes = 1 + rand() % 3;
+      for(int b = 0; b < n_boxes; b++)
+        commit.push_back(paintBox(work, randomBox(dim), (LabelType) (rand() % 5)));
+      journal->AppendCommit(commit, "paint", false);
+      history.push_back(commit);
+      position++;
+      }
+    n_records++;
+    }
+
+  // Simulate a crash: the journal stays on disk
+  journal->Flush();
+  journal->Close(false);
+
+  TEST_CHECK(SegmentationJournal::GetNumberOfRecoverableRecords(segfile, dims) == n_records,
+             "wrong number of recoverable records");
+
+  // Replay onto the saved segmentation
+  LabelImageType::Pointer recovered = toRLE(saved);
+  unsigned int n_replayed = SegmentationJournal::Replay(segfile, recovered);
+  TEST_CHECK(n_replayed == n_records, "not all records replayed");
+  TEST_CHECK(countDifferences(work, recovered) == 0, "replayed image differs from edited image");
+
+  // A torn record at the end of the journal is ignored
+  std::string jfile = SegmentationJournal::GetJournalFileName(segfile);
+  FILE *f = fopen(jfile.c_str(), "ab");
+  const char torn[] = { 'R', 'C', 'R', 'D', 100, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3 };
+  fwrite(torn, 1, sizeof(torn), f);
+  fclose(f);
+
+  LabelImageType::Pointer recovered2 = toRLE(saved);
+  TEST_CHECK(SegmentationJournal::Replay(segfile, recovered2) == n_records,
+             "torn record not handled");
+  TEST_CHECK(countDifferences(work, recovered2) == 0, "torn record changed replay");
+
+  // A journal does not apply to an image with different dimensions
+  TEST_CHECK(SegmentationJournal::GetNumberOfRecoverableRecords(
+               segfile, Vector3ui(dim, dim, dim + 1)) == 0,
+             "journal accepted for mismatched dimensions");
+
+  // Appending after recovery, then truncating on save
+  TEST_CHECK(journal->Open(segfile, dims, true), "could not reopen journal");
+  DeltaList extra;
+  extra.push_back(paintBox(work, randomBox(dim), 3));
+  journal->AppendCommit(extra, "paint", false);
+  journal->Flush();
+  TEST_CHECK(SegmentationJournal::GetNumberOfRecoverableRecords(segfile, dims) == n_records + 1,
+             "append after recovery failed");
+
+  LabelImageType::Pointer recovered3 = toRLE(saved);
+  SegmentationJournal::Replay(segfile, recovered3);
+  TEST_CHECK(countDifferences(work, recovered3) == 0, "appended record not replayed");
+
+  journal->Truncate();
+  TEST_CHECK(SegmentationJournal::GetNumberOfRecoverableRecords(segfile, dims) == 0,
+             "truncate failed");
+
+  // Normal close deletes the journal
+  journal->Close(true);
+  TEST_CHECK(!itksys::SystemTools::FileExists(jfile.c_str()), "journal not removed");
+
+  // Clean up
+  for(unsigned int k = 0; k < history.size(); k++)
+    for(DeltaList::iterator it = history[k].begin(); it != history[k].end(); ++it)
+      delete *it;
+  delete extra.front();
+
+  return EXIT_SUCCESS;
+}
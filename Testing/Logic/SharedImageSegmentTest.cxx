@@ -0,0 +1,192 @@
+#include "SharedImageSegment.h"
+#include "LogicTestCommon.h"
+#include <itksys/SystemTools.hxx>
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+void writeFile(const std::string &fn, size_t n)
+{
+  std::ofstream out(fn.c_str(), std::ios::binary);
+  for(size_t i = 0; i < n; i++)
+    out.put((char) i);
+}
+
+SharedImageSegment::ImageInfo makeInfo()
+{
+  SharedImageSegment::ImageInfo info;
+  memset(&info, 0, sizeof(info));
+  info.ComponentType = 9;
+  info.NumberOfComponents = 1;
+  info.Size[0] = 100; info.Size[1] = 50; info.Size[2] = 20;
+  for(int i = 0; i < 3; i++)
+    {
+    info.Spacing[i] = 0.5 * (i + 1);
+    info.Origin[i] = -10.0 * i;
+    info.Direction[4 * i] = 1.0;
+    }
+  return info;
+}
+
+#ifndef WIN32
+
+// Run a function in a child process and return its exit code
+template <class TFunc>
+int runInChild(TFunc func)
+{
+  pid_t pid = fork();
+  if(pid == 0)
+    _exit(func());
+
+  int status = 0;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Attach from another process and check the contents
+struct CheckInChild
+{
+  std::string key;
+  const std::vector<float> *expected;
+  bool release;
+
+  int operator()() const
+    {
+    SharedImageSegment seg;
+    if(!seg.Attach(key))
+      return 1;
+    if(seg.GetImageInfo().Size[1] != 50 || seg.GetImageInfo().Spacing[2] != 1.5)
+      return 2;
+    if(seg.GetFileHash() != "hash1" || seg.GetContentDigest() != "digest1")
+      return 3;
+    if(seg.GetDataSize() != expected->size() * sizeof(float)
+       || memcmp(seg.GetData(), &(*expected)[0], seg.GetDataSize()))
+      return 4;
+    if(seg.GetNumberOfUsers() != 2)
+      return 5;
+
+    // Changes to the data are private to this process
+    static_cast<float *>(seg.GetData())[0] = -1.0f;
+
+    // Without releasing, exit as if the process crashed
+    if(!release)
+      _exit(0);
+    return 0;
+    }
+};
+
+// Publish and exit without releasing, as if the process crashed
+struct PublishAndDie
+{
+  std::string key;
+  const std::vector<float> *data;
+
+  int operator()() const
+    {
+    SharedImageSegment *seg = new SharedImageSegment();
+    bool ok = seg->Publish(key, makeInfo(), &(*data)[0], data->size() * sizeof(float),
+                           "hash0", "digest0");
+    return ok ? 0 : 1;
+    }
+};
+
+#endif
+
+int main(int argc, char *argv[])
+{
+  if(argc < 2)
+    {
+    std::cerr << "Usage: " << argv[0] << " temp_dir" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if(!SharedImageSegment::IsSupported())
+    {
+    std::cout << "Shared memory is not supported on this system" << std::endl;
+    return EXIT_SUCCESS;
+    }
+
+#ifndef WIN32
+
+  std::string tempdir = argv[1];
+  itksys::SystemTools::MakeDirectory(tempdir);
+
+  // The key depends on the file and the options
+  std::string fn = tempdir + "/shared_segment_test.bin";
+  writeFile(fn, 1000);
+  std::string key = SharedImageSegment::MakeKey(fn.c_str(), "options");
+  TEST_CHECK(key.size() > 1 && key.size() < 32 && key[0] == '/', "bad key");
+  TEST_CHECK(SharedImageSegment::MakeKey(fn.c_str(), "other") != key, "options not in key");
+  TEST_CHECK(SharedImageSegment::MakeKey((fn + ".missing").c_str(), "").empty(), "missing file");
+
+  // The key is a shortened form of the file hash that validates the segment
+  std::string hash = SharedImageSegment::MakeFileHash(fn.c_str(), "options");
+  TEST_CHECK(hash.size() == 32 && key == "/itksnap-" + hash.substr(0, 20), "bad file hash");
+
+  writeFile(fn, 1001);
+  TEST_CHECK(SharedImageSegment::MakeKey(fn.c_str(), "options") != key, "changed file, same key");
+  key = SharedImageSegment::MakeKey(fn.c_str(), "options");
+
+  std::vector<float> data(100 * 50 * 20);
+  for(size_t i = 0; i < data.size(); i++)
+    data[i] = (float) (i % 1000) * 0.25f;
+
+  // Publish the data
+  SharedImageSegment pub;
+  TEST_CHECK(pub.Publish(key, makeInfo(), &data[0], data.size() * sizeof(float), "hash1", "digest1"),
+             "publish failed");
+  TEST_CHECK(pub.GetNumberOfUsers() == 1, "publisher not counted");
+  TEST_CHECK(!memcmp(pub.GetData(), &data[0], data.size() * sizeof(float)), "published data differ");
+
+  // A segment that is in use can not be published again
+  SharedImageSegment pub2;
+  TEST_CHECK(!pub2.Publish(key, makeInfo(), &data[0], data.size() * sizeof(float), "hash2", "digest2"),
+             "published twice");
+
+  // Another process maps the data, and its changes are not seen here
+  CheckInChild check = { key, &data, true };
+  int rc = runInChild(check);
+  TEST_CHECK(rc == 0, "child process check failed with code " << rc);
+  TEST_CHECK(static_cast<float *>(pub.GetData())[0] == data[0], "child changed the data");
+  TEST_CHECK(pub.GetNumberOfUsers() == 1, "child not removed from users");
+
+  // A process that dies without releasing is no longer counted
+  check.release = false;
+  rc = runInChild(check);
+  TEST_CHECK(rc == 0, "second child process check failed with code " << rc);
+  TEST_CHECK(pub.GetNumberOfUsers() == 1, "dead child still counted");
+
+  // Several users in the same process
+  SharedImageSegment att;
+  TEST_CHECK(att.Attach(key), "attach in same process failed");
+  TEST_CHECK(pub.GetNumberOfUsers() == 2, "wrong number of users");
+
+  // The segment stays while someone uses it, and is removed by the last user
+  pub.Release();
+  TEST_CHECK(att.GetNumberOfUsers() == 1, "wrong number of users after release");
+  att.Release();
+  SharedImageSegment late;
+  TEST_CHECK(!late.Attach(key), "segment not removed by last user");
+
+  // A segment left behind by a crashed publisher is replaced
+  PublishAndDie pad = { key, &data };
+  TEST_CHECK(runInChild(pad) == 0, "child failed to publish");
+  TEST_CHECK(pub.Publish(key, makeInfo(), &data[0], data.size() * sizeof(float), "hash1", "digest1"),
+             "stale segment not replaced");
+  TEST_CHECK(pub.GetFileHash() == "hash1" && pub.GetContentDigest() == "digest1",
+             "stale segment contents");
+  pub.Release();
+  TEST_CHECK(!late.Attach(key), "segment not removed");
+
+#endif
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+#include "IRISSlicer.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkImageRegionIterator.h>
+#include <vector>
+#include <algorithm>
+
+typedef itk::Image<LabelType, 2> SliceType;
+
+// The bounding box of the pixels that differ between two slices
+SliceType::RegionType changedRegion(const std::vector<LabelType> &before, SliceType *after)
+{
+  SliceType::RegionType region = after->GetBufferedRegion();
+  int nx = region.GetSize(0), ny = region.GetSize(1);
+  int x0 = nx, y0 = ny, x1 = -1, y1 = -1;
+  for(int y = 0; y < ny; y++)
+    for(int x = 0; x < nx; x++)
+      if(before[y * nx + x] != after->GetBufferPointer()[y * nx + x])
+        {
+        x0 = std::min(x0, x); x1 = std::max(x1, x);
+        y0 = std::min(y0, y); y1 = std::max(y1, y);
+        }
+
+  SliceType::RegionType changed;
+  if(x1 >= 0)
+    {
+    changed.SetIndex(0, x0); changed.SetSize(0, x1 + 1 - x0);
+    changed.SetIndex(1, y0); changed.SetSize(1, y1 + 1 - y0);
+    }
+  return changed;
+}
+
+// Check that the region mapped by the slicer is the region of the slice that
+// changes when a box in the image is edited
+template <class TImage>
+int testSlicer()
+{
+  typedef IRISSlicer<TImage, SliceType, TImage> SlicerType;
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(makeRegion(0, 0, 0, 13, 11, 7));
+  image->Allocate();
+  image->FillBuffer(0);
+
+  // Slice along each axis, traversing the pixels and lines both ways
+  for(int axis = 0; axis < 3; axis++)
+    {
+    for(int dir = 0; dir < 4; dir++)
+      {
+      typename SlicerType::Pointer slicer = SlicerType::New();
+      slicer->SetInput(image);
+      slicer->SetSliceDirectionImageAxis(axis);
+      slicer->SetPixelDirectionImageAxis((axis + 1) % 3);
+      slicer->SetLineDirectionImageAxis((axis + 2) % 3);
+      slicer->SetPixelTraverseForward((dir & 1) != 0);
+      slicer->SetLineTraverseForward((dir & 2) != 0);
+      slicer->SetSliceIndex(3);
+      slicer->Update();
+
+      SliceType *slice = slicer->GetOutput();
+      std::vector<LabelType> before(slice->GetBufferPointer(),
+                                slice->GetBufferPointer()
+                                + slice->GetBufferedRegion().GetNumberOfPixels());
+
+      // Edit a box that passes through the slice
+      itk::ImageRegion<3> box = makeRegion(2, 1, 1, 4, 3, 5);
+      itk::ImageRegionIterator<TImage> it(image, box);
+      for(; !it.IsAtEnd(); ++it)
+        it.Set(it.Get() + 1);
+      image->Modified();
+      slicer->Update();
+
+      SliceType::RegionType mapped;
+      TEST_CHECK(slicer->CopyInputRegionToOutputRegion(mapped, box),
+                 "box not mapped into slice along axis " << axis);
+      TEST_CHECK(mapped == changedRegion(before, slice),
+                 "wrong region along axis " << axis << " with directions " << dir);
+
+      // A box next to the slice is not mapped
+      TEST_CHECK(!slicer->CopyInputRegionToOutputRegion(mapped, makeRegion(
+                   axis == 0 ? 4 : 0, axis == 1 ? 4 : 0, axis == 2 ? 4 : 0, 2, 2, 2)),
+                 "box outside of the slice mapped along axis " << axis);
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int, char *[])
+{
+  // Segmentations are stored run-length encoded, and have their own slicer
+  if(testSlicer< itk::Image<LabelType, 3> >() != EXIT_SUCCESS
+     || testSlicer<LabelImageWrapper::ImageType>() != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,119 @@
+#include "SNAPLevelSetDriver.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+typedef itk::Image<float, 3> FloatImage;
+typedef itk::Image<short, 3> ShortImage;
+
+// A speed image that expands the contour everywhere
+ShortImage::Pointer makeSpeed(const itk::ImageRegion<3> &region, double x0)
+{
+  ShortImage::Pointer speed = ShortImage::New();
+  speed->SetRegions(region);
+  ShortImage::PointType origin;
+  origin[0] = x0; origin[1] = 0.0; origin[2] = 0.0;
+  speed->SetOrigin(origin);
+  speed->Allocate();
+  speed->FillBuffer(0x3fff);
+  return speed;
+}
+
+// Whether any voxel inside the contour lies outside of a range along x
+bool hasInsideVoxelOutsideOfRange(FloatImage *phi, long xmin, long xmax)
+{
+  itk::ImageRegionIteratorWithIndex<FloatImage> it(phi, phi->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    if(it.Get() <= 0 && (it.GetIndex()[0] < xmin || it.GetIndex()[0] > xmax))
+      return true;
+  return false;
+}
+
+int main(int, char *[])
+{
+  // A ball in the middle of a region that is narrow along x, so the contour
+  // reaches the faces along x long before the others
+  itk::ImageRegion<3> region = makeRegion(0, 0, 0, 16, 30, 30);
+  FloatImage::Pointer phi = FloatImage::New();
+  phi->SetRegions(region);
+  phi->Allocate();
+  itk::ImageRegionIteratorWithIndex<FloatImage> itPhi(phi, region);
+  for(; !itPhi.IsAtEnd(); ++itPhi)
+    {
+    FloatImage::IndexType idx = itPhi.GetIndex();
+    double x = idx[0] - 7.5, y = idx[1] - 14.5, z = idx[2] - 14.5;
+    itPhi.Set((float) std::max(-4.0, std::min(4.0, sqrt(x * x + y * y + z * z) - 3.0)));
+    }
+
+  SnakeParameters parms = SnakeParameters::GetDefaultInOutParameters();
+  parms.SetSolver(SnakeParameters::PARALLEL_SPARSE_FIELD_SOLVER);
+  ShortImage::Pointer speed = makeSpeed(region, 0.0);
+  SNAPLevelSetDriver3d driver(phi, speed, parms);
+
+  TEST_CHECK(driver.GetBoundaryFacesReachedByActiveLayer(2) == 0,
+             "initial contour reported at the edge of the region");
+
+  // Evolve until the contour reaches the edge of the region
+  unsigned int faces = 0;
+  while(!faces && driver.GetElapsedIterations() < 200)
+    {
+    driver.Run(5);
+    faces = driver.GetBoundaryFacesReachedByActiveLayer(2);
+    }
+  TEST_CHECK(faces == 3, "expected the contour to reach both faces along x, got "
+             << faces << " after " << driver.GetElapsedIterations() << " iterations");
+
+  // Keep a copy of the contour before the region grows
+  std::vector<float> before;
+  itk::ImageRegionIteratorWithIndex<FloatImage> itOld(driver.GetCurrentState(), region);
+  for(; !itOld.IsAtEnd(); ++itOld)
+    before.push_back(itOld.Get());
+  unsigned int nIter = driver.GetElapsedIterations();
+
+  // Grow the region by 10 voxels on both sides along x
+  itk::ImageRegion<3> grown = makeRegion(0, 0, 0, 36, 30, 30);
+  ShortImage::Pointer speedGrown = makeSpeed(grown, -10.0);
+  driver.ResampleToSpeedImage(speedGrown);
+
+  FloatImage *state = driver.GetCurrentState();
+  TEST_CHECK(state->GetBufferedRegion() == grown, "level set not resampled to the new region");
+  TEST_CHECK(driver.GetElapsedIterations() == nIter, "iteration count not carried over");
+  TEST_CHECK(driver.GetBoundaryFacesReachedByActiveLayer(2) == 0,
+             "contour still at the edge of the grown region");
+
+  // Away from the active layer, every voxel of the old region keeps its side
+  // of the contour, and the new voxels are outside
+  itk::ImageRegionIteratorWithIndex<FloatImage> itNew(state, grown);
+  for(; !itNew.IsAtEnd(); ++itNew)
+    {
+    FloatImage::IndexType idx = itNew.GetIndex();
+    idx[0] -= 10;
+    if(!region.IsInside(idx))
+      {
+      TEST_CHECK(itNew.Get() > 0, "new voxel " << itNew.GetIndex() << " inside the contour");
+      continue;
+      }
+
+    float old = before[idx[0] + 16 * (idx[1] + 30 * idx[2])];
+    TEST_CHECK(old > -0.5 || itNew.Get() <= 0,
+               "voxel " << itNew.GetIndex() << " moved outside of the contour");
+    TEST_CHECK(old < 0.5 || itNew.Get() > 0,
+               "voxel " << itNew.GetIndex() << " moved inside of the contour");
+    }
+
+  // The evolution continues past the initial region
+  while(!hasInsideVoxelOutsideOfRange(state, 10, 25) && driver.GetElapsedIterations() < nIter + 200)
+    {
+    driver.Run(5);
+    state = driver.GetCurrentState();
+    }
+  TEST_CHECK(hasInsideVoxelOutsideOfRange(state, 10, 25),
+             "contour did not grow past the initial region");
+
+  return EXIT_SUCCESS;
+}
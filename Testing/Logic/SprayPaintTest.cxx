@@ -0,0 +1,113 @@
+#include "LogicTestCommon.h"
+#include <itkImageRegionIteratorWithIndex.h>
+#include <vector>
+
+typedef LabelImageWrapper::ImageType ImageType;
+typedef SegmentationVoxelSetUpdate::VoxelSet VoxelSet;
+
+const int NX = 12, NY = 9, NZ = 7;
+
+size_t offset(const itk::Index<3> &idx)
+{
+  return idx[0] + NX * (idx[1] + NY * idx[2]);
+}
+
+// Check that the image matches the expected labels
+bool matches(ImageType *image, const std::vector<LabelType> &expected)
+{
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    if(it.Get() != expected[offset(it.GetIndex())])
+      return false;
+  return true;
+}
+
+int main(int, char *[])
+{
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(makeRegion(0, 0, 0, NX, NY, NZ));
+  image->Allocate();
+  image->FillBuffer(0);
+
+  LabelImageWrapper::Pointer seg = LabelImageWrapper::New();
+  seg->SetImage(image);
+
+  // Some existing labels under the spray
+  seg->StoreUndoPoint("box", paint(image, makeRegion(2, 1, 1, 6, 5, 4), 2));
+  std::vector<LabelType> original(NX * NY * NZ, 0);
+  for(int z = 1; z < 5; z++)
+    for(int y = 1; y < 6; y++)
+      for(int x = 2; x < 8; x++)
+        original[x + NX * (y + NY * z)] = 2;
+  TEST_CHECK(matches(image, original), "box not painted");
+
+  // Voxels on several y and z lines, where the x extent of later lines is
+  // to the left of earlier ones, and a voxel that is listed twice
+  int coords[][3] = {
+    { 9, 1, 1 }, { 10, 1, 1 }, { 3, 2, 1 }, { 11, 2, 1 }, { 0, 6, 1 },
+    { 5, 0, 3 }, { 1, 4, 3 }, { 4, 4, 3 }, { 8, 8, 3 }, { 2, 3, 5 },
+    { 10, 1, 1 }, { 6, 7, 6 }, { 0, 8, 6 }
+  };
+  int nc = sizeof(coords) / sizeof(coords[0]);
+
+  VoxelSet voxels;
+  for(int i = 0; i < nc; i++)
+    {
+    itk::Index<3> idx = {{ coords[i][0], coords[i][1], coords[i][2] }};
+    voxels.insert(idx);
+    }
+  TEST_CHECK(voxels.size() == (size_t) nc - 1, "duplicate voxel not merged");
+
+  // The set visits the voxels in the order in which they are stored
+  size_t last = 0;
+  for(VoxelSet::const_iterator it = voxels.begin(); it != voxels.end(); ++it)
+    {
+    TEST_CHECK(it == voxels.begin() || offset(*it) > last, "voxels not in image order");
+    last = offset(*it);
+    }
+
+  // Paint over the box label only. Voxels with label 0 are left alone
+  unsigned long n_changed = 0, n_expected = 0;
+  std::vector<LabelType> painted(original);
+  for(VoxelSet::const_iterator it = voxels.begin(); it != voxels.end(); ++it)
+    if(painted[offset(*it)] == 2)
+      {
+      painted[offset(*it)] = 5;
+      n_expected++;
+      }
+
+  SegmentationVoxelSetUpdate::UndoDelta *delta = SegmentationVoxelSetUpdate::Paint(
+        image, voxels, 5, DrawOverFilter(PAINT_OVER_ONE, 2), n_changed);
+  TEST_CHECK(delta && n_expected == 2 && n_changed == n_expected,
+             "wrong number of voxels painted over one: " << n_changed);
+  seg->StoreUndoPoint("spray over one", delta);
+  TEST_CHECK(matches(image, painted), "wrong labels after painting over one");
+
+  // Paint over all labels
+  std::vector<LabelType> sprayed(painted);
+  for(VoxelSet::const_iterator it = voxels.begin(); it != voxels.end(); ++it)
+    sprayed[offset(*it)] = 7;
+
+  delta = SegmentationVoxelSetUpdate::Paint(
+        image, voxels, 7, DrawOverFilter(PAINT_OVER_ALL, 0), n_changed);
+  TEST_CHECK(delta && n_changed == voxels.size(), "wrong number of voxels painted: " << n_changed);
+  seg->StoreUndoPoint("spray", delta);
+  TEST_CHECK(matches(image, sprayed), "wrong labels after painting over all");
+
+  // Painting the same voxels again changes nothing and makes no delta
+  delta = SegmentationVoxelSetUpdate::Paint(
+        image, voxels, 7, DrawOverFilter(PAINT_OVER_ALL, 0), n_changed);
+  TEST_CHECK(!delta && n_changed == 0, "repainting changed the image");
+
+  // Undo and redo restore the labels exactly
+  seg->Undo();
+  TEST_CHECK(matches(image, painted), "wrong labels after undo");
+  seg->Undo();
+  TEST_CHECK(matches(image, original), "wrong labels after second undo");
+  seg->Redo();
+  TEST_CHECK(matches(image, painted), "wrong labels after redo");
+  seg->Redo();
+  TEST_CHECK(matches(image, sprayed), "wrong labels after second redo");
+
+  return EXIT_SUCCESS;
+}
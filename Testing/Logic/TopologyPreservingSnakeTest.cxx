@@ -0,0 +1,209 @@
+#include "DigitalTopology.h"
+#include "SNAPLevelSetDriver.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <itkBinaryThresholdImageFilter.h>
+#include <itkConnectedComponentImageFilter.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+typedef itk::Image<float, 3> FloatImage;
+typedef itk::Image<short, 3> ShortImage;
+typedef itk::Image<unsigned char, 3> ByteImage;
+typedef itk::Image<unsigned int, 3> LabelImage;
+
+// Neighborhood mask from a list of offsets
+unsigned int makeMask(const int offsets[][3], int n, unsigned int dim)
+{
+  unsigned int mask = 0;
+  for(int i = 0; i < n; i++)
+    mask |= 1u << DigitalTopology::GetNeighborBit(offsets[i], dim);
+  return mask;
+}
+
+// A level set of the given size, from a signed distance function
+template <class TFunction>
+FloatImage::Pointer makeLevelSet(int nx, int ny, int nz, TFunction f)
+{
+  FloatImage::Pointer image = FloatImage::New();
+  FloatImage::RegionType region;
+  region.SetSize(0, nx); region.SetSize(1, ny); region.SetSize(2, nz);
+  image->SetRegions(region);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<FloatImage> it(image, region);
+  for(; !it.IsAtEnd(); ++it)
+    {
+    FloatImage::IndexType idx = it.GetIndex();
+    it.Set((float) f(idx[0] - 0.5 * (nx - 1), idx[1] - 0.5 * (ny - 1), idx[2] - 0.5 * (nz - 1)));
+    }
+  return image;
+}
+
+// Two balls with a small gap between them
+double twoBalls(double x, double y, double z)
+{
+  double d1 = sqrt((x - 8.5) * (x - 8.5) + y * y + z * z) - 6.0;
+  double d2 = sqrt((x + 8.5) * (x + 8.5) + y * y + z * z) - 6.0;
+  return std::min(d1, d2);
+}
+
+// A torus around the z axis
+double torus(double x, double y, double z)
+{
+  double r = sqrt(x * x + y * y) - 9.0;
+  return sqrt(r * r + z * z) - 3.5;
+}
+
+// Euler characteristic of the union of the closed voxel cubes with phi <= 0,
+// i.e., components - tunnels + cavities with 26/6 connectivity
+int eulerCharacteristic(FloatImage *phi)
+{
+  FloatImage::SizeType size = phi->GetBufferedRegion().GetSize();
+  int n[3] = { (int) size[0], (int) size[1], (int) size[2] };
+  int chi = 0;
+
+  // Cells of the cubical complex in doubled coordinates: odd coordinates
+  // are voxel centers, even coordinates are voxel boundaries
+  for(int c = 0; c <= 2 * n[2]; c++)
+    for(int b = 0; b <= 2 * n[1]; b++)
+      for(int a = 0; a <= 2 * n[0]; a++)
+        {
+        int e[3] = { a, b, c }, lo[3], hi[3], dim = 0;
+        for(int d = 0; d < 3; d++)
+          {
+          if(e[d] % 2)
+            {
+            lo[d] = hi[d] = (e[d] - 1) / 2;
+            dim++;
+            }
+          else
+            {
+            lo[d] = std::max(e[d] / 2 - 1, 0);
+            hi[d] = std::min(e[d] / 2, n[d] - 1);
+            }
+          }
+
+        bool inside = false;
+        FloatImage::IndexType idx;
+        for(idx[2] = lo[2]; idx[2] <= hi[2] && !inside; idx[2]++)
+          for(idx[1] = lo[1]; idx[1] <= hi[1] && !inside; idx[1]++)
+            for(idx[0] = lo[0]; idx[0] <= hi[0] && !inside; idx[0]++)
+              inside = phi->GetPixel(idx) <= 0.0f;
+
+        if(inside)
+          chi += (dim % 2) ? -1 : 1;
+        }
+
+  return chi;
+}
+
+// Number of 26-connected components and voxels of the segmentation
+int countComponents(FloatImage *phi, int &volume)
+{
+  typedef itk::BinaryThresholdImageFilter<FloatImage, ByteImage> ThresholdType;
+  ThresholdType::Pointer thresh = ThresholdType::New();
+  thresh->SetInput(phi);
+  thresh->SetUpperThreshold(0.0f);
+  thresh->SetInsideValue(1);
+  thresh->SetOutsideValue(0);
+  thresh->Update();
+
+  volume = 0;
+  ByteImage *seg = thresh->GetOutput();
+  for(size_t i = 0; i < seg->GetBufferedRegion().GetNumberOfPixels(); i++)
+    volume += seg->GetBufferPointer()[i];
+
+  typedef itk::ConnectedComponentImageFilter<ByteImage, LabelImage> ComponentType;
+  ComponentType::Pointer comp = ComponentType::New();
+  comp->SetInput(seg);
+  comp->SetFullyConnected(true);
+  comp->Update();
+  return (int) comp->GetObjectCount();
+}
+
+// Expand the level set with a constant speed, with and without the topology
+// constraint, and check that only the constrained evolution keeps the topology
+int testEvolution(const char *name, FloatImage *init, int nIter)
+{
+  int v0, c0 = countComponents(init, v0), chi0 = eulerCharacteristic(init);
+
+  ShortImage::Pointer speed = ShortImage::New();
+  speed->SetRegions(init->GetBufferedRegion());
+  speed->Allocate();
+  speed->FillBuffer(0x3fff);
+
+  SnakeParameters parms = SnakeParameters::GetDefaultInOutParameters();
+  parms.SetSolver(SnakeParameters::PARALLEL_SPARSE_FIELD_SOLVER);
+
+  for(int preserve = 0; preserve < 2; preserve++)
+    {
+    // The driver evolves the initialization image in place
+    FloatImage::Pointer phi = FloatImage::New();
+    phi->SetRegions(init->GetBufferedRegion());
+    phi->Allocate();
+    std::copy(init->GetBufferPointer(),
+              init->GetBufferPointer() + init->GetBufferedRegion().GetNumberOfPixels(),
+              phi->GetBufferPointer());
+
+    parms.SetPreserveTopology(preserve != 0);
+    SNAPLevelSetDriver3d driver(phi, speed, parms);
+    driver.Run(nIter);
+
+    FloatImage *state = driver.GetCurrentState();
+    int v, c = countComponents(state, v), chi = eulerCharacteristic(state);
+
+    if(preserve)
+      {
+      TEST_CHECK(c == c0 && chi == chi0, name << ": topology changed");
+      TEST_CHECK(v > 1.5 * v0, name << ": the contour did not evolve");
+      }
+    else
+      {
+      TEST_CHECK(c != c0 || chi != chi0, name << ": topology did not change without the constraint");
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+int main(int, char *[])
+{
+  // Simple points in 3D
+  const int one[][3] = { {-1, 0, 0} };
+  const int bridge[][3] = { {-1, 0, 0}, {1, 0, 0} };
+  const int corners[][3] = { {-1, -1, -1}, {1, 1, 1} };
+  const int ring[][3] = { {-1,-1,0}, {0,-1,0}, {1,-1,0}, {-1,0,0}, {1,0,0}, {-1,1,0}, {0,1,0}, {1,1,0} };
+  const int lid[][3] = { {-1,-1,-1}, {0,-1,-1}, {1,-1,-1}, {-1,0,-1}, {0,0,-1}, {1,0,-1}, {-1,1,-1}, {0,1,-1}, {1,1,-1} };
+
+  TEST_CHECK(!DigitalTopology::IsSimplePoint(0, 3), "isolated point is simple");
+  TEST_CHECK(!DigitalTopology::IsSimplePoint(0x7ffffff, 3), "interior point is simple");
+  TEST_CHECK(DigitalTopology::IsSimplePoint(makeMask(one, 1, 3), 3), "end point is not simple");
+  TEST_CHECK(DigitalTopology::IsSimplePoint(makeMask(lid, 9, 3), 3), "surface point is not simple");
+  TEST_CHECK(!DigitalTopology::IsSimplePoint(makeMask(bridge, 2, 3), 3), "bridge is simple");
+  TEST_CHECK(DigitalTopology::GetObjectNumber(makeMask(corners, 2, 3), 3) == 2, "wrong object number");
+  TEST_CHECK(!DigitalTopology::IsSimplePoint(makeMask(ring, 8, 3), 3), "hole filling point is simple");
+  TEST_CHECK(DigitalTopology::GetBackgroundNumber(makeMask(ring, 8, 3), 3) == 2,
+             "wrong background number");
+
+  // Removing the center of a closed box opens a cavity
+  TEST_CHECK(DigitalTopology::GetBackgroundNumber(0x7ffffff, 3) == 0, "cavity not detected");
+
+  // Simple points in 2D
+  TEST_CHECK(!DigitalTopology::IsSimplePoint(makeMask(ring, 8, 2), 2), "2D ring center is simple");
+  TEST_CHECK(DigitalTopology::IsSimplePoint(makeMask(one, 1, 2), 2), "2D end point is not simple");
+  TEST_CHECK(!DigitalTopology::IsSimplePoint(makeMask(bridge, 2, 2), 2), "2D bridge is simple");
+
+  // Two balls merge, and the hole of a torus closes, unless the topology is
+  // preserved
+  if(testEvolution("Two balls", makeLevelSet(40, 20, 20, twoBalls), 150) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+  if(testEvolution("Torus", makeLevelSet(32, 32, 16, torus), 150) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+#include "NonOrthogonalSlicer.h"
+#include "LogicTestCommon.h"
+#include <itkImage.h>
+#include <itkAffineTransform.h>
+#include <itkCompositeTransform.h>
+#include <itkDisplacementFieldTransform.h>
+#include <itkResampleImageFilter.h>
+#include <itkImageRegionIteratorWithIndex.h>
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+
+typedef itk::Image<float, 3> FloatImage;
+typedef itk::Image<float, 2> SliceImage;
+typedef itk::AffineTransform<double, 3> AffineTransform;
+typedef itk::DisplacementFieldTransform<double, 3> WarpTransform;
+typedef WarpTransform::DisplacementFieldType FieldImage;
+typedef itk::CompositeTransform<double, 3> CompositeTransform;
+typedef itk::Transform<double, 3, 3> TransformBase;
+
+// Set up the geometry of an image with an oblique direction
+template <class TImage>
+typename TImage::Pointer makeImage(const int *size, const double *spacing,
+                                   const double *origin, double angle)
+{
+  typename TImage::Pointer image = TImage::New();
+  typename TImage::RegionType region;
+  typename TImage::SpacingType sp;
+  typename TImage::PointType org;
+  for(int d = 0; d < 3; d++)
+    {
+    region.SetSize(d, size[d]);
+    sp[d] = spacing[d];
+    org[d] = origin[d];
+    }
+  image->SetRegions(region);
+  image->SetSpacing(sp);
+  image->SetOrigin(org);
+
+  typename TImage::DirectionType dir;
+  double c = cos(angle), s = sin(angle);
+  dir.SetIdentity();
+  dir(0,0) = c; dir(0,2) = -s; dir(2,0) = s; dir(2,2) = c;
+  image->SetDirection(dir);
+  return image;
+}
+
+int main(int, char *[])
+{
+  srand(12345);
+
+  // The image being sliced
+  int in_size[] = { 48, 40, 36 };
+  double in_spacing[] = { 1.1, 0.9, 1.3 };
+  double in_origin[] = { -10.0, -4.0, -8.0 };
+  FloatImage::Pointer image = makeImage<FloatImage>(in_size, in_spacing, in_origin, 0.2);
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex<FloatImage> it(image, image->GetBufferedRegion());
+  for(; !it.IsAtEnd(); ++it)
+    {
+    FloatImage::IndexType idx = it.GetIndex();
+    it.Set(100.0 * sin(idx[0] * 0.3) * cos(idx[1] * 0.2) + idx[2] * 3.0 + (rand() % 100) * 0.1);
+    }
+
+  // The reference space is a single oblique slice through the image
+  int ref_size[] = { 64, 56, 1 };
+  double ref_spacing[] = { 0.8, 0.75, 1.0 };
+  double ref_origin[] = { -12.0, -6.0, 14.0 };
+  FloatImage::Pointer reference = makeImage<FloatImage>(ref_size, ref_spacing, ref_origin, -0.3);
+
+  // The displacement field covers part of the slice, so that some of the
+  // slice is outside of the field and is only mapped by the affine
+  int fld_size[] = { 36, 30, 8 };
+  double fld_spacing[] = { 1.0, 1.2, 1.5 };
+  double fld_origin[] = { -4.0, -2.0, 8.0 };
+  FieldImage::Pointer field = makeImage<FieldImage>(fld_size, fld_spacing, fld_origin, -0.1);
+  field->Allocate();
+  itk::ImageRegionIteratorWithIndex<FieldImage> itf(field, field->GetBufferedRegion());
+  for(; !itf.IsAtEnd(); ++itf)
+    {
+    FieldImage::IndexType idx = itf.GetIndex();
+    FieldImage::PixelType u;
+    u[0] = 2.5 * sin(idx[0] * 0.2);
+    u[1] = 1.5 * cos(idx[1] * 0.15);
+    u[2] = 1.0 * sin((idx[0] + idx[1]) * 0.1);
+    itf.Set(u);
+    }
+
+  // The warp is applied first, and the affine second
+  AffineTransform::Pointer affine = AffineTransform::New();
+  AffineTransform::OutputVectorType axis, offset;
+  axis[0] = 0.3; axis[1] = 0.4; axis[2] = 0.9;
+  offset[0] = 1.2; offset[1] = -0.7; offset[2] = 0.9;
+  affine->Rotate3D(axis, 0.1);
+  affine->Translate(offset);
+
+  WarpTransform::Pointer warp = WarpTransform::New();
+  warp->SetDisplacementField(field);
+
+  CompositeTransform::Pointer comp = CompositeTransform::New();
+  comp->AddTransform(affine);
+  comp->AddTransform(warp);
+
+  // Resample with ITK
+  typedef itk::ResampleImageFilter<FloatImage, FloatImage> ITKFilter;
+  ITKFilter::Pointer fi = ITKFilter::New();
+  fi->SetInput(image);
+  fi->SetTransform(comp);
+  fi->SetOutputParametersFromImage(reference);
+  fi->Update();
+
+  // Slice with the oblique slicer
+  typedef NonOrthogonalSlicer<FloatImage, SliceImage> SlicerType;
+  SlicerType::Pointer slicer = SlicerType::New();
+  slicer->SetInput(image);
+  slicer->SetReferenceImage(reference);
+  slicer->SetTransform(comp.GetPointer());
+  slicer->Update();
+
+  // Compare the voxels that map inside of the image, away from the edges,
+  // where the two filters treat the boundary differently
+  int n_compared = 0, n_diff = 0, n_warped = 0;
+  FloatImage *a = fi->GetOutput();
+  SliceImage *b = slicer->GetOutput();
+  for(int y = 0; y < ref_size[1]; y++)
+    {
+    for(int x = 0; x < ref_size[0]; x++)
+      {
+      FloatImage::IndexType idx3 = {{ x, y, 0 }};
+      SliceImage::IndexType idx2 = {{ x, y }};
+
+      FloatImage::PointType p, q;
+      reference->TransformIndexToPhysicalPoint(idx3, p);
+      q = comp->TransformPoint(p);
+
+      itk::ContinuousIndex<double, 3> cix;
+      image->TransformPhysicalPointToContinuousIndex(q, cix);
+      bool inside = true;
+      for(int d = 0; d < 3; d++)
+        if(cix[d] < 1e-3 || cix[d] > in_size[d] - 1 - 1e-3)
+          inside = false;
+      if(!inside)
+        continue;
+
+      n_compared++;
+      if(q.EuclideanDistanceTo(affine->TransformPoint(p)) > 0.1)
+        n_warped++;
+      if(fabs(a->GetPixel(idx3) - b->GetPixel(idx2)) > 1e-2)
+        n_diff++;
+      }
+    }
+
+  TEST_CHECK(n_compared > ref_size[0] * ref_size[1] / 4, "slice mostly outside of the image");
+  TEST_CHECK(n_warped > 0 && n_warped < n_compared, "field does not partially cover the slice");
+  TEST_CHECK(n_diff == 0, "slicer differs from ITK");
+
+  // The slicer relies on the category to tell warps from affine transforms
+  TEST_CHECK(comp->GetTransformCategory() != TransformBase::Linear, "warp reported as linear");
+
+  return EXIT_SUCCESS;
+}